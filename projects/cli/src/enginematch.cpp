@@ -24,12 +24,14 @@
 #include <tournament.h>
 #include <gamemanager.h>
 #include <sprt.h>
+#include <enginelog.h>
 
 
 EngineMatch::EngineMatch(Tournament* tournament, QObject* parent)
 	: QObject(parent),
 	  m_tournament(tournament),
 	  m_debug(false),
+	  m_engineLog(nullptr),
 	  m_ratingInterval(0),
 	  m_bookMode(OpeningBook::Ram)
 {
@@ -41,6 +43,15 @@ EngineMatch::EngineMatch(Tournament* tournament, QObject* parent)
 EngineMatch::~EngineMatch()
 {
 	qDeleteAll(m_books);
+
+	if (m_engineLog != nullptr)
+	{
+		m_engineLog->finish();
+		if (m_engineLog->droppedCount() > 0)
+			qWarning("%u engine log lines were dropped",
+				 m_engineLog->droppedCount());
+		delete m_engineLog;
+	}
 }
 
 OpeningBook* EngineMatch::addOpeningBook(const QString& fileName)
@@ -75,6 +86,16 @@ void EngineMatch::start()
 	if (m_debug)
 		connect(m_tournament->gameManager(), SIGNAL(debugMessage(QString)),
 			this, SLOT(print(QString)));
+	if (m_engineLog != nullptr)
+	{
+		// With -debug the lines are printed as well as logged
+		m_engineLog->setEchoEnabled(m_debug);
+		if (!m_engineLog->activate())
+		{
+			delete m_engineLog;
+			m_engineLog = nullptr;
+		}
+	}
 
 	QMetaObject::invokeMethod(m_tournament, "start", Qt::QueuedConnection);
 }
@@ -89,6 +110,12 @@ void EngineMatch::setDebugMode(bool debug)
 	m_debug = debug;
 }
 
+void EngineMatch::setEngineLog(EngineLog* log)
+{
+	delete m_engineLog;
+	m_engineLog = log;
+}
+
 void EngineMatch::setRatingInterval(int interval)
 {
 	Q_ASSERT(interval >= 0);
@@ -197,10 +224,19 @@ void EngineMatch::onGameFinished(ChessGame* game, int number)
 
 void EngineMatch::onTournamentFinished()
 {
+	m_tournament->waitForRatings();
 	if (m_ratingInterval == 0
 	||  m_tournament->finishedGameCount() % m_ratingInterval != 0)
 		printRanking();
 
+	QString usage = m_tournament->resourceUsage();
+	if (!usage.isEmpty())
+		qInfo("%s", qUtf8Printable(usage));
+
+	QString nps = m_tournament->npsStatistics();
+	if (!nps.isEmpty())
+		qInfo("%s", qUtf8Printable(nps));
+
 	QString error = m_tournament->errorString();
 	if (!error.isEmpty())
 		qWarning("%s", qUtf8Printable(error));
@@ -219,4 +255,8 @@ void EngineMatch::print(const QString& msg)
 void EngineMatch::printRanking()
 {
 	qInfo("%s", qUtf8Printable(m_tournament->results()));
+
+	QString ratings = m_tournament->ratingTable();
+	if (!ratings.isEmpty())
+		qInfo("%s", qUtf8Printable(ratings));
 }
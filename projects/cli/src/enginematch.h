@@ -28,6 +28,7 @@
 class ChessGame;
 class OpeningBook;
 class Tournament;
+class EngineLog;
 
 
 class EngineMatch : public QObject
@@ -40,6 +41,7 @@ class EngineMatch : public QObject
 
 		OpeningBook* addOpeningBook(const QString& fileName);
 		void setDebugMode(bool debug);
+		void setEngineLog(EngineLog* log);
 		void setRatingInterval(int interval);
 		void setBookMode(OpeningBook::AccessMode mode);
 
@@ -62,6 +64,7 @@ class EngineMatch : public QObject
 
 
 		bool m_debug;
+		EngineLog* m_engineLog;
 		int m_ratingInterval;
 		OpeningBook::AccessMode m_bookMode;
 		QMap<QString, OpeningBook*> m_books;
@@ -26,6 +26,11 @@
 #include <QFile>
 #include <QMetaType>
 #include <QSysInfo>
+#include <QProcess>
+#include <QElapsedTimer>
+#include <QRegularExpression>
+#include <QFileInfo>
+#include <QTemporaryDir>
 
 #include <mersenne.h>
 #include <enginemanager.h>
@@ -33,11 +38,23 @@
 #include <gamemanager.h>
 #include <tournament.h>
 #include <tournamentfactory.h>
+#include <gauntlettournament.h>
+#include <roundrobintournament.h>
 #include <board/boardfactory.h>
+#include <board/board.h>
 #include <enginefactory.h>
 #include <enginetextoption.h>
 #include <openingsuite.h>
 #include <sprt.h>
+#include <npsmonitor.h>
+#include <ratingsolver.h>
+#include <enginelog.h>
+#include <gamewriter.h>
+#include <gzipfile.h>
+#include <pgnstream.h>
+#include <pgngameentry.h>
+#include <positionindex.h>
+#include <polyglotbook.h>
 #include <board/syzygytablebase.h>
 #include <board/result.h>
 
@@ -236,6 +253,81 @@ bool parseEngine(const QStringList& args, EngineData& data)
 	return true;
 }
 
+quint64 perft(Chess::Board* board, int depth)
+{
+	const auto moves = board->legalMoves();
+	if (depth <= 1)
+		return moves.size();
+
+	quint64 nodeCount = 0;
+	for (const auto& move : moves)
+	{
+		board->makeMove(move);
+		nodeCount += perft(board, depth - 1);
+		board->undoMove();
+	}
+
+	return nodeCount;
+}
+
+// Returns the move generation speed of this machine in nodes per second
+double boardBenchSpeed()
+{
+	Chess::Board* board = Chess::BoardFactory::create("standard");
+	Q_ASSERT(board != nullptr);
+	board->reset();
+
+	QElapsedTimer timer;
+	timer.start();
+	quint64 nodes = 0;
+	do
+		nodes += perft(board, 4);
+	while (timer.elapsed() < 3000);
+
+	delete board;
+	return nodes * 1000.0 / timer.elapsed();
+}
+
+// Runs the "bench" command of an engine and returns the speed it reports
+double engineBenchSpeed(const EngineConfiguration& config)
+{
+	QProcess process;
+	process.setProcessChannelMode(QProcess::MergedChannels);
+	if (!config.workingDirectory().isEmpty())
+		process.setWorkingDirectory(config.workingDirectory());
+
+	QStringList args(config.arguments());
+	args << "bench";
+	if (!config.arguments().isEmpty())
+		process.start(config.command().trimmed(), args);
+	else
+		process.start(config.command().trimmed() + " bench");
+
+	if (!process.waitForFinished(600000))
+	{
+		qWarning("Cannot run the bench command of %s",
+			 qUtf8Printable(config.name()));
+		process.kill();
+		return 0.0;
+	}
+
+	// Eg. "Nodes/second    : 1234567" or "... 1234567 nps"
+	QRegularExpression re("nodes/second\\D*(\\d+)|(\\d+)\\s*nps",
+			      QRegularExpression::CaseInsensitiveOption);
+	double nps = 0.0;
+	auto it = re.globalMatch(QString::fromLocal8Bit(process.readAll()));
+	while (it.hasNext())
+	{
+		auto match = it.next();
+		nps = match.captured(match.lastCapturedIndex()).toDouble();
+	}
+
+	if (nps <= 0.0)
+		qWarning("No speed found in the bench output of %s",
+			 qUtf8Printable(config.name()));
+	return nps;
+}
+
 EngineMatch* parseMatch(const QStringList& args, QObject* parent)
 {
 	MatchParser parser(args);
@@ -255,17 +347,30 @@ EngineMatch* parseMatch(const QStringList& args, QObject* parent)
 	parser.addOption("-games", QVariant::Int, 1, 1);
 	parser.addOption("-rounds", QVariant::Int, 1, 1);
 	parser.addOption("-sprt", QVariant::StringList);
+	parser.addOption("-elimination", QVariant::StringList);
+	parser.addOption("-adaptive", QVariant::StringList);
+	parser.addOption("-npsmonitor", QVariant::StringList);
+	parser.addOption("-tcnormalize", QVariant::StringList);
 	parser.addOption("-ratinginterval", QVariant::Int, 1, 1);
+	parser.addOption("-mlratings", QVariant::StringList);
 	parser.addOption("-resultformat", QVariant::String, 1, 1);
 	parser.addOption("-debug", QVariant::Bool, 0, 0);
+	parser.addOption("-debuglog", QVariant::StringList);
 	parser.addOption("-openings", QVariant::StringList);
+	parser.addOption("-openingcache", QVariant::String, 1, 1);
+	parser.addOption("-openingindex", QVariant::String, 0, 1);
 	parser.addOption("-bookmode", QVariant::String);
-	parser.addOption("-pgnout", QVariant::StringList, 1, 3);
+	parser.addOption("-pgnout", QVariant::StringList, 1, 4);
 	parser.addOption("-epdout", QVariant::String, 1, 1);
+	parser.addOption("-outputflush", QVariant::StringList);
 	parser.addOption("-repeat", QVariant::Int, 0, 1);
 	parser.addOption("-noswap", QVariant::Bool, 0, 0);
 	parser.addOption("-reverse", QVariant::Bool, 0, 0);
+	parser.addOption("-pairschedule", QVariant::Bool, 0, 0);
 	parser.addOption("-recover", QVariant::Bool, 0, 0);
+	parser.addOption("-checkpoint", QVariant::StringList);
+	parser.addOption("-resume", QVariant::Bool, 0, 0);
+	parser.addOption("-statsout", QVariant::StringList);
 	parser.addOption("-site", QVariant::String, 1, 1);
 	parser.addOption("-wait", QVariant::Int, 1, 1);
 	parser.addOption("-seeds", QVariant::UInt, 1, 1);
@@ -289,10 +394,16 @@ EngineMatch* parseMatch(const QStringList& args, QObject* parent)
 	}
 
 	EngineMatch* match = new EngineMatch(tournament, parent);
+	const QString openingCache = parser.takeOption("-openingcache").toString();
+	const QVariant openingIndex = parser.takeOption("-openingindex");
 
 	QList<EngineData> engines;
 	QStringList eachOptions;
 	GameAdjudicator adjudicator;
+	double tcReference = 0.0;
+	QString tcBench;
+	QString checkpointFile;
+	bool resume = false;
 
 	const auto options = parser.options();
 	for (const auto& option : options)
@@ -417,7 +528,8 @@ EngineMatch* parseMatch(const QStringList& args, QObject* parent)
 		// SPRT-based stopping rule
 		else if (name == "-sprt")
 		{
-			QMap<QString, QString> params = option.toMap("elo0|elo1|alpha|beta");
+			QMap<QString, QString> params =
+				option.toMap("elo0|elo1|alpha|beta|model=trinomial|elo=logistic");
 			bool sprtOk[4];
 			double elo0 = params["elo0"].toDouble(sprtOk);
 			double elo1 = params["elo1"].toDouble(sprtOk + 1);
@@ -425,12 +537,110 @@ EngineMatch* parseMatch(const QStringList& args, QObject* parent)
 			double beta = params["beta"].toDouble(sprtOk + 3);
 
 			ok = (sprtOk[0] && sprtOk[1] && sprtOk[2] && sprtOk[3]);
+
+			Sprt::Model model = Sprt::Trinomial;
+			if (params["model"] == "pentanomial")
+				model = Sprt::Pentanomial;
+			else if (params["model"] != "trinomial")
+				ok = false;
+
+			// Normalized Elo is only supported by the pentanomial model
+			Sprt::EloModel eloModel = Sprt::LogisticElo;
+			if (params["elo"] == "normalized" && model == Sprt::Pentanomial)
+				eloModel = Sprt::NormalizedElo;
+			else if (params["elo"] != "logistic")
+				ok = false;
+
+			if (ok)
+				tournament->sprt()->initialize(elo0, elo1, alpha, beta,
+							       model, eloModel);
+		}
+		// Successive elimination of gauntlet challengers
+		else if (name == "-elimination")
+		{
+			// Only gauntlet tournaments have challengers
+			auto gauntlet = qobject_cast<GauntletTournament*>(tournament);
+			QMap<QString, QString> params =
+				option.toMap("elo0|elo1|alpha|beta");
+			bool sprtOk[4];
+			double elo0 = params["elo0"].toDouble(sprtOk);
+			double elo1 = params["elo1"].toDouble(sprtOk + 1);
+			double alpha = params["alpha"].toDouble(sprtOk + 2);
+			double beta = params["beta"].toDouble(sprtOk + 3);
+
+			ok = (gauntlet != nullptr
+			      && sprtOk[0] && sprtOk[1] && sprtOk[2] && sprtOk[3]);
 			if (ok)
-				tournament->sprt()->initialize(elo0, elo1, alpha, beta);
+				gauntlet->setElimination(elo0, elo1, alpha, beta);
+		}
+		// Adaptive round-robin pairing
+		else if (name == "-adaptive")
+		{
+			auto roundRobin = qobject_cast<RoundRobinTournament*>(tournament);
+			QMap<QString, QString> params =
+				option.toMap("confidence=0");
+			bool confidenceOk = false;
+			double confidence = params["confidence"].toDouble(&confidenceOk);
+
+			ok = (roundRobin != nullptr && confidenceOk
+			      && confidence >= 0.0 && confidence < 1.0);
+			if (ok)
+				roundRobin->setAdaptive(confidence);
+		}
+		// Engine search speed monitoring
+		else if (name == "-npsmonitor")
+		{
+			QMap<QString, QString> params =
+				option.toMap("games=10|threshold=0.85|action=warn");
+			bool gamesOk = false;
+			bool thresholdOk = false;
+			int games = params["games"].toInt(&gamesOk);
+			double threshold = params["threshold"].toDouble(&thresholdOk);
+
+			NpsMonitor::Action action = NpsMonitor::Warn;
+			if (params["action"] == "pause")
+				action = NpsMonitor::Pause;
+			else if (params["action"] != "warn")
+				thresholdOk = false;
+
+			ok = (gamesOk && games > 0
+			      && thresholdOk && threshold > 0.0 && threshold < 1.0);
+			if (ok)
+				tournament->npsMonitor()->initialize(games, threshold, action);
+		}
+		// Time controls normalized by machine speed
+		else if (name == "-tcnormalize")
+		{
+			QMap<QString, QString> params =
+				option.toMap("reference|bench=board");
+			tcReference = params["reference"].toDouble(&ok);
+			tcBench = params["bench"];
+			ok = (ok && tcReference > 0.0
+			      && (tcBench == "board" || tcBench == "engine"));
 		}
 		// Interval for rating list updates
 		else if (name == "-ratinginterval")
 			match->setRatingInterval(value.toInt());
+		// Maximum likelihood ratings of all players
+		else if (name == "-mlratings")
+		{
+			QMap<QString, QString> params =
+				option.toMap("bootstrap=100|threads=1");
+			bool bootstrapOk = false;
+			bool threadsOk = false;
+			int bootstrap = params["bootstrap"].toInt(&bootstrapOk);
+			int threads = params["threads"].toInt(&threadsOk);
+
+			ok = (bootstrapOk && bootstrap >= 0
+			      && threadsOk && threads >= 0);
+			if (ok)
+			{
+				RatingSolver* solver = tournament->ratingSolver();
+				solver->setBootstrapCount(bootstrap);
+				solver->setThreadCount(threads);
+				tournament->setRatingsEnabled(true);
+			}
+		}
 		// Interval for rating list updates
 		else if (name == "-resultformat")
 		{
@@ -459,6 +669,22 @@ EngineMatch* parseMatch(const QStringList& args, QObject* parent)
 			QLoggingCategory::defaultCategory()->setEnabled(QtDebugMsg, true);
 			match->setDebugMode(true);
 		}
+		// Asynchronous engine input/output log
+		else if (name == "-debuglog")
+		{
+			QMap<QString, QString> params =
+				option.toMap("dir|files=engine|buffer=65536");
+			int buffer = params["buffer"].toInt(&ok);
+			EngineLog::FileMode mode = EngineLog::PerEngine;
+			if (params["files"] == "game")
+				mode = EngineLog::PerGame;
+			else if (params["files"] != "engine")
+				ok = false;
+
+			ok = (ok && buffer > 0 && !params["dir"].isEmpty());
+			if (ok)
+				match->setEngineLog(new EngineLog(params["dir"], mode, buffer));
+		}
 		// Use an opening suite
 		else if (name == "-openings")
 		{
@@ -518,7 +744,17 @@ EngineMatch* parseMatch(const QStringList& args, QObject* parent)
 								       format,
 								       order,
 								       start - 1);
-				if (order == OpeningSuite::RandomOrder)
+				// Without a file name the index is kept next
+				// to the suite
+				if (openingIndex.type() == QVariant::Bool)
+					suite->setIndexFile(params["file"] + ".idx");
+				else if (openingIndex.isValid())
+					suite->setIndexFile(openingIndex.toString());
+
+				if (!openingCache.isEmpty())
+					suite->setCacheFile(openingCache,
+							    tournament->variant());
+				else if (order == OpeningSuite::RandomOrder)
 					qInfo("Indexing opening suite...");
 				ok = suite->initialize();
 				if (ok)
@@ -534,6 +770,8 @@ EngineMatch* parseMatch(const QStringList& args, QObject* parent)
 				match->setBookMode(OpeningBook::Ram);
 			else if (val == "disk")
 				match->setBookMode(OpeningBook::Disk);
+			else if (val == "mapped")
+				match->setBookMode(OpeningBook::Mapped);
 			else
 				ok = false;
 		}
@@ -542,7 +780,7 @@ EngineMatch* parseMatch(const QStringList& args, QObject* parent)
 		{
 			PgnGame::PgnMode mode = PgnGame::Verbose;
 			QStringList list = value.toStringList();
-			if (list.size() == 2 || list.size() == 3)
+			if (list.size() >= 2 && list.size() <= 4)
 			{
 				for (int i = 1; i < list.size(); i++)
 				{
@@ -550,10 +788,18 @@ EngineMatch* parseMatch(const QStringList& args, QObject* parent)
 						mode = PgnGame::Minimal;
 					else if (list.at(i) == "fi")
 						tournament->setPgnWriteUnfinishedGames(false);
+					else if (list.at(i) == "cpu")
+						tournament->setPgnCpuUsage(true);
 					else
 						ok = false;
 				}
 			}
+			if (list.at(0).endsWith(".zst", Qt::CaseInsensitive))
+			{
+				qWarning("Zstandard compression is not supported, "
+					 "use a .gz file instead");
+				ok = false;
+			}
 			if (ok)
 				tournament->setPgnOutput(list.at(0), mode);
 		}
@@ -563,6 +809,28 @@ EngineMatch* parseMatch(const QStringList& args, QObject* parent)
 			QString fileName = value.toString();
 			tournament->setEpdOutput(fileName);
 		}
+		// How often the PGN and EPD output files are flushed
+		else if (name == "-outputflush")
+		{
+			QMap<QString, QString> params =
+				option.toMap("interval=0|sync=no|frame=100");
+			bool intervalOk = false;
+			bool frameOk = false;
+			int interval = params["interval"].toInt(&intervalOk);
+			int frame = params["frame"].toInt(&frameOk);
+			QString sync = params["sync"];
+
+			ok = (intervalOk && interval >= 0
+			      && frameOk && frame > 0
+			      && (sync == "yes" || sync == "no"));
+			if (ok)
+			{
+				GameWriter* writer = tournament->gameWriter();
+				writer->setFlushInterval(interval);
+				writer->setSyncEnabled(sync == "yes");
+				writer->setFrameSize(frame);
+			}
+		}
 		// Play every opening twice (default), or multiple times
 		else if (name == "-repeat")
 		{
@@ -589,9 +857,39 @@ EngineMatch* parseMatch(const QStringList& args, QObject* parent)
 		// Use tournament schedule but with reverse sides
 		else if (name == "-reverse")
 			tournament->setReverseSides(true);
+		// Start the games of a repeated opening together
+		else if (name == "-pairschedule")
+			tournament->setPairScheduling(true);
 		// Recover crashed/stalled engines
 		else if (name == "-recover")
 			tournament->setRecoveryMode(true);
+		// Periodic tournament checkpoints
+		else if (name == "-checkpoint")
+		{
+			QMap<QString, QString> params =
+				option.toMap("file|interval=100");
+			int interval = params["interval"].toInt(&ok);
+			checkpointFile = params["file"];
+
+			ok = ok && interval > 0 && !checkpointFile.isEmpty();
+			if (ok)
+				tournament->setCheckpoint(checkpointFile, interval);
+		}
+		// Continue from the checkpoint file
+		else if (name == "-resume")
+			resume = true;
+		// Live tournament statistics
+		else if (name == "-statsout")
+		{
+			QMap<QString, QString> params =
+				option.toMap("file|interval=10");
+			int interval = params["interval"].toInt(&ok);
+			QString file = params["file"];
+
+			ok = ok && interval > 0 && !file.isEmpty();
+			if (ok)
+				tournament->setStatsOutput(file, interval);
+		}
 		// Site/location name
 		else if (name == "-site")
 			tournament->setSite(value.toString());
@@ -674,7 +972,29 @@ EngineMatch* parseMatch(const QStringList& args, QObject* parent)
 
 	bool ok = true;
 
-	if (!eachOptions.isEmpty())
+	// The pentanomial model pairs the two games of each opening,
+	// which are consecutive games of the same encounter
+	if (tournament->sprt()->model() == Sprt::Pentanomial
+	&&  (tournament->openingRepetitions() != 2
+	||   tournament->gamesPerEncounter() % 2 != 0))
+	{
+		qWarning("The pentanomial SPRT needs -repeat 2 and an even "
+			 "number of games per encounter");
+		ok = false;
+	}
+
+	if (ok && resume)
+	{
+		if (checkpointFile.isEmpty())
+		{
+			qWarning("-resume needs a checkpoint file, see -checkpoint");
+			ok = false;
+		}
+		else
+			tournament->setResumeFile(checkpointFile);
+	}
+
+	if (ok && !eachOptions.isEmpty())
 	{
 		QList<EngineData>::iterator it;
 		for (it = engines.begin(); it != engines.end(); ++it)
@@ -685,6 +1005,23 @@ EngineMatch* parseMatch(const QStringList& args, QObject* parent)
 		}
 	}
 
+	if (ok && tcReference > 0.0 && !engines.isEmpty())
+	{
+		double speed = (tcBench == "engine")
+			? engineBenchSpeed(engines.first().config)
+			: boardBenchSpeed();
+		if (speed <= 0.0)
+			ok = false;
+		else
+		{
+			double factor = tcReference / speed;
+			qInfo("Machine speed: %.0f nps, time control factor: %.3f",
+			      speed, factor);
+			for (auto& engine : engines)
+				engine.tc.scale(factor);
+		}
+	}
+
 	const auto& constEngines = engines;
 	for (const auto& engine : constEngines)
 	{
@@ -733,6 +1070,147 @@ EngineMatch* parseMatch(const QStringList& args, QObject* parent)
 	return match;
 }
 
+// Parses the arguments of option \a name for a command that runs on
+// its own instead of a match, like -findpos. Returns an empty map if
+// the arguments are invalid.
+QMap<QString, QString> commandArguments(const QStringList& args,
+					const QString& name,
+					const QString& validArgs,
+					int minArgs,
+					int maxArgs)
+{
+	MatchParser parser(args);
+	parser.addOption(name, QVariant::StringList, minArgs, maxArgs);
+	if (!parser.parse())
+		return QMap<QString, QString>();
+
+	const MatchParser::Option option = { name, parser.takeOption(name) };
+	return option.toMap(validArgs);
+}
+
+// Lists the games of a PGN file that reached a position
+int findPosition(const QStringList& args)
+{
+	const QMap<QString, QString> params = commandArguments(args,
+		"-findpos", "fen|pgn|index=|variant=standard", 2, 4);
+	if (params.isEmpty())
+		return 1;
+
+	const QString variant = params.value("variant");
+	Chess::Board* board = Chess::BoardFactory::create(variant);
+	if (board == nullptr)
+	{
+		qWarning("Unknown variant: %s", qUtf8Printable(variant));
+		return 1;
+	}
+	if (!board->setFenString(params.value("fen")))
+	{
+		qWarning("Invalid FEN string: %s",
+			 qUtf8Printable(params.value("fen")));
+		delete board;
+		return 1;
+	}
+	const quint64 key = board->key();
+	delete board;
+
+	// Without an index file the index is thrown away at exit
+	const QString pgnFile = params.value("pgn");
+	QTemporaryDir tmpDir;
+	QString indexFile = params.value("index");
+	if (indexFile.isEmpty())
+		indexFile = tmpDir.filePath("positions.pos");
+
+	PositionIndex index;
+	const QFileInfo indexInfo(indexFile);
+	if (!indexInfo.exists()
+	||  indexInfo.lastModified() < QFileInfo(pgnFile).lastModified()
+	||  !index.open(indexFile))
+	{
+		if (!PositionIndex::build(indexFile, pgnFile)
+		||  !index.open(indexFile))
+		{
+			qWarning("Cannot index the positions of %s",
+				 qUtf8Printable(pgnFile));
+			return 1;
+		}
+	}
+
+	QIODevice* device = GzipFile::openFile(pgnFile,
+		QIODevice::ReadOnly | QIODevice::Text);
+	if (device == nullptr)
+	{
+		qWarning("Cannot open PGN file %s", qUtf8Printable(pgnFile));
+		return 1;
+	}
+
+	QTextStream out(stdout);
+	const auto matches = index.find(key);
+	{
+		PgnStream stream(device);
+		for (const PositionIndex::Match& match : matches)
+		{
+			const qint64 lineNumber = index.gameLineNumber(match.game);
+			out << pgnFile << ":" << lineNumber << ": game "
+			    << match.game + 1 << ", ply " << match.ply;
+
+			PgnGameEntry entry;
+			if (stream.seek(index.gamePos(match.game), lineNumber)
+			&&  entry.read(stream))
+			{
+				out << ": " << entry.tagValue(PgnGameEntry::WhiteTag)
+				    << " - " << entry.tagValue(PgnGameEntry::BlackTag)
+				    << " " << entry.tagValue(PgnGameEntry::ResultTag)
+				    << " (" << entry.tagValue(PgnGameEntry::EventTag)
+				    << ")";
+			}
+			out << endl;
+		}
+	}
+	delete device;
+
+	out << matches.size() << " games found" << endl;
+	return 0;
+}
+
+// Creates a Polyglot book from the games of a PGN file
+int makeBook(const QStringList& args)
+{
+	const QMap<QString, QString> params = commandArguments(args,
+		"-makebook", "pgn|out|depth=20", 2, 3);
+	if (params.isEmpty())
+		return 1;
+
+	bool ok = true;
+	const int depth = params.value("depth").toInt(&ok);
+	if (!ok || depth <= 0)
+	{
+		qWarning("Invalid book depth: %s",
+			 qUtf8Printable(params.value("depth")));
+		return 1;
+	}
+
+	const QString pgnFile = params.value("pgn");
+	PolyglotBook book;
+	const int moveCount = book.import(pgnFile, depth);
+	if (moveCount == 0)
+	{
+		qWarning("No moves imported from %s", qUtf8Printable(pgnFile));
+		return 1;
+	}
+
+	const QString bookFile = params.value("out");
+	if (!book.write(bookFile))
+	{
+		qWarning("Cannot write opening book file %s",
+			 qUtf8Printable(bookFile));
+		return 1;
+	}
+
+	QTextStream out(stdout);
+	out << moveCount << " moves imported" << endl;
+	return 0;
+}
+
 } // anonymous namespace
 
 int main(int argc, char* argv[])
@@ -776,6 +1254,10 @@ int main(int argc, char* argv[])
 
 			return 0;
 		}
+		else if (arg == "--findpos" || arg == "-findpos")
+			return findPosition(arguments);
+		else if (arg == "--makebook" || arg == "-makebook")
+			return makeBook(arguments);
 		else if (arg == "--help" || arg == "-help")
 		{
 			QFile file(":/help.txt");
@@ -17,6 +17,7 @@
 */
 
 #include "matchparser.h"
+#include <QSet>
 
 
 MatchParser::MatchParser(const QStringList& args)
@@ -164,6 +165,7 @@ QMap<QString, QString> MatchParser::Option::toMap(const QString& validArgs) cons
 	const QStringList args = value.toStringList();
 	QMap<QString, QString> defaults;
 	QMap<QString, QString> map;
+	QSet<QString> optional;
 
 	const auto splitArgs = validArgs.split('|');
 	for (const auto& arg : splitArgs)
@@ -172,7 +174,11 @@ QMap<QString, QString> MatchParser::Option::toMap(const QString& validArgs) cons
 		QString argVal = arg.section('=', 1);
 
 		if (argName.isEmpty() || argVal.isEmpty())
-			defaults[arg] = QString();
+		{
+			defaults[argName.isEmpty() ? arg : argName] = QString();
+			if (!argName.isEmpty() && arg.endsWith('='))
+				optional.insert(argName);
+		}
 		else
 			defaults[argName] = argVal;
 	}
@@ -203,7 +209,7 @@ QMap<QString, QString> MatchParser::Option::toMap(const QString& validArgs) cons
 			if (map.contains(it.key()))
 				continue;
 
-			if (it.value().isEmpty())
+			if (it.value().isEmpty() && !optional.contains(it.key()))
 				missing.append(QString("\"%1\"").arg(it.key()));
 			else
 				map[it.key()] = it.value();
@@ -42,7 +42,10 @@ class MatchParser
 			 *
 			 * \a validArgs should contain all acceptable argument
 			 * names for this option, separated by the '|' character
-			 * (eg. "argument1|argument2").
+			 * (eg. "argument1|argument2"). An argument can have a
+			 * default value (eg. "argument=value"); an argument
+			 * followed by '=' and no value (eg. "argument=") is
+			 * optional and empty by default.
 			 *
 			 * If this option's arguments don't match the ones in
 			 * \a validArgs exactly, an empty map is returned.
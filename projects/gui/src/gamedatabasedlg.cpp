@@ -115,8 +115,8 @@ PgnGame PgnGameIterator::next(bool* ok, int depth)
 		return game;
 	}
 
-	const PgnGameEntry* entry = m_dlg->m_pgnGameEntryModel->entryAt(m_gameIndex++);
-	*ok = m_in.seek(entry->pos(), entry->lineNumber()) && game.read(m_in, depth);
+	const PgnGameEntry entry = m_dlg->m_pgnGameEntryModel->entryAt(m_gameIndex++);
+	*ok = m_in.seek(entry.pos(), entry.lineNumber()) && game.read(m_in, depth);
 
 	return game;
 }
@@ -289,7 +289,7 @@ GameDatabaseDialog::GameDatabaseDialog(GameDatabaseManager* dbManager, QWidget*
 	connect(ui->m_importBtn, &QPushButton::clicked, this, [=]()
 	{
 		auto dlg = new QFileDialog(this, tr("Import Game"), QString(),
-			tr("Portable Game Notation (*.pgn);;All Files (*.*)"));
+			tr("Portable Game Notation (*.pgn *.pgn.gz);;All Files (*.*)"));
 		connect(dlg, &QFileDialog::fileSelected, m_dbManager, &GameDatabaseManager::importPgnFile);
 		dlg->setAttribute(Qt::WA_DeleteOnClose);
 		dlg->open();
@@ -318,6 +318,9 @@ GameDatabaseDialog::GameDatabaseDialog(GameDatabaseManager* dbManager, QWidget*
 		ui->m_copyFenBtn->setText(tr("Copy FEN"));
 	});
 
+	connect(ui->m_findPositionBtn, SIGNAL(clicked()),
+		this, SLOT(findPosition()));
+
 	connect(ui->m_databasesListView->selectionModel(),
 		SIGNAL(selectionChanged(const QItemSelection&, const QItemSelection&)),
 		this, SLOT(databaseSelectionChanged(const QItemSelection&, const QItemSelection&)));
@@ -362,16 +365,16 @@ void GameDatabaseDialog::databaseSelectionChanged(const QItemSelection& selected
 
 	if (m_selectedDatabases.isEmpty())
 	{
-		m_pgnGameEntryModel->setEntries(QList<const PgnGameEntry*>());
+		m_pgnGameEntryModel->setDatabases(QList<const PgnDatabase*>());
 		return;
 	}
 
-	QList<const PgnGameEntry*> entries;
+	QList<const PgnDatabase*> databases;
 	QMap<int, PgnDatabase*>::const_iterator it;
 	for (it = m_selectedDatabases.constBegin(); it != m_selectedDatabases.constEnd(); ++it)
-		entries.append(it.value()->entries());
+		databases.append(it.value());
 
-	m_pgnGameEntryModel->setEntries(entries);
+	m_pgnGameEntryModel->setDatabases(databases);
 	ui->m_advancedSearchBtn->setEnabled(true);
 }
 
@@ -390,9 +393,9 @@ void GameDatabaseDialog::gameSelectionChanged(const QModelIndex& current,
 	PgnDatabase* selectedDatabase = m_dbManager->databases().at(databaseIndex);
 
 	PgnDatabase::Status status;
-	const PgnGameEntry* entry = m_pgnGameEntryModel->entryAt(current.row());
+	const PgnGameEntry entry = m_pgnGameEntryModel->entryAt(current.row());
 
-	if ((status = selectedDatabase->game(entry, &m_game)) != PgnDatabase::Ok)
+	if ((status = selectedDatabase->game(&entry, &m_game)) != PgnDatabase::Ok)
 	{
 		if (status == PgnDatabase::DoesNotExist)
 		{
@@ -489,7 +492,7 @@ int GameDatabaseDialog::databaseIndexFromGame(int game) const
 	QMap<int, PgnDatabase*>::const_iterator it;
 	for (it = m_selectedDatabases.constBegin(); it != m_selectedDatabases.constEnd(); ++it)
 	{
-		game -= it.value()->entries().count();
+		game -= it.value()->entryCount();
 		if (game < 0)
 			return it.key();
 	}
@@ -572,6 +575,35 @@ void GameDatabaseDialog::copyFen()
 	ui->m_copyFenBtn->setText(tr("Copied"));
 }
 
+void GameDatabaseDialog::findPosition()
+{
+	if (m_game.isNull() || m_gameViewer->board() == nullptr)
+		return;
+
+	bool indexed = false;
+	for (const PgnDatabase* db : qAsConst(m_selectedDatabases))
+	{
+		if (db->positionIndex().isOpen())
+		{
+			indexed = true;
+			break;
+		}
+	}
+	if (!indexed)
+	{
+		QMessageBox::information(this, tr("Find Position"),
+			tr("The selected databases have no position index.\n"
+			   "Enable position indexing in the settings and "
+			   "import the databases again."));
+		return;
+	}
+
+	ui->m_searchEdit->setText(tr("[Position search]"));
+	ui->m_searchEdit->setEnabled(false);
+	m_pgnGameEntryModel->setPositionFilter(m_gameViewer->board()->key());
+	ui->m_clearBtn->setEnabled(true);
+}
+
 void GameDatabaseDialog::updateUi()
 {
 	bool enable = m_pgnGameEntryModel->rowCount() > 0;
@@ -579,6 +611,7 @@ void GameDatabaseDialog::updateUi()
 	ui->m_exportBtn->setEnabled(enable);
 	ui->m_copyGameBtn->setEnabled(enable);
 	ui->m_copyFenBtn->setEnabled(enable);
+	ui->m_findPositionBtn->setEnabled(enable);
 }
 
 #include "gamedatabasedlg.moc"
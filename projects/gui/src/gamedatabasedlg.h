@@ -63,6 +63,7 @@ class GameDatabaseDialog : public QDialog
 		void createOpeningBook();
 		void copyGame();
 		void copyFen();
+		void findPosition();
 		void updateUi();
 
 	private:
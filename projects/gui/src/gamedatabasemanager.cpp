@@ -19,8 +19,12 @@
 #include "gamedatabasemanager.h"
 
 #include <QFileInfo>
+#include <QDir>
+#include <QSet>
 #include <QDataStream>
 #include <QThreadPool>
+#include <QCryptographicHash>
+#include <QSettings>
 
 #include <pgngameentry.h>
 
@@ -30,7 +34,27 @@
 #include "cutechessapp.h"
 
 #define GAME_DATABASE_STATE_MAGIC   0xDEADD00D
-#define GAME_DATABASE_STATE_VERSION 1
+#define GAME_DATABASE_STATE_VERSION 2
+
+namespace {
+
+// Returns the directory of the index files next to state file \a fileName
+QDir indexDir(const QString& fileName)
+{
+	return QDir(QFileInfo(fileName).absolutePath() + "/gamedb");
+}
+
+// Returns the name of the index file of PGN database \a fileName.
+// The entries are in an ".idx" file and the positions in a ".pos" file.
+QString indexFileName(const QString& fileName,
+		      const QString& suffix = QString(".idx"))
+{
+	const QByteArray path = QFileInfo(fileName).absoluteFilePath().toUtf8();
+	return QCryptographicHash::hash(path, QCryptographicHash::Sha1).toHex()
+		+ suffix;
+}
+
+} // anonymous namespace
 
 GameDatabaseManager::GameDatabaseManager(QObject* parent)
 	: QObject(parent),
@@ -50,6 +74,13 @@ QList<PgnDatabase*> GameDatabaseManager::databases() const
 
 bool GameDatabaseManager::writeState(const QString& fileName)
 {
+	// The game entries of each database are kept in an index file
+	// that is mapped into memory when the state is read
+	QDir dir(indexDir(fileName));
+	m_indexDir = dir.absolutePath();
+	if (!dir.exists() && !dir.mkpath("."))
+		return false;
+
 	QFile stateFile(fileName);
 
 	if (!stateFile.open(QIODevice::WriteOnly | QIODevice::Truncate))
@@ -65,17 +96,42 @@ bool GameDatabaseManager::writeState(const QString& fileName)
 	// Write the number of databases
 	out << (qint32)m_databases.count();
 
-	// Write the contents of the databases
+	// Write the databases and their index files
+	QSet<QString> indexFiles;
 	for (const PgnDatabase* db : qAsConst(m_databases))
 	{
+		const PositionIndex& positionIndex = db->positionIndex();
+		if (positionIndex.isOpen())
+			indexFiles << QFileInfo(positionIndex.fileName()).fileName();
+
 		out << db->fileName();
 		out << db->lastModified();
 		out << db->displayName();
-		out << (qint32)db->entries().count();
 
-		const auto entries = db->entries();
-		for (const PgnGameEntry* entry : entries)
-			entry->write(out);
+		QString indexName = QFileInfo(db->indexFile()).fileName();
+		if (db->indexFile().isEmpty()
+		||  QFileInfo(db->indexFile()).absoluteDir() != dir)
+		{
+			indexName = indexFileName(db->fileName());
+			if (!db->writeIndex(dir.filePath(indexName)))
+			{
+				qWarning("GameDatabaseManager: cannot write index file "
+					 "for %s", qUtf8Printable(db->fileName()));
+				indexName.clear();
+			}
+		}
+
+		out << indexName;
+		indexFiles << indexName;
+	}
+
+	// Remove the index files of databases that were removed
+	const QStringList oldFiles = dir.entryList(
+		QStringList() << "*.idx" << "*.pos", QDir::Files);
+	for (const QString& indexName : oldFiles)
+	{
+		if (!indexFiles.contains(indexName))
+			dir.remove(indexName);
 	}
 
 	m_modified = false;
@@ -85,6 +141,9 @@ bool GameDatabaseManager::writeState(const QString& fileName)
 
 bool GameDatabaseManager::readState(const QString& fileName)
 {
+	// New databases are indexed even if there's no state file yet
+	m_indexDir = indexDir(fileName).absolutePath();
+
 	QFile stateFile(fileName);
 
 	if (!stateFile.open(QIODevice::ReadOnly))
@@ -103,14 +162,14 @@ bool GameDatabaseManager::readState(const QString& fileName)
 		return false;
 	}
 
-	// Read and verify the version number
+	// Read and verify the version number. Version 1 had the game
+	// entries in the state file.
 	quint32 version;
 	in >> version;
 
-	if (version < GAME_DATABASE_STATE_VERSION ||
+	if (version < 1 ||
 	    version > GAME_DATABASE_STATE_VERSION)
 	{
-		// TODO: Add backward compatibility
 		qWarning("GameDatabaseManager: state file version mismatch");
 		return false;
 	}
@@ -120,6 +179,7 @@ bool GameDatabaseManager::readState(const QString& fileName)
 	in >> dbCount;
 
 	// Read the contents of the databases
+	const QDir dir(indexDir(fileName));
 	QString dbFileName;
 	QDateTime dbLastModified;
 	QString dbDisplayName;
@@ -131,10 +191,29 @@ bool GameDatabaseManager::readState(const QString& fileName)
 		in >> dbLastModified;
 		in >> dbDisplayName;
 
+		QString indexName;
+		QList<const PgnGameEntry*> entries;
+		if (version >= 2)
+			in >> indexName;
+		else
+		{
+			qint32 dbEntryCount;
+			in >> dbEntryCount;
+
+			// Read the entries
+			for (int j = 0; j < dbEntryCount; j++)
+			{
+				PgnGameEntry* entry = new PgnGameEntry;
+				entry->read(in);
+				entries << entry;
+			}
+		}
+
 		// Check if the database exists
 		QFileInfo fileInfo(dbFileName);
 		if (!fileInfo.exists())
 		{
+			qDeleteAll(entries);
 			m_modified = true;
 			continue;
 		}
@@ -142,32 +221,37 @@ bool GameDatabaseManager::readState(const QString& fileName)
 		// Check if the database has been modified
 		if (fileInfo.lastModified() > dbLastModified)
 		{
+			qDeleteAll(entries);
 			m_modified = true;
 			importPgnFile(dbFileName);
 			continue;
 		}
 
-		qint32 dbEntryCount;
-		in >> dbEntryCount;
-
-		// Read the entries
-		QList<const PgnGameEntry*> entries;
-		for (int j = 0; j < dbEntryCount; j++)
+		PgnDatabase* db = new PgnDatabase(dbFileName);
+		if (version < 2)
+			db->setEntries(entries);
+		else if (indexName.isEmpty()
+		     ||  !db->setIndexFile(dir.filePath(indexName)))
 		{
-			PgnGameEntry* entry = new PgnGameEntry;
-			entry->read(in);
-			entries << entry;
+			// The index is missing or broken
+			delete db;
+			m_modified = true;
+			importPgnFile(dbFileName);
+			continue;
 		}
-
-		PgnDatabase* db = new PgnDatabase(dbFileName);
-		db->setEntries(entries);
 		db->setLastModified(dbLastModified);
 		db->setDisplayName(dbDisplayName);
 
+		const QString positionIndexFile =
+			dir.filePath(indexFileName(dbFileName, ".pos"));
+		if (QFile::exists(positionIndexFile))
+			db->setPositionIndexFile(positionIndexFile);
+
 		readDatabases << db;
 	}
 
-	m_modified = false;
+	// An old state file is converted when the state is written
+	m_modified = (version < GAME_DATABASE_STATE_VERSION);
 
 	m_databases = readDatabases;
 	emit databasesReset();
@@ -178,6 +262,20 @@ bool GameDatabaseManager::readState(const QString& fileName)
 void GameDatabaseManager::importPgnFile(const QString& fileName)
 {
 	PgnImporter* pgnImporter = new PgnImporter(fileName);
+
+	// The positions are indexed only if the user wants it because
+	// the index takes a lot of space
+	if (!m_indexDir.isEmpty())
+	{
+		QDir dir(m_indexDir);
+		const QString positionIndexFile =
+			dir.filePath(indexFileName(fileName, ".pos"));
+		dir.remove(positionIndexFile);
+
+		if (QSettings().value("games/position_index", false).toBool()
+		&&  dir.mkpath("."))
+			pgnImporter->setPositionIndexFile(positionIndexFile);
+	}
 	connect(pgnImporter, SIGNAL(databaseRead(PgnDatabase*)),
 		this, SLOT(addDatabase(PgnDatabase*)));
 
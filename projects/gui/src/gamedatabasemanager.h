@@ -21,6 +21,7 @@
 
 #include <QObject>
 #include <QList>
+#include <QString>
 
 class PgnImporter;
 class PgnDatabase;
@@ -110,6 +111,7 @@ class GameDatabaseManager : public QObject
 
 	private:
 		QList<PgnDatabase*> m_databases;
+		QString m_indexDir;
 		bool m_modified;
 
 };
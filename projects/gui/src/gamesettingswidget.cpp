@@ -51,7 +51,7 @@ GameSettingsWidget::GameSettingsWidget(QWidget *parent)
 	connect(ui->m_browseOpeningSuiteBtn, &QPushButton::clicked, this, [=]()
 	{
 		auto dlg = new QFileDialog(this, tr("Select opening suite"), QString(),
-			tr("PGN/EPD files (*.pgn *.epd)"));
+			tr("PGN/EPD files (*.pgn *.epd *.pgn.gz *.epd.gz)"));
 		connect(dlg, &QFileDialog::fileSelected,
 			ui->m_openingSuiteEdit, &QLineEdit::setText);
 		dlg->setAttribute(Qt::WA_DeleteOnClose);
@@ -103,6 +103,7 @@ GameSettingsWidget::GameSettingsWidget(QWidget *parent)
 		ui->m_polyglotDepthSpin->setEnabled(!str.isEmpty());
 		ui->m_ramAccessRadio->setEnabled(!str.isEmpty());
 		ui->m_diskAccessRadio->setEnabled(!str.isEmpty());
+		ui->m_mappedAccessRadio->setEnabled(!str.isEmpty());
 	});
 
 	readSettings();
@@ -161,7 +162,8 @@ OpeningSuite* GameSettingsWidget::openingSuite() const
 		return nullptr;
 
 	OpeningSuite::Format format = OpeningSuite::PgnFormat;
-	if (file.endsWith(".epd", Qt::CaseInsensitive))
+	if (file.endsWith(".epd", Qt::CaseInsensitive)
+	||  file.endsWith(".epd.gz", Qt::CaseInsensitive))
 		format = OpeningSuite::EpdFormat;
 
 	OpeningSuite::Order order = OpeningSuite::SequentialOrder;
@@ -192,6 +194,8 @@ OpeningBook* GameSettingsWidget::openingBook() const
 	auto mode = OpeningBook::Ram;
 	if (ui->m_diskAccessRadio->isChecked())
 		mode = OpeningBook::Disk;
+	else if (ui->m_mappedAccessRadio->isChecked())
+		mode = OpeningBook::Mapped;
 	auto book = new PolyglotBook(mode);
 	if (!book->read(file))
 	{
@@ -246,6 +250,8 @@ void GameSettingsWidget::readSettings()
 	ui->m_polyglotDepthSpin->setValue(s.value("depth", 10).toInt());
 	if (s.value("disk_access").toBool())
 		ui->m_diskAccessRadio->setChecked(true);
+	else if (s.value("mapped_access").toBool())
+		ui->m_mappedAccessRadio->setChecked(true);
 	s.endGroup();
 
 	s.beginGroup("draw_adjudication");
@@ -324,6 +330,10 @@ void GameSettingsWidget::enableSettingsUpdates()
 	{
 		QSettings().setValue("games/opening_book/disk_access", checked);
 	});
+	connect(ui->m_mappedAccessRadio, &QRadioButton::toggled, [=](bool checked)
+	{
+		QSettings().setValue("games/opening_book/mapped_access", checked);
+	});
 
 	connect(ui->m_drawMoveNumberSpin, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged),
 		[=](int moveNumber)
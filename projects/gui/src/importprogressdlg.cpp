@@ -48,6 +48,8 @@ ImportProgressDialog::ImportProgressDialog(PgnImporter* pgnImporter,
 		SLOT(onImportError(int)));
 	connect(pgnImporter, SIGNAL(databaseReadStatus(const QTime&, int, qint64)),
 		this, SLOT(updateImportStatus(const QTime&, int, qint64)));
+	connect(pgnImporter, SIGNAL(statusChanged(const QString&)),
+		ui->m_statusLabel, SLOT(setText(const QString&)));
 }
 
 ImportProgressDialog::~ImportProgressDialog()
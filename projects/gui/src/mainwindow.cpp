@@ -796,6 +796,8 @@ void MainWindow::newTournament()
 		this, SLOT(addGame(ChessGame*)));
 	connect(t, SIGNAL(gameFinished(ChessGame*, int, int, int)),
 		resultsDialog, SLOT(update()));
+	connect(t, SIGNAL(ratingTableChanged()),
+		resultsDialog, SLOT(update()));
 	connect(t, SIGNAL(gameFinished(ChessGame*, int, int, int)),
 		this, SLOT(onGameFinished(ChessGame*)));
 	t->start();
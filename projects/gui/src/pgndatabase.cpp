@@ -18,6 +18,7 @@
 
 #include "pgndatabase.h"
 #include <pgnstream.h>
+#include <gzipfile.h>
 #include <QFileInfo>
 
 PgnDatabase::PgnDatabase(const QString& fileName, QObject* parent)
@@ -36,11 +37,83 @@ void PgnDatabase::setEntries(const QList<const PgnGameEntry*>& entries)
 {
 	qDeleteAll(m_entries);
 	m_entries = entries;
+	m_index.close();
 }
 
-QList<const PgnGameEntry*> PgnDatabase::entries() const
+bool PgnDatabase::setIndexFile(const QString& fileName)
 {
-	return m_entries;
+	if (!m_index.open(fileName))
+		return false;
+
+	qDeleteAll(m_entries);
+	m_entries.clear();
+
+	return true;
+}
+
+QString PgnDatabase::indexFile() const
+{
+	if (!m_index.isOpen())
+		return QString();
+	return m_index.fileName();
+}
+
+bool PgnDatabase::writeIndex(const QString& fileName) const
+{
+	if (m_index.isOpen())
+	{
+		if (m_index.fileName() == fileName)
+			return true;
+
+		QList<const PgnGameEntry*> entries;
+		for (int i = 0; i < m_index.count(); i++)
+			entries << new PgnGameEntry(m_index.entry(i));
+
+		bool ok = PgnGameIndex::write(fileName, entries);
+		qDeleteAll(entries);
+		return ok;
+	}
+
+	return PgnGameIndex::write(fileName, m_entries);
+}
+
+bool PgnDatabase::setPositionIndexFile(const QString& fileName)
+{
+	// The games of the position index must be the games of
+	// the database
+	if (!m_positionIndex.open(fileName))
+		return false;
+	if (m_positionIndex.gameCount() != entryCount())
+	{
+		m_positionIndex.close();
+		return false;
+	}
+
+	return true;
+}
+
+const PositionIndex& PgnDatabase::positionIndex() const
+{
+	return m_positionIndex;
+}
+
+int PgnDatabase::entryCount() const
+{
+	if (m_index.isOpen())
+		return m_index.count();
+	return m_entries.size();
+}
+
+PgnGameEntry PgnDatabase::entry(int index) const
+{
+	if (m_index.isOpen())
+		return m_index.entry(index);
+	return *m_entries.at(index);
+}
+
+PgnGameIndex::Query PgnDatabase::query(const PgnGameFilter& filter) const
+{
+	return m_index.query(filter);
 }
 
 QString PgnDatabase::fileName() const
@@ -92,13 +165,14 @@ PgnDatabase::Status PgnDatabase::game(const PgnGameEntry* entry,
 	if (status != Ok)
 		return status;
 
-	QFile file(m_fileName);
-	if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+	QIODevice* file = GzipFile::openFile(m_fileName,
+		QIODevice::ReadOnly | QIODevice::Text);
+	if (file == nullptr)
 		return Unreadable;
 
-	PgnStream in(&file);
-	if (!in.seek(entry->pos(), entry->lineNumber()) || !game->read(in))
-		return Corrupted;
+	PgnStream in(file);
+	bool ok = in.seek(entry->pos(), entry->lineNumber()) && game->read(in);
+	delete file;
 
-	return Ok;
+	return ok ? Ok : Corrupted;
 }
@@ -25,6 +25,8 @@
 #include <QFile>
 #include <pgngame.h>
 #include <pgngameentry.h>
+#include <pgngameindex.h>
+#include <positionindex.h>
 class PgnStream;
 
 /*!
@@ -65,14 +67,60 @@ class PgnDatabase : public QObject
 		 */
 		void setEntries(const QList<const PgnGameEntry*>& entries);
 		/*!
-		 * Returns the list of game entries in this database.
+		 * Reads the game entries from index file \a fileName instead
+		 * of keeping them in memory.
+		 *
+		 * Returns true if successful; otherwise returns false.
+		 * \sa writeIndex()
+		 */
+		bool setIndexFile(const QString& fileName);
+		/*!
+		 * Returns the name of the index file, or an empty string if
+		 * the entries are kept in memory.
+		 */
+		QString indexFile() const;
+		/*!
+		 * Writes the game entries to index file \a fileName.
+		 *
+		 * Returns true if successful; otherwise returns false.
+		 */
+		bool writeIndex(const QString& fileName) const;
+		/*!
+		 * Opens position index file \a fileName for searching
+		 * the games by position.
+		 *
+		 * Returns true if successful; otherwise returns false.
+		 * \sa positionIndex()
+		 */
+		bool setPositionIndexFile(const QString& fileName);
+		/*!
+		 * Returns the position index of the database.
+		 *
+		 * The index isn't open if the database has no position
+		 * index file.
+		 */
+		const PositionIndex& positionIndex() const;
+
+		/*! Returns the number of game entries in this database. */
+		int entryCount() const;
+		/*!
+		 * Returns the game entry at \a index.
 		 *
 		 * Game entries are light-weight "pointers" to the database. The game()
-		 * method can be used to read the move information.
+		 * method can be used to read the move information. This function
+		 * is thread-safe.
 		 *
 		 * \sa game()
 		 */
-		QList<const PgnGameEntry*> entries() const;
+		PgnGameEntry entry(int index) const;
+		/*!
+		 * Returns a query for quickly skipping the entries that
+		 * can't match \a filter.
+		 *
+		 * Only databases with an index file can skip entries; for
+		 * other databases the query lets every entry pass.
+		 */
+		PgnGameIndex::Query query(const PgnGameFilter& filter) const;
 
 		/*! Returns the file name of this database. */
 		QString fileName() const;
@@ -123,6 +171,8 @@ class PgnDatabase : public QObject
 
 	private:
 		QList<const PgnGameEntry*> m_entries;
+		PgnGameIndex m_index;
+		PositionIndex m_positionIndex;
 		QDateTime m_lastModified;
 		QString m_fileName;
 		QString m_displayName;
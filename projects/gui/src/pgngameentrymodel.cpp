@@ -18,38 +18,84 @@
 
 #include "pgngameentrymodel.h"
 #include <QtConcurrentFilter>
-#include <pgngameentry.h>
+#include <QSet>
+#include <algorithm>
+#include "pgndatabase.h"
 
 
-struct EntryContains
+struct PgnGameEntryModel::EntryContains
 {
-	EntryContains(const QList<const PgnGameEntry*>& entries,
-		      const PgnGameFilter& filter)
-		: m_entries(entries), m_filter(filter) { }
+	EntryContains(const PgnGameEntryModel* model,
+		      const PgnGameFilter& filter,
+		      quint64 positionKey)
+		: m_model(model),
+		  m_filter(filter),
+		  m_positionSearch(positionKey != 0)
+	{
+		for (const PgnDatabase* db : model->m_databases)
+		{
+			m_queries.append(db->query(filter));
+			if (!m_positionSearch)
+				continue;
+
+			QSet<int> games;
+			const auto matches = db->positionIndex().find(positionKey);
+			for (const PositionIndex::Match& match : matches)
+				games.insert(match.game);
+			m_games.append(games);
+		}
+	}
 
 	typedef bool result_type;
 
 	inline bool operator()(int index)
 	{
-		return m_entries.at(index)->match(m_filter);
+		// The index query rejects most games without reading
+		// their tags
+		int db = m_model->database(index);
+		int i = index - m_model->m_offsets.at(db);
+		if (m_positionSearch && !m_games.at(db).contains(i))
+			return false;
+
+		return m_queries.at(db).mayMatch(i)
+		    && m_model->m_databases.at(db)->entry(i).match(m_filter);
 	}
 
-	const QList<const PgnGameEntry*>& m_entries;
+	const PgnGameEntryModel* m_model;
 	PgnGameFilter m_filter;
+	QVector<PgnGameIndex::Query> m_queries;
+	bool m_positionSearch;
+	QVector<QSet<int>> m_games;
 };
 
 
 PgnGameEntryModel::PgnGameEntryModel(QObject* parent)
 	: QAbstractItemModel(parent),
-	  m_entryCount(0)
+	  m_entryTotal(0),
+	  m_entryCount(0),
+	  m_positionKey(0)
 {
 	connect(&m_watcher, SIGNAL(resultsReadyAt(int,int)),
 		this, SLOT(onResultsReady()));
 }
 
-const PgnGameEntry* PgnGameEntryModel::entryAt(int row) const
+PgnGameEntry PgnGameEntryModel::entryAt(int row) const
+{
+	return entry(m_filtered.resultAt(row));
+}
+
+int PgnGameEntryModel::database(int index) const
+{
+	auto it = std::upper_bound(m_offsets.constBegin(),
+				   m_offsets.constEnd(),
+				   index);
+	return int(it - m_offsets.constBegin()) - 1;
+}
+
+PgnGameEntry PgnGameEntryModel::entry(int index) const
 {
-	return m_entries.at(m_filtered.resultAt(row));
+	int db = database(index);
+	return m_databases.at(db)->entry(index - m_offsets.at(db));
 }
 
 int PgnGameEntryModel::sourceIndex(int row) const
@@ -62,19 +108,28 @@ int PgnGameEntryModel::entryCount() const
 	return m_filtered.resultCount();
 }
 
-void PgnGameEntryModel::setEntries(const QList<const PgnGameEntry*>& entries)
+void PgnGameEntryModel::setDatabases(const QList<const PgnDatabase*>& databases)
 {
 	m_watcher.cancel();
 	m_watcher.waitForFinished();
 
-	m_entries = entries;
+	m_databases = databases;
+	m_offsets.clear();
 
-	if (entries.size() > m_indexes.size())
+	int count = 0;
+	for (const PgnDatabase* db : databases)
 	{
-		m_indexes.reserve(entries.size());
-		for (int i = m_indexes.size(); i < entries.size(); i++)
+		m_offsets.append(count);
+		count += db->entryCount();
+	}
+
+	if (count > m_indexes.size())
+	{
+		m_indexes.reserve(count);
+		for (int i = m_indexes.size(); i < count; i++)
 			m_indexes.append(i);
 	}
+	m_entryTotal = count;
 
 	applyFilter(m_filter);
 }
@@ -91,8 +146,8 @@ void PgnGameEntryModel::applyFilter(const PgnGameFilter& filter)
 	m_entryCount = 0;
 
 	m_filtered = QtConcurrent::filtered(m_indexes.constBegin(),
-					    m_indexes.constBegin() + m_entries.size(),
-					    EntryContains(m_entries, filter));
+					    m_indexes.constBegin() + m_entryTotal,
+					    EntryContains(this, filter, m_positionKey));
 
 	m_watcher.setFuture(m_filtered);
 	endResetModel();
@@ -104,9 +159,20 @@ void PgnGameEntryModel::setFilter(const PgnGameFilter& filter)
 	m_watcher.waitForFinished();
 
 	m_filter = filter;
+	m_positionKey = 0;
 	applyFilter(filter);
 }
 
+void PgnGameEntryModel::setPositionFilter(quint64 key)
+{
+	m_watcher.cancel();
+	m_watcher.waitForFinished();
+
+	m_filter = PgnGameFilter();
+	m_positionKey = key;
+	applyFilter(m_filter);
+}
+
 QModelIndex PgnGameEntryModel::index(int row, int column,
 				 const QModelIndex& parent) const
 {
@@ -150,7 +216,7 @@ QVariant PgnGameEntryModel::data(const QModelIndex& index, int role) const
 	if (role == Qt::DisplayRole || role == Qt::EditRole)
 	{
 		PgnGameEntry::TagType tagType = PgnGameEntry::TagType(index.column());
-		return entryAt(index.row())->tagValue(tagType);
+		return entryAt(index.row()).tagValue(tagType);
 	}
 
 	return QVariant();
@@ -23,8 +23,11 @@
 #include <QList>
 #include <QFuture>
 #include <QFutureWatcher>
+#include <QVector>
 #include <pgngamefilter.h>
-class PgnGameEntry;
+#include <pgngameentry.h>
+#include <pgngameindex.h>
+class PgnDatabase;
 
 /*!
  * \brief Supplies PGN game entry information to views.
@@ -38,7 +41,7 @@ class PgnGameEntryModel : public QAbstractItemModel
 		PgnGameEntryModel(QObject* parent = nullptr);
 
 		/*! Returns the PGN entry at \a row. */
-		const PgnGameEntry* entryAt(int row) const;
+		PgnGameEntry entryAt(int row) const;
 		/*!
 		 * Returns the total number of PGN game entries matching the
 		 * current filter.
@@ -52,8 +55,11 @@ class PgnGameEntryModel : public QAbstractItemModel
 		 * \a row in the model.
 		 */
 		int sourceIndex(int row) const;
-		/*! Associates a list of PGN game entries with this model. */
-		void setEntries(const QList<const PgnGameEntry*>& entries);
+		/*!
+		 * Associates the game entries of \a databases with this
+		 * model. The entries are listed in the order of the databases.
+		 */
+		void setDatabases(const QList<const PgnDatabase*>& databases);
 
 		// Inherited from QAbstractItemModel
 		virtual QModelIndex index(int row, int column,
@@ -66,8 +72,20 @@ class PgnGameEntryModel : public QAbstractItemModel
 					    int role = Qt::DisplayRole) const;
 
 	public slots:
-		/*! Sets the filter for filtering the contents of the database. */
+		/*!
+		 * Sets the filter for filtering the contents of the database.
+		 *
+		 * This clears the position filter.
+		 */
 		void setFilter(const PgnGameFilter& filter);
+		/*!
+		 * Shows only the games that reached the position with
+		 * zobrist key \a key.
+		 *
+		 * Only databases with a position index are searched. This
+		 * clears the tag filter. If \a key is 0, all games are shown.
+		 */
+		void setPositionFilter(quint64 key);
 
 	protected:
 		// Inherited from QAbstractItemModel
@@ -78,14 +96,21 @@ class PgnGameEntryModel : public QAbstractItemModel
 		void onResultsReady();
 
 	private:
+		struct EntryContains;
+
 		void applyFilter(const PgnGameFilter& filter);
+		int database(int index) const;
+		PgnGameEntry entry(int index) const;
 
-		QList<const PgnGameEntry*> m_entries;
+		QList<const PgnDatabase*> m_databases;
+		QVector<int> m_offsets;
 		QVector<int> m_indexes;
+		int m_entryTotal;
 		int m_entryCount;
 		QFuture<int> m_filtered;
 		QFutureWatcher<int> m_watcher;
 		PgnGameFilter m_filter;
+		quint64 m_positionKey;
 };
 
 #endif // PGN_GAME_ENTRY_MODEL_H
@@ -17,14 +17,54 @@
 */
 
 #include "pgnimporter.h"
+#include <cctype>
 
-#include <QFile>
 #include <QFileInfo>
+#include <QFile>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrentRun>
 
 #include <pgnstream.h>
+#include <gzipfile.h>
 #include <pgngameentry.h>
+#include <positionindex.h>
 #include "pgndatabase.h"
 
+namespace {
+
+// Files smaller than this are read in a single thread
+const qint64 s_minChunkSize = 16 * 1024 * 1024;
+
+// Returns true if \a line is a PGN tag like [Event "?"]
+bool isTagLine(const QByteArray& line)
+{
+	const QByteArray str = line.trimmed();
+	return line.startsWith('[')
+	    && str.endsWith(']')
+	    && str.size() > 3
+	    && isalpha(uchar(str.at(1)))
+	    && str.contains('"');
+}
+
+} // anonymous namespace
+
+struct PgnImporter::Chunk
+{
+	enum Status
+	{
+		Ok,
+		Cancelled,
+		Failed
+	};
+
+	qint64 start;
+	qint64 end;
+	qint64 lineCount;
+	QList<PgnGameEntry*> games;
+	Status status;
+};
+
 PgnImporter::PgnImporter(const QString& fileName)
 	: Worker(QString("PGN import: %1").arg(fileName)),
 	  m_fileName(fileName)
@@ -36,12 +76,14 @@ QString PgnImporter::fileName() const
 	return m_fileName;
 }
 
+void PgnImporter::setPositionIndexFile(const QString& fileName)
+{
+	m_positionIndexFile = fileName;
+}
+
 void PgnImporter::work()
 {
-	QFile file(m_fileName);
 	QFileInfo fileInfo(m_fileName);
-	static const int updateInterval = 1024;
-	int numReadGames = 0;
 
 	if (!fileInfo.exists())
 	{
@@ -49,14 +91,54 @@ void PgnImporter::work()
 		return;
 	}
 
-	if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+	QList<const PgnGameEntry*> games;
+	bool ok = false;
+
+	// Compressed files can only be read from the start
+	if (!GzipFile::isCompressed(m_fileName))
+	{
+		const QVector<qint64> boundaries(chunkBoundaries(fileInfo.size()));
+		if (boundaries.size() > 2)
+			ok = readChunks(games, boundaries);
+	}
+	// If a chunk boundary turned out to be wrong, eg. because it was
+	// in a comment, the file is read again in a single thread
+	if (!ok && !readFile(games))
 	{
 		emit error(PgnImporter::IoError);
 		return;
 	}
 
-	PgnStream pgnStream(&file);
-	QList<const PgnGameEntry*> games;
+	PgnDatabase* db = new PgnDatabase(m_fileName);
+	db->setEntries(games);
+	db->setLastModified(fileInfo.lastModified());
+
+	if (!m_positionIndexFile.isEmpty() && !cancelRequested())
+	{
+		emit statusChanged(tr("Indexing positions..."));
+		if (!PositionIndex::build(m_positionIndexFile, m_fileName, games)
+		||  !db->setPositionIndexFile(m_positionIndexFile))
+			qWarning("PgnImporter: cannot index the positions of %s",
+				 qUtf8Printable(m_fileName));
+	}
+
+	emit databaseRead(db);
+}
+
+bool PgnImporter::readFile(QList<const PgnGameEntry*>& games)
+{
+	static const int updateInterval = 1024;
+	int numReadGames = 0;
+
+	QIODevice* file = GzipFile::openFile(m_fileName,
+		QIODevice::ReadOnly | QIODevice::Text);
+	if (file == nullptr)
+		return false;
+
+	// The progress is measured in bytes of the file on disk
+	auto gzipFile = qobject_cast<GzipFile*>(file);
+
+	PgnStream pgnStream(file);
 
 	for (;;)
 	{
@@ -72,11 +154,163 @@ void PgnImporter::work()
 
 		if (numReadGames % updateInterval == 0)
 			emit databaseReadStatus(startTime(), numReadGames,
-			    pgnStream.pos());
+			    gzipFile ? gzipFile->compressedPos() : pgnStream.pos());
 	}
-	PgnDatabase* db = new PgnDatabase(m_fileName);
-	db->setEntries(games);
-	db->setLastModified(fileInfo.lastModified());
+	delete file;
 
-	emit databaseRead(db);
+	return true;
+}
+
+QVector<qint64> PgnImporter::chunkBoundaries(qint64 fileSize) const
+{
+	QVector<qint64> boundaries;
+	const qint64 count = qMin(qint64(QThread::idealThreadCount()),
+				  fileSize / s_minChunkSize);
+	if (count <= 1)
+		return boundaries;
+
+	QFile file(m_fileName);
+	if (!file.open(QIODevice::ReadOnly))
+		return boundaries;
+
+	// A chunk starts at the first tag of a game, which is a tag
+	// line that follows an empty line.
+	boundaries << 0;
+	for (qint64 i = 1; i < count; i++)
+	{
+		const qint64 pos = fileSize * i / count;
+		if (pos <= boundaries.last() || !file.seek(pos))
+			continue;
+
+		// Skip the rest of the current line
+		file.readLine();
+		bool emptyLine = false;
+		while (!file.atEnd())
+		{
+			const qint64 linePos = file.pos();
+			const QByteArray line = file.readLine();
+			if (emptyLine && isTagLine(line))
+			{
+				boundaries << linePos;
+				break;
+			}
+			emptyLine = line.trimmed().isEmpty();
+		}
+	}
+	boundaries << fileSize;
+
+	return boundaries;
+}
+
+bool PgnImporter::readChunks(QList<const PgnGameEntry*>& games,
+			     const QVector<qint64>& boundaries)
+{
+	QVector<Chunk> chunks(boundaries.size() - 1);
+	QThreadPool pool;
+	QList< QFuture<void> > futures;
+
+	for (int i = 0; i < chunks.size(); i++)
+	{
+		Chunk* chunk = &chunks[i];
+		chunk->start = boundaries.at(i);
+		chunk->end = boundaries.at(i + 1);
+		chunk->lineCount = 0;
+		chunk->status = Chunk::Ok;
+
+		futures << QtConcurrent::run(&pool, [=]() { readChunk(chunk); });
+	}
+
+	// Merge the chunks in file order. The line numbers of each chunk
+	// start from the end of the previous chunk.
+	bool ok = true;
+	bool cancelled = false;
+	qint64 lineOffset = 0;
+
+	for (int i = 0; i < chunks.size(); i++)
+	{
+		futures[i].waitForFinished();
+		Chunk& chunk = chunks[i];
+
+		if (!ok || chunk.status == Chunk::Failed)
+		{
+			ok = false;
+			qDeleteAll(chunk.games);
+			continue;
+		}
+		// Keep the games up to the first cancelled chunk
+		if (cancelled)
+		{
+			qDeleteAll(chunk.games);
+			continue;
+		}
+
+		for (PgnGameEntry* game : qAsConst(chunk.games))
+		{
+			game->addLineOffset(lineOffset);
+			games << game;
+		}
+		lineOffset += chunk.lineCount;
+		cancelled = (chunk.status == Chunk::Cancelled);
+
+		emit databaseReadStatus(startTime(), games.size(), chunk.end);
+	}
+
+	if (!ok)
+	{
+		qDeleteAll(games);
+		games.clear();
+	}
+
+	return ok;
+}
+
+void PgnImporter::readChunk(Chunk* chunk) const
+{
+	QFile file(m_fileName);
+	if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+	{
+		chunk->status = Chunk::Failed;
+		return;
+	}
+
+	PgnStream pgnStream(&file);
+	if (!pgnStream.seek(chunk->start))
+	{
+		chunk->status = Chunk::Failed;
+		return;
+	}
+
+	const bool isLast = (chunk->end >= file.size());
+	for (;;)
+	{
+		if (cancelRequested())
+		{
+			chunk->status = Chunk::Cancelled;
+			return;
+		}
+
+		PgnGameEntry* game = new PgnGameEntry;
+		if (!game->read(pgnStream))
+		{
+			delete game;
+			// Only the last chunk may end at the end of the file
+			if (!isLast)
+				chunk->status = Chunk::Failed;
+			return;
+		}
+
+		// The first game of the next chunk
+		if (game->pos() >= chunk->end)
+		{
+			// The chunk boundary must be at the start of a game
+			// or the line numbers would be wrong
+			if (game->pos() != chunk->end)
+				chunk->status = Chunk::Failed;
+			chunk->lineCount = game->lineNumber() - 1;
+			delete game;
+			return;
+		}
+
+		chunk->games << game;
+	}
 }
@@ -20,12 +20,19 @@
 #define PGN_IMPORTER_H
 
 #include <worker.h>
+#include <QList>
+#include <QVector>
 
 class PgnDatabase;
+class PgnGameEntry;
 
 /*!
  * \brief Reads PGN database in a separate thread.
  *
+ * Large uncompressed files are split into chunks at game boundaries,
+ * and the chunks are read in parallel. The entries of the chunks are
+ * merged in file order.
+ *
  * \sa PgnDatabase
  */
 class PgnImporter : public Worker
@@ -47,6 +54,15 @@ class PgnImporter : public Worker
 		PgnImporter(const QString& fileName);
 		/*! Returns the file name of the database to be imported. */
 		QString fileName() const;
+		/*!
+		 * Sets the position index file of the database to
+		 * \a fileName.
+		 *
+		 * If \a fileName is not empty, the positions of the games
+		 * are indexed after the games are read.
+		 * \sa PositionIndex
+		 */
+		void setPositionIndexFile(const QString& fileName);
 
 	protected:
 		void work() override;
@@ -63,7 +79,16 @@ class PgnImporter : public Worker
 		void databaseReadStatus(const QTime& started, int numReadGames, qint64 numReadBytes);
 
 	private:
+		struct Chunk;
+
+		bool readFile(QList<const PgnGameEntry*>& games);
+		bool readChunks(QList<const PgnGameEntry*>& games,
+				const QVector<qint64>& boundaries);
+		void readChunk(Chunk* chunk) const;
+		QVector<qint64> chunkBoundaries(qint64 fileSize) const;
+
 		QString m_fileName;
+		QString m_positionIndexFile;
 
 };
 
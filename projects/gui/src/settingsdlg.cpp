@@ -69,6 +69,12 @@ SettingsDialog::SettingsDialog(QWidget* parent)
 				      checked);
 	});
 
+	connect(ui->m_positionIndexCheck, &QCheckBox::toggled,
+		[=](bool checked)
+	{
+		QSettings().setValue("games/position_index", checked);
+	});
+
 
 	connect(ui->m_concurrencySpin, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged),
 		this, [=](int value)
@@ -224,6 +230,8 @@ void SettingsDialog::readSettings()
 		->setChecked(s.value("human_can_play_after_timeout", true).toBool());
 	ui->m_defaultPgnOutFileEdit
 		->setText(s.value("default_pgn_output_file").toString());
+	ui->m_positionIndexCheck
+		->setChecked(s.value("position_index", false).toBool());
 	s.endGroup();
 
 	s.beginGroup("tournament");
@@ -84,6 +84,9 @@ void TournamentResultsDialog::update()
 	*/
 
 	text += tournament->results();
+	const QString ratings = tournament->ratingTable();
+	if (!ratings.isEmpty())
+		text += "\n" + ratings;
 	text += tr("\n%1 of %2 games finished.")
 		.arg(tournament->finishedGameCount())
 		.arg(tournament->finalGameCount());
@@ -141,6 +141,11 @@ bool TournamentSettingsWidget::swappingSides() const
 	return ui->m_swapCheck->isChecked();
 }
 
+bool TournamentSettingsWidget::mlRatings() const
+{
+	return ui->m_mlRatingsCheck->isChecked();
+}
+
 QString TournamentSettingsWidget::resultFormat() const
 {
 	return ui->m_resultFormatEdit->text();
@@ -171,6 +176,7 @@ void TournamentSettingsWidget::readSettings()
 	ui->m_saveUnfinishedGamesCheck->setChecked(
 		s.value("save_unfinished_games", true).toBool());
 	ui->m_swapCheck->setChecked(s.value("swap_sides", true).toBool());
+	ui->m_mlRatingsCheck->setChecked(s.value("ml_ratings", false).toBool());
 
 	QString format = s.value("result_format").toString();
 	if (format.isEmpty())
@@ -249,6 +255,10 @@ void TournamentSettingsWidget::enableSettingsUpdates()
 	{
 		QSettings().setValue("tournament/swap_sides", checked);
 	});
+	connect(ui->m_mlRatingsCheck, &QCheckBox::toggled, [=](bool checked)
+	{
+		QSettings().setValue("tournament/ml_ratings", checked);
+	});
 	connect(ui->m_resultFormatEdit, &QLineEdit::textChanged, [=](const QString &text)
 	{
 		QSettings().setValue("tournament/result_format", text);
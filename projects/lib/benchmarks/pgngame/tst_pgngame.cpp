@@ -1,4 +1,5 @@
 #include <QtTest/QtTest>
+#include <QBuffer>
 #include <pgnstream.h>
 #include <pgngame.h>
 
@@ -10,6 +11,8 @@ class tst_PgnGame: public QObject
 	private slots:
 		void parser_data() const;
 		void parser();
+		void deviceParser_data() const;
+		void deviceParser();
 };
 
 void tst_PgnGame::parser_data() const
@@ -99,5 +102,33 @@ void tst_PgnGame::parser()
 	}
 }
 
+void tst_PgnGame::deviceParser_data() const
+{
+	parser_data();
+}
+
+void tst_PgnGame::deviceParser()
+{
+	QFETCH(QByteArray, pgn);
+
+	// Read many games through a device, like from a large PGN file
+	QByteArray data;
+	for (int i = 0; i < 1000; i++)
+		data.append(pgn).append('\n');
+
+	QBuffer buffer(&data);
+	QVERIFY(buffer.open(QIODevice::ReadOnly | QIODevice::Text));
+	PgnStream stream(&buffer);
+	PgnGame game;
+	QBENCHMARK
+	{
+		stream.rewind();
+		int count = 0;
+		while (game.read(stream))
+			count++;
+		QCOMPARE(count, 1000);
+	}
+}
+
 QTEST_MAIN(tst_PgnGame)
 #include "tst_pgngame.moc"
@@ -1,2 +1,6 @@
 INCLUDEPATH += $$PWD/src
 LIBS += -lcutechess -L$$PWD
+
+# zlib is used for reading and writing gzip-compressed files
+win32-msvc*: LIBS += -lzlib
+else: LIBS += -lz
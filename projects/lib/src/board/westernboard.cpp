@@ -488,42 +488,65 @@ Move WesternBoard::moveFromSanString(const QString& str)
 			return Move();
 	}
 
-	QVarLengthArray<Move> moves;
-	generateMoves(moves, piece.type());
-	const Move* match = nullptr;
-
-	// Loop through all legal moves to find a move that matches
-	// the data we got from the move string.
-	for (int i = 0; i < moves.size(); i++)
+	// Finds the legal move in a list of pseudo-legal moves that
+	// matches the move string. Returns the number of matches.
+	Move match;
+	auto findMatch = [&](const QVarLengthArray<Move>& moves)
 	{
-		const Move& move = moves[i];
-		if (move.sourceSquare() == 0 || move.targetSquare() != target)
-			continue;
-		Square sourceSq2 = chessSquare(move.sourceSquare());
-		if (sourceSq.rank() != -1 && sourceSq2.rank() != sourceSq.rank())
-			continue;
-		if (sourceSq.file() != -1 && sourceSq2.file() != sourceSq.file())
-			continue;
-		// Castling moves were handled earlier
-		if (pieceAt(target) == Piece(side, Rook))
-			continue;
-		if (move.promotion() != promotion)
-			continue;
+		int count = 0;
+		for (const Move& move : moves)
+		{
+			if (move.sourceSquare() == 0 || move.targetSquare() != target)
+				continue;
+			Square sourceSq2 = chessSquare(move.sourceSquare());
+			if (sourceSq.rank() != -1 && sourceSq2.rank() != sourceSq.rank())
+				continue;
+			if (sourceSq.file() != -1 && sourceSq2.file() != sourceSq.file())
+				continue;
+			// Castling moves were handled earlier
+			if (pieceAt(target) == Piece(side, Rook))
+				continue;
+			if (move.promotion() != promotion)
+				continue;
 
-		if (!vIsLegalMove(move))
-			continue;
+			if (!vIsLegalMove(move))
+				continue;
 
-		// Return an empty move if there are multiple moves that
-		// match the move string.
-		if (match != nullptr)
-			return Move();
-		match = &move;
+			match = move;
+			count++;
+		}
+		return count;
+	};
+
+	// Look back from the target square for the pieces that can make
+	// the move, and generate only their moves.
+	QVarLengthArray<int> sources;
+	findSanSources(piece.type(), target, sources);
+
+	QVarLengthArray<Move> moves;
+	for (int source : sources)
+	{
+		Square sourceSq2 = chessSquare(source);
+		if ((sourceSq.rank() == -1 || sourceSq2.rank() == sourceSq.rank())
+		&&  (sourceSq.file() == -1 || sourceSq2.file() == sourceSq.file()))
+			generateMovesForPiece(moves, piece.type(), source);
 	}
 
-	if (match != nullptr)
-		return *match;
+	// If the lookup found nothing, the piece may move in a way the
+	// lookup can't follow, so check the moves of all the pieces of
+	// the same type.
+	int count = findMatch(moves);
+	if (count == 0)
+	{
+		generateMoves(moves, piece.type());
+		count = findMatch(moves);
+	}
 
-	return Move();
+	// Return an empty move if there are multiple moves that
+	// match the move string.
+	if (count != 1)
+		return Move();
+	return match;
 }
 
 QString WesternBoard::castlingRightsString(FenNotation notation) const
@@ -1317,6 +1340,64 @@ void WesternBoard::generatePawnMoves(int sourceSquare,
 	}
 }
 
+void WesternBoard::findSanSources(int pieceType,
+				  int target,
+				  QVarLengthArray<int>& sources) const
+{
+	const Piece piece(sideToMove(), pieceType);
+
+	if (pieceType == Pawn)
+	{
+		for (const PawnStep& pStep: m_pawnSteps)
+		{
+			int offset = pawnPushOffset(pStep, m_sign);
+			int square = target - offset;
+			if (pieceAt(square) == piece)
+				sources.append(square);
+			// Double step
+			else if (pStep.type == FreeStep
+			     &&  m_pawnHasDoubleStep
+			     &&  pieceAt(square).isEmpty()
+			     &&  pieceAt(square - offset) == piece)
+				sources.append(square - offset);
+		}
+		return;
+	}
+
+	const bool isKing = (pieceType == King);
+
+	auto addHops = [&](const QVarLengthArray<int>& offsets)
+	{
+		for (int offset : offsets)
+		{
+			if (pieceAt(target - offset) == piece)
+				sources.append(target - offset);
+		}
+	};
+	auto addSlides = [&](const QVarLengthArray<int>& offsets)
+	{
+		for (int offset : offsets)
+		{
+			int square = target - offset;
+			while (pieceAt(square).isEmpty())
+				square -= offset;
+			if (pieceAt(square) == piece)
+				sources.append(square);
+		}
+	};
+
+	if (!isKing && pieceHasMovement(pieceType, KnightMovement))
+		addHops(m_knightOffsets);
+	if (isKing)
+		addHops(m_bishopOffsets);
+	else if (pieceHasMovement(pieceType, BishopMovement))
+		addSlides(m_bishopOffsets);
+	if (isKing)
+		addHops(m_rookOffsets);
+	else if (pieceHasMovement(pieceType, RookMovement))
+		addSlides(m_rookOffsets);
+}
+
 bool WesternBoard::canCastle(CastlingSide castlingSide) const
 {
 	Side side = sideToMove();
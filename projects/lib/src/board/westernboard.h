@@ -244,6 +244,9 @@ class LIB_EXPORT WesternBoard : public Board
 		void generateCastlingMoves(QVarLengthArray<Move>& moves) const;
 		void generatePawnMoves(int sourceSquare,
 				       QVarLengthArray<Move>& moves) const;
+		void findSanSources(int pieceType,
+				    int target,
+				    QVarLengthArray<int>& sources) const;
 
 		bool canCastle(CastlingSide castlingSide) const;
 		QString castlingRightsString(FenNotation notation) const;
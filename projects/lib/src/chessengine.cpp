@@ -18,10 +18,12 @@
 
 #include "chessengine.h"
 #include <QIODevice>
+#include <QProcess>
 #include <QTimer>
 #include <QStringRef>
 #include <QtAlgorithms>
 #include "engineoption.h"
+#include "enginelog.h"
 
 
 int ChessEngine::s_count = 0;
@@ -81,6 +83,7 @@ ChessEngine::ChessEngine(QObject* parent)
 	  m_idleTimer(new QTimer(this)),
 	  m_protocolStartTimer(new QTimer(this)),
 	  m_ioDevice(nullptr),
+	  m_logGame(false),
 	  m_restartMode(EngineConfiguration::RestartAuto)
 {
 	m_pingTimer->setSingleShot(true);
@@ -279,6 +282,7 @@ bool ChessEngine::pondering() const
 void ChessEngine::endGame(const Chess::Result& result)
 {
 	ChessPlayer::endGame(result);
+	m_logGame = false;
 
 	if (restartsBetweenGames())
 		quit();
@@ -308,6 +312,15 @@ int ChessEngine::id() const
 	return m_id;
 }
 
+ProcessUsage ChessEngine::processUsage() const
+{
+	auto process = qobject_cast<QProcess*>(m_ioDevice);
+	if (process == nullptr || process->state() != QProcess::Running)
+		return ProcessUsage();
+
+	return ProcessUsage::sample(process->processId());
+}
+
 bool ChessEngine::stopThinking()
 {
 	if (state() == Thinking || isPondering())
@@ -432,32 +445,68 @@ void ChessEngine::write(const QString& data, WriteMode mode)
 	}
 
 	Q_ASSERT(m_ioDevice->isWritable());
-	emit debugMessage(QString(">%1(%2): %3")
-			  .arg(name())
-			  .arg(m_id)
-			  .arg(data));
+	const QByteArray bytes(data.toLatin1());
+
+	EngineLog* log = EngineLog::active();
+	if (log != nullptr)
+		logLine(log, EngineLog::ToEngine, bytes);
+	if (log == nullptr || log->isEchoEnabled())
+		emit debugMessage(QString(">%1(%2): %3")
+				  .arg(name())
+				  .arg(m_id)
+				  .arg(data));
 
-	if (m_ioDevice->write(data.toLatin1() + "\n") == -1)
+	if (m_ioDevice->write(bytes + '\n') == -1)
 		qWarning("Writing to engine %s(%d) failed",
 			 qUtf8Printable(name()), m_id);
 }
 
+void ChessEngine::logLine(EngineLog* log,
+			  int direction,
+			  const QByteArray& line)
+{
+	// The name and the game must reach the log before the lines
+	// that follow them. If the log's buffer is full, they're sent
+	// again with the next line, and this line is dropped so that
+	// it can't go to the wrong file.
+	if (m_logName != name())
+	{
+		if (!log->addName(m_id, name()))
+			return;
+		m_logName = name();
+	}
+	if (!m_logGame && board() != nullptr
+	&&  (state() == Observing || state() == Thinking))
+	{
+		if (!log->addGame(m_id, board()))
+			return;
+		m_logGame = true;
+	}
+
+	log->addLine(m_id, EngineLog::Direction(direction), line);
+}
+
 void ChessEngine::onReadyRead()
 {
 	while (m_ioDevice->isReadable() && m_ioDevice->canReadLine())
 	{
-		QString line = QString(m_ioDevice->readLine());
-		if (line.endsWith('\n'))
-			line.chop(1);
-		if (line.endsWith('\r'))
-			line.chop(1);
-		if (line.isEmpty())
+		QByteArray bytes(m_ioDevice->readLine());
+		if (bytes.endsWith('\n'))
+			bytes.chop(1);
+		if (bytes.endsWith('\r'))
+			bytes.chop(1);
+		if (bytes.isEmpty())
 			continue;
 
-		emit debugMessage(QString("<%1(%2): %3")
-				  .arg(name())
-				  .arg(m_id)
-				  .arg(line));
+		QString line(bytes);
+		EngineLog* log = EngineLog::active();
+		if (log != nullptr)
+			logLine(log, EngineLog::FromEngine, bytes);
+		if (log == nullptr || log->isEchoEnabled())
+			emit debugMessage(QString("<%1(%2): %3")
+					  .arg(name())
+					  .arg(m_id)
+					  .arg(line));
 		parseLine(line);
 
 		if (m_idleTimer->isActive())
@@ -23,6 +23,7 @@
 #include <QVariant>
 #include <QStringList>
 #include "engineconfiguration.h"
+class EngineLog;
 
 class QIODevice;
 class EngineOption;
@@ -231,6 +232,9 @@ class LIB_EXPORT ChessEngine : public ChessPlayer
 		 */
 		int id() const;
 
+		// Inherited from ChessPlayer
+		virtual ProcessUsage processUsage() const;
+
 	protected slots:
 		// Inherited from ChessPlayer
 		virtual void onTimeout();
@@ -275,6 +279,8 @@ class LIB_EXPORT ChessEngine : public ChessPlayer
 		void onProtocolStartTimeout();
 
 	private:
+		void logLine(EngineLog* log, int direction, const QByteArray& line);
+
 		static int s_count;
 
 		int m_id;
@@ -288,6 +294,8 @@ class LIB_EXPORT ChessEngine : public ChessPlayer
 		QTimer* m_protocolStartTimer;
 		QIODevice *m_ioDevice;
 		QStringList m_writeBuffer;
+		bool m_logGame;
+		QString m_logName;
 		QStringList m_variants;
 		QList<EngineOption*> m_options;
 		QMap<QString, QVariant> m_optionBuffer;
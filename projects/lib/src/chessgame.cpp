@@ -26,7 +26,7 @@
 
 namespace {
 
-QString evalString(const MoveEvaluation& eval)
+QString evalString(const MoveEvaluation& eval, bool cpuUsage)
 {
 	if (eval.isBookEval())
 		return "book";
@@ -50,6 +50,10 @@ QString evalString(const MoveEvaluation& eval)
 		precision = 1;
 	str += QString::number(double(t / 1000.0), 'f', precision) + 's';
 
+	// Ratio of CPU time to wall-clock time
+	if (cpuUsage && eval.cpuTime() > 0)
+		str += " cpu=" + QString::number(double(eval.cpuTime()) / t, 'f', 2);
+
 	return str;
 }
 
@@ -65,6 +69,7 @@ ChessGame::ChessGame(Chess::Board* board, PgnGame* pgn, QObject* parent)
 	  m_pgnInitialized(false),
 	  m_bookOwnership(false),
 	  m_boardShouldBeFlipped(false),
+	  m_cpuUsageComments(false),
 	  m_pgn(pgn)
 {
 
@@ -264,7 +269,7 @@ void ChessGame::onMoveMade(const Chess::Move& move)
 
 	m_scores[m_moves.size()] = sender->evaluation().score();
 	m_moves.append(move);
-	addPgnMove(move, evalString(sender->evaluation()));
+	addPgnMove(move, evalString(sender->evaluation(), m_cpuUsageComments));
 
 	// Get the result before sending the move to the opponent
 
@@ -545,6 +550,11 @@ void ChessGame::setBookOwnership(bool enabled)
 	m_bookOwnership = enabled;
 }
 
+void ChessGame::setCpuUsageComments(bool enabled)
+{
+	m_cpuUsageComments = enabled;
+}
+
 void ChessGame::pauseThread()
 {
 	m_pauseSem.release();
@@ -71,6 +71,7 @@ class LIB_EXPORT ChessGame : public QObject
 		void setAdjudicator(const GameAdjudicator& adjudicator);
 		void setStartDelay(int time);
 		void setBookOwnership(bool enabled);
+		void setCpuUsageComments(bool enabled);
 
 		void generateOpening();
 
@@ -137,6 +138,7 @@ class LIB_EXPORT ChessGame : public QObject
 		bool m_pgnInitialized;
 		bool m_bookOwnership;
 		bool m_boardShouldBeFlipped;
+		bool m_cpuUsageComments;
 		QString m_error;
 		QString m_startingFen;
 		Chess::Result m_result;
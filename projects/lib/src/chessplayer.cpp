@@ -29,7 +29,10 @@ ChessPlayer::ChessPlayer(QObject* parent)
 	  m_validateClaims(true),
 	  m_canPlayAfterTimeout(false),
 	  m_board(nullptr),
-	  m_opponent(nullptr)
+	  m_opponent(nullptr),
+	  m_gameUsageTime(0),
+	  m_gameNodes(0.0),
+	  m_gameNpsTime(0)
 {
 	m_timer->setSingleShot(true);
 	connect(m_timer, SIGNAL(timeout()), this, SLOT(onTimeout()));
@@ -66,6 +69,10 @@ void ChessPlayer::newGame(Chess::Side side, ChessPlayer* opponent, Chess::Board*
 	m_board = board;
 	m_side = side;
 	m_timeControl.initialize();
+	m_gameUsage = ProcessUsage();
+	m_gameUsageTime = 0;
+	m_gameNodes = 0.0;
+	m_gameNpsTime = 0;
 
 	setState(Observing);
 	startGame();
@@ -125,6 +132,7 @@ void ChessPlayer::startClock()
 	if (m_timeControl.isValid())
 		emit startedThinking(m_timeControl.timeLeft());
 
+	m_moveStartUsage = processUsage();
 	m_timeControl.startTimer();
 
 	if (!m_timeControl.isInfinite())
@@ -149,6 +157,28 @@ const TimeControl* ChessPlayer::timeControl() const
 	return &m_timeControl;
 }
 
+const ProcessUsage& ChessPlayer::gameUsage() const
+{
+	return m_gameUsage;
+}
+
+qint64 ChessPlayer::gameUsageTime() const
+{
+	return m_gameUsageTime;
+}
+
+double ChessPlayer::gameNps() const
+{
+	if (m_gameNpsTime <= 0)
+		return 0.0;
+	return m_gameNodes * 1000.0 / m_gameNpsTime;
+}
+
+ProcessUsage ChessPlayer::processUsage() const
+{
+	return ProcessUsage();
+}
+
 void ChessPlayer::setTimeControl(const TimeControl& timeControl)
 {
 	m_timeControl = timeControl;
@@ -278,6 +308,19 @@ void ChessPlayer::emitMove(const Chess::Move& move)
 	m_eval.setTime(m_timeControl.lastMoveTime());
 	m_eval.setIsTrusted(!areClaimsValidated());
 
+	const ProcessUsage usage(processUsage() - m_moveStartUsage);
+	if (!usage.isNull())
+	{
+		m_eval.setCpuTime(usage.cpuTime());
+		m_gameUsage += usage;
+		m_gameUsageTime += m_timeControl.lastMoveTime();
+	}
+	if (m_eval.nps() > 0 && m_timeControl.lastMoveTime() > 0)
+	{
+		m_gameNodes += double(m_eval.nps()) * m_timeControl.lastMoveTime() / 1000.0;
+		m_gameNpsTime += m_timeControl.lastMoveTime();
+	}
+
 	m_timer->stop();
 	if (m_timeControl.expired() && !canPlayAfterTimeout())
 	{
@@ -26,6 +26,7 @@
 #include "board/move.h"
 #include "timecontrol.h"
 #include "moveevaluation.h"
+#include "processusage.h"
 class QTimer;
 namespace Chess { class Board; }
 
@@ -102,6 +103,27 @@ class LIB_EXPORT ChessPlayer : public QObject
 		/*! Returns the player's time control. */
 		const TimeControl* timeControl() const;
 
+		/*!
+		 * Returns the resources used by the player's process while
+		 * thinking in the current (or last) game.
+		 *
+		 * Returns a null object if the player has no process or if
+		 * process sampling isn't supported.
+		 */
+		const ProcessUsage& gameUsage() const;
+		/*!
+		 * Returns the wall-clock thinking time in milliseconds that
+		 * corresponds to gameUsage().
+		 */
+		qint64 gameUsageTime() const;
+		/*!
+		 * Returns the average nodes per second reported by the player
+		 * in the current (or last) game, weighted by thinking time.
+		 *
+		 * Returns 0 if the player didn't report its search speed.
+		 */
+		double gameNps() const;
+
 		/*! Sets the time control for the player. */
 		void setTimeControl(const TimeControl& timeControl);
 
@@ -264,6 +286,13 @@ class LIB_EXPORT ChessPlayer : public QObject
 		 */
 		virtual bool canPlayAfterTimeout() const;
 
+		/*!
+		 * Returns the current resource usage of the player's process.
+		 *
+		 * The default implementation returns a null object.
+		 */
+		virtual ProcessUsage processUsage() const;
+
 		/*! Emits the resultClaim() signal with result \a result. */
 		void claimResult(const Chess::Result& result);
 		/*!
@@ -312,6 +341,11 @@ class LIB_EXPORT ChessPlayer : public QObject
 		Chess::Side m_side;
 		Chess::Board* m_board;
 		ChessPlayer* m_opponent;
+		ProcessUsage m_moveStartUsage;
+		ProcessUsage m_gameUsage;
+		qint64 m_gameUsageTime;
+		double m_gameNodes;
+		qint64 m_gameNpsTime;
 };
 
 #endif // CHESSPLAYER_H
@@ -17,27 +17,80 @@
 */
 
 #include "econode.h"
+#include <algorithm>
+#include <cstring>
 #include <QStringList>
 #include <QFile>
-#include <QDataStream>
-#include <QMutex>
+#include <QHash>
+#include <QMap>
+#include <QResource>
+#include <QtEndian>
 #include "pgngame.h"
 #include "pgnstream.h"
 
 namespace {
 
-QStringList s_openings;
-EcoNode* s_root = nullptr;
+const quint32 s_magic = 0x54454343; // "CCET"
+const quint32 s_version = 1;
 
-class EcoDeleter
+/*
+ * The header is followed by the nodes (16 bytes each, in breadth-first
+ * order with the root first), the edges, the string offsets of the
+ * opening names and the strings. A string is a 16-bit length followed
+ * by UTF-8 characters, and offset 0 is the empty string. All numbers
+ * are little-endian.
+ */
+struct Header
 {
-	public:
-		~EcoDeleter()
-		{
-			delete s_root;
-		}
+	quint32 magic;
+	quint32 version;
+	quint32 nodeCount;
+	quint32 edgeCount;
+	quint32 openingCount;
+	quint32 stringsSize;
+};
+
+// An edge from a node to a child. The edges of a node are sorted by move.
+struct Edge
+{
+	quint16 move;
+	quint16 reserved;
+	quint32 node;
+};
+
+// A node of the tree that's built from PGN games
+struct BuildNode
+{
+	BuildNode()
+		: ecoCode(-1),
+		  opening(-1)
+	{
+	}
+
+	~BuildNode()
+	{
+		qDeleteAll(children);
+	}
+
+	qint16 ecoCode;
+	qint32 opening;
+	QString variation;
+	QMap<quint16, BuildNode*> children;
 };
-EcoDeleter s_ecoDeleter;
+
+// The trie data points to the library's resources, or to s_buffer if
+// the tree was built from PGN games or the resource had to be copied.
+QByteArray s_buffer;
+const char* s_data = nullptr;
+int s_size = 0;
+const EcoNode* s_nodes = nullptr;
+quint32 s_nodeCount = 0;
+const Edge* s_edges = nullptr;
+quint32 s_edgeCount = 0;
+const quint32* s_openings = nullptr;
+quint32 s_openingCount = 0;
+const uchar* s_strings = nullptr;
+quint32 s_stringsSize = 0;
 
 int ecoFromString(const QString& ecoString)
 {
@@ -53,59 +106,217 @@ int ecoFromString(const QString& ecoString)
 	return hundreds * 100 + tens;
 }
 
-} // anonymous namespace
+// Packs \a move into 16 bits: the source square, the target square
+// (a1 = 0, h8 = 63) and the promotion. Returns -1 if the move can't
+// be in the tree.
+int moveCode(const Chess::GenericMove& move)
+{
+	const Chess::Square source = move.sourceSquare();
+	const Chess::Square target = move.targetSquare();
+	if (!source.isValid() || !target.isValid()
+	||  source.file() > 7 || source.rank() > 7
+	||  target.file() > 7 || target.rank() > 7
+	||  move.promotion() < 0 || move.promotion() > 15)
+		return -1;
+
+	return (source.rank() * 8 + source.file())
+	     | (target.rank() * 8 + target.file()) << 6
+	     | move.promotion() << 12;
+}
 
-QDataStream& operator<<(QDataStream& out, const EcoNode* node)
+template <typename T>
+void appendValue(QByteArray& data, T value)
 {
-	if (!node)
-		return out;
-	out << node->m_ecoCode
-	    << node->m_opening
-	    << node->m_variation
-	    << node->m_children;
+	value = qToLittleEndian(value);
+	data.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+QString trieString(quint32 offset)
+{
+	if (offset >= s_stringsSize || s_stringsSize - offset < 2)
+		return QString();
+
+	const quint16 length = qFromLittleEndian<quint16>(s_strings + offset);
+	if (s_stringsSize - offset - 2 < length)
+		return QString();
 
-	return out;
+	return QString::fromUtf8(
+		reinterpret_cast<const char*>(s_strings + offset + 2), length);
 }
 
-QDataStream& operator>>(QDataStream& in, EcoNode*& node)
+bool setData(const char* data, int size)
 {
-	node = new EcoNode;
+	Q_STATIC_ASSERT(sizeof(Header) == 24);
+	Q_STATIC_ASSERT(sizeof(EcoNode) == 16);
+	Q_STATIC_ASSERT(sizeof(Edge) == 8);
+
+	if (size < int(sizeof(Header)))
+		return false;
+
+	Header header;
+	std::memcpy(&header, data, sizeof(header));
+	const quint32 nodeCount = qFromLittleEndian(header.nodeCount);
+	const quint32 edgeCount = qFromLittleEndian(header.edgeCount);
+	const quint32 openingCount = qFromLittleEndian(header.openingCount);
+	const quint32 stringsSize = qFromLittleEndian(header.stringsSize);
+
+	if (qFromLittleEndian(header.magic) != s_magic
+	||  qFromLittleEndian(header.version) != s_version
+	||  nodeCount == 0
+	||  qint64(size) != qint64(sizeof(Header))
+			  + qint64(nodeCount) * qint64(sizeof(EcoNode))
+			  + qint64(edgeCount) * qint64(sizeof(Edge))
+			  + qint64(openingCount) * qint64(sizeof(quint32))
+			  + qint64(stringsSize))
+		return false;
+
+	const char* ptr = data + sizeof(Header);
+	const EcoNode* nodes = reinterpret_cast<const EcoNode*>(ptr);
+	ptr += nodeCount * sizeof(EcoNode);
+	s_edges = reinterpret_cast<const Edge*>(ptr);
+	ptr += edgeCount * sizeof(Edge);
+	s_openings = reinterpret_cast<const quint32*>(ptr);
+	ptr += openingCount * sizeof(quint32);
+	s_strings = reinterpret_cast<const uchar*>(ptr);
+
+	s_data = data;
+	s_size = size;
+	s_nodeCount = nodeCount;
+	s_edgeCount = edgeCount;
+	s_openingCount = openingCount;
+	s_stringsSize = stringsSize;
+
+	// The tree counts as initialized once the nodes are set, so
+	// they're set after everything else
+	s_nodes = nodes;
+
+	return true;
+}
 
-	in >> node->m_ecoCode
-	   >> node->m_opening
-	   >> node->m_variation
-	   >> node->m_children;
+QByteArray compile(const BuildNode* root, const QStringList& openings)
+{
+	QByteArray strings;
+	QHash<QString, quint32> stringOffsets;
+	auto addString = [&](const QString& str)
+	{
+		auto it = stringOffsets.constFind(str);
+		if (it != stringOffsets.constEnd())
+			return it.value();
+
+		const QByteArray utf8 = str.toUtf8().left(0xffff);
+		const quint32 offset = quint32(strings.size());
+		appendValue(strings, quint16(utf8.size()));
+		strings.append(utf8);
+		stringOffsets.insert(str, offset);
+
+		return offset;
+	};
+	addString(QString());
+
+	QByteArray openingData;
+	for (const QString& opening : openings)
+		appendValue(openingData, addString(opening));
+
+	// In breadth-first order the children of a node are adjacent
+	QVector<const BuildNode*> nodes;
+	nodes.append(root);
+	QByteArray nodeData;
+	QByteArray edgeData;
+	quint32 edgeCount = 0;
+
+	for (int i = 0; i < nodes.size(); i++)
+	{
+		const BuildNode* node = nodes.at(i);
+		appendValue(nodeData, edgeCount);
+		appendValue(nodeData, quint16(node->children.size()));
+		appendValue(nodeData, node->ecoCode);
+		appendValue(nodeData, node->opening);
+		appendValue(nodeData, addString(node->variation));
+
+		for (auto it = node->children.constBegin();
+		     it != node->children.constEnd(); ++it)
+		{
+			appendValue(edgeData, it.key());
+			appendValue(edgeData, quint16(0));
+			appendValue(edgeData, quint32(nodes.size()));
+			nodes.append(it.value());
+			edgeCount++;
+		}
+	}
 
-	return in;
+	QByteArray data;
+	appendValue(data, s_magic);
+	appendValue(data, s_version);
+	appendValue(data, quint32(nodes.size()));
+	appendValue(data, edgeCount);
+	appendValue(data, quint32(openings.size()));
+	appendValue(data, quint32(strings.size()));
+	data += nodeData;
+	data += edgeData;
+	data += openingData;
+	data += strings;
+
+	return data;
 }
 
+} // anonymous namespace
+
 void EcoNode::initialize()
 {
-	static QMutex mutex;
-	if (s_root)
-		return;
-
-	mutex.lock();
-	if (!s_root)
+	// A function-local static is initialized only once, even if
+	// several threads get here at the same time
+	static const bool loaded = []()
 	{
+		if (s_nodes)
+			return true;
+
 		Q_INIT_RESOURCE(eco);
 
-		QFile file(":/eco.bin");
-		if (!file.open(QIODevice::ReadOnly))
+		QResource resource(":/eco.bin");
+		if (!resource.isValid())
+		{
 			qWarning("Could not open ECO file");
-		else
+			return false;
+		}
+
+		// The resource is used in place unless it's compressed or
+		// misaligned
+		const char* data = reinterpret_cast<const char*>(resource.data());
+		int size = int(resource.size());
+#if QT_VERSION >= QT_VERSION_CHECK(5, 13, 0)
+		const bool compressed = resource.compressionAlgorithm()
+					!= QResource::NoCompression;
+#else
+		const bool compressed = resource.isCompressed();
+#endif
+		if (compressed)
 		{
-			QDataStream in(&file);
-			in.setVersion(QDataStream::Qt_4_6);
-			in >> s_openings >> s_root;
+			QFile file(resource.absoluteFilePath());
+			if (file.open(QIODevice::ReadOnly))
+				s_buffer = file.readAll();
 		}
-	}
-	mutex.unlock();
+		else if (quintptr(data) % alignof(quint32) != 0)
+			s_buffer = QByteArray(data, size);
+
+		if (compressed || !s_buffer.isEmpty())
+		{
+			data = s_buffer.constData();
+			size = s_buffer.size();
+		}
+
+		if (!setData(data, size))
+		{
+			qWarning("Invalid ECO file");
+			return false;
+		}
+		return true;
+	}();
+	Q_UNUSED(loaded);
 }
 
 void EcoNode::initialize(PgnStream& in)
 {
-	if (s_root)
+	if (s_nodes)
 		return;
 
 	if (!in.isOpen())
@@ -114,29 +325,32 @@ void EcoNode::initialize(PgnStream& in)
 		return;
 	}
 
-	s_root = new EcoNode;
-	EcoNode* current = s_root;
+	BuildNode root;
+	QStringList openings;
 	QMap<QString, int> tmpOpenings;
 
 	PgnGame game;
 	while (game.read(in, INT_MAX - 1, false))
 	{
-		current = s_root;
+		BuildNode* current = &root;
 		for (const PgnGame::MoveData& move : game.moves())
 		{
-			QString san = move.moveString;
-			EcoNode* node = current->child(san);
-			if (node == nullptr)
+			const int code = moveCode(move.move);
+			if (code == -1)
 			{
-				node = new EcoNode;
-				current->addChild(san, node);
+				current = &root;
+				break;
 			}
+
+			BuildNode*& node = current->children[quint16(code)];
+			if (node == nullptr)
+				node = new BuildNode;
 			current = node;
 		}
-		if (current == s_root)
+		if (current == &root)
 			continue;
 
-		current->m_ecoCode = ecoFromString(game.tagValue("ECO"));
+		current->ecoCode = qint16(ecoFromString(game.tagValue("ECO")));
 
 		QString val = game.tagValue("Opening");
 		if (!val.isEmpty())
@@ -146,33 +360,38 @@ void EcoNode::initialize(PgnStream& in)
 			{
 				index = tmpOpenings.count();
 				tmpOpenings[val] = index;
-				s_openings.append(val);
+				openings.append(val);
 			}
-			current->m_opening = index;
+			current->opening = index;
 		}
 
-		current->m_variation = game.tagValue("Variation");
+		current->variation = game.tagValue("Variation");
 	}
+
+	s_buffer = compile(&root, openings);
+	setData(s_buffer.constData(), s_buffer.size());
 }
 
 const EcoNode* EcoNode::root()
 {
-	if (!s_root)
-		initialize();
-	return s_root;
+	// Always go through the static guard of initialize(), so that a
+	// thread never sees the nodes before the rest of the tree. After
+	// the first call the guard is only a check of a flag.
+	initialize();
+	return s_nodes;
 }
 
 const EcoNode* EcoNode::find(const QVector<PgnGame::MoveData>& moves)
 {
-	if (!s_root)
+	const EcoNode* current = root();
+	if (current == nullptr)
 		return nullptr;
 
-	EcoNode* current = s_root;
-	EcoNode* valid = nullptr;
+	const EcoNode* valid = nullptr;
 
 	for (const PgnGame::MoveData& move : moves)
 	{
-		EcoNode* node = current->child(move.moveString);
+		const EcoNode* node = current->child(move.move);
 		if (node == nullptr)
 			return valid;
 		if (!node->opening().isEmpty())
@@ -185,7 +404,7 @@ const EcoNode* EcoNode::find(const QVector<PgnGame::MoveData>& moves)
 
 void EcoNode::write(const QString& fileName)
 {
-	if (!s_root)
+	if (!s_nodes)
 		return;
 
 	QFile file(fileName);
@@ -195,52 +414,59 @@ void EcoNode::write(const QString& fileName)
 		return;
 	}
 
-	QDataStream out(&file);
-	out.setVersion(QDataStream::Qt_4_6);
-	out << s_openings << s_root;
-}
-
-EcoNode::EcoNode()
-	: m_ecoCode(-1),
-	  m_opening(-1)
-{
-}
-
-EcoNode::~EcoNode()
-{
-	qDeleteAll(m_children);
+	file.write(s_data, s_size);
 }
 
 bool EcoNode::isLeaf() const
 {
-	return m_ecoCode != -1;
+	return qFromLittleEndian(m_ecoCode) != -1;
 }
 
 QString EcoNode::ecoCode() const
 {
-	if (m_ecoCode == -1)
+	const int code = qFromLittleEndian(m_ecoCode);
+	if (code == -1)
 		return QString();
 
-	QChar segment('A' + m_ecoCode / 100);
-	return segment + QString("%1").arg(m_ecoCode % 100, 2, 10, QChar('0'));
+	QChar segment('A' + code / 100);
+	return segment + QString("%1").arg(code % 100, 2, 10, QChar('0'));
 }
 
 QString EcoNode::opening() const
 {
-	return m_opening >= 0 ? s_openings[m_opening] : QString();
+	const qint32 index = qFromLittleEndian(m_opening);
+	if (index < 0 || quint32(index) >= s_openingCount)
+		return QString();
+
+	return trieString(qFromLittleEndian(s_openings[index]));
 }
 
 QString EcoNode::variation() const
 {
-	return m_variation;
+	return trieString(qFromLittleEndian(m_variation));
 }
 
-EcoNode* EcoNode::child(const QString& sanMove) const
+const EcoNode* EcoNode::child(const Chess::GenericMove& move) const
 {
-	return m_children.value(sanMove);
-}
+	const int code = moveCode(move);
+	if (code == -1)
+		return nullptr;
 
-void EcoNode::addChild(const QString& sanMove, EcoNode* child)
-{
-	m_children[sanMove] = child;
+	const quint32 first = qFromLittleEndian(m_firstEdge);
+	const quint32 count = qFromLittleEndian(m_edgeCount);
+	if (first > s_edgeCount || s_edgeCount - first < count)
+		return nullptr;
+
+	const Edge* begin = s_edges + first;
+	const Edge* end = begin + count;
+	const Edge* it = std::lower_bound(begin, end, quint16(code),
+		[](const Edge& edge, quint16 move)
+	{
+		return qFromLittleEndian(edge.move) < move;
+	});
+	if (it == end || qFromLittleEndian(it->move) != code)
+		return nullptr;
+
+	const quint32 node = qFromLittleEndian(it->node);
+	return node < s_nodeCount ? s_nodes + node : nullptr;
 }
@@ -20,9 +20,7 @@
 #define ECONODE_H
 
 #include <QString>
-#include <QMap>
 #include "pgngame.h"
-class QDataStream;
 class PgnStream;
 
 /*!
@@ -37,15 +35,18 @@ class PgnStream;
  * to a PgnGame can be found by traversing the ECO tree as new moves are added
  * to the game, or by passing all the moves at once to the find() function.
  *
+ * The tree is stored as a flat trie: an array of nodes, and an array of
+ * edges sorted by move, so a node's children are found with a binary search
+ * over packed moves. The built-in tree is used straight from the library's
+ * read-only data without parsing it, and EcoNode pointers point into that
+ * data.
+ *
  * \note The Encyclopaedia of Chess Openings only applies to games of standard
  * chess that start from the default starting position.
  */
 class LIB_EXPORT EcoNode
 {
 	public:
-		/*! Destroys the node and its subtree. */
-		~EcoNode();
-
 		/*!
 		 * Returns true if the node is a leaf node; otherwise returns false.
 		 * A leaf node is a node that counts as an opening and has an ECO
@@ -53,10 +54,10 @@ class LIB_EXPORT EcoNode
 		 */
 		bool isLeaf() const;
 		/*!
-		 * Returns the node's child node corresponding to \a sanMove, or 0
+		 * Returns the node's child node corresponding to \a move, or 0
 		 * if no match is found.
 		 */
-		EcoNode* child(const QString& sanMove) const;
+		const EcoNode* child(const Chess::GenericMove& move) const;
 		/*!
 		 * Returns the node's ECO code, or an empty string if the node is
 		 * an inner node.
@@ -79,37 +80,30 @@ class LIB_EXPORT EcoNode
 		static void initialize(PgnStream& in);
 		/*!
 		 * Returns the root node of the ECO tree.
-		 * initialize() is called first if the tree is uninitialized.
+		 * initialize() is called first if the tree is uninitialized,
+		 * so this function is safe to call from several threads.
 		 */
 		static const EcoNode* root();
 		/*!
 		 * Returns the deepest node (closest to the leaves) that matches the
 		 * opening sequence in \a moves.
+		 * The tree is initialized through root().
 		 */
 		static const EcoNode* find(const QVector<PgnGame::MoveData>& moves);
 		/*! Writes the ECO tree in binary format to \a fileName. */
 		static void write(const QString& fileName);
 
 	private:
-		friend LIB_EXPORT QDataStream& operator<<(QDataStream& out, const EcoNode* node);
-		friend LIB_EXPORT QDataStream& operator>>(QDataStream& in, EcoNode*& node);
-
+		// The nodes are never created, only mapped over the trie data
 		EcoNode();
-		void addChild(const QString& sanMove, EcoNode* child);
+		~EcoNode();
 
+		// Little-endian fields of the trie data
+		quint32 m_firstEdge;
+		quint16 m_edgeCount;
 		qint16 m_ecoCode;
 		qint32 m_opening;
-		QString m_variation;
-
-		QMap<QString, EcoNode*> m_children;
+		quint32 m_variation;
 };
 
-/*! Writes the node \a node to stream \a out. */
-extern LIB_EXPORT QDataStream& operator<<(QDataStream& out, const EcoNode* node);
-/*!
- * Reads a node from stream \a in into \a node.
- * \a node should be a null or uninitialized pointer.
- */
-extern LIB_EXPORT QDataStream& operator>>(QDataStream& in, EcoNode*& node);
-
 #endif // ECONODE_H
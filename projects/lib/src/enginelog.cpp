@@ -0,0 +1,345 @@
+/*
+    This file is part of Cute Chess.
+    Copyright (C) 2008-2018 Cute Chess authors
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "enginelog.h"
+#include <QFile>
+
+namespace {
+
+// Longer lines are truncated to keep the memory usage bounded
+const int s_maxLineLength = 16384;
+
+// Time the writer thread sleeps when there's nothing to write
+const unsigned long s_idleSleep = 10;
+
+} // anonymous namespace
+
+QAtomicPointer<EngineLog> EngineLog::s_active;
+
+EngineLog::EngineLog(const QString& dir,
+		     FileMode mode,
+		     int capacity,
+		     QObject* parent)
+	: QThread(parent),
+	  m_dir(dir),
+	  m_mode(mode),
+	  m_echo(false),
+	  m_cells(nullptr),
+	  m_mask(0),
+	  m_enqueuePos(0),
+	  m_dequeuePos(0),
+	  m_dropped(0),
+	  m_stopping(0),
+	  m_reportedDrops(0),
+	  m_gameCount(0)
+{
+	Q_ASSERT(capacity > 0);
+
+	quint32 size = 2;
+	while (size < quint32(capacity))
+		size *= 2;
+	m_mask = size - 1;
+
+	m_cells = new Cell[size];
+	for (quint32 i = 0; i < size; i++)
+		m_cells[i].sequence.storeRelease(i);
+
+	m_timer.start();
+}
+
+EngineLog::~EngineLog()
+{
+	finish();
+	delete[] m_cells;
+}
+
+EngineLog* EngineLog::active()
+{
+	return s_active.loadAcquire();
+}
+
+void EngineLog::setEchoEnabled(bool enabled)
+{
+	Q_ASSERT(!isRunning());
+	m_echo = enabled;
+}
+
+bool EngineLog::isEchoEnabled() const
+{
+	return m_echo;
+}
+
+bool EngineLog::activate()
+{
+	if (!m_dir.mkpath("."))
+	{
+		qWarning("Cannot create engine log directory %s",
+			 qUtf8Printable(m_dir.path()));
+		return false;
+	}
+
+	m_stopping.storeRelease(0);
+	start(QThread::LowPriority);
+	s_active.storeRelease(this);
+
+	return true;
+}
+
+void EngineLog::finish()
+{
+	s_active.testAndSetOrdered(this, nullptr);
+	if (!isRunning())
+		return;
+
+	m_stopping.storeRelease(1);
+	wait();
+}
+
+quint32 EngineLog::droppedCount() const
+{
+	return m_dropped.loadAcquire();
+}
+
+bool EngineLog::addLine(int engineId, Direction dir, const QByteArray& line)
+{
+	Record record;
+	record.time = m_timer.elapsed();
+	record.engine = engineId;
+	record.type = (dir == ToEngine) ? LineToEngine : LineFromEngine;
+	record.game = 0;
+	record.data = line.left(s_maxLineLength);
+
+	return push(record);
+}
+
+bool EngineLog::addName(int engineId, const QString& name)
+{
+	Record record;
+	record.time = m_timer.elapsed();
+	record.engine = engineId;
+	record.type = EngineName;
+	record.game = 0;
+	record.data = name.toUtf8();
+
+	return push(record);
+}
+
+bool EngineLog::addGame(int engineId, const void* game)
+{
+	Record record;
+	record.time = m_timer.elapsed();
+	record.engine = engineId;
+	record.type = GameStart;
+	record.game = quintptr(game);
+
+	return push(record);
+}
+
+bool EngineLog::push(Record& record)
+{
+	// Bounded multi-producer queue: a cell can be written when its
+	// sequence number equals the enqueue position, and read when it
+	// equals the position + 1.
+	Cell* cell = nullptr;
+	quint32 pos = m_enqueuePos.loadAcquire();
+	for (;;)
+	{
+		cell = &m_cells[pos & m_mask];
+		qint32 diff = qint32(cell->sequence.loadAcquire() - pos);
+
+		if (diff == 0)
+		{
+			if (m_enqueuePos.testAndSetRelaxed(pos, pos + 1))
+				break;
+		}
+		else if (diff < 0)
+		{
+			// The buffer is full
+			m_dropped.fetchAndAddRelaxed(1);
+			return false;
+		}
+		pos = m_enqueuePos.loadAcquire();
+	}
+
+	qSwap(cell->record, record);
+	cell->sequence.storeRelease(pos + 1);
+
+	return true;
+}
+
+bool EngineLog::pop(Record& record)
+{
+	Cell* cell = &m_cells[m_dequeuePos & m_mask];
+	qint32 diff = qint32(cell->sequence.loadAcquire() - (m_dequeuePos + 1));
+	if (diff < 0)
+		return false;
+
+	qSwap(cell->record, record);
+	cell->record.data.clear();
+	cell->sequence.storeRelease(m_dequeuePos + m_mask + 1);
+	m_dequeuePos++;
+
+	return true;
+}
+
+void EngineLog::run()
+{
+	Record record;
+
+	for (;;)
+	{
+		// Read the flag before draining so that the records pushed
+		// before finish() was called are always written.
+		bool stopping = m_stopping.loadAcquire();
+
+		int count = 0;
+		while (pop(record))
+		{
+			writeRecord(record);
+			count++;
+		}
+		writeDropCount();
+
+		if (stopping)
+			break;
+		if (count == 0)
+		{
+			for (QFile* out : qAsConst(m_files))
+			{
+				if (out != nullptr)
+					out->flush();
+			}
+			msleep(s_idleSleep);
+		}
+	}
+
+	qDeleteAll(m_files);
+	m_files.clear();
+	m_engineFiles.clear();
+	m_fileUsers.clear();
+	m_games.clear();
+}
+
+void EngineLog::writeRecord(const Record& record)
+{
+	if (record.type == EngineName)
+	{
+		m_names[record.engine] = record.data;
+		return;
+	}
+
+	if (record.type == GameStart)
+	{
+		if (m_mode != PerGame)
+			return;
+
+		// The key of a finished game can be reused by a new game,
+		// so a game that already has both engines (or this engine)
+		// is replaced.
+		auto it = m_games.find(record.game);
+		if (it == m_games.end()
+		||  it->engines[1] != -1
+		||  it->engines[0] == record.engine)
+		{
+			GameFile game = { ++m_gameCount, { record.engine, -1 } };
+			it = m_games.insert(record.game, game);
+		}
+		else
+			it->engines[1] = record.engine;
+
+		setEngineFile(record.engine,
+			      QString("game-%1.log").arg(it->number));
+		return;
+	}
+
+	QString fileName = m_engineFiles.value(record.engine);
+	if (fileName.isEmpty())
+	{
+		if (m_mode == PerGame)
+			fileName = "engines.log";
+		else
+			fileName = QString("engine-%1.log").arg(record.engine);
+		setEngineFile(record.engine, fileName);
+	}
+	QFile* out = file(fileName);
+	if (out == nullptr)
+		return;
+
+	QByteArray line;
+	line.reserve(record.data.size() + 64);
+	line += QByteArray::number(record.time);
+	line += (record.type == LineToEngine) ? " >" : " <";
+	line += m_names.value(record.engine);
+	line += '(' + QByteArray::number(record.engine) + "): ";
+	line += record.data;
+	line += '\n';
+
+	out->write(line);
+}
+
+void EngineLog::setEngineFile(int engineId, const QString& fileName)
+{
+	const QString oldName = m_engineFiles.value(engineId);
+	m_engineFiles[engineId] = fileName;
+	m_fileUsers[fileName]++;
+
+	// Close the file of a finished game when the last engine leaves it
+	if (!oldName.isEmpty() && --m_fileUsers[oldName] <= 0)
+	{
+		m_fileUsers.remove(oldName);
+		delete m_files.take(oldName);
+	}
+}
+
+QFile* EngineLog::file(const QString& fileName)
+{
+	auto it = m_files.constFind(fileName);
+	if (it != m_files.constEnd())
+		return it.value();
+
+	QFile* out = new QFile(m_dir.filePath(fileName));
+	if (!out->open(QIODevice::WriteOnly | QIODevice::Append))
+	{
+		qWarning("Cannot open engine log file %s",
+			 qUtf8Printable(out->fileName()));
+		delete out;
+		out = nullptr;
+	}
+
+	// A failed file is remembered as well, so that the warning
+	// is only printed once.
+	m_files.insert(fileName, out);
+	return out;
+}
+
+void EngineLog::writeDropCount()
+{
+	quint32 dropped = m_dropped.loadAcquire();
+	if (dropped == m_reportedDrops)
+		return;
+
+	QByteArray line = QByteArray::number(m_timer.elapsed())
+		+ " *** " + QByteArray::number(dropped - m_reportedDrops)
+		+ " lines dropped, the log writer is too slow\n";
+	for (QFile* out : qAsConst(m_files))
+	{
+		if (out != nullptr)
+			out->write(line);
+	}
+	m_reportedDrops = dropped;
+}
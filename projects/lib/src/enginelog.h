@@ -0,0 +1,206 @@
+/*
+    This file is part of Cute Chess.
+    Copyright (C) 2008-2018 Cute Chess authors
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ENGINELOG_H
+#define ENGINELOG_H
+
+#include <QThread>
+#include <QAtomicInteger>
+#include <QAtomicPointer>
+#include <QElapsedTimer>
+#include <QByteArray>
+#include <QHash>
+#include <QDir>
+class QFile;
+
+/*!
+ * \brief An asynchronous log of engine input and output
+ *
+ * EngineLog collects every line written to and read from the chess
+ * engines without blocking the threads that run the games. The engines
+ * push small binary records into a bounded lock-free ring buffer, and a
+ * background thread formats the records and writes them to log files,
+ * either one file per engine or one file per game.
+ *
+ * If the writer falls behind and the ring buffer is full, new records
+ * are dropped and the number of dropped records is written to the logs.
+ * This keeps memory usage bounded, so the log can stay enabled in long
+ * matches.
+ *
+ * Only one EngineLog can be active at a time.
+ */
+class LIB_EXPORT EngineLog : public QThread
+{
+	Q_OBJECT
+
+	public:
+		/*! The direction of a logged line. */
+		enum Direction
+		{
+			ToEngine,	//!< Line written to the engine
+			FromEngine	//!< Line read from the engine
+		};
+
+		/*! How the log is split into files. */
+		enum FileMode
+		{
+			PerEngine,	//!< One file per engine process
+			PerGame		//!< One file per game
+		};
+
+		/*!
+		 * Creates a new log that writes its files to \a dir.
+		 *
+		 * \a capacity is the number of records the ring buffer can
+		 * hold. It is rounded up to a power of two.
+		 */
+		EngineLog(const QString& dir,
+			  FileMode mode,
+			  int capacity = 65536,
+			  QObject* parent = nullptr);
+		/*! Finishes and destroys the log. */
+		virtual ~EngineLog();
+
+		/*!
+		 * Returns the active log, or 0 if engine I/O is not
+		 * being logged.
+		 */
+		static EngineLog* active();
+
+		/*!
+		 * Sets echo mode to \a enabled.
+		 *
+		 * By default the engines don't emit
+		 * ChessPlayer::debugMessage() for the lines that go to the
+		 * log. In echo mode they emit it as well, so the lines can
+		 * also be shown on a console. This must be set before
+		 * activate().
+		 */
+		void setEchoEnabled(bool enabled);
+		/*! Returns true if echo mode is enabled. */
+		bool isEchoEnabled() const;
+
+		/*!
+		 * Starts the writer thread and makes this the active log.
+		 *
+		 * Returns false if the log directory can't be created.
+		 */
+		bool activate();
+		/*!
+		 * Deactivates the log, writes the remaining records and
+		 * stops the writer thread.
+		 *
+		 * This should be called after the engines have stopped.
+		 */
+		void finish();
+
+		/*!
+		 * Logs \a line of engine \a engineId going in direction \a dir.
+		 *
+		 * This function is thread-safe and never blocks. Returns
+		 * false if the ring buffer is full and the line was dropped.
+		 */
+		bool addLine(int engineId, Direction dir, const QByteArray& line);
+		/*!
+		 * Logs the name \a name of engine \a engineId.
+		 *
+		 * The name is used for the lines that follow. Returns false
+		 * if the ring buffer is full, in which case the caller must
+		 * send the name again before its next line.
+		 */
+		bool addName(int engineId, const QString& name);
+		/*!
+		 * Logs the start of a new game for engine \a engineId.
+		 *
+		 * Both players of the same game must use the same \a game key.
+		 * The lines that follow are written to the game's file in
+		 * PerGame mode. Returns false if the ring buffer is full, in
+		 * which case the caller must send the game again before its
+		 * next line.
+		 */
+		bool addGame(int engineId, const void* game);
+
+		/*! Returns the number of records dropped so far. */
+		quint32 droppedCount() const;
+
+	protected:
+		// Inherited from QThread
+		virtual void run();
+
+	private:
+		enum RecordType
+		{
+			LineToEngine,
+			LineFromEngine,
+			EngineName,
+			GameStart
+		};
+
+		struct Record
+		{
+			qint64 time;
+			int engine;
+			int type;
+			quintptr game;
+			QByteArray data;
+		};
+
+		struct Cell
+		{
+			QAtomicInteger<quint32> sequence;
+			Record record;
+		};
+
+		struct GameFile
+		{
+			int number;
+			int engines[2];
+		};
+
+		bool push(Record& record);
+		bool pop(Record& record);
+		void writeRecord(const Record& record);
+		void setEngineFile(int engineId, const QString& fileName);
+		QFile* file(const QString& fileName);
+		void writeDropCount();
+
+		static QAtomicPointer<EngineLog> s_active;
+
+		QDir m_dir;
+		FileMode m_mode;
+		bool m_echo;
+		QElapsedTimer m_timer;
+
+		Cell* m_cells;
+		quint32 m_mask;
+		QAtomicInteger<quint32> m_enqueuePos;
+		quint32 m_dequeuePos;
+		QAtomicInteger<quint32> m_dropped;
+		QAtomicInt m_stopping;
+
+		// Used only by the writer thread
+		quint32 m_reportedDrops;
+		int m_gameCount;
+		QHash<QString, QFile*> m_files;
+		QHash<int, QByteArray> m_names;
+		QHash<int, QString> m_engineFiles;
+		QHash<QString, int> m_fileUsers;
+		QHash<quintptr, GameFile> m_games;
+};
+
+#endif // ENGINELOG_H
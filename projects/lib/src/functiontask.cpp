@@ -0,0 +1,41 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "functiontask.h"
+#include <QThreadPool>
+
+FunctionTask::FunctionTask(const std::function<void()>& function)
+	: m_function(function)
+{
+}
+
+void FunctionTask::parallelFor(QThreadPool* pool,
+			       int count,
+			       const std::function<void(int)>& function)
+{
+	for (int i = 1; i < count; i++)
+		pool->start(new FunctionTask(std::bind(function, i)));
+	function(0);
+	if (count > 1)
+		pool->waitForDone();
+}
+
+void FunctionTask::run()
+{
+	m_function();
+}
@@ -0,0 +1,57 @@
+/*
+    This file is part of Cute Chess.
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef FUNCTIONTASK_H
+#define FUNCTIONTASK_H
+
+#include <functional>
+#include <QRunnable>
+class QThreadPool;
+
+/*!
+ * \brief A QRunnable that calls a function
+ *
+ * The library only links QtCore, so its parallel loops run their
+ * functions on a QThreadPool through FunctionTask instead of
+ * QtConcurrent. The pool deletes the task when it's done.
+ */
+class LIB_EXPORT FunctionTask : public QRunnable
+{
+	public:
+		/*! Creates a new task that calls \a function. */
+		explicit FunctionTask(const std::function<void()>& function);
+
+		/*!
+		 * Calls \a function with the arguments 0 to \a count - 1
+		 * in parallel and waits for all the calls to finish.
+		 *
+		 * Call 0 is made in the calling thread and the others in
+		 * \a pool.
+		 */
+		static void parallelFor(QThreadPool* pool,
+					int count,
+					const std::function<void(int)>& function);
+
+		// Inherited from QRunnable
+		virtual void run();
+
+	private:
+		std::function<void()> m_function;
+};
+
+#endif // FUNCTIONTASK_H
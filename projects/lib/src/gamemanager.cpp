@@ -353,6 +353,12 @@ void GameManager::setConcurrency(int concurrency)
 	m_concurrency = concurrency;
 }
 
+int GameManager::freeSlotCount() const
+{
+	return qMax(0, m_concurrency - m_activeQueuedGameCount
+		       - m_gameEntries.size());
+}
+
 void GameManager::cleanupIdleThreads()
 {
 	QList<GameThread*>::iterator it = m_activeThreads.begin();
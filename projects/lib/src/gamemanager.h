@@ -97,6 +97,14 @@ class LIB_EXPORT GameManager : public QObject
 		 * \sa concurrency()
 		 */
 		void setConcurrency(int concurrency);
+		/*!
+		 * Returns the number of game slots that are free for games
+		 * started in Enqueue mode.
+		 *
+		 * Queued games that haven't started yet are counted as
+		 * using a slot.
+		 */
+		int freeSlotCount() const;
 
 		/*!
 		 * Cleans up and deletes all idle game threads
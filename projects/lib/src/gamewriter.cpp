@@ -0,0 +1,405 @@
+/*
+    This file is part of Cute Chess.
+    Copyright (C) 2008-2018 Cute Chess authors
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "gamewriter.h"
+#include <QFile>
+#include <QTextStream>
+#include "gzipfile.h"
+
+#ifdef Q_OS_WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+
+bool isCompressed(const QString& fileName)
+{
+	return fileName.endsWith(".gz", Qt::CaseInsensitive);
+}
+
+bool syncFile(QFile* file)
+{
+#ifdef Q_OS_WIN32
+	return _commit(file->handle()) == 0;
+#else
+	return fsync(file->handle()) == 0;
+#endif
+}
+
+} // anonymous namespace
+
+GameWriter::GameWriter(int capacity, QObject* parent)
+	: QThread(parent),
+	  m_capacity(capacity),
+	  m_flushInterval(0),
+	  m_sync(false),
+	  m_frameSize(100),
+	  m_queuedCount(0),
+	  m_flushedCount(0),
+	  m_flushTarget(0),
+	  m_stopping(false),
+	  m_dirty(false)
+{
+	Q_ASSERT(capacity > 0);
+}
+
+GameWriter::~GameWriter()
+{
+	finish();
+}
+
+void GameWriter::setFlushInterval(int msecs)
+{
+	Q_ASSERT(msecs >= 0);
+
+	QMutexLocker locker(&m_mutex);
+	m_flushInterval = msecs;
+}
+
+int GameWriter::flushInterval() const
+{
+	return m_flushInterval;
+}
+
+void GameWriter::setSyncEnabled(bool enabled)
+{
+	QMutexLocker locker(&m_mutex);
+	m_sync = enabled;
+}
+
+bool GameWriter::isSyncEnabled() const
+{
+	return m_sync;
+}
+
+void GameWriter::setFrameSize(int count)
+{
+	Q_ASSERT(count > 0);
+
+	QMutexLocker locker(&m_mutex);
+	m_frameSize = count;
+}
+
+int GameWriter::frameSize() const
+{
+	return m_frameSize;
+}
+
+void GameWriter::writePgn(const QString& fileName,
+			  const PgnGame& game,
+			  PgnGame::PgnMode mode)
+{
+	Record record;
+	record.fileName = fileName;
+	record.game = game;
+	record.mode = mode;
+	record.isPgn = true;
+
+	push(record);
+}
+
+void GameWriter::writeLine(const QString& fileName, const QString& line)
+{
+	Record record;
+	record.fileName = fileName;
+	record.mode = PgnGame::Verbose;
+	record.line = line;
+	record.isPgn = false;
+
+	push(record);
+}
+
+void GameWriter::push(const Record& record)
+{
+	QMutexLocker locker(&m_mutex);
+
+	if (!isRunning())
+	{
+		m_stopping = false;
+		m_errorString.clear();
+		start();
+	}
+
+	while (m_queue.size() >= m_capacity)
+		m_queueNotFull.wait(&m_mutex);
+
+	m_queue.append(record);
+	m_queuedCount++;
+	m_queueNotEmpty.wakeOne();
+}
+
+void GameWriter::flush()
+{
+	QMutexLocker locker(&m_mutex);
+	if (!isRunning())
+		return;
+
+	const quint64 target = m_queuedCount;
+	m_flushTarget = qMax(m_flushTarget, target);
+	m_queueNotEmpty.wakeOne();
+
+	while (m_flushedCount < target)
+		m_flushed.wait(&m_mutex);
+}
+
+void GameWriter::finish()
+{
+	if (!isRunning())
+		return;
+
+	m_mutex.lock();
+	m_stopping = true;
+	m_queueNotEmpty.wakeOne();
+	m_mutex.unlock();
+
+	wait();
+}
+
+bool GameWriter::hasError() const
+{
+	QMutexLocker locker(&m_mutex);
+	return !m_errorString.isEmpty();
+}
+
+QString GameWriter::errorString() const
+{
+	QMutexLocker locker(&m_mutex);
+	return m_errorString;
+}
+
+void GameWriter::setError(const QString& message)
+{
+	qWarning("%s", qUtf8Printable(message));
+
+	QMutexLocker locker(&m_mutex);
+	if (m_errorString.isEmpty())
+		m_errorString = message;
+}
+
+void GameWriter::run()
+{
+	QList<Record> batch;
+	m_dirty = false;
+	m_flushTimer.start();
+
+	for (;;)
+	{
+		bool stopping;
+		bool forced;
+		bool flushNow;
+		bool sync;
+		int frameSize;
+		quint64 batchEnd;
+
+		m_mutex.lock();
+		for (;;)
+		{
+			if (!m_queue.isEmpty()
+			||  m_stopping
+			||  m_flushedCount < m_flushTarget)
+				break;
+
+			// Unflushed data waits at most one flush interval
+			if (!m_dirty)
+				m_queueNotEmpty.wait(&m_mutex);
+			else
+			{
+				qint64 remaining = m_flushInterval - m_flushTimer.elapsed();
+				if (remaining <= 0)
+					break;
+				m_queueNotEmpty.wait(&m_mutex, remaining);
+			}
+		}
+
+		batch.swap(m_queue);
+		batchEnd = m_queuedCount;
+		stopping = m_stopping;
+		sync = m_sync;
+		frameSize = m_frameSize;
+		forced = stopping || m_flushedCount < m_flushTarget;
+		flushNow = forced
+			|| m_flushInterval == 0
+			|| m_flushTimer.elapsed() >= m_flushInterval;
+		m_queueNotFull.wakeAll();
+		m_mutex.unlock();
+
+		writeBatch(batch, frameSize);
+		batch.clear();
+
+		if (flushNow)
+		{
+			if (forced)
+				writeFrames();
+			if (m_dirty)
+			{
+				flushFiles();
+				if (sync)
+				{
+					for (QFile* out : qAsConst(m_files))
+					{
+						if (!syncFile(out))
+							setError(QString("Could not sync file %1")
+								 .arg(out->fileName()));
+					}
+				}
+			}
+
+			m_mutex.lock();
+			m_flushedCount = batchEnd;
+			m_flushed.wakeAll();
+			m_mutex.unlock();
+		}
+
+		if (stopping)
+			break;
+	}
+
+	qDeleteAll(m_files);
+	m_files.clear();
+	m_frames.clear();
+}
+
+void GameWriter::writeBatch(const QList<Record>& batch, int frameSize)
+{
+	if (batch.isEmpty())
+		return;
+
+	// Each file is written with a single call
+	QList<QString> fileNames;
+	QHash<QString, QByteArray> buffers;
+
+	for (const Record& record : batch)
+	{
+		auto it = buffers.find(record.fileName);
+		if (it == buffers.end())
+		{
+			fileNames.append(record.fileName);
+			it = buffers.insert(record.fileName, QByteArray());
+		}
+
+		QByteArray text;
+		if (record.isPgn)
+		{
+			QString str;
+			QTextStream out(&str);
+			if (!record.game.write(out, record.mode))
+				setError(QString("Could not write a PGN game to %1")
+					 .arg(record.fileName));
+			out.flush();
+			text = str.toUtf8();
+		}
+		else
+			text = record.line.toUtf8() + '\n';
+
+		if (!isCompressed(record.fileName))
+		{
+			it->append(text);
+			continue;
+		}
+
+		Frame& frame = m_frames[record.fileName];
+		frame.data.append(text);
+		if (++frame.count >= frameSize)
+		{
+			it->append(GzipFile::compress(frame.data));
+			frame.data.clear();
+			frame.count = 0;
+		}
+	}
+
+	for (const QString& fileName : qAsConst(fileNames))
+	{
+		QFile* out = file(fileName);
+		if (out == nullptr)
+			continue;
+
+		const QByteArray& buffer = buffers[fileName];
+		if (buffer.isEmpty())
+			continue;
+		if (out->write(buffer) != buffer.size()
+		||  out->error() != QFile::NoError)
+		{
+			setError(QString("Could not write to file %1")
+				 .arg(fileName));
+			out->unsetError();
+		}
+	}
+
+	m_dirty = true;
+}
+
+void GameWriter::writeFrames()
+{
+	for (auto it = m_frames.begin(); it != m_frames.end(); ++it)
+	{
+		if (it->count == 0)
+			continue;
+
+		QFile* out = file(it.key());
+		const QByteArray data = GzipFile::compress(it->data);
+		if (out == nullptr || out->write(data) != data.size())
+			setError(QString("Could not write to file %1")
+				 .arg(it.key()));
+
+		it->data.clear();
+		it->count = 0;
+		m_dirty = true;
+	}
+}
+
+void GameWriter::flushFiles()
+{
+	for (QFile* out : qAsConst(m_files))
+	{
+		if (!out->flush())
+			setError(QString("Could not flush file %1")
+				 .arg(out->fileName()));
+	}
+
+	m_dirty = false;
+	m_flushTimer.restart();
+}
+
+QFile* GameWriter::file(const QString& fileName)
+{
+	QFile* out = m_files.value(fileName);
+	if (out != nullptr && !out->exists())
+	{
+		qWarning("File %s does not exist. Reopening...",
+			 qUtf8Printable(fileName));
+		delete m_files.take(fileName);
+		out = nullptr;
+	}
+
+	if (out == nullptr)
+	{
+		out = new QFile(fileName);
+		if (!out->open(QIODevice::WriteOnly | QIODevice::Append))
+		{
+			setError(QString("Could not open file %1")
+				 .arg(fileName));
+			delete out;
+			return nullptr;
+		}
+		m_files.insert(fileName, out);
+	}
+
+	return out;
+}
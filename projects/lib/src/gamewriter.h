@@ -0,0 +1,172 @@
+/*
+    This file is part of Cute Chess.
+    Copyright (C) 2008-2018 Cute Chess authors
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GAMEWRITER_H
+#define GAMEWRITER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QElapsedTimer>
+#include <QList>
+#include <QHash>
+#include "pgngame.h"
+class QFile;
+
+/*!
+ * \brief An asynchronous writer of PGN games and EPD positions
+ *
+ * GameWriter moves the formatting and writing of finished games off
+ * the thread that schedules the games. Records are queued in the order
+ * they are added and written in that order, so the order of the games
+ * in each file is preserved.
+ *
+ * The writer thread takes all queued records at once, formats them and
+ * writes each file with a single call. By default the files are flushed
+ * after every batch; a flush interval can be set to flush less often on
+ * slow disks, and the data can also be synced to the storage device.
+ *
+ * Files whose name ends in ".gz" are compressed with gzip. Every
+ * frameSize() records are compressed into a separate gzip member, so
+ * the members can be decompressed independently and GzipFile can seek
+ * in the file quickly. An unfinished member is written only when
+ * flush() or finish() is called, so up to frameSize() - 1 records are
+ * lost if the process crashes. Tournament flushes the writer at every
+ * checkpoint, so a resumed tournament doesn't miss them.
+ *
+ * The queue is bounded: if the writer falls behind by \a capacity
+ * records, adding a record waits until there's room in the queue. No
+ * records are ever dropped.
+ *
+ * Write errors happen in the writer thread, so they can't be returned
+ * from writePgn() or writeLine(). The first error is kept and can be
+ * checked with hasError() after flush() or finish().
+ */
+class LIB_EXPORT GameWriter : public QThread
+{
+	Q_OBJECT
+
+	public:
+		/*!
+		 * Creates a new writer whose queue holds at most
+		 * \a capacity records.
+		 */
+		explicit GameWriter(int capacity = 1024, QObject* parent = nullptr);
+		/*! Writes the remaining records and destroys the writer. */
+		virtual ~GameWriter();
+
+		/*!
+		 * Sets the flush interval to \a msecs milliseconds.
+		 *
+		 * If \a msecs is 0 (the default), the files are flushed
+		 * after every batch of records.
+		 */
+		void setFlushInterval(int msecs);
+		/*! Returns the flush interval in milliseconds. */
+		int flushInterval() const;
+		/*!
+		 * Sets syncing to \a enabled.
+		 *
+		 * If \a enabled is true, the files are synced to the storage
+		 * device every time they are flushed. The default is false.
+		 */
+		void setSyncEnabled(bool enabled);
+		/*! Returns true if the files are synced when flushed. */
+		bool isSyncEnabled() const;
+		/*!
+		 * Sets the number of records in each member of a compressed
+		 * file to \a count. The default is 100.
+		 */
+		void setFrameSize(int count);
+		/*! Returns the number of records in each compressed member. */
+		int frameSize() const;
+
+		/*!
+		 * Queues \a game to be appended to PGN file \a fileName
+		 * in mode \a mode.
+		 */
+		void writePgn(const QString& fileName,
+			      const PgnGame& game,
+			      PgnGame::PgnMode mode);
+		/*! Queues \a line to be appended to text file \a fileName. */
+		void writeLine(const QString& fileName, const QString& line);
+
+		/*!
+		 * Waits until all the records queued so far have been
+		 * written and flushed.
+		 */
+		void flush();
+		/*! Writes the remaining records and stops the writer thread. */
+		void finish();
+
+		/*! Returns true if writing or flushing a file has failed. */
+		bool hasError() const;
+		/*! Returns a description of the first error. */
+		QString errorString() const;
+
+	protected:
+		// Inherited from QThread
+		virtual void run();
+
+	private:
+		struct Record
+		{
+			QString fileName;
+			PgnGame game;
+			PgnGame::PgnMode mode;
+			QString line;
+			bool isPgn;
+		};
+
+		struct Frame
+		{
+			QByteArray data;
+			int count;
+		};
+
+		void push(const Record& record);
+		void writeBatch(const QList<Record>& batch, int frameSize);
+		void writeFrames();
+		void flushFiles();
+		void setError(const QString& message);
+		QFile* file(const QString& fileName);
+
+		int m_capacity;
+		int m_flushInterval;
+		bool m_sync;
+		int m_frameSize;
+
+		mutable QMutex m_mutex;
+		QWaitCondition m_queueNotEmpty;
+		QWaitCondition m_queueNotFull;
+		QWaitCondition m_flushed;
+		QList<Record> m_queue;
+		quint64 m_queuedCount;
+		quint64 m_flushedCount;
+		quint64 m_flushTarget;
+		bool m_stopping;
+		QString m_errorString;
+
+		// Used only by the writer thread
+		QHash<QString, QFile*> m_files;
+		QHash<QString, Frame> m_frames;
+		QElapsedTimer m_flushTimer;
+		bool m_dirty;
+};
+
+#endif // GAMEWRITER_H
@@ -19,11 +19,13 @@
 
 #include "gauntlettournament.h"
 #include <algorithm>
+#include <QDataStream>
 #include "chessgame.h"
 
 GauntletTournament::GauntletTournament(GameManager* gameManager,
 				       QObject *parent)
 	: Tournament(gameManager, parent),
+	  m_currentPlayer(0),
 	  m_opponent(-1)
 {
 }
@@ -33,6 +35,46 @@ QString GauntletTournament::type() const
 	return "gauntlet";
 }
 
+QString GauntletTournament::results() const
+{
+	QString ret(Tournament::results());
+	if (m_sprts.isEmpty())
+		return ret;
+
+	ret += "\nElimination:";
+	for (int i = seedCount(); i < m_sprts.size(); i++)
+	{
+		const Sprt::Status status = m_sprts.at(i).status();
+		QString state;
+		if (status.result == Sprt::AcceptH0)
+			state = "eliminated (H0)";
+		else if (status.result == Sprt::AcceptH1)
+			state = "accepted (H1)";
+		else
+			state = "undecided";
+
+		ret += QString("\n%1: %2, llr %3, lbound %4, ubound %5")
+			.arg(playerAt(i).name())
+			.arg(state)
+			.arg(status.llr, 0, 'g', 3)
+			.arg(status.lBound, 0, 'g', 3)
+			.arg(status.uBound, 0, 'g', 3);
+	}
+
+	return ret;
+}
+
+void GauntletTournament::setElimination(double elo0, double elo1,
+					double alpha, double beta)
+{
+	m_eliminationSprt.initialize(elo0, elo1, alpha, beta);
+}
+
+bool GauntletTournament::hasElimination() const
+{
+	return !m_eliminationSprt.isNull();
+}
+
 void GauntletTournament::onGameAboutToStart(ChessGame* game,
 					    const PlayerBuilder* white,
 					    const PlayerBuilder* black)
@@ -50,6 +92,10 @@ void GauntletTournament::initializePairing()
 
 	m_opponent = seedCount();
 	m_currentPlayer = 0;
+
+	m_sprts.clear();
+	if (hasElimination())
+		m_sprts.fill(m_eliminationSprt, playerCount());
 }
 
 int GauntletTournament::gamesPerCycle() const
@@ -61,26 +107,137 @@ TournamentPair* GauntletTournament::nextPair(int gameNumber)
 {
 	if (gameNumber >= finalGameCount())
 		return nullptr;
+	if (!m_sprts.isEmpty() && !hasMoreGames(gameNumber))
+		return nullptr;
 	if (gameNumber % gamesPerEncounter() != 0)
 		return currentPair();
 
-	if (m_opponent >= playerCount())
+	// With elimination the encounters of decided challengers are
+	// skipped, so the free game slots go to the undecided ones.
+	// hasMoreGames() guarantees that an encounter is found.
+	for (;;)
 	{
-		m_opponent = seedCount();
-		if (++m_currentPlayer >= seedCount())
+		if (m_opponent >= playerCount())
 		{
-			m_currentPlayer = 0;
-			setCurrentRound(currentRound() + 1);
+			m_opponent = seedCount();
+			if (++m_currentPlayer >= seedCount())
+			{
+				m_currentPlayer = 0;
+				setCurrentRound(currentRound() + 1);
+			}
 		}
+
+		int white = m_currentPlayer;
+		int black = m_opponent++;
+
+		if (!isDecided(black))
+			return pair(white, black);
 	}
+}
 
-	int white = m_currentPlayer;
-	int black = m_opponent++;
+void GauntletTournament::writePairingState(QDataStream& out) const
+{
+	out << qint32(m_currentPlayer) << qint32(m_opponent)
+	    << qint32(m_sprts.size());
+	for (const Sprt& sprt : m_sprts)
+		sprt.write(out);
+}
 
-	return pair(white, black);
+bool GauntletTournament::readPairingState(QDataStream& in)
+{
+	qint32 currentPlayer;
+	qint32 opponent;
+	qint32 sprtCount;
+	in >> currentPlayer >> opponent >> sprtCount;
+	if (in.status() != QDataStream::Ok
+	||  sprtCount != m_sprts.size())
+		return false;
+
+	for (Sprt& sprt : m_sprts)
+	{
+		if (!sprt.read(in))
+			return false;
+	}
+
+	m_currentPlayer = currentPlayer;
+	m_opponent = opponent;
+	return true;
 }
 
 bool GauntletTournament::hasGauntletRatingsOrder() const
 {
 	return true;
 }
+
+void GauntletTournament::addScore(int player,
+				  Chess::Side side,
+				  Chess::rMobResult gResult,
+				  Chess::rMobKomi komi)
+{
+	const qreal oldPoints = playerPoints(player);
+	Tournament::addScore(player, side, gResult, komi);
+
+	if (player < seedCount() || player >= m_sprts.size())
+		return;
+
+	// Games that were already running when the challenger was
+	// decided don't change the result of the test
+	Sprt& sprt = m_sprts[player];
+	if (sprt.status().result != Sprt::Continue)
+		return;
+
+	sprt.addGameResult(playerPoints(player) - oldPoints);
+}
+
+bool GauntletTournament::areAllGamesFinished() const
+{
+	if (m_sprts.isEmpty())
+		return Tournament::areAllGamesFinished();
+
+	return gamesInProgress() == 0
+	    && !hasMoreGames(finishedGameCount());
+}
+
+bool GauntletTournament::hasMoreGames(int gameNumber) const
+{
+	// An encounter that was already started is finished even if its
+	// challenger was decided, to keep the openings balanced
+	if (gameNumber % gamesPerEncounter() != 0)
+		return true;
+	if (undecidedCount() == 0)
+		return false;
+	if (currentRound() < roundMultiplier())
+		return true;
+
+	// Last round: look for an undecided challenger later in the cycle
+	int black = m_opponent;
+	for (int white = m_currentPlayer; white < seedCount(); white++)
+	{
+		for (; black < playerCount(); black++)
+		{
+			if (!isDecided(black))
+				return true;
+		}
+		black = seedCount();
+	}
+
+	return false;
+}
+
+bool GauntletTournament::isDecided(int player) const
+{
+	if (player >= m_sprts.size())
+		return false;
+	return m_sprts.at(player).status().result != Sprt::Continue;
+}
+
+int GauntletTournament::undecidedCount() const
+{
+	int count = 0;
+	for (int i = seedCount(); i < m_sprts.size(); i++)
+	{
+		if (!isDecided(i))
+			count++;
+	}
+	return count;
+}
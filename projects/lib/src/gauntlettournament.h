@@ -20,12 +20,19 @@
 #define GAUNTLETTOURNAMENT_H
 
 #include "tournament.h"
+#include <QVector>
+#include "sprt.h"
 
 /*!
  * \brief Gauntlet type chess tournament.
  *
  * In a Gauntlet tournament the first participant plays
  * against all the others.
+ *
+ * With successive elimination each challenger has its own SPRT
+ * against the gauntlet player(s). A challenger whose test is decided
+ * gets no new games, so the freed game slots go to the challengers
+ * that are still undecided.
  */
 class LIB_EXPORT GauntletTournament : public Tournament
 {
@@ -37,6 +44,23 @@ class LIB_EXPORT GauntletTournament : public Tournament
 					    QObject *parent = nullptr);
 		// Inherited from Tournament
 		virtual QString type() const;
+		virtual QString results() const;
+
+		/*!
+		 * Enables successive elimination of the challengers.
+		 *
+		 * Each challenger is tested with an SPRT using the
+		 * parameters \a elo0, \a elo1, \a alpha and \a beta from
+		 * the challenger's point of view (see Sprt::initialize()).
+		 * Once a test accepts either hypothesis, no more games are
+		 * started for that challenger. The tournament ends when
+		 * every challenger has been decided or has played all of
+		 * its games.
+		 */
+		void setElimination(double elo0, double elo1,
+				    double alpha, double beta);
+		/*! Returns true if successive elimination is enabled. */
+		bool hasElimination() const;
 
 	protected:
 		// Inherited from Tournament
@@ -46,11 +70,21 @@ class LIB_EXPORT GauntletTournament : public Tournament
 		virtual void initializePairing();
 		virtual int gamesPerCycle() const;
 		virtual TournamentPair* nextPair(int gameNumber);
+		virtual void writePairingState(QDataStream& out) const;
+		virtual bool readPairingState(QDataStream& in);
 		virtual bool hasGauntletRatingsOrder() const;
+		virtual void addScore(int player, Chess::Side side, Chess::rMobResult gResult, Chess::rMobKomi komi);
+		virtual bool areAllGamesFinished() const;
 
 	private:
+		bool isDecided(int player) const;
+		int undecidedCount() const;
+		bool hasMoreGames(int gameNumber) const;
+
 		int m_currentPlayer;
 		int m_opponent;
+		Sprt m_eliminationSprt;
+		QVector<Sprt> m_sprts;
 };
 
 #endif // GAUNTLETTOURNAMENT_H
@@ -0,0 +1,391 @@
+/*
+    This file is part of Cute Chess.
+    Copyright (C) 2008-2018 Cute Chess authors
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "gzipfile.h"
+#include <cstring>
+
+// The tablebase code defines Z_PREFIX for the whole library, but the
+// system zlib doesn't use prefixed names.
+#undef Z_PREFIX
+#include <zlib.h>
+
+namespace {
+
+const int s_bufferSize = 65536;
+
+// Maximum window size with a gzip header and trailer
+const int s_windowBits = 15 + 16;
+
+} // anonymous namespace
+
+struct GzipFile::Stream
+{
+	z_stream zs;
+};
+
+GzipFile::GzipFile(const QString& fileName, QObject* parent)
+	: QIODevice(parent),
+	  m_file(fileName),
+	  m_stream(nullptr),
+	  m_outputPos(0),
+	  m_pos(0),
+	  m_atEnd(false),
+	  m_size(-1)
+{
+}
+
+GzipFile::~GzipFile()
+{
+	close();
+}
+
+bool GzipFile::isCompressed(const QString& fileName)
+{
+	QFile file(fileName);
+	if (!file.open(QIODevice::ReadOnly))
+		return false;
+
+	const QByteArray magic = file.read(2);
+	return magic.size() == 2
+	    && uchar(magic.at(0)) == 0x1f
+	    && uchar(magic.at(1)) == 0x8b;
+}
+
+QIODevice* GzipFile::openFile(const QString& fileName,
+			      QIODevice::OpenMode mode)
+{
+	QIODevice* device;
+	if (isCompressed(fileName))
+		device = new GzipFile(fileName);
+	else
+		device = new QFile(fileName);
+
+	if (!device->open(mode))
+	{
+		delete device;
+		return nullptr;
+	}
+
+	return device;
+}
+
+QByteArray GzipFile::compress(const QByteArray& data)
+{
+	z_stream zs;
+	std::memset(&zs, 0, sizeof(zs));
+	if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+			 s_windowBits, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+		return QByteArray();
+
+	QByteArray out;
+	out.resize(int(deflateBound(&zs, uLong(data.size()))));
+
+	zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.constData()));
+	zs.avail_in = uInt(data.size());
+	zs.next_out = reinterpret_cast<Bytef*>(out.data());
+	zs.avail_out = uInt(out.size());
+
+	int ret = deflate(&zs, Z_FINISH);
+	out.resize(out.size() - int(zs.avail_out));
+	deflateEnd(&zs);
+
+	if (ret != Z_STREAM_END)
+		return QByteArray();
+	return out;
+}
+
+QString GzipFile::fileName() const
+{
+	return m_file.fileName();
+}
+
+qint64 GzipFile::compressedPos() const
+{
+	if (m_stream == nullptr)
+		return 0;
+	return m_file.pos() - m_stream->zs.avail_in;
+}
+
+bool GzipFile::open(OpenMode mode)
+{
+	if (isOpen())
+		return false;
+	if (mode & (WriteOnly | Append))
+	{
+		setErrorString(tr("Compressed files can only be read"));
+		return false;
+	}
+	if (!m_file.open(QIODevice::ReadOnly))
+	{
+		setErrorString(m_file.errorString());
+		return false;
+	}
+
+	m_stream = new Stream;
+	std::memset(&m_stream->zs, 0, sizeof(m_stream->zs));
+	if (inflateInit2(&m_stream->zs, s_windowBits) != Z_OK)
+	{
+		delete m_stream;
+		m_stream = nullptr;
+		m_file.close();
+		setErrorString(tr("Cannot initialize the decompressor"));
+		return false;
+	}
+
+	m_input.resize(s_bufferSize);
+	m_output.clear();
+	m_outputPos = 0;
+	m_pos = 0;
+	m_atEnd = false;
+	m_size = -1;
+	m_members.clear();
+	m_members.append({ 0, 0 });
+
+	// The decompressed data is buffered here, not in QIODevice
+	return QIODevice::open(mode | Unbuffered);
+}
+
+void GzipFile::close()
+{
+	if (!isOpen())
+		return;
+
+	QIODevice::close();
+	inflateEnd(&m_stream->zs);
+	delete m_stream;
+	m_stream = nullptr;
+
+	m_file.close();
+	m_input.clear();
+	m_output.clear();
+	m_members.clear();
+}
+
+bool GzipFile::isSequential() const
+{
+	return false;
+}
+
+bool GzipFile::seek(qint64 pos)
+{
+	if (!isOpen() || pos < 0 || !QIODevice::seek(pos))
+		return false;
+
+	// Start from the nearest known member if it's closer than the
+	// current position
+	int i = m_members.size() - 1;
+	while (i > 0 && m_members.at(i).pos > pos)
+		i--;
+
+	qint64 current = m_pos + m_outputPos;
+	if (pos < current || m_members.at(i).pos > current)
+	{
+		if (!restart(m_members.at(i)))
+			return false;
+		current = m_pos;
+	}
+
+	while (current < pos)
+	{
+		int available = m_output.size() - m_outputPos;
+		if (available == 0)
+		{
+			if (!inflateMore())
+				return false;
+			continue;
+		}
+
+		int n = int(qMin(qint64(available), pos - current));
+		m_outputPos += n;
+		current += n;
+	}
+
+	return true;
+}
+
+bool GzipFile::atEnd() const
+{
+	if (!isOpen())
+		return true;
+	if (m_outputPos < m_output.size())
+		return false;
+
+	// Decompressing more data doesn't move the read position
+	return !const_cast<GzipFile*>(this)->inflateMore();
+}
+
+qint64 GzipFile::size() const
+{
+	if (!isOpen())
+		return 0;
+	if (m_size < 0)
+		m_size = uncompressedSize();
+	return m_size;
+}
+
+qint64 GzipFile::bytesAvailable() const
+{
+	// QIODevice would compute this from size(), which may have to
+	// decompress the whole file
+	return m_output.size() - m_outputPos;
+}
+
+qint64 GzipFile::readData(char* data, qint64 maxSize)
+{
+	qint64 total = 0;
+	while (total < maxSize)
+	{
+		int available = m_output.size() - m_outputPos;
+		if (available == 0)
+		{
+			if (!inflateMore())
+				break;
+			continue;
+		}
+
+		int n = int(qMin(qint64(available), maxSize - total));
+		std::memcpy(data + total, m_output.constData() + m_outputPos, n);
+		m_outputPos += n;
+		total += n;
+	}
+
+	return total;
+}
+
+qint64 GzipFile::writeData(const char* data, qint64 maxSize)
+{
+	Q_UNUSED(data);
+	Q_UNUSED(maxSize);
+	return -1;
+}
+
+bool GzipFile::inflateMore()
+{
+	z_stream& zs = m_stream->zs;
+
+	m_pos += m_output.size();
+	m_output.resize(s_bufferSize);
+	m_outputPos = 0;
+	zs.next_out = reinterpret_cast<Bytef*>(m_output.data());
+	zs.avail_out = uInt(s_bufferSize);
+
+	while (zs.avail_out == uInt(s_bufferSize) && !m_atEnd)
+	{
+		if (zs.avail_in == 0)
+		{
+			qint64 n = m_file.read(m_input.data(), m_input.size());
+			if (n <= 0)
+			{
+				// A truncated member can still have output
+				// pending in the decompressor
+				inflate(&zs, Z_NO_FLUSH);
+				m_atEnd = true;
+				break;
+			}
+			zs.next_in = reinterpret_cast<Bytef*>(m_input.data());
+			zs.avail_in = uInt(n);
+		}
+
+		int ret = inflate(&zs, Z_NO_FLUSH);
+		if (ret == Z_STREAM_END)
+		{
+			// Remember where the next member starts
+			Member member;
+			member.compressedPos = m_file.pos() - zs.avail_in;
+			member.pos = m_pos + (s_bufferSize - zs.avail_out);
+			if (member.pos > m_members.last().pos)
+				m_members.append(member);
+
+			inflateReset(&zs);
+		}
+		else if (ret != Z_OK)
+		{
+			setErrorString(tr("Corrupted compressed data"));
+			m_atEnd = true;
+		}
+	}
+
+	m_output.resize(s_bufferSize - int(zs.avail_out));
+	return !m_output.isEmpty();
+}
+
+bool GzipFile::restart(const Member& member)
+{
+	if (!m_file.seek(member.compressedPos))
+		return false;
+
+	z_stream& zs = m_stream->zs;
+	inflateReset(&zs);
+	zs.avail_in = 0;
+
+	m_output.clear();
+	m_outputPos = 0;
+	m_pos = member.pos;
+	m_atEnd = false;
+
+	return true;
+}
+
+qint64 GzipFile::uncompressedSize() const
+{
+	// Use a separate stream so that the read position isn't changed
+	const Member& member = m_members.last();
+	QFile file(m_file.fileName());
+	if (!file.open(QIODevice::ReadOnly) || !file.seek(member.compressedPos))
+		return member.pos;
+
+	z_stream zs;
+	std::memset(&zs, 0, sizeof(zs));
+	if (inflateInit2(&zs, s_windowBits) != Z_OK)
+		return member.pos;
+
+	QByteArray input(s_bufferSize, 0);
+	QByteArray output(s_bufferSize, 0);
+	qint64 size = member.pos;
+
+	for (;;)
+	{
+		if (zs.avail_in == 0)
+		{
+			qint64 n = file.read(input.data(), input.size());
+			if (n <= 0)
+			{
+				zs.next_out = reinterpret_cast<Bytef*>(output.data());
+				zs.avail_out = uInt(s_bufferSize);
+				inflate(&zs, Z_NO_FLUSH);
+				size += s_bufferSize - zs.avail_out;
+				break;
+			}
+			zs.next_in = reinterpret_cast<Bytef*>(input.data());
+			zs.avail_in = uInt(n);
+		}
+
+		zs.next_out = reinterpret_cast<Bytef*>(output.data());
+		zs.avail_out = uInt(s_bufferSize);
+		int ret = inflate(&zs, Z_NO_FLUSH);
+		size += s_bufferSize - zs.avail_out;
+
+		if (ret == Z_STREAM_END)
+			inflateReset(&zs);
+		else if (ret != Z_OK)
+			break;
+	}
+
+	inflateEnd(&zs);
+	return size;
+}
@@ -0,0 +1,126 @@
+/*
+    This file is part of Cute Chess.
+    Copyright (C) 2008-2018 Cute Chess authors
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GZIPFILE_H
+#define GZIPFILE_H
+
+#include <QIODevice>
+#include <QFile>
+#include <QVector>
+#include <QByteArray>
+
+/*!
+ * \brief A read-only device for gzip-compressed files
+ *
+ * GzipFile decompresses a gzip file on the fly, so that PgnStream and
+ * QTextStream can read compressed PGN and EPD files like plain ones.
+ * Positions and seek() use offsets in the uncompressed data.
+ *
+ * A gzip file can consist of several independently compressed members.
+ * GameWriter starts a new member every few games, and GzipFile
+ * remembers where each member starts, so seeking only has to
+ * decompress the data between the nearest member and the target
+ * position.
+ */
+class LIB_EXPORT GzipFile : public QIODevice
+{
+	Q_OBJECT
+
+	public:
+		/*! Creates a new device for reading file \a fileName. */
+		explicit GzipFile(const QString& fileName, QObject* parent = nullptr);
+		/*! Closes and destroys the device. */
+		virtual ~GzipFile();
+
+		/*!
+		 * Returns true if file \a fileName exists and starts with
+		 * the gzip signature.
+		 */
+		static bool isCompressed(const QString& fileName);
+		/*!
+		 * Opens file \a fileName for reading in mode \a mode.
+		 *
+		 * Returns a GzipFile for a compressed file and a QFile for
+		 * other files, or 0 if the file can't be opened. The caller
+		 * takes ownership of the device.
+		 */
+		static QIODevice* openFile(const QString& fileName,
+					   QIODevice::OpenMode mode = QIODevice::ReadOnly);
+
+		/*!
+		 * Compresses \a data into a complete gzip member.
+		 *
+		 * Members can be appended to a gzip file one after another.
+		 */
+		static QByteArray compress(const QByteArray& data);
+
+		/*! Returns the name of the compressed file. */
+		QString fileName() const;
+		/*!
+		 * Returns the position in the compressed file, eg. for
+		 * showing the progress of reading the file.
+		 */
+		qint64 compressedPos() const;
+
+		/*!
+		 * Returns the size of the uncompressed data.
+		 *
+		 * The size isn't stored in a multi-member file, so the first
+		 * call decompresses the rest of the file from the last
+		 * known member. The result is cached until the file is
+		 * closed.
+		 */
+		virtual qint64 size() const;
+
+		// Inherited from QIODevice
+		virtual bool open(OpenMode mode);
+		virtual void close();
+		virtual bool isSequential() const;
+		virtual bool seek(qint64 pos);
+		virtual bool atEnd() const;
+		virtual qint64 bytesAvailable() const;
+
+	protected:
+		// Inherited from QIODevice
+		virtual qint64 readData(char* data, qint64 maxSize);
+		virtual qint64 writeData(const char* data, qint64 maxSize);
+
+	private:
+		struct Stream;
+		struct Member
+		{
+			qint64 compressedPos;
+			qint64 pos;
+		};
+
+		bool inflateMore();
+		bool restart(const Member& member);
+		qint64 uncompressedSize() const;
+
+		QFile m_file;
+		Stream* m_stream;
+		QByteArray m_input;
+		QByteArray m_output;
+		int m_outputPos;
+		qint64 m_pos;
+		bool m_atEnd;
+		mutable qint64 m_size;
+		QVector<Member> m_members;
+};
+
+#endif // GZIPFILE_H
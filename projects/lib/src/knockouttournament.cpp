@@ -18,6 +18,7 @@
 
 #include "knockouttournament.h"
 #include <QStringList>
+#include <QDataStream>
 #include <QtMath>
 #include "playerbuilder.h"
 #include "mersenne.h"
@@ -210,6 +211,53 @@ bool KnockoutTournament::needMoreGames(const TournamentPair* pair) const
 	return pair->gamesStarted() % 2 != 0;
 }
 
+void KnockoutTournament::writePairingState(QDataStream& out) const
+{
+	out << qint32(m_rounds.size());
+	for (const auto& round : m_rounds)
+	{
+		out << qint32(round.size());
+		for (const TournamentPair* pair : round)
+			out << qint32(pair->firstPlayer())
+			    << qint32(pair->secondPlayer());
+	}
+}
+
+bool KnockoutTournament::readPairingState(QDataStream& in)
+{
+	qint32 roundCount;
+	in >> roundCount;
+	if (in.status() != QDataStream::Ok || roundCount < 1)
+		return false;
+
+	QList< QList<TournamentPair*> > rounds;
+	for (int i = 0; i < roundCount; i++)
+	{
+		qint32 pairCount;
+		in >> pairCount;
+		if (in.status() != QDataStream::Ok || pairCount < 1)
+			return false;
+
+		QList<TournamentPair*> pairs;
+		for (int j = 0; j < pairCount; j++)
+		{
+			qint32 first;
+			qint32 second;
+			in >> first >> second;
+			if (in.status() != QDataStream::Ok
+			||  first < -1 || first >= playerCount()
+			||  second < -1 || second >= playerCount()
+			||  (first == -1 && second == -1))
+				return false;
+			pairs << pair(first, second);
+		}
+		rounds << pairs;
+	}
+
+	m_rounds = rounds;
+	return true;
+}
+
 TournamentPair* KnockoutTournament::nextPair(int gameNumber)
 {
 	Q_UNUSED(gameNumber);
@@ -49,6 +49,8 @@ class LIB_EXPORT KnockoutTournament : public Tournament
 		virtual void initializePairing();
 		virtual int gamesPerCycle() const;
 		virtual TournamentPair* nextPair(int gameNumber);
+		virtual void writePairingState(QDataStream& out) const;
+		virtual bool readPairingState(QDataStream& in);
 		virtual void addScore(int player, Chess::Side side, Chess::rMobResult gResult, Chess::rMobKomi komi);
 		virtual bool areAllGamesFinished() const;
 
@@ -23,6 +23,7 @@ namespace {
 
 int s_index = 0;
 quint32 s_mt[624];
+QMutex s_mutex;
 
 void generateNumbers()
 {
@@ -48,8 +49,7 @@ void Mersenne::initialize(quint32 seed)
 
 quint32 Mersenne::random()
 {
-	static QMutex mutex;
-	mutex.lock();
+	s_mutex.lock();
 
 	if (s_index == 0)
 		generateNumbers();
@@ -61,7 +61,32 @@ quint32 Mersenne::random()
 	y ^= y >> 18;
 
 	s_index = (s_index + 1) % 624;
-	mutex.unlock();
+	s_mutex.unlock();
 
 	return y;
 }
+
+QVector<quint32> Mersenne::state()
+{
+	QMutexLocker locker(&s_mutex);
+
+	QVector<quint32> state(625);
+	for (int i = 0; i < 624; i++)
+		state[i] = s_mt[i];
+	state[624] = s_index;
+
+	return state;
+}
+
+bool Mersenne::setState(const QVector<quint32>& state)
+{
+	if (state.size() != 625 || state.at(624) >= 624)
+		return false;
+
+	QMutexLocker locker(&s_mutex);
+	for (int i = 0; i < 624; i++)
+		s_mt[i] = state.at(i);
+	s_index = state.at(624);
+
+	return true;
+}
@@ -20,6 +20,7 @@
 #define MERSENNE_H
 
 #include <QtGlobal>
+#include <QVector>
 
 /*!
  * \brief A "Mersenne Twister" pseudorandom number generator
@@ -40,6 +41,19 @@ class LIB_EXPORT Mersenne
 		 * This function is thread-safe.
 		 */
 		static quint32 random();
+		/*!
+		 * Returns the internal state of the PRNG.
+		 *
+		 * The state can be restored with setState() to continue
+		 * the same sequence of numbers later.
+		 */
+		static QVector<quint32> state();
+		/*!
+		 * Restores the internal state of the PRNG from \a state.
+		 *
+		 * Returns false if \a state is invalid.
+		 */
+		static bool setState(const QVector<quint32>& state);
 
 	private:
 		Mersenne();
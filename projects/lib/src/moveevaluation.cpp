@@ -25,6 +25,7 @@ MoveEvaluation::MoveEvaluation()
 	  m_selDepth(0),
 	  m_score(NULL_SCORE),
 	  m_time(0),
+	  m_cpuTime(0),
 	  m_pvNumber(0),
 	  m_hashUsage(0),
 	  m_ponderhitRate(0),
@@ -42,6 +43,7 @@ bool MoveEvaluation::operator==(const MoveEvaluation& other) const
 	&&  m_selDepth == other.m_selDepth
 	&&  m_score == other.m_score
 	&&  m_time == other.m_time
+	&&  m_cpuTime == other.m_cpuTime
 	&&  m_pvNumber == other.m_pvNumber
 	&&  m_hashUsage == other.m_hashUsage
 	&&  m_ponderhitRate == other.m_ponderhitRate
@@ -61,6 +63,7 @@ bool MoveEvaluation::operator!=(const MoveEvaluation& other) const
 	||  m_selDepth != other.m_selDepth
 	||  m_score != other.m_score
 	||  m_time != other.m_time
+	||  m_cpuTime != other.m_cpuTime
 	||  m_pvNumber != other.m_pvNumber
 	||  m_hashUsage != other.m_hashUsage
 	||  m_ponderhitRate != other.m_ponderhitRate
@@ -148,6 +151,11 @@ int MoveEvaluation::time() const
 	return m_time;
 }
 
+int MoveEvaluation::cpuTime() const
+{
+	return m_cpuTime;
+}
+
 quint64 MoveEvaluation::nodeCount() const
 {
 	return m_nodeCount;
@@ -197,6 +205,7 @@ void MoveEvaluation::clear()
 	m_selDepth = 0;
 	m_score = NULL_SCORE;
 	m_time = 0;
+	m_cpuTime = 0;
 	m_pvNumber = 0;
 	m_nodeCount = 0;
 	m_nps = 0;
@@ -237,6 +246,11 @@ void MoveEvaluation::setTime(int time)
 	m_time = time;
 }
 
+void MoveEvaluation::setCpuTime(int time)
+{
+	m_cpuTime = time;
+}
+
 void MoveEvaluation::setNodeCount(quint64 nodeCount)
 {
 	m_nodeCount = nodeCount;
@@ -304,4 +318,6 @@ void MoveEvaluation::merge(const MoveEvaluation& other)
 		m_score = other.m_score;
 	if (other.m_time)
 		m_time = other.m_time;
+	if (other.m_cpuTime)
+		m_cpuTime = other.m_cpuTime;
 }
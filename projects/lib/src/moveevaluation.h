@@ -87,6 +87,13 @@ class LIB_EXPORT MoveEvaluation
 		/*! Move time in milliseconds. */
 		int time() const;
 
+		/*!
+		 * CPU time in milliseconds used by the player's process
+		 * during the move.
+		 * \note For human players this is always 0.
+		 */
+		int cpuTime() const;
+
 		/*!
 		 * How many nodes were searched?
 		 * \note For human players this is always 0.
@@ -156,6 +163,9 @@ class LIB_EXPORT MoveEvaluation
 		/*! Sets the move time to \a time. */
 		void setTime(int time);
 
+		/*! Sets the CPU time used during the move to \a time. */
+		void setCpuTime(int time);
+
 		/*! Sets the node count to \a nodeCount. */
 		void setNodeCount(quint64 nodeCount);
 
@@ -190,6 +200,7 @@ class LIB_EXPORT MoveEvaluation
 		int m_selDepth;
 		int m_score;
 		int m_time;
+		int m_cpuTime;
 		int m_pvNumber;
 		int m_hashUsage;
 		int m_ponderhitRate;
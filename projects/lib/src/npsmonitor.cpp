@@ -0,0 +1,154 @@
+/*
+    This file is part of Cute Chess.
+    Copyright (C) 2008-2018 Cute Chess authors
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "npsmonitor.h"
+#include <cmath>
+
+namespace {
+
+// Weight of the newest sample in a slot's moving average
+const double s_smoothing = 0.25;
+
+} // anonymous namespace
+
+NpsMonitor::NpsMonitor()
+	: m_baselineGames(0),
+	  m_threshold(0.0),
+	  m_action(Warn)
+{
+}
+
+bool NpsMonitor::isNull() const
+{
+	return m_baselineGames <= 0;
+}
+
+void NpsMonitor::initialize(int baselineGames, double threshold, Action action)
+{
+	Q_ASSERT(baselineGames > 0);
+	Q_ASSERT(threshold > 0.0);
+
+	m_baselineGames = baselineGames;
+	m_threshold = threshold;
+	m_action = action;
+	m_players.clear();
+	m_slots.clear();
+}
+
+NpsMonitor::Action NpsMonitor::action() const
+{
+	return m_action;
+}
+
+double NpsMonitor::threshold() const
+{
+	return m_threshold;
+}
+
+bool NpsMonitor::addSample(int player, int slot, double nps)
+{
+	Q_ASSERT(player >= 0);
+	if (isNull() || nps <= 0.0)
+		return false;
+
+	if (player >= m_players.size())
+		m_players.resize(player + 1);
+	PlayerData& p = m_players[player];
+
+	// Welford's online algorithm for the mean and variance
+	if (p.count == 0)
+	{
+		p.min = nps;
+		p.max = nps;
+	}
+	p.count++;
+	double delta = nps - p.mean;
+	p.mean += delta / p.count;
+	p.m2 += delta * (nps - p.mean);
+	p.min = qMin(p.min, nps);
+	p.max = qMax(p.max, nps);
+
+	if (p.baselineCount < m_baselineGames)
+	{
+		p.baselineCount++;
+		p.baselineSum += nps;
+		return false;
+	}
+	if (slot < 0)
+		return false;
+
+	if (slot >= m_slots.size())
+		m_slots.resize(slot + 1);
+	SlotData& s = m_slots[slot];
+
+	double ratio = nps / (p.baselineSum / p.baselineCount);
+	if (s.count == 0)
+		s.ratio = ratio;
+	else
+		s.ratio += s_smoothing * (ratio - s.ratio);
+	s.count++;
+	s.ratioSum += ratio;
+
+	bool wasSlow = s.isSlow;
+	s.isSlow = s.ratio < m_threshold;
+
+	return s.isSlow && !wasSlow;
+}
+
+int NpsMonitor::playerCount() const
+{
+	return m_players.size();
+}
+
+NpsMonitor::PlayerStats NpsMonitor::playerStats(int player) const
+{
+	PlayerStats stats = { 0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+	if (player < 0 || player >= m_players.size())
+		return stats;
+
+	const PlayerData& p = m_players.at(player);
+	stats.count = p.count;
+	stats.mean = p.mean;
+	stats.stdev = p.count > 1 ? std::sqrt(p.m2 / (p.count - 1)) : 0.0;
+	stats.min = p.min;
+	stats.max = p.max;
+	if (p.baselineCount >= m_baselineGames)
+		stats.baseline = p.baselineSum / p.baselineCount;
+
+	return stats;
+}
+
+int NpsMonitor::slotCount() const
+{
+	return m_slots.size();
+}
+
+NpsMonitor::SlotStats NpsMonitor::slotStats(int slot) const
+{
+	SlotStats stats = { 0, 0.0, 0.0, false };
+	if (slot < 0 || slot >= m_slots.size())
+		return stats;
+
+	const SlotData& s = m_slots.at(slot);
+	stats.count = s.count;
+	stats.meanRatio = s.count > 0 ? s.ratioSum / s.count : 0.0;
+	stats.ratio = s.ratio;
+	stats.isSlow = s.isSlow;
+
+	return stats;
+}
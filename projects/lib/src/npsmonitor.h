@@ -0,0 +1,140 @@
+/*
+    This file is part of Cute Chess.
+    Copyright (C) 2008-2018 Cute Chess authors
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef NPSMONITOR_H
+#define NPSMONITOR_H
+
+#include <QVector>
+
+/*!
+ * \brief A monitor for engine search speed in a tournament
+ *
+ * The NpsMonitor class collects the average nodes per second (NPS)
+ * of each player in each game. The first games of every player
+ * establish the player's baseline speed. After that every sample is
+ * compared to the baseline and the ratio is tracked per concurrency
+ * slot with an exponential moving average.
+ *
+ * A concurrency slot is a logical index that the tournament gives to
+ * each running game; it isn't tied to a CPU or core, and the engines
+ * of a slot run wherever the operating system schedules them. The
+ * slot statistics therefore can't single out a throttled core. A slot
+ * whose average ratio falls below the threshold means that the
+ * machine as a whole got slower while that slot's games were running,
+ * usually because it is thermally throttled or oversubscribed.
+ */
+class LIB_EXPORT NpsMonitor
+{
+	public:
+		/*! The action to take when a slot is too slow. */
+		enum Action
+		{
+			Warn,	//!< Only print a warning
+			Pause	//!< Stop scheduling games on the slot
+		};
+
+		/*! NPS statistics of a single player. */
+		struct PlayerStats
+		{
+			int count;	//!< Number of samples
+			double mean;	//!< Mean NPS
+			double stdev;	//!< Standard deviation of NPS
+			double min;	//!< Smallest NPS sample
+			double max;	//!< Largest NPS sample
+			double baseline; //!< Baseline NPS, or 0 if not established
+		};
+
+		/*! NPS statistics of a single concurrency slot. */
+		struct SlotStats
+		{
+			int count;	//!< Number of samples compared to a baseline
+			double meanRatio; //!< Mean ratio of NPS to baseline
+			double ratio;	//!< Moving average of the ratio
+			bool isSlow;	//!< True if the moving average is too low
+		};
+
+		/*! Creates a new uninitialized NpsMonitor object. */
+		NpsMonitor();
+
+		/*!
+		 * Returns true if the monitor is uninitialized; otherwise
+		 * returns false.
+		 */
+		bool isNull() const;
+		/*!
+		 * Initializes the monitor.
+		 *
+		 * The first \a baselineGames games of each player establish
+		 * the player's baseline NPS. A slot is considered slow when
+		 * its average NPS ratio drops below \a threshold (eg. 0.85).
+		 */
+		void initialize(int baselineGames, double threshold, Action action);
+		/*! Returns the action to take on slow slots. */
+		Action action() const;
+		/*! Returns the slow slot threshold. */
+		double threshold() const;
+
+		/*!
+		 * Adds the average NPS \a nps of \a player in a game played
+		 * in concurrency slot \a slot.
+		 *
+		 * Samples of zero NPS (eg. from engines that don't report it)
+		 * are ignored, as are negative slot numbers.
+		 *
+		 * Returns true if the slot just became slow; otherwise
+		 * returns false.
+		 */
+		bool addSample(int player, int slot, double nps);
+
+		/*! Returns the number of players with samples. */
+		int playerCount() const;
+		/*! Returns the statistics of \a player. */
+		PlayerStats playerStats(int player) const;
+		/*! Returns the number of slots with samples. */
+		int slotCount() const;
+		/*! Returns the statistics of \a slot. */
+		SlotStats slotStats(int slot) const;
+
+	private:
+		struct PlayerData
+		{
+			int count;
+			double mean;
+			double m2;
+			double min;
+			double max;
+			int baselineCount;
+			double baselineSum;
+		};
+
+		struct SlotData
+		{
+			int count;
+			double ratioSum;
+			double ratio;
+			bool isSlow;
+		};
+
+		int m_baselineGames;
+		double m_threshold;
+		Action m_action;
+		QVector<PlayerData> m_players;
+		QVector<SlotData> m_slots;
+};
+
+#endif // NPSMONITOR_H
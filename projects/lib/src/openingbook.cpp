@@ -17,14 +17,49 @@
 */
 
 #include "openingbook.h"
+#include <functional>
 #include <QString>
 #include <QFile>
+#include <QFileInfo>
 #include <QDataStream>
+#include <QHash>
+#include <QMutex>
+#include <QThread>
+#include <QThreadPool>
 #include <QtDebug>
 #include "pgngame.h"
+#include "pgngameentry.h"
 #include "pgnstream.h"
+#include "gzipfile.h"
+#include "functiontask.h"
 #include "mersenne.h"
 
+namespace {
+
+// Minimum number of games imported by one thread
+const int s_minGamesPerThread = 256;
+
+} // anonymous namespace
+
+struct OpeningBook::MappedFile
+{
+	MappedFile()
+		: data(nullptr),
+		  size(0)
+	{
+	}
+
+	~MappedFile()
+	{
+		if (data != nullptr)
+			file.unmap(const_cast<uchar*>(data));
+	}
+
+	QFile file;
+	const uchar* data;
+	qint64 size;
+};
+
 
 QDataStream& operator>>(QDataStream& in, OpeningBook* book)
 {
@@ -72,6 +107,11 @@ bool OpeningBook::read(const QString& filename)
 
 	if (m_mode == Disk)
 		return true;
+	if (m_mode == Mapped)
+	{
+		m_mappedFile = mapFile(filename);
+		return !m_mappedFile.isNull();
+	}
 
 	m_map.clear();
 	QDataStream in(&file);
@@ -92,10 +132,47 @@ bool OpeningBook::write(const QString& filename) const
 	return true;
 }
 
+QSharedPointer<const OpeningBook::MappedFile> OpeningBook::mapFile(const QString& filename)
+{
+	static QMutex mutex;
+	static QHash<QString, QWeakPointer<const MappedFile>> files;
+
+	const QString path = QFileInfo(filename).canonicalFilePath();
+	if (path.isEmpty())
+		return QSharedPointer<const MappedFile>();
+
+	QMutexLocker locker(&mutex);
+	QSharedPointer<const MappedFile> shared = files.value(path).toStrongRef();
+	if (!shared.isNull())
+		return shared;
+
+	QSharedPointer<MappedFile> mapped(new MappedFile);
+	mapped->file.setFileName(path);
+	if (!mapped->file.open(QIODevice::ReadOnly))
+		return QSharedPointer<const MappedFile>();
+
+	mapped->size = mapped->file.size();
+	if (mapped->size > 0)
+		mapped->data = mapped->file.map(0, mapped->size);
+	if (mapped->data == nullptr)
+	{
+		qWarning("Could not map book file %s", qUtf8Printable(filename));
+		return QSharedPointer<const MappedFile>();
+	}
+
+	files[path] = mapped;
+	return mapped;
+}
+
 void OpeningBook::addEntry(const Entry& entry, quint64 key)
 {
-	Map::iterator it = m_map.find(key);
-	while (it != m_map.end() && it.key() == key)
+	addEntry(m_map, entry, key);
+}
+
+void OpeningBook::addEntry(Map& map, const Entry& entry, quint64 key)
+{
+	Map::iterator it = map.find(key);
+	while (it != map.end() && it.key() == key)
 	{
 		Entry& tmp = it.value();
 		if (tmp.move == entry.move)
@@ -106,10 +183,15 @@ void OpeningBook::addEntry(const Entry& entry, quint64 key)
 		++it;
 	}
 	
-	m_map.insert(key, entry);
+	map.insert(key, entry);
 }
 
 int OpeningBook::import(const PgnGame& pgn, int maxMoves)
+{
+	return importGame(m_map, pgn, maxMoves);
+}
+
+int OpeningBook::importGame(Map& map, const PgnGame& pgn, int maxMoves)
 {
 	Q_ASSERT(maxMoves > 0);
 
@@ -133,7 +215,7 @@ int OpeningBook::import(const PgnGame& pgn, int maxMoves)
 		if ((i % 2) != loserMod)
 		{
 			Entry entry = { moves.at(i).move, weight };
-			addEntry(entry, moves.at(i).key);
+			addEntry(map, entry, moves.at(i).key);
 		}
 	}
 
@@ -161,6 +243,86 @@ int OpeningBook::import(PgnStream& in, int maxMoves)
 	return moveCount;
 }
 
+int OpeningBook::import(const QString& fileName, int maxMoves, int threadCount)
+{
+	Q_ASSERT(maxMoves > 0);
+
+	QIODevice* device = GzipFile::openFile(fileName,
+		QIODevice::ReadOnly | QIODevice::Text);
+	if (device == nullptr)
+		return 0;
+
+	// Find where the games begin, so that each thread can seek
+	// to its first game
+	QVector<qint64> positions;
+	QVector<qint64> lineNumbers;
+	{
+		PgnStream stream(device);
+		PgnGameEntry entry;
+		while (entry.read(stream))
+		{
+			positions.append(entry.pos());
+			lineNumbers.append(entry.lineNumber());
+		}
+	}
+	delete device;
+
+	const int count = positions.size();
+	if (threadCount <= 0)
+		threadCount = QThread::idealThreadCount();
+	// Each thread would decompress a compressed file from its
+	// start to seek to its first game
+	if (GzipFile::isCompressed(fileName))
+		threadCount = 1;
+	threadCount = qBound(1, count / s_minGamesPerThread, qMax(1, threadCount));
+
+	QVector<Map> maps(threadCount);
+	QVector<int> moveCounts(threadCount, 0);
+
+	auto importGames = [&](int thread)
+	{
+		QIODevice* device = GzipFile::openFile(fileName,
+			QIODevice::ReadOnly | QIODevice::Text);
+		if (device == nullptr)
+			return;
+
+		const int first = int(qint64(count) * thread / threadCount);
+		const int last = int(qint64(count) * (thread + 1) / threadCount);
+		{
+			PgnStream stream(device);
+			PgnGame game;
+
+			for (int i = first; i < last; i++)
+			{
+				if (!stream.seek(positions.at(i), lineNumbers.at(i))
+				||  !game.read(stream, maxMoves, false)
+				||  game.moves().isEmpty())
+					continue;
+
+				moveCounts[thread] += importGame(maps[thread],
+								 game, maxMoves);
+			}
+		}
+		delete device;
+	};
+
+	QThreadPool pool;
+	pool.setMaxThreadCount(threadCount);
+	FunctionTask::parallelFor(&pool, threadCount, importGames);
+
+	int moveCount = 0;
+	for (int i = 0; i < threadCount; i++)
+	{
+		moveCount += moveCounts.at(i);
+
+		const Map& map = maps.at(i);
+		for (auto it = map.constBegin(); it != map.constEnd(); ++it)
+			addEntry(it.value(), it.key());
+	}
+
+	return moveCount;
+}
+
 QList<OpeningBook::Entry> OpeningBook::entriesFromDisk(quint64 key) const
 {
 	QList<Entry> entries;
@@ -218,13 +380,66 @@ QList<OpeningBook::Entry> OpeningBook::entriesFromDisk(quint64 key) const
 	return entries;
 }
 
+QList<OpeningBook::Entry> OpeningBook::entriesFromMemory(quint64 key) const
+{
+	QList<Entry> entries;
+	if (m_mappedFile.isNull())
+		return entries;
+
+	const qint64 step = entrySize();
+	qint64 n = m_mappedFile->size / step;
+	const uchar* base = m_mappedFile->data;
+	const uchar* end = base + n * step;
+	if (n == 0)
+		return entries;
+
+	// Branch-free binary search for the first entry whose key is not
+	// less than \a key. The comparison only moves the base, so the
+	// number of steps depends on the size of the book alone.
+	while (n > 1)
+	{
+		const qint64 half = n / 2;
+		base += (keyFromData(base + half * step) < key) * half * step;
+		n -= half;
+	}
+	base += (keyFromData(base) < key) * step;
+
+	for (; base < end; base += step)
+	{
+		quint64 entryKey = 0;
+		Entry entry = entryFromData(base, &entryKey);
+		if (entryKey != key)
+			break;
+		entries << entry;
+	}
+
+	return entries;
+}
+
 QList<OpeningBook::Entry> OpeningBook::entries(quint64 key) const
 {
 	if (m_mode == Ram)
 		return m_map.values(key);
+	if (m_mode == Mapped)
+		return entriesFromMemory(key);
 	return entriesFromDisk(key);
 }
 
+quint64 OpeningBook::keyFromData(const uchar* data) const
+{
+	quint64 key = 0;
+	entryFromData(data, &key);
+	return key;
+}
+
+OpeningBook::Entry OpeningBook::entryFromData(const uchar* data, quint64* key) const
+{
+	QByteArray bytes = QByteArray::fromRawData(
+		reinterpret_cast<const char*>(data), entrySize());
+	QDataStream in(bytes);
+	return readEntry(in, key);
+}
+
 Chess::GenericMove OpeningBook::move(quint64 key) const
 {
 	Chess::GenericMove move;
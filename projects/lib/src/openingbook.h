@@ -21,6 +21,7 @@
 
 #include <QtGlobal>
 #include <QMultiMap>
+#include <QSharedPointer>
 #include "board/genericmove.h"
 
 class QString;
@@ -39,6 +40,11 @@ class PgnStream;
  * The opening book can be stored externally in a binary file. When it's needed,
  * it is loaded in memory, and positions can be found quickly by searching
  * the book for Zobrist keys that match the current board position.
+ *
+ * In Mapped mode the book file is mapped into memory instead. The mapping
+ * is shared by all the books in the process that read the same file, so a
+ * large book used by many concurrent games is only in memory once, and
+ * the operating system pages it in as it's probed.
  */
 class LIB_EXPORT OpeningBook
 {
@@ -47,7 +53,8 @@ class LIB_EXPORT OpeningBook
 		enum AccessMode
 		{
 			Ram,	//!< Load the entire book to RAM
-			Disk	//!< Read moves directly from disk
+			Disk,	//!< Read moves directly from disk
+			Mapped	//!< Share a memory-mapped book file
 		};
 
 		/*!
@@ -94,6 +101,24 @@ class LIB_EXPORT OpeningBook
 		 * Returns the number of moves imported.
 		 */
 		int import(PgnStream& in, int maxMoves);
+		/*!
+		 * Imports the games of PGN file \a fileName.
+		 *
+		 * \param fileName The PGN file that contains the games.
+		 * \param maxMoves The maximum number of halfmoves per game
+		 * that can be imported.
+		 * \param threadCount The number of threads that read the
+		 * games. If \a threadCount is 0, the number of threads is
+		 * chosen automatically. A compressed file is always read
+		 * in one thread.
+		 *
+		 * Each thread imports its share of the games into a book of
+		 * its own, and the books are merged at the end. The result
+		 * is the same as importing the games one by one.
+		 *
+		 * Returns the number of moves imported.
+		 */
+		int import(const QString& fileName, int maxMoves, int threadCount = 0);
 		
 		/*!
 		 * Returns a move that can be played in a position where the
@@ -149,12 +174,34 @@ class LIB_EXPORT OpeningBook
 		virtual void writeEntry(const Map::const_iterator& it,
 					QDataStream& out) const = 0;
 
+		/*!
+		 * Returns the key of the book entry at \a data.
+		 *
+		 * This is used to search a memory-mapped book. The default
+		 * implementation calls entryFromData().
+		 */
+		virtual quint64 keyFromData(const uchar* data) const;
+		/*!
+		 * Reads the book entry at \a data and returns it.
+		 *
+		 * \a key is set to the hash that belongs to the entry. The
+		 * default implementation calls readEntry().
+		 */
+		virtual Entry entryFromData(const uchar* data, quint64* key) const;
+
 	private:
+		struct MappedFile;
+
+		static QSharedPointer<const MappedFile> mapFile(const QString& filename);
+		static void addEntry(Map& map, const Entry& entry, quint64 key);
+		static int importGame(Map& map, const PgnGame& pgn, int maxMoves);
 		QList<Entry> entriesFromDisk(quint64 key) const;
+		QList<Entry> entriesFromMemory(quint64 key) const;
 
 		AccessMode m_mode;
 		QString m_filename;
 		Map m_map;
+		QSharedPointer<const MappedFile> m_mappedFile;
 };
 
 /*!
@@ -17,12 +17,188 @@
 */
 
 #include "openingsuite.h"
-#include <QFile>
 #include <QTextStream>
+#include <QDataStream>
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QHash>
+#include <QSaveFile>
 #include <algorithm>
+#include <climits>
+#include <cstring>
 #include "pgnstream.h"
 #include "epdrecord.h"
 #include "mersenne.h"
+#include "gzipfile.h"
+#include "board/board.h"
+#include "board/boardfactory.h"
+
+namespace {
+
+const quint32 s_magic = 0x534f4343; // "CCOS"
+const quint32 s_version = 2;
+const quint32 s_indexMagic = 0x49534343; // "CCSI"
+const quint32 s_indexVersion = 1;
+
+// Number of bytes at the start of a suite file covered by the checksum
+// of its index. The checksum is only a sanity check for a suite that was
+// replaced by one with the same size and modification time.
+const int s_checksumSize = 65536;
+
+// The opening has an illegal move after its moveCount legal moves
+const quint32 s_invalidMove = 0x1;
+// The starting position is invalid, so the opening has no moves
+const quint32 s_invalidFen = 0x2;
+
+/*
+ * The header is followed by the opening records in file order, the
+ * packed moves and the strings. A string is a 16-bit length followed
+ * by UTF-8 characters, and offset 0 is the empty string.
+ */
+struct Header
+{
+	quint32 magic;
+	quint32 version;
+	quint32 format;
+	quint32 openingCount;
+	quint32 moveCount;
+	quint32 stringsSize;
+	qint64 sourceSize;
+	qint64 sourceModified;
+	quint32 variant;
+	quint32 reserved;
+};
+
+/*
+ * The header of an index file is followed by the file positions of
+ * the openings (FilePosition objects) in file order.
+ */
+struct IndexHeader
+{
+	quint32 magic;
+	quint32 version;
+	quint32 format;
+	quint32 count;
+	qint64 sourceSize;
+	qint64 sourceModified;
+	quint32 checksum;
+	quint32 reserved;
+};
+
+struct Record
+{
+	qint64 pos;
+	qint64 lineNumber;
+	quint64 key;
+	quint32 firstMove;
+	quint32 moveCount;
+	quint32 fen;
+	quint32 komi;
+	quint32 flags;
+	quint32 gResult;
+};
+
+// Packs a square into 8 bits, with 0 for a null square (eg. the
+// source square of a piece drop)
+bool packSquare(const Chess::Square& square, quint32* code)
+{
+	if (!square.isValid())
+	{
+		*code = 0;
+		return true;
+	}
+	if (square.file() > 15 || square.rank() > 14)
+		return false;
+
+	*code = quint32(square.rank() * 16 + square.file() + 1);
+	return true;
+}
+
+Chess::Square unpackSquare(quint32 code)
+{
+	if (code == 0)
+		return Chess::Square();
+	return Chess::Square(int((code - 1) % 16), int((code - 1) / 16));
+}
+
+bool packMove(const Chess::GenericMove& move, quint32* code)
+{
+	quint32 source;
+	quint32 target;
+	if (!packSquare(move.sourceSquare(), &source)
+	||  !packSquare(move.targetSquare(), &target)
+	||  move.promotion() < 0 || move.promotion() > 0xffff)
+		return false;
+
+	*code = source | target << 8 | quint32(move.promotion()) << 16;
+	return true;
+}
+
+Chess::GenericMove unpackMove(quint32 code)
+{
+	return Chess::GenericMove(unpackSquare(code & 0xff),
+				  unpackSquare((code >> 8) & 0xff),
+				  int(code >> 16));
+}
+
+qint64 lastModified(const QFileInfo& info)
+{
+	return info.lastModified().toMSecsSinceEpoch();
+}
+
+// Returns a 16-bit CRC (qChecksum) of the first s_checksumSize bytes
+// of file fileName. It's stored in a 32-bit field of the index header,
+// but it doesn't detect changes after the first s_checksumSize bytes.
+quint32 fileChecksum(const QString& fileName)
+{
+	QFile file(fileName);
+	if (!file.open(QIODevice::ReadOnly))
+		return 0;
+
+	const QByteArray data = file.read(s_checksumSize);
+	return qChecksum(data.constData(), uint(data.size()));
+}
+
+} // anonymous namespace
+
+struct OpeningSuite::Cache
+{
+	Cache()
+		: data(nullptr),
+		  count(0),
+		  records(nullptr),
+		  moveCount(0),
+		  moves(nullptr),
+		  strings(nullptr),
+		  stringsSize(0)
+	{
+	}
+
+	QString string(quint32 offset) const
+	{
+		if (offset >= stringsSize || stringsSize - offset < 2)
+			return QString();
+
+		quint16 length;
+		std::memcpy(&length, strings + offset, sizeof(length));
+		if (stringsSize - offset - 2 < length)
+			return QString();
+
+		return QString::fromUtf8(
+			reinterpret_cast<const char*>(strings + offset + 2),
+			length);
+	}
+
+	QFile file;
+	const uchar* data;
+	int count;
+	const Record* records;
+	quint32 moveCount;
+	const quint32* moves;
+	const uchar* strings;
+	quint32 stringsSize;
+};
 
 OpeningSuite::OpeningSuite(const QString& fen)
 	: m_format(EpdFormat),
@@ -33,7 +209,8 @@ OpeningSuite::OpeningSuite(const QString& fen)
 	  m_fen(fen),
 	  m_file(nullptr),
 	  m_epdStream(nullptr),
-	  m_pgnStream(nullptr)
+	  m_pgnStream(nullptr),
+	  m_cache(nullptr)
 {
 }
 
@@ -49,7 +226,8 @@ OpeningSuite::OpeningSuite(const QString& fileName,
 	  m_fileName(fileName),
 	  m_file(nullptr),
 	  m_epdStream(nullptr),
-	  m_pgnStream(nullptr)
+	  m_pgnStream(nullptr),
+	  m_cache(nullptr)
 {
 }
 
@@ -65,6 +243,7 @@ OpeningSuite::~OpeningSuite()
 		delete m_pgnStream->device();
 		delete m_pgnStream;
 	}
+	delete m_cache;
 }
 
 OpeningSuite::Format OpeningSuite::format() const
@@ -79,7 +258,25 @@ OpeningSuite::Order OpeningSuite::order() const
 
 bool OpeningSuite::isNull() const
 {
-	return m_epdStream == nullptr && m_pgnStream == nullptr;
+	return m_epdStream == nullptr && m_pgnStream == nullptr
+	    && m_cache == nullptr;
+}
+
+void OpeningSuite::setCacheFile(const QString& fileName,
+				const QString& variant)
+{
+	m_cacheFileName = fileName;
+	m_variant = variant;
+}
+
+void OpeningSuite::setIndexFile(const QString& fileName)
+{
+	m_indexFileName = fileName;
+}
+
+bool OpeningSuite::isCompiled() const
+{
+	return m_cache != nullptr;
 }
 
 bool OpeningSuite::initialize()
@@ -103,40 +300,55 @@ bool OpeningSuite::initialize()
 		delete m_pgnStream;
 		m_pgnStream = nullptr;
 	}
+	delete m_cache;
+	m_cache = nullptr;
 
-	m_file = new QFile(m_fileName);
-	if (!m_file->open(QIODevice::ReadOnly | QIODevice::Text))
+	// A compiled suite doesn't need the suite file at all
+	if (!m_cacheFileName.isEmpty()
+	&&  !openCache()
+	&&  (!compileCache() || !openCache()))
 	{
-		qWarning("Can't open opening suite %s",
-			 qUtf8Printable(m_fileName));
-		delete m_file;
-		return false;
+		qWarning("Can't use opening suite cache %s",
+			 qUtf8Printable(m_cacheFileName));
 	}
 
-	if (m_format == PgnFormat)
-		m_pgnStream = new PgnStream(m_file);
-
-	if (m_format == EpdFormat)
+	if (m_cache == nullptr)
 	{
-		m_file->reset();
-		m_epdStream = new QTextStream(m_file);
+		m_file = GzipFile::openFile(m_fileName,
+					    QIODevice::ReadOnly | QIODevice::Text);
+		if (m_file == nullptr)
+		{
+			qWarning("Can't open opening suite %s",
+				 qUtf8Printable(m_fileName));
+			return false;
+		}
+
+		if (m_format == PgnFormat)
+			m_pgnStream = new PgnStream(m_file);
+
+		if (m_format == EpdFormat)
+		{
+			m_file->reset();
+			m_epdStream = new QTextStream(m_file);
+		}
 	}
 
 	if (m_order == RandomOrder)
 	{
 		// Create a vector of file positions
-		for (;;)
+		if (m_cache != nullptr)
 		{
-			FilePosition pos;
-			if (m_format == EpdFormat)
-				pos = getEpdPos();
-			else if (m_format == PgnFormat)
-				pos = getPgnPos();
-
-			if (pos.pos == -1)
-				break;
-
-			m_filePositions.append(pos);
+			for (int i = 0; i < m_cache->count; i++)
+			{
+				const Record& record = m_cache->records[i];
+				m_filePositions.append({ record.pos, record.lineNumber });
+			}
+		}
+		else if (m_indexFileName.isEmpty() || !readIndex())
+		{
+			findFilePositions();
+			if (!m_indexFileName.isEmpty())
+				writeIndex();
 		}
 
 		// use a Knuth shuffle to generate a random permutation
@@ -151,6 +363,44 @@ bool OpeningSuite::initialize()
 
 		m_gameIndex += m_startIndex % m_filePositions.size();
 	}
+	else if (m_order == SequentialOrder && m_cache != nullptr)
+	{
+		if (m_cache->count > 0)
+		{
+			if (m_startIndex >= m_cache->count)
+				qWarning("Start index larger than book size, wrapping after %d.", m_cache->count);
+			m_gameIndex = m_startIndex % m_cache->count;
+		}
+	}
+	else if (m_order == SequentialOrder
+	     &&  m_startIndex > 0 && !m_indexFileName.isEmpty())
+	{
+		// Seek straight to the first opening
+		FilePosition pos = { -1, -1 };
+		int count = 0;
+		if (!readIndexEntry(m_startIndex, &pos, &count))
+		{
+			findFilePositions();
+			writeIndex();
+			count = m_filePositions.size();
+			if (count > 0)
+				pos = m_filePositions.at(m_startIndex % count);
+			m_filePositions.clear();
+		}
+
+		if (count > 0)
+		{
+			if (m_startIndex >= count)
+				qWarning("Start index larger than book size, wrapping after %d.", count);
+			if (m_format == EpdFormat)
+			{
+				m_epdStream->seek(pos.pos);
+				m_epdStream->resetStatus();
+			}
+			else if (m_format == PgnFormat)
+				m_pgnStream->seek(pos.pos, pos.lineNumber);
+		}
+	}
 	else if (m_order == SequentialOrder)
 	{
 		for (int i = 0; i < m_startIndex; i++)
@@ -193,6 +443,22 @@ PgnGame OpeningSuite::nextGame(int maxPlies)
 	if (isNull())
 		return game;
 
+	if (m_cache != nullptr)
+	{
+		const Opening opening = nextOpening(maxPlies);
+		if (!opening.startingFen.isEmpty())
+		{
+			Chess::Side side(opening.startingFen.section(' ', 1, 1));
+			game.setStartingFenString(side, opening.startingFen);
+		}
+		if (!opening.komi.isEmpty())
+			game.setTag("Komi", opening.komi);
+		for (const Chess::GenericMove& move : opening.moves)
+			game.addMove({ 0, move, QString(), QString() }, false);
+
+		return game;
+	}
+
 	FilePosition pos = { -1, -1 };
 	if (m_order == RandomOrder)
 	{
@@ -246,6 +512,235 @@ PgnGame OpeningSuite::nextGame(int maxPlies)
 	return game;
 }
 
+OpeningSuite::Opening OpeningSuite::nextOpening(int maxPlies)
+{
+	if (m_cache == nullptr || m_cache->count == 0)
+		return { QString(), QString(), QString(),
+			 QVector<Chess::GenericMove>(), 0, false };
+
+	int index;
+	if (m_order == RandomOrder)
+	{
+		index = cacheIndex(m_filePositions.at(m_gameIndex++).pos);
+		if (m_gameIndex >= m_filePositions.size())
+			m_gameIndex = 0;
+	}
+	else
+	{
+		index = m_gameIndex++;
+		if (m_gameIndex >= m_cache->count)
+			m_gameIndex = 0;
+	}
+
+	m_gamesRead++;
+	return cachedOpening(index, maxPlies);
+}
+
+void OpeningSuite::write(QDataStream& out) const
+{
+	out << qint32(m_format) << qint32(m_order)
+	    << qint32(m_gamesRead) << qint32(m_gameIndex);
+
+	if (m_order == RandomOrder)
+	{
+		out << qint32(m_filePositions.size());
+		for (const FilePosition& pos : m_filePositions)
+			out << pos.pos << pos.lineNumber;
+	}
+	else if (m_cache != nullptr && m_cache->count > 0)
+	{
+		// The position of the next opening in the suite file
+		const Record& record = m_cache->records[m_gameIndex];
+		out << record.pos << record.lineNumber;
+	}
+	else if (m_epdStream != nullptr)
+		out << m_epdStream->pos() << qint64(-1);
+	else if (m_pgnStream != nullptr)
+		out << m_pgnStream->pos() << m_pgnStream->lineNumber();
+	else
+		out << qint64(-1) << qint64(-1);
+}
+
+bool OpeningSuite::read(QDataStream& in)
+{
+	qint32 format;
+	qint32 order;
+	qint32 gamesRead;
+	qint32 gameIndex;
+	in >> format >> order >> gamesRead >> gameIndex;
+	if (in.status() != QDataStream::Ok
+	||  format != m_format || order != m_order)
+		return false;
+
+	if (m_order == RandomOrder)
+	{
+		qint32 count;
+		in >> count;
+		if (in.status() != QDataStream::Ok
+		||  count != m_filePositions.size()
+		||  gameIndex < 0 || gameIndex >= qMax(count, 1))
+			return false;
+
+		QVector<FilePosition> positions(count);
+		for (FilePosition& pos : positions)
+			in >> pos.pos >> pos.lineNumber;
+		if (in.status() != QDataStream::Ok)
+			return false;
+		m_filePositions = positions;
+	}
+	else
+	{
+		qint64 pos;
+		qint64 lineNumber;
+		in >> pos >> lineNumber;
+		if (in.status() != QDataStream::Ok)
+			return false;
+
+		if (m_cache != nullptr && pos >= 0)
+		{
+			gameIndex = cacheIndex(pos);
+			if (gameIndex >= m_cache->count)
+				gameIndex = 0;
+		}
+		else if (m_epdStream != nullptr && pos >= 0)
+		{
+			m_epdStream->seek(pos);
+			m_epdStream->resetStatus();
+		}
+		else if (m_pgnStream != nullptr && pos >= 0
+		     &&  !m_pgnStream->seek(pos, lineNumber))
+			return false;
+	}
+
+	m_gamesRead = gamesRead;
+	m_gameIndex = gameIndex;
+
+	return true;
+}
+
+void OpeningSuite::findFilePositions()
+{
+	for (;;)
+	{
+		FilePosition pos;
+		if (m_format == EpdFormat)
+			pos = getEpdPos();
+		else if (m_format == PgnFormat)
+			pos = getPgnPos();
+
+		if (pos.pos == -1)
+			break;
+
+		m_filePositions.append(pos);
+	}
+}
+
+const uchar* OpeningSuite::mapIndex(QFile& file, int* count) const
+{
+	const QFileInfo sourceInfo(m_fileName);
+	file.setFileName(m_indexFileName);
+
+	const qint64 size = file.size();
+	if (!sourceInfo.exists()
+	||  size < qint64(sizeof(IndexHeader))
+	||  !file.open(QIODevice::ReadOnly))
+		return nullptr;
+
+	uchar* data = file.map(0, size);
+	if (data == nullptr)
+		return nullptr;
+
+	IndexHeader header;
+	std::memcpy(&header, data, sizeof(header));
+	if (header.magic != s_indexMagic
+	||  header.version != s_indexVersion
+	||  header.format != quint32(m_format)
+	||  header.count > quint32(INT_MAX)
+	||  header.sourceSize != sourceInfo.size()
+	||  header.sourceModified != lastModified(sourceInfo)
+	||  size != qint64(sizeof(IndexHeader))
+		  + qint64(header.count) * qint64(sizeof(FilePosition))
+	||  header.checksum != fileChecksum(m_fileName))
+	{
+		file.unmap(data);
+		return nullptr;
+	}
+
+	*count = int(header.count);
+	return data + sizeof(IndexHeader);
+}
+
+bool OpeningSuite::readIndex()
+{
+	QFile file;
+	int count = 0;
+	const uchar* data = mapIndex(file, &count);
+	if (data == nullptr)
+		return false;
+
+	// The positions are shuffled, so they are copied; mapping the
+	// index only saves parsing the suite, not the memory
+	m_filePositions.resize(count);
+	std::memcpy(m_filePositions.data(), data, count * sizeof(FilePosition));
+	file.unmap(const_cast<uchar*>(data - sizeof(IndexHeader)));
+
+	return true;
+}
+
+bool OpeningSuite::readIndexEntry(int index, FilePosition* pos, int* count) const
+{
+	QFile file;
+	const uchar* data = mapIndex(file, count);
+	if (data == nullptr)
+		return false;
+
+	if (*count > 0)
+	{
+		std::memcpy(pos, data + (index % *count) * sizeof(FilePosition),
+			    sizeof(FilePosition));
+	}
+	file.unmap(const_cast<uchar*>(data - sizeof(IndexHeader)));
+
+	return true;
+}
+
+void OpeningSuite::writeIndex()
+{
+	// The index is built from a full scan, so the suite is read from
+	// the start again
+	if (m_epdStream != nullptr)
+	{
+		m_epdStream->seek(0);
+		m_epdStream->resetStatus();
+	}
+	else if (m_pgnStream != nullptr)
+		m_pgnStream->rewind();
+
+	const QFileInfo sourceInfo(m_fileName);
+	IndexHeader header;
+	std::memset(&header, 0, sizeof(header));
+	header.magic = s_indexMagic;
+	header.version = s_indexVersion;
+	header.format = quint32(m_format);
+	header.count = quint32(m_filePositions.size());
+	header.sourceSize = sourceInfo.size();
+	header.sourceModified = lastModified(sourceInfo);
+	header.checksum = fileChecksum(m_fileName);
+
+	const qint64 size = m_filePositions.size() * qint64(sizeof(FilePosition));
+	QSaveFile file(m_indexFileName);
+	if (!file.open(QIODevice::WriteOnly)
+	||  file.write(reinterpret_cast<const char*>(&header), sizeof(header))
+		!= qint64(sizeof(header))
+	||  file.write(reinterpret_cast<const char*>(m_filePositions.constData()),
+		       size) != size
+	||  !file.commit())
+	{
+		qWarning("Can't write opening suite index %s",
+			 qUtf8Printable(m_indexFileName));
+	}
+}
+
 OpeningSuite::FilePosition OpeningSuite::getPgnPos()
 {
 	FilePosition pos = { -1, -1 };
@@ -303,3 +798,274 @@ OpeningSuite::FilePosition OpeningSuite::getEpdPos()
 
 	return pos;
 }
+
+bool OpeningSuite::openCache()
+{
+	const QFileInfo sourceInfo(m_fileName);
+	Cache* cache = new Cache;
+	cache->file.setFileName(m_cacheFileName);
+
+	const qint64 size = cache->file.size();
+	if (!sourceInfo.exists()
+	||  size < qint64(sizeof(Header))
+	||  !cache->file.open(QIODevice::ReadOnly)
+	||  (cache->data = cache->file.map(0, size)) == nullptr)
+	{
+		delete cache;
+		return false;
+	}
+
+	Header header;
+	std::memcpy(&header, cache->data, sizeof(header));
+	const qint64 recordsSize = qint64(header.openingCount) * sizeof(Record);
+	const qint64 movesSize = qint64(header.moveCount) * sizeof(quint32);
+
+	if (header.magic != s_magic
+	||  header.version != s_version
+	||  header.format != quint32(m_format)
+	||  header.openingCount > quint32(INT_MAX)
+	||  header.sourceSize != sourceInfo.size()
+	||  header.sourceModified != lastModified(sourceInfo)
+	||  size != qint64(sizeof(Header)) + recordsSize + movesSize
+		  + qint64(header.stringsSize))
+	{
+		delete cache;
+		return false;
+	}
+
+	const uchar* data = cache->data + sizeof(Header);
+	cache->count = int(header.openingCount);
+	cache->records = reinterpret_cast<const Record*>(data);
+	data += recordsSize;
+	cache->moveCount = header.moveCount;
+	cache->moves = reinterpret_cast<const quint32*>(data);
+	data += movesSize;
+	cache->strings = data;
+	cache->stringsSize = header.stringsSize;
+
+	if (cache->string(header.variant) != m_variant)
+	{
+		delete cache;
+		return false;
+	}
+
+	// The records must stay inside the move array
+	for (int i = 0; i < cache->count; i++)
+	{
+		const Record& record = cache->records[i];
+		if (record.firstMove > cache->moveCount
+		||  cache->moveCount - record.firstMove < record.moveCount)
+		{
+			delete cache;
+			return false;
+		}
+	}
+
+	m_cache = cache;
+	return true;
+}
+
+bool OpeningSuite::compileCache() const
+{
+	Chess::Board* board = Chess::BoardFactory::create(m_variant);
+	if (board == nullptr)
+		return false;
+
+	QIODevice* device = GzipFile::openFile(m_fileName,
+		QIODevice::ReadOnly | QIODevice::Text);
+	if (device == nullptr)
+	{
+		delete board;
+		return false;
+	}
+
+	QVector<Record> records;
+	QVector<quint32> moves;
+	QByteArray strings;
+	QHash<QString, quint32> stringOffsets;
+	auto addString = [&](const QString& str)
+	{
+		auto it = stringOffsets.constFind(str);
+		if (it != stringOffsets.constEnd())
+			return it.value();
+
+		const QByteArray utf8 = str.toUtf8().left(0xffff);
+		const quint32 offset = quint32(strings.size());
+		const quint16 length = quint16(utf8.size());
+		strings.append(reinterpret_cast<const char*>(&length),
+			       sizeof(length));
+		strings.append(utf8);
+		stringOffsets.insert(str, offset);
+
+		return offset;
+	};
+	addString(QString());
+
+	// Validates an opening the same way as ChessGame::setMoves()
+	auto addOpening = [&](qint64 pos, qint64 lineNumber,
+			      const QString& fen, const QString& komi,
+			      const QVector<PgnGame::MoveData>& gameMoves)
+	{
+		Record record;
+		std::memset(&record, 0, sizeof(record));
+		record.pos = pos;
+		record.lineNumber = lineNumber;
+		record.firstMove = quint32(moves.size());
+		record.komi = addString(komi);
+
+		// The FEN is kept as written, also when it's invalid, so
+		// that the game fails like it does without the cache
+		if (!fen.isEmpty())
+			record.fen = addString(fen);
+
+		if (!board->setFenString(fen.isEmpty()
+					 ? board->defaultFenString() : fen))
+			record.flags |= s_invalidFen;
+		else
+		{
+			// The FEN may leave out the G-result, so it's
+			// taken from the board
+			const QString gResult = board->fenString().section(' ', -1);
+			if (gResult.startsWith('G') || gResult.startsWith("-G"))
+				record.gResult = addString(gResult);
+			record.key = board->key();
+
+			for (const PgnGame::MoveData& md : gameMoves)
+			{
+				quint32 code;
+				Chess::Move move(board->moveFromGenericMove(md.move));
+				if (!packMove(md.move, &code)
+				||  !board->isLegalMove(move))
+				{
+					record.flags |= s_invalidMove;
+					break;
+				}
+
+				board->makeMove(move);
+				if (!board->result().isNone())
+					break;
+
+				moves.append(code);
+				record.moveCount++;
+				record.key = board->key();
+			}
+		}
+
+		records.append(record);
+	};
+
+	if (m_format == PgnFormat)
+	{
+		PgnStream stream(device);
+		PgnGame game;
+		while (stream.nextGame())
+		{
+			const qint64 pos = stream.pos();
+			const qint64 lineNumber = stream.lineNumber();
+			if (!game.read(stream, INT_MAX - 1, false))
+				break;
+
+			addOpening(pos, lineNumber, game.startingFenString(),
+				   game.tagValue("Komi"), game.moves());
+		}
+	}
+	else
+	{
+		for (;;)
+		{
+			const qint64 pos = device->pos();
+			const QByteArray line = device->readLine();
+			if (line.isEmpty())
+				break;
+			if (line.trimmed().isEmpty())
+				continue;
+
+			QTextStream lineStream(line);
+			EpdRecord epd;
+			if (epd.parse(lineStream))
+				addOpening(pos, -1, epd.fen(), QString(),
+					   QVector<PgnGame::MoveData>());
+		}
+	}
+	delete device;
+	delete board;
+
+	const QFileInfo sourceInfo(m_fileName);
+	Header header;
+	std::memset(&header, 0, sizeof(header));
+	header.magic = s_magic;
+	header.version = s_version;
+	header.format = quint32(m_format);
+	header.openingCount = quint32(records.size());
+	header.moveCount = quint32(moves.size());
+	header.sourceSize = sourceInfo.size();
+	header.sourceModified = lastModified(sourceInfo);
+	header.variant = addString(m_variant);
+	header.stringsSize = quint32(strings.size());
+
+	QSaveFile file(m_cacheFileName);
+	if (!file.open(QIODevice::WriteOnly))
+		return false;
+
+	const qint64 recordsSize = records.size() * qint64(sizeof(Record));
+	const qint64 movesSize = moves.size() * qint64(sizeof(quint32));
+	if (file.write(reinterpret_cast<const char*>(&header), sizeof(header))
+		!= qint64(sizeof(header))
+	||  file.write(reinterpret_cast<const char*>(records.constData()),
+		       recordsSize) != recordsSize
+	||  file.write(reinterpret_cast<const char*>(moves.constData()),
+		       movesSize) != movesSize
+	||  file.write(strings) != strings.size())
+	{
+		file.cancelWriting();
+		return false;
+	}
+
+	return file.commit();
+}
+
+int OpeningSuite::cacheIndex(qint64 pos) const
+{
+	// The records are in file order
+	const Record* begin = m_cache->records;
+	const Record* end = begin + m_cache->count;
+	const Record* it = std::lower_bound(begin, end, pos,
+		[](const Record& record, qint64 pos)
+	{
+		return record.pos < pos;
+	});
+
+	return int(it - begin);
+}
+
+OpeningSuite::Opening OpeningSuite::cachedOpening(int index,
+						  int maxPlies) const
+{
+	Q_ASSERT(index >= 0 && index < m_cache->count);
+	const Record& record = m_cache->records[index];
+
+	Opening opening;
+	opening.startingFen = m_cache->string(record.fen);
+	opening.startingGResult = m_cache->string(record.gResult);
+	opening.komi = m_cache->string(record.komi);
+	opening.key = record.key;
+
+	// An illegal move is only played if it's within maxPlies
+	opening.isValid = !(record.flags & s_invalidFen)
+		       && (!(record.flags & s_invalidMove)
+			   || int(record.moveCount) >= maxPlies);
+
+	int count = int(record.moveCount);
+	if (count > maxPlies)
+	{
+		count = qMax(maxPlies, 0);
+		opening.key = 0;
+	}
+
+	opening.moves.reserve(count);
+	const quint32* moves = m_cache->moves + record.firstMove;
+	for (int i = 0; i < count; i++)
+		opening.moves.append(unpackMove(moves[i]));
+
+	return opening;
+}
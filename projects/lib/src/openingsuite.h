@@ -23,8 +23,10 @@
 #include "pgngame.h"
 class QString;
 class QFile;
+class QIODevice;
 class QTextStream;
 class PgnStream;
+class QDataStream;
 
 /*!
  * \brief A suite of chess openings
@@ -34,6 +36,19 @@ class PgnStream;
  * reads positions and games from a text stream (eg. a text file)
  * and returns the opening as a PgnGame object.
  *
+ * A suite file can also be compiled into a cache file for one chess
+ * variant. The cache holds each opening's starting position, its
+ * starting G-result and the packed moves, which are validated when the
+ * cache is compiled, so a suite with hundreds of thousands of openings
+ * is parsed and checked only once. Later runs map the cache into
+ * memory and get the openings from nextOpening() without parsing or
+ * replaying them.
+ *
+ * A lighter alternative is an index file that only holds the file
+ * positions of the openings. It makes random order and a sequential
+ * start index independent of the size of the suite, and any number of
+ * processes can share the same suite and index.
+ *
  * \sa EpdRecord
  * \sa PgnGame
  */
@@ -54,13 +69,52 @@ class LIB_EXPORT OpeningSuite
 			RandomOrder		//!< Random order
 		};
 
+		/*! \brief An opening from a compiled suite. */
+		struct Opening
+		{
+			/*!
+			 * The starting position as written in the suite,
+			 * or an empty string for the variant's default
+			 * position.
+			 */
+			QString startingFen;
+			/*!
+			 * The G-result of the starting position, eg.
+			 * "G218.0", or an empty string if the variant has
+			 * no G-result or the starting position is invalid.
+			 */
+			QString startingGResult;
+			/*! The value of the opening's Komi tag. */
+			QString komi;
+			/*!
+			 * The opening moves. Moves after a move that ends
+			 * the game are left out.
+			 */
+			QVector<Chess::GenericMove> moves;
+			/*!
+			 * The zobrist key of the position after the moves, or
+			 * 0 if the moves were cut short.
+			 */
+			quint64 key;
+			/*!
+			 * True if the starting position and the opening
+			 * plies returned by nextOpening() are valid in the
+			 * variant. An illegal move after the last returned
+			 * ply doesn't make the opening invalid. If false,
+			 * \a moves holds the legal moves before the first
+			 * illegal one.
+			 */
+			bool isValid;
+		};
+
 		/*!
 		 * Creates a new opening suite that starts every game at \a fen.
 		 */
 		OpeningSuite(const QString& fen);
 		/*!
 		 * Creates a new opening suite that reads the openings
-		 * from \a fileName in \a format format.
+		 * from \a fileName in \a format format. The file can be
+		 * compressed with gzip.
 		 *
 		 * Openings will be picked according to \a order.
 		 *
@@ -88,6 +142,41 @@ class LIB_EXPORT OpeningSuite
 		 */
 		bool isNull() const;
 
+		/*!
+		 * Uses \a fileName as a compiled cache of the suite for
+		 * chess variant \a variant.
+		 *
+		 * initialize() loads the cache if it was compiled from the
+		 * current suite file for the same variant; otherwise it
+		 * compiles the suite and writes the cache first. If the cache
+		 * can't be used, the suite is read from the file as usual.
+		 */
+		void setCacheFile(const QString& fileName, const QString& variant);
+		/*!
+		 * Uses \a fileName as an index of the openings' file
+		 * positions.
+		 *
+		 * initialize() maps the index instead of scanning the suite
+		 * file if the index matches the suite file's size,
+		 * modification time and checksum; otherwise it scans the
+		 * suite once and writes the index. The index is only used
+		 * in random order or with a start index.
+		 *
+		 * The checksum is a 16-bit CRC of the first 64 KiB of the
+		 * suite, so it's a sanity check rather than a checksum of
+		 * the file. In random order the positions are copied from
+		 * the mapped index, so the index saves parsing the suite
+		 * but not memory. With a start index N a missing or stale
+		 * index costs a scan of the whole suite instead of the
+		 * first N openings.
+		 */
+		void setIndexFile(const QString& fileName);
+		/*!
+		 * Returns true if the openings are read from a compiled
+		 * cache; otherwise returns false.
+		 */
+		bool isCompiled() const;
+
 		/*!
 		 * Initializes the opening suite.
 		 *
@@ -105,6 +194,32 @@ class LIB_EXPORT OpeningSuite
 		 * A maximum of \a maxPlies plies (halfmoves) are read.
 		 */
 		PgnGame nextGame(int maxPlies);
+		/*!
+		 * Returns the next opening of a compiled suite.
+		 * A maximum of \a maxPlies plies (halfmoves) are returned.
+		 *
+		 * Unlike nextGame(), this function doesn't parse or check the
+		 * moves, and the returned moves have no SAN strings.
+		 *
+		 * \sa isCompiled()
+		 */
+		Opening nextOpening(int maxPlies);
+
+		/*!
+		 * Writes the position of the next opening to \a out.
+		 *
+		 * In random order the shuffled order of the openings is
+		 * written as well.
+		 */
+		void write(QDataStream& out) const;
+		/*!
+		 * Reads the position of the next opening from \a in.
+		 *
+		 * The suite must be initialized with the same file, format
+		 * and order as the suite that wrote the data. Returns false
+		 * if the data is invalid.
+		 */
+		bool read(QDataStream& in);
 
 	private:
 		struct FilePosition
@@ -113,8 +228,19 @@ class LIB_EXPORT OpeningSuite
 			qint64 lineNumber;
 		};
 
+		struct Cache;
+
 		FilePosition getPgnPos();
 		FilePosition getEpdPos();
+		void findFilePositions();
+		const uchar* mapIndex(QFile& file, int* count) const;
+		bool readIndex();
+		bool readIndexEntry(int index, FilePosition* pos, int* count) const;
+		void writeIndex();
+		bool openCache();
+		bool compileCache() const;
+		int cacheIndex(qint64 pos) const;
+		Opening cachedOpening(int index, int maxPlies) const;
 
 		Format m_format;
 		Order m_order;
@@ -123,10 +249,14 @@ class LIB_EXPORT OpeningSuite
 		int m_startIndex;
 		QString m_fileName;
 		QString m_fen;
-		QFile* m_file;
+		QIODevice* m_file;
 		QTextStream* m_epdStream;
 		PgnStream* m_pgnStream;
 		QVector<FilePosition> m_filePositions;
+		QString m_indexFileName;
+		QString m_cacheFileName;
+		QString m_variant;
+		Cache* m_cache;
 };
 
 #endif // OPENINGSUITE_H
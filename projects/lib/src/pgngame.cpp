@@ -118,7 +118,7 @@ void PgnGame::addMove(const MoveData& data, bool addEco)
 	m_moves.append(data);
 
 	if (addEco) {
-		m_eco = (m_eco && isStandard()) ? m_eco->child(data.moveString)
+		m_eco = (m_eco && isStandard()) ? m_eco->child(data.move)
 						: nullptr;
 		if (m_eco && m_eco->isLeaf())
 		{
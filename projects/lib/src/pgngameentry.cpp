@@ -253,6 +253,11 @@ bool PgnGameEntry::match(const PgnGameFilter& filter) const
 	return true;
 }
 
+bool PgnGameEntry::contains(const char* str, int size, const char* pattern)
+{
+	return s_stringContains(str, pattern, size) != -1;
+}
+
 void PgnGameEntry::addTag(const QByteArray& tagValue)
 {
 	int size = qMin(127, tagValue.size());
@@ -369,6 +374,11 @@ qint64 PgnGameEntry::lineNumber() const
 	return m_lineNumber;
 }
 
+void PgnGameEntry::addLineOffset(qint64 offset)
+{
+	m_lineNumber += offset;
+}
+
 QString PgnGameEntry::tagValue(TagType type) const
 {
 	int i = 0;
@@ -86,11 +86,22 @@ class LIB_EXPORT PgnGameEntry
 		qint64 pos() const;
 		/*! Returns the line number where the game begins. */
 		qint64 lineNumber() const;
+		/*!
+		 * Adds \a offset to the line number.
+		 *
+		 * This is used when the entry was read from a stream that
+		 * started in the middle of a file.
+		 */
+		void addLineOffset(qint64 offset);
 
 		/*! Returns the tag value corresponding to \a type. */
 		QString tagValue(TagType type) const;
 
 	private:
+		friend class PgnGameIndex;
+
+		static bool contains(const char* str, int size,
+				     const char* pattern);
 		void addTag(const QByteArray& tagValue);
 
 		QByteArray m_data;
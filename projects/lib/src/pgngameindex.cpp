@@ -0,0 +1,341 @@
+/*
+    This file is part of Cute Chess.
+    Copyright (C) 2008-2018 Cute Chess authors
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "pgngameindex.h"
+#include <climits>
+#include <cstring>
+#include <QSaveFile>
+#include <QVector>
+#include <QHash>
+#include "pgngamefilter.h"
+
+namespace {
+
+const quint32 s_magic = 0x49474343; // "CCGI"
+const quint32 s_version = 1;
+const int s_tagCount = PgnGameEntry::VariantTag + 1;
+
+/*
+ * The header is followed by the columns: the stream positions and the
+ * line numbers (qint64 each), the tags (quint32 offsets to the string
+ * table, one column per tag) and the string table. Each string is a
+ * length byte followed by the characters.
+ */
+struct Header
+{
+	quint32 magic;
+	quint32 version;
+	quint32 count;
+	quint32 tagCount;
+	quint32 stringsSize;
+	quint32 reserved[3];
+};
+
+bool writeData(QSaveFile& file, const void* data, qint64 size)
+{
+	return file.write(static_cast<const char*>(data), size) == size;
+}
+
+} // anonymous namespace
+
+PgnGameIndex::Query::Query()
+	: m_index(nullptr)
+{
+}
+
+bool PgnGameIndex::Query::mayMatch(int index) const
+{
+	for (const Condition& condition : m_conditions)
+	{
+		bool found = false;
+		for (int tag : condition.tags)
+		{
+			const quint32 offset =
+				m_index->m_tags[qint64(tag) * m_index->m_count + index];
+			if (offset < quint32(condition.values.size())
+			&&  condition.values.testBit(int(offset)))
+			{
+				found = true;
+				break;
+			}
+		}
+		if (!found)
+			return false;
+	}
+
+	return true;
+}
+
+PgnGameIndex::PgnGameIndex()
+	: m_data(nullptr),
+	  m_count(0),
+	  m_positions(nullptr),
+	  m_lineNumbers(nullptr),
+	  m_tags(nullptr),
+	  m_strings(nullptr),
+	  m_stringsSize(0)
+{
+}
+
+PgnGameIndex::~PgnGameIndex()
+{
+	close();
+}
+
+bool PgnGameIndex::write(const QString& fileName,
+			 const QList<const PgnGameEntry*>& entries)
+{
+	const int count = entries.size();
+	QVector<qint64> positions(count);
+	QVector<qint64> lineNumbers(count);
+	QVector<quint32> tags(s_tagCount * count);
+	QByteArray strings;
+	QHash<QByteArray, quint32> stringOffsets;
+
+	for (int i = 0; i < count; i++)
+	{
+		const PgnGameEntry* entry = entries.at(i);
+		const QByteArray& data = entry->m_data;
+		positions[i] = entry->m_pos;
+		lineNumbers[i] = entry->m_lineNumber;
+
+		int j = 0;
+		for (int tag = 0; tag < s_tagCount; tag++)
+		{
+			QByteArray value(1, 0);
+			if (j < data.size())
+				value = data.mid(j, uchar(data.at(j)) + 1);
+			j += value.size();
+
+			auto it = stringOffsets.constFind(value);
+			if (it == stringOffsets.constEnd())
+			{
+				it = stringOffsets.insert(value, strings.size());
+				strings.append(value);
+			}
+			tags[tag * count + i] = it.value();
+		}
+	}
+
+	Header header;
+	std::memset(&header, 0, sizeof(header));
+	header.magic = s_magic;
+	header.version = s_version;
+	header.count = count;
+	header.tagCount = s_tagCount;
+	header.stringsSize = strings.size();
+
+	QSaveFile file(fileName);
+	if (!file.open(QIODevice::WriteOnly))
+		return false;
+
+	if (!writeData(file, &header, sizeof(header))
+	||  !writeData(file, positions.constData(), count * sizeof(qint64))
+	||  !writeData(file, lineNumbers.constData(), count * sizeof(qint64))
+	||  !writeData(file, tags.constData(), tags.size() * sizeof(quint32))
+	||  !writeData(file, strings.constData(), strings.size()))
+	{
+		file.cancelWriting();
+		return false;
+	}
+
+	return file.commit();
+}
+
+bool PgnGameIndex::open(const QString& fileName)
+{
+	close();
+
+	m_file.setFileName(fileName);
+	if (!m_file.open(QIODevice::ReadOnly))
+		return false;
+
+	const qint64 size = m_file.size();
+	if (size < qint64(sizeof(Header))
+	||  (m_data = m_file.map(0, size)) == nullptr)
+	{
+		close();
+		return false;
+	}
+
+	Header header;
+	std::memcpy(&header, m_data, sizeof(header));
+
+	const qint64 count = header.count;
+	const qint64 expectedSize = qint64(sizeof(Header))
+		+ count * 2 * qint64(sizeof(qint64))
+		+ count * s_tagCount * qint64(sizeof(quint32))
+		+ header.stringsSize;
+
+	if (header.magic != s_magic
+	||  header.version != s_version
+	||  header.tagCount != quint32(s_tagCount)
+	||  count > INT_MAX
+	||  size != expectedSize)
+	{
+		close();
+		return false;
+	}
+
+	const uchar* data = m_data + sizeof(Header);
+	m_count = int(count);
+	m_positions = reinterpret_cast<const qint64*>(data);
+	data += count * sizeof(qint64);
+	m_lineNumbers = reinterpret_cast<const qint64*>(data);
+	data += count * sizeof(qint64);
+	m_tags = reinterpret_cast<const quint32*>(data);
+	data += count * s_tagCount * sizeof(quint32);
+	m_strings = data;
+	m_stringsSize = header.stringsSize;
+
+	return true;
+}
+
+void PgnGameIndex::close()
+{
+	if (m_data != nullptr)
+		m_file.unmap(const_cast<uchar*>(m_data));
+	m_file.close();
+
+	m_data = nullptr;
+	m_count = 0;
+	m_positions = nullptr;
+	m_lineNumbers = nullptr;
+	m_tags = nullptr;
+	m_strings = nullptr;
+	m_stringsSize = 0;
+}
+
+bool PgnGameIndex::isOpen() const
+{
+	return m_data != nullptr;
+}
+
+QString PgnGameIndex::fileName() const
+{
+	return m_file.fileName();
+}
+
+int PgnGameIndex::count() const
+{
+	return m_count;
+}
+
+PgnGameEntry PgnGameIndex::entry(int index) const
+{
+	Q_ASSERT(index >= 0 && index < m_count);
+
+	PgnGameEntry entry;
+	entry.m_pos = m_positions[index];
+	entry.m_lineNumber = m_lineNumbers[index];
+	entry.m_data.reserve(64);
+
+	for (int tag = 0; tag < s_tagCount; tag++)
+	{
+		const quint32 offset = m_tags[qint64(tag) * m_count + index];
+		if (offset >= m_stringsSize
+		||  m_stringsSize - offset < quint32(m_strings[offset]) + 1)
+		{
+			entry.m_data.append(char(0));
+			continue;
+		}
+
+		entry.m_data.append(reinterpret_cast<const char*>(m_strings + offset),
+				    m_strings[offset] + 1);
+	}
+
+	return entry;
+}
+
+PgnGameIndex::Query PgnGameIndex::query(const PgnGameFilter& filter) const
+{
+	Query query;
+	query.m_index = this;
+	if (!isOpen() || m_stringsSize > quint32(INT_MAX))
+		return query;
+
+	if (filter.type() == PgnGameFilter::FixedString)
+	{
+		QVector<int> tags;
+		for (int tag = 0; tag < s_tagCount; tag++)
+			tags << tag;
+		addCondition(query, filter.pattern(), tags);
+		return query;
+	}
+
+	addCondition(query, filter.event(), { PgnGameEntry::EventTag });
+	addCondition(query, filter.site(), { PgnGameEntry::SiteTag });
+
+	// The sides of the players follow the same rules as
+	// PgnGameEntry::match()
+	QVector<int> playerTags;
+	QVector<int> opponentTags;
+	switch (filter.playerSide())
+	{
+	case Chess::Side::White:
+		playerTags << PgnGameEntry::WhiteTag;
+		opponentTags << PgnGameEntry::BlackTag;
+		break;
+	case Chess::Side::Black:
+		playerTags << PgnGameEntry::BlackTag;
+		opponentTags << PgnGameEntry::WhiteTag;
+		break;
+	default:
+		playerTags << PgnGameEntry::WhiteTag << PgnGameEntry::BlackTag;
+		opponentTags = playerTags;
+		break;
+	}
+	addCondition(query, filter.player(), playerTags);
+	addCondition(query, filter.opponent(), opponentTags);
+
+	return query;
+}
+
+QBitArray PgnGameIndex::matchingValues(const char* pattern) const
+{
+	QBitArray values(int(m_stringsSize));
+
+	quint32 offset = 0;
+	while (offset < m_stringsSize)
+	{
+		const int size = m_strings[offset];
+		if (m_stringsSize - offset < quint32(size) + 1)
+			break;
+
+		const char* str = reinterpret_cast<const char*>(m_strings + offset + 1);
+		if (PgnGameEntry::contains(str, size, pattern))
+			values.setBit(int(offset));
+		offset += size + 1;
+	}
+
+	return values;
+}
+
+void PgnGameIndex::addCondition(Query& query,
+				const char* pattern,
+				const QVector<int>& tags) const
+{
+	// An empty pattern matches every game
+	if (*pattern == 0)
+		return;
+
+	Query::Condition condition;
+	condition.values = matchingValues(pattern);
+	condition.tags = tags;
+	query.m_conditions.append(condition);
+}
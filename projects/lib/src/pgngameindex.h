@@ -0,0 +1,149 @@
+/*
+    This file is part of Cute Chess.
+    Copyright (C) 2008-2018 Cute Chess authors
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PGNGAMEINDEX_H
+#define PGNGAMEINDEX_H
+
+#include <QList>
+#include <QFile>
+#include <QVector>
+#include <QBitArray>
+#include "pgngameentry.h"
+class PgnGameFilter;
+
+/*!
+ * \brief A memory-mapped index of the games in a PGN file.
+ *
+ * PgnGameIndex stores the same information as a list of PgnGameEntry
+ * objects, but in columns: the stream positions, the line numbers and
+ * one column per PGN tag. The tag values are interned in a string
+ * table, so a tag column only holds a 32-bit offset per game, and
+ * repeated values like player names, events and results are stored
+ * once.
+ *
+ * The index file is mapped into memory when it's opened, so opening an
+ * index takes the same time regardless of the number of games, and the
+ * entries are only created when they're needed. The file uses the byte
+ * order of the machine that wrote it; an index from a machine with a
+ * different byte order fails to open.
+ *
+ * Because the tag values are interned, a filter's text patterns only
+ * have to be matched once against each distinct value. query() does
+ * that and returns a Query that tests the games by looking up their
+ * tag values in the matching sets.
+ *
+ * \sa PgnGameEntry
+ */
+class LIB_EXPORT PgnGameIndex
+{
+	public:
+		/*!
+		 * \brief The text conditions of a PgnGameFilter compiled
+		 * against an index.
+		 *
+		 * A game that fails mayMatch() doesn't match the filter. A
+		 * game that passes it still has to be checked with
+		 * PgnGameEntry::match() for the other conditions, like the
+		 * dates and the result.
+		 */
+		class LIB_EXPORT Query
+		{
+			public:
+				/*! Creates a query that lets every game pass. */
+				Query();
+
+				/*!
+				 * Returns true if the text patterns of the
+				 * filter can match the game at \a index.
+				 *
+				 * This function is thread-safe.
+				 */
+				bool mayMatch(int index) const;
+
+			private:
+				friend class PgnGameIndex;
+
+				struct Condition
+				{
+					QBitArray values;
+					QVector<int> tags;
+				};
+
+				const PgnGameIndex* m_index;
+				QVector<Condition> m_conditions;
+		};
+
+		/*! Creates a new index with no file. */
+		PgnGameIndex();
+		/*! Closes and destroys the index. */
+		~PgnGameIndex();
+
+		/*!
+		 * Writes an index of \a entries to file \a fileName.
+		 *
+		 * The file is replaced atomically. Returns true if
+		 * successful; otherwise returns false.
+		 */
+		static bool write(const QString& fileName,
+				  const QList<const PgnGameEntry*>& entries);
+
+		/*!
+		 * Opens and maps index file \a fileName.
+		 * Returns true if successful; otherwise returns false.
+		 */
+		bool open(const QString& fileName);
+		/*! Closes the index file. */
+		void close();
+		/*! Returns true if an index file is open. */
+		bool isOpen() const;
+		/*! Returns the name of the index file. */
+		QString fileName() const;
+
+		/*! Returns the number of games in the index. */
+		int count() const;
+		/*!
+		 * Returns the entry of the game at \a index.
+		 *
+		 * This function is thread-safe.
+		 */
+		PgnGameEntry entry(int index) const;
+		/*!
+		 * Compiles the text patterns of \a filter into a query.
+		 *
+		 * The query refers to this index, so it can't be used after
+		 * the index is closed.
+		 */
+		Query query(const PgnGameFilter& filter) const;
+
+	private:
+		QBitArray matchingValues(const char* pattern) const;
+		void addCondition(Query& query,
+				  const char* pattern,
+				  const QVector<int>& tags) const;
+
+		QFile m_file;
+		const uchar* m_data;
+		int m_count;
+		const qint64* m_positions;
+		const qint64* m_lineNumbers;
+		const quint32* m_tags;
+		const uchar* m_strings;
+		quint32 m_stringsSize;
+};
+
+#endif // PGNGAMEINDEX_H
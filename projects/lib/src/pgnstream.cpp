@@ -19,49 +19,48 @@
 #include "pgnstream.h"
 #include <cctype>
 #include <cstring>
+#include <algorithm>
 #include <QIODevice>
 #include "board/boardfactory.h"
 
 namespace {
 
-void skipSection(PgnStream* in, char start)
+// Number of bytes read from the device at a time
+const int s_blockSize = 65536;
+
+} // anonymous namespace
+
+/*
+ * A set of characters for scanning the input. The null character is
+ * always in the set, because it ends the input like in readChar().
+ */
+class PgnStream::CharSet
 {
-	char end;
-	switch (start)
-	{
-	case '(':
-		end = ')';
-		break;
-	case '{':
-		end = '}';
-		break;
-	case ';':
-	case '%':
-		start = 0;
-		end = '\n';
-		break;
-	default:
-		return;
-	}
+	public:
+		explicit CharSet(const char* chars)
+		{
+			std::memset(m_contains, 0, sizeof(m_contains));
+			m_contains[0] = true;
+			for (; *chars != 0; chars++)
+				m_contains[uchar(*chars)] = true;
+		}
 
-	int level = 1;
-	char c;
-	while ((c = in->readChar()) != 0)
-	{
-		if (c == end && --level == 0)
-			break;
-		if (c == start)
-			level++;
-	}
-}
+		bool contains(char c) const
+		{
+			return m_contains[uchar(c)];
+		}
 
-} // anonymous namespace
+	private:
+		bool m_contains[256];
+};
 
 PgnStream::PgnStream(const QString& variant)
 	: m_board(nullptr),
-	  m_pos(0),
+	  m_data(nullptr),
+	  m_size(0),
+	  m_index(0),
+	  m_bufferPos(0),
 	  m_lineNumber(1),
-	  m_lastChar(0),
 	  m_tokenType(NoToken),
 	  m_device(nullptr),
 	  m_string(nullptr),
@@ -92,9 +91,7 @@ PgnStream::~PgnStream()
 
 void PgnStream::reset()
 {
-	m_pos = 0;
 	m_lineNumber = 1;
-	m_lastChar = 0;
 	m_tokenString.clear();
 	m_tagName.clear();
 	m_tagValue.clear();
@@ -103,6 +100,101 @@ void PgnStream::reset()
 	m_string = nullptr;
 	m_status = Ok;
 	m_phase = OutOfGame;
+	resetBuffer();
+}
+
+void PgnStream::resetBuffer()
+{
+	m_data = nullptr;
+	m_size = 0;
+	m_index = 0;
+	m_removedCr.clear();
+
+	// pos() must stay correct before the next block is read
+	m_bufferPos = (m_device != nullptr) ? m_device->pos() : 0;
+}
+
+bool PgnStream::fillBuffer()
+{
+	if (m_string != nullptr)
+	{
+		// The string is used directly as the buffer
+		m_data = m_string->constData();
+		m_size = m_string->size();
+		return m_index < m_size;
+	}
+	if (m_device == nullptr)
+		return false;
+
+	// Keep the last character so that it can be rewound
+	int keep = 0;
+	int trailingCr = 0;
+	if (m_size > 0)
+	{
+		const qint64 end = devicePos(m_size);
+		keep = 1;
+		m_bufferPos = devicePos(m_size - 1);
+		trailingCr = int(end - m_bufferPos - 1);
+		m_buffer[0] = m_data[m_size - 1];
+	}
+	else
+		m_bufferPos = m_device->pos();
+
+	m_buffer.resize(keep + s_blockSize);
+	char* data = m_buffer.data();
+
+	// Read the raw bytes so that the offsets in the buffer can be
+	// mapped to device positions
+	const bool textMode = m_device->isTextModeEnabled();
+	if (textMode)
+		m_device->setTextModeEnabled(false);
+	const qint64 n = m_device->read(data + keep, s_blockSize);
+	if (textMode)
+		m_device->setTextModeEnabled(true);
+
+	m_removedCr.fill(keep, trailingCr);
+	int size = keep;
+	if (n > 0 && !textMode)
+		size += int(n);
+	else if (n > 0)
+	{
+		const char* in = data + keep;
+		const char* inEnd = in + n;
+		char* out = data + keep;
+
+		while (in < inEnd)
+		{
+			const char* cr = static_cast<const char*>(
+				std::memchr(in, '\r', inEnd - in));
+			if (cr == nullptr)
+				cr = inEnd;
+
+			std::memmove(out, in, cr - in);
+			out += cr - in;
+			in = cr;
+			if (in < inEnd)
+			{
+				m_removedCr.append(int(out - data));
+				in++;
+			}
+		}
+		size = int(out - data);
+	}
+
+	m_data = data;
+	m_size = size;
+	m_index = keep;
+
+	return m_index < m_size;
+}
+
+qint64 PgnStream::devicePos(int index) const
+{
+	// Every removed carriage return before the index moves it by one
+	auto it = std::upper_bound(m_removedCr.constBegin(),
+				   m_removedCr.constEnd(),
+				   index);
+	return m_bufferPos + index + (it - m_removedCr.constBegin());
 }
 
 Chess::Board* PgnStream::board()
@@ -121,6 +213,7 @@ void PgnStream::setDevice(QIODevice* device)
 
 	reset();
 	m_device = device;
+	resetBuffer();
 }
 
 const QByteArray* PgnStream::string() const
@@ -162,9 +255,7 @@ bool PgnStream::isOpen() const
 
 qint64 PgnStream::pos() const
 {
-	if (m_device)
-		return m_device->pos();
-	return m_pos;
+	return devicePos(m_index);
 }
 
 qint64 PgnStream::lineNumber() const
@@ -174,32 +265,50 @@ qint64 PgnStream::lineNumber() const
 
 char PgnStream::readChar()
 {
-	char c;
-	if (m_device)
-	{
-		if (!m_device->getChar(&m_lastChar))
-		{
-			m_status = ReadPastEnd;
-			return 0;
-		}
-		c = m_lastChar;
-	}
-	else if (m_string && m_pos < m_string->size())
-	{
-		c = m_string->at(m_pos++);
-	}
-	else
+	if (m_index >= m_size && !fillBuffer())
 	{
 		m_status = ReadPastEnd;
 		return 0;
 	}
 
+	const char c = m_data[m_index++];
 	if (c == '\n')
 		m_lineNumber++;
 
 	return c;
 }
 
+char PgnStream::readUntil(const CharSet& chars, QByteArray* skipped)
+{
+	for (;;)
+	{
+		if (m_index >= m_size && !fillBuffer())
+		{
+			m_status = ReadPastEnd;
+			return 0;
+		}
+
+		const char* begin = m_data + m_index;
+		const char* end = m_data + m_size;
+		const char* p = begin;
+		while (p != end && !chars.contains(*p))
+			p++;
+
+		m_lineNumber += std::count(begin, p, '\n');
+		if (skipped != nullptr)
+			skipped->append(begin, int(p - begin));
+		m_index = int(p - m_data);
+
+		if (p != end)
+		{
+			m_index++;
+			if (*p == '\n')
+				m_lineNumber++;
+			return *p;
+		}
+	}
+}
+
 void PgnStream::rewind()
 {
 	seek(0);
@@ -207,21 +316,11 @@ void PgnStream::rewind()
 
 void PgnStream::rewindChar()
 {
-	Q_ASSERT(pos() > 0);
-
-	char c;
-	if (m_device)
-	{
-		c = m_lastChar;
-		m_device->ungetChar(m_lastChar);
-		m_lastChar = 0;
-	}
-	else if (m_string)
-		c = m_string->at(m_pos--);
-	else
+	Q_ASSERT(m_index > 0);
+	if (m_index <= 0)
 		return;
 
-	if (c == '\n')
+	if (m_data[--m_index] == '\n')
 		m_lineNumber--;
 }
 
@@ -233,20 +332,35 @@ bool PgnStream::seek(qint64 pos, qint64 lineNumber)
 	bool ok = false;
 	if (m_device)
 	{
-		ok = m_device->seek(pos);
-		m_pos = 0;
+		// Stay in the buffer if the position is in it
+		if (m_size > 0
+		&&  m_removedCr.isEmpty()
+		&&  pos >= m_bufferPos
+		&&  pos <= m_bufferPos + m_size)
+		{
+			m_index = int(pos - m_bufferPos);
+			ok = true;
+		}
+		else
+		{
+			ok = m_device->seek(pos);
+			resetBuffer();
+		}
 	}
 	else if (m_string)
 	{
 		ok = pos < m_string->size();
-		m_pos = pos;
+		if (ok)
+		{
+			resetBuffer();
+			m_index = int(pos);
+		}
 	}
 	if (!ok)
 		return false;
 
 	m_status = Ok;
 	m_lineNumber = lineNumber;
-	m_lastChar = 0;
 	m_phase = OutOfGame;
 
 	return true;
@@ -257,16 +371,45 @@ PgnStream::Status PgnStream::status() const
 	return m_status;
 }
 
-void PgnStream::parseUntil(const char* chars)
+void PgnStream::parseUntil(const CharSet& chars)
+{
+	readUntil(chars, &m_tokenString);
+}
+
+void PgnStream::skipSection(char start)
 {
-	Q_ASSERT(chars != nullptr);
+	static const CharSet variation("()");
+	static const CharSet comment("{}");
+	static const CharSet lineEnd("\n");
+
+	const CharSet* chars;
+	char end;
+	switch (start)
+	{
+	case '(':
+		chars = &variation;
+		end = ')';
+		break;
+	case '{':
+		chars = &comment;
+		end = '}';
+		break;
+	case ';':
+	case '%':
+		readUntil(lineEnd, nullptr);
+		return;
+	default:
+		return;
+	}
 
+	int level = 1;
 	char c;
-	while ((c = readChar()) != 0)
+	while ((c = readUntil(*chars, nullptr)) != 0)
 	{
-		if (strchr(chars, c))
+		if (c != end)
+			level++;
+		else if (--level == 0)
 			break;
-		m_tokenString.append(c);
 	}
 }
 
@@ -334,26 +477,36 @@ void PgnStream::parseTag()
 
 void PgnStream::parseComment(char opBracket)
 {
+	static const CharSet variation("()");
+	static const CharSet comment("{}");
+
+	const CharSet& brackets = (opBracket == '(') ? variation : comment;
 	int level = 1;
-	char clBracket = (opBracket == '(') ? ')' : '}';
 
 	char c;
-	while ((c = readChar()) != 0)
+	while ((c = readUntil(brackets, &m_tokenString)) != 0)
 	{
 		if (c == opBracket)
 			level++;
-		else if (c == clBracket && --level <= 0)
+		else if (--level <= 0)
 			break;
 
-		if (c != '\n' || !m_tokenString.isEmpty())
-			m_tokenString.append(c);
+		m_tokenString.append(c);
 	}
+
+	// Leave out the newlines at the start of the comment
+	int i = 0;
+	while (i < m_tokenString.size() && m_tokenString.at(i) == '\n')
+		i++;
+	m_tokenString.remove(0, i);
 }
 
 bool PgnStream::nextGame()
 {
+	static const CharSet sectionStart("[({;%");
+
 	char c;
-	while ((c = readChar()) != 0)
+	while ((c = readUntil(sectionStart, nullptr)) != 0)
 	{
 		if (c == '[')
 		{
@@ -362,7 +515,7 @@ bool PgnStream::nextGame()
 			return true;
 		}
 		else
-			skipSection(this, c);
+			skipSection(c);
 	}
 
 	return false;
@@ -370,6 +523,10 @@ bool PgnStream::nextGame()
 
 PgnStream::TokenType PgnStream::readNext()
 {
+	static const CharSet lineEnd("\n\r");
+	static const CharSet tokenEnd(" \t\n\r");
+	static const CharSet numberEnd(". \t\n\r");
+
 	if (m_phase == OutOfGame)
 		return NoToken;
 
@@ -389,7 +546,7 @@ PgnStream::TokenType PgnStream::readNext()
 			break;
 		case '%':
 			// Escape mechanism (skip this line)
-			parseUntil("\n\r");
+			parseUntil(lineEnd);
 			m_tokenString.clear();
 			break;
 		case '[':
@@ -409,12 +566,12 @@ PgnStream::TokenType PgnStream::readNext()
 			return m_tokenType;
 		case ';':
 			m_tokenType = PgnLineComment;
-			parseUntil("\n\r");
+			parseUntil(lineEnd);
 			return m_tokenType;
 		case '$':
 			// NAG (Numeric Annotation Glyph)
 			m_tokenType = PgnNag;
-			parseUntil(" \t\n\r");
+			parseUntil(tokenEnd);
 			return m_tokenType;
 		case '*':
 			// Unfinished game
@@ -426,7 +583,7 @@ PgnStream::TokenType PgnStream::readNext()
 		case '6': case '7': case '8': case '9': case '0':
 			// Move number or result
 			m_tokenString.append(c);
-			parseUntil(". \t\n\r");
+			parseUntil(numberEnd);
 
 			if (m_tokenString == "1-0"
 			||  m_tokenString == "0-1"
@@ -446,7 +603,7 @@ PgnStream::TokenType PgnStream::readNext()
 		default:
 			m_tokenType = PgnMove;
 			m_tokenString.append(c);
-			parseUntil(" \t\n\r");
+			parseUntil(tokenEnd);
 			m_phase = InGame;
 			return m_tokenType;
 		}
@@ -21,6 +21,7 @@
 
 #include <QtGlobal>
 #include <QString>
+#include <QVector>
 class QIODevice;
 namespace Chess { class Board; }
 
@@ -30,11 +31,19 @@ namespace Chess { class Board; }
  *
  * PgnStream is used for reading PGN games from a QIODevice or a string.
  * It has its own input methods, and keeps track of the current line
- * number which can be used to report errors in the games. PgnStream
- * also has its own Chess::Board object, so that the same board can be
- * easily used with all the games in the stream. The chess variant can
- * be changed at any time, so it's possible to read PGN streams that
- * contain games of multiple variants.
+ * number which can be used to report errors in the games.
+ *
+ * Data is read from the device in large blocks, and comments, variations,
+ * line comments and the text between games are skipped a block at a time
+ * instead of character by character. Carriage returns are removed from
+ * devices opened in text mode, but pos() and seek() still use offsets in
+ * the device. The device shouldn't be read by anyone else while it's in
+ * use by the stream.
+ *
+ * PgnStream also has its own Chess::Board object, so that the same
+ * board can be easily used with all the games in the stream. The chess
+ * variant can be changed at any time, so it's possible to read PGN
+ * streams that contain games of multiple variants.
  *
  * \sa PgnGame
  * \sa OpeningBook
@@ -200,14 +209,25 @@ class LIB_EXPORT PgnStream
 			InGame
 		};
 
-		void parseUntil(const char* chars);
+		class CharSet;
+
+		bool fillBuffer();
+		qint64 devicePos(int index) const;
+		void resetBuffer();
+		char readUntil(const CharSet& chars, QByteArray* skipped);
+		void skipSection(char start);
+		void parseUntil(const CharSet& chars);
 		void parseTag();
 		void parseComment(char opBracket);
 
 		Chess::Board* m_board;
-		qint64 m_pos;
+		QByteArray m_buffer;
+		const char* m_data;
+		int m_size;
+		int m_index;
+		qint64 m_bufferPos;
+		QVector<int> m_removedCr;
 		qint64 m_lineNumber;
-		char m_lastChar;
 		QByteArray m_tokenString;
 		QByteArray m_tagName;
 		QByteArray m_tagValue;
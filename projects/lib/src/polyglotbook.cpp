@@ -18,6 +18,7 @@
 
 #include "polyglotbook.h"
 #include <QDataStream>
+#include <QtEndian>
 
 namespace {
 
@@ -88,3 +89,18 @@ void PolyglotBook::writeEntry(const Map::const_iterator& it,
 	// Store the data. Again, big-endian is used by default.
 	out << key << pgMove << weight << learn;
 }
+
+quint64 PolyglotBook::keyFromData(const uchar* data) const
+{
+	return qFromBigEndian<quint64>(data);
+}
+
+OpeningBook::Entry PolyglotBook::entryFromData(const uchar* data,
+					       quint64* key) const
+{
+	*key = qFromBigEndian<quint64>(data);
+	quint16 pgMove = qFromBigEndian<quint16>(data + 8);
+	quint16 weight = qFromBigEndian<quint16>(data + 10);
+
+	return { moveFromBits(pgMove), weight };
+}
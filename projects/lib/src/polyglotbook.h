@@ -42,6 +42,8 @@ class LIB_EXPORT PolyglotBook: public OpeningBook
 		virtual Entry readEntry(QDataStream& in, quint64* key) const;
 		virtual void writeEntry(const Map::const_iterator& it,
 					QDataStream& out) const;
+		virtual quint64 keyFromData(const uchar* data) const;
+		virtual Entry entryFromData(const uchar* data, quint64* key) const;
 };
 
 #endif // POLYGLOT_BOOK_H
@@ -0,0 +1,485 @@
+/*
+    This file is part of Cute Chess.
+    Copyright (C) 2008-2018 Cute Chess authors
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "positionindex.h"
+#include <climits>
+#include <cstring>
+#include <algorithm>
+#include <functional>
+#include <QSaveFile>
+#include <QTemporaryFile>
+#include <QThread>
+#include <QThreadPool>
+#include "pgnstream.h"
+#include "pgngame.h"
+#include "pgngameentry.h"
+#include "gzipfile.h"
+#include "functiontask.h"
+#include "board/board.h"
+
+namespace {
+
+const quint32 s_magic = 0x49504343; // "CCPI"
+const quint32 s_version = 1;
+
+// Minimum number of games replayed by one thread
+const int s_minGamesPerThread = 64;
+
+// Number of records written with a single call
+const int s_writeBlockSize = 65536;
+
+// Number of records a thread sorts in memory before it spills them to
+// a temporary file as a sorted run (32 MiB)
+const int s_maxRunSize = 2 * 1024 * 1024;
+
+// Number of records read from a spilled run at a time
+const int s_readBlockSize = 4096;
+
+/*
+ * The header is followed by the stream positions and the line numbers
+ * of the games (qint64 each) and the position records, sorted by key,
+ * game and ply.
+ */
+struct Header
+{
+	quint32 magic;
+	quint32 version;
+	quint32 gameCount;
+	quint32 reserved1;
+	quint64 recordCount;
+	quint64 reserved2;
+};
+
+bool writeData(QIODevice& file, const void* data, qint64 size)
+{
+	return file.write(static_cast<const char*>(data), size) == size;
+}
+
+} // anonymous namespace
+
+struct PositionIndex::Record
+{
+	quint64 key;
+	quint32 game;
+	quint32 ply;
+};
+
+PositionIndex::PositionIndex()
+	: m_data(nullptr),
+	  m_gameCount(0),
+	  m_recordCount(0),
+	  m_positions(nullptr),
+	  m_lineNumbers(nullptr),
+	  m_records(nullptr)
+{
+}
+
+PositionIndex::~PositionIndex()
+{
+	close();
+}
+
+bool PositionIndex::build(const QString& fileName,
+			  const QString& pgnFileName,
+			  const QList<const PgnGameEntry*>& games,
+			  int threadCount)
+{
+	const int count = games.size();
+	if (threadCount <= 0)
+		threadCount = QThread::idealThreadCount();
+	// A compressed file is decompressed from its start to reach a
+	// game, so the threads would decompress the same data again
+	if (GzipFile::isCompressed(pgnFileName))
+		threadCount = 1;
+	threadCount = qBound(1, count / s_minGamesPerThread, qMax(1, threadCount));
+
+	auto lessThan = [](const Record& a, const Record& b)
+	{
+		if (a.key != b.key)
+			return a.key < b.key;
+		if (a.game != b.game)
+			return a.game < b.game;
+		return a.ply < b.ply;
+	};
+
+	// A sorted run of records. The last run of each thread stays in
+	// memory, the others are spilled to the thread's temporary file.
+	struct Run
+	{
+		QVector<Record> records;
+		QIODevice* file;
+		qint64 offset;
+		qint64 size;
+	};
+
+	// Each thread replays a contiguous range of games with its own
+	// stream and sorts the records of the range in runs
+	QVector<QVector<Run>> runs(threadCount);
+	QVector<QTemporaryFile*> tmpFiles(threadCount, nullptr);
+	QVector<bool> ok(threadCount, true);
+
+	auto readGames = [&](int thread)
+	{
+		QVector<Run>& threadRuns = runs[thread];
+		QVector<Record> out;
+		auto addRun = [&](bool last)
+		{
+			std::sort(out.begin(), out.end(), lessThan);
+			Run run = { QVector<Record>(), nullptr, 0, out.size() };
+			if (last)
+			{
+				run.records = out;
+				threadRuns.append(run);
+				return;
+			}
+
+			QTemporaryFile*& file = tmpFiles[thread];
+			if (file == nullptr)
+			{
+				file = new QTemporaryFile(fileName + ".XXXXXX");
+				if (!file->open())
+					ok[thread] = false;
+			}
+			run.file = file;
+			run.offset = file->pos();
+			if (!ok.at(thread)
+			||  !writeData(*file, out.constData(),
+				       out.size() * sizeof(Record)))
+				ok[thread] = false;
+			threadRuns.append(run);
+			out.resize(0);
+		};
+
+		QIODevice* device = GzipFile::openFile(pgnFileName,
+			QIODevice::ReadOnly | QIODevice::Text);
+		if (device == nullptr)
+		{
+			ok[thread] = false;
+			return;
+		}
+
+		const int first = int(qint64(count) * thread / threadCount);
+		const int last = int(qint64(count) * (thread + 1) / threadCount);
+		{
+			PgnStream stream(device);
+			PgnGame game;
+			QVector<Record> gameRecords;
+
+			for (int i = first; i < last && ok.at(thread); i++)
+			{
+				const PgnGameEntry* entry = games.at(i);
+				if (!stream.seek(entry->pos(), entry->lineNumber())
+				||  !game.read(stream, INT_MAX - 1, false))
+					continue;
+
+				gameRecords.resize(0);
+				const QVector<PgnGame::MoveData>& moves = game.moves();
+				for (int ply = 0; ply < moves.size(); ply++)
+					gameRecords.append({ moves.at(ply).key, quint32(i),
+							     quint32(ply) });
+
+				// Reading the game leaves the stream's board
+				// in the final position
+				if (!moves.isEmpty())
+					gameRecords.append({ stream.board()->key(),
+							     quint32(i),
+							     quint32(moves.size()) });
+
+				// Keep only the first ply of a repeated position
+				std::sort(gameRecords.begin(), gameRecords.end(),
+					  lessThan);
+				auto end = std::unique(gameRecords.begin(),
+						       gameRecords.end(),
+					[](const Record& a, const Record& b)
+				{
+					return a.key == b.key;
+				});
+				for (auto it = gameRecords.begin(); it != end; ++it)
+					out.append(*it);
+
+				if (out.size() >= s_maxRunSize)
+					addRun(false);
+			}
+		}
+		delete device;
+
+		addRun(true);
+	};
+
+	QThreadPool pool;
+	pool.setMaxThreadCount(threadCount);
+	FunctionTask::parallelFor(&pool, threadCount, readGames);
+
+	// Reads a run a block at a time during the merge
+	struct RunReader
+	{
+		const Run* run;
+		QVector<Record> block;
+		int index;
+		qint64 read;
+
+		bool fill()
+		{
+			index = 0;
+			if (run->file == nullptr)
+			{
+				block = run->records;
+				read = run->size;
+				return true;
+			}
+
+			const int size = int(qMin<qint64>(s_readBlockSize,
+							  run->size - read));
+			const qint64 bytes = size * qint64(sizeof(Record));
+			block.resize(size);
+			if (!run->file->seek(run->offset + read * sizeof(Record))
+			||  run->file->read(reinterpret_cast<char*>(block.data()),
+					    bytes) != bytes)
+				return false;
+			read += size;
+			return true;
+		}
+	};
+
+	Header header;
+	std::memset(&header, 0, sizeof(header));
+	header.magic = s_magic;
+	header.version = s_version;
+	header.gameCount = count;
+
+	QVector<RunReader> readers;
+	bool written = !ok.contains(false);
+	for (const QVector<Run>& threadRuns : qAsConst(runs))
+	{
+		for (const Run& run : threadRuns)
+		{
+			header.recordCount += run.size;
+			if (run.size > 0)
+				readers.append({ &run, QVector<Record>(), 0, 0 });
+		}
+	}
+	for (RunReader& reader : readers)
+		written = written && reader.fill();
+
+	QVector<qint64> positions(count);
+	QVector<qint64> lineNumbers(count);
+	for (int i = 0; i < count; i++)
+	{
+		positions[i] = games.at(i)->pos();
+		lineNumbers[i] = games.at(i)->lineNumber();
+	}
+
+	QSaveFile file(fileName);
+	written = written
+		&& file.open(QIODevice::WriteOnly)
+		&& writeData(file, &header, sizeof(header))
+		&& writeData(file, positions.constData(), count * sizeof(qint64))
+		&& writeData(file, lineNumbers.constData(), count * sizeof(qint64));
+
+	// Merge the runs with a heap of the readers, ordered by their
+	// next records. The game ranges of the threads don't overlap, and
+	// a game's records are all in the same run, so there are no
+	// duplicates between the runs.
+	auto greaterThan = [&](int a, int b)
+	{
+		const RunReader& ra = readers.at(a);
+		const RunReader& rb = readers.at(b);
+		return lessThan(rb.block.at(rb.index), ra.block.at(ra.index));
+	};
+	QVector<int> heap;
+	for (int i = 0; i < readers.size(); i++)
+		heap.append(i);
+	std::make_heap(heap.begin(), heap.end(), greaterThan);
+
+	QVector<Record> block;
+	block.reserve(s_writeBlockSize);
+
+	while (written && !heap.isEmpty())
+	{
+		std::pop_heap(heap.begin(), heap.end(), greaterThan);
+		RunReader& reader = readers[heap.last()];
+		block.append(reader.block.at(reader.index));
+
+		if (++reader.index < reader.block.size()
+		||  (reader.read < reader.run->size && (written = reader.fill())))
+			std::push_heap(heap.begin(), heap.end(), greaterThan);
+		else
+			heap.removeLast();
+
+		if (block.size() == s_writeBlockSize || heap.isEmpty())
+		{
+			written = written
+				&& writeData(file, block.constData(),
+					     block.size() * sizeof(Record));
+			block.resize(0);
+		}
+	}
+	qDeleteAll(tmpFiles);
+
+	if (!written)
+	{
+		file.cancelWriting();
+		return false;
+	}
+
+	return file.commit();
+}
+
+bool PositionIndex::build(const QString& fileName,
+			  const QString& pgnFileName,
+			  int threadCount)
+{
+	QIODevice* device = GzipFile::openFile(pgnFileName,
+		QIODevice::ReadOnly | QIODevice::Text);
+	if (device == nullptr)
+		return false;
+
+	QList<const PgnGameEntry*> games;
+	{
+		PgnStream stream(device);
+		for (;;)
+		{
+			PgnGameEntry* entry = new PgnGameEntry;
+			if (!entry->read(stream))
+			{
+				delete entry;
+				break;
+			}
+			games << entry;
+		}
+	}
+	delete device;
+
+	bool ok = build(fileName, pgnFileName, games, threadCount);
+	qDeleteAll(games);
+
+	return ok;
+}
+
+bool PositionIndex::open(const QString& fileName)
+{
+	close();
+
+	m_file.setFileName(fileName);
+	if (!m_file.open(QIODevice::ReadOnly))
+		return false;
+
+	const qint64 size = m_file.size();
+	if (size < qint64(sizeof(Header))
+	||  (m_data = m_file.map(0, size)) == nullptr)
+	{
+		close();
+		return false;
+	}
+
+	Header header;
+	std::memcpy(&header, m_data, sizeof(header));
+
+	const qint64 gameCount = header.gameCount;
+	const qint64 recordSize = sizeof(Record);
+	if (header.magic != s_magic
+	||  header.version != s_version
+	||  gameCount > INT_MAX
+	||  header.recordCount > quint64(size) / recordSize
+	||  size != qint64(sizeof(Header))
+		  + gameCount * 2 * qint64(sizeof(qint64))
+		  + qint64(header.recordCount) * recordSize)
+	{
+		close();
+		return false;
+	}
+
+	const uchar* data = m_data + sizeof(Header);
+	m_gameCount = int(gameCount);
+	m_recordCount = qint64(header.recordCount);
+	m_positions = reinterpret_cast<const qint64*>(data);
+	data += gameCount * sizeof(qint64);
+	m_lineNumbers = reinterpret_cast<const qint64*>(data);
+	data += gameCount * sizeof(qint64);
+	m_records = reinterpret_cast<const Record*>(data);
+
+	return true;
+}
+
+void PositionIndex::close()
+{
+	if (m_data != nullptr)
+		m_file.unmap(const_cast<uchar*>(m_data));
+	m_file.close();
+
+	m_data = nullptr;
+	m_gameCount = 0;
+	m_recordCount = 0;
+	m_positions = nullptr;
+	m_lineNumbers = nullptr;
+	m_records = nullptr;
+}
+
+bool PositionIndex::isOpen() const
+{
+	return m_data != nullptr;
+}
+
+QString PositionIndex::fileName() const
+{
+	return m_file.fileName();
+}
+
+int PositionIndex::gameCount() const
+{
+	return m_gameCount;
+}
+
+qint64 PositionIndex::positionCount() const
+{
+	return m_recordCount;
+}
+
+qint64 PositionIndex::gamePos(int game) const
+{
+	Q_ASSERT(game >= 0 && game < m_gameCount);
+	return m_positions[game];
+}
+
+qint64 PositionIndex::gameLineNumber(int game) const
+{
+	Q_ASSERT(game >= 0 && game < m_gameCount);
+	return m_lineNumbers[game];
+}
+
+QVector<PositionIndex::Match> PositionIndex::find(quint64 key) const
+{
+	QVector<Match> matches;
+	if (!isOpen())
+		return matches;
+
+	const Record* end = m_records + m_recordCount;
+	const Record* first = std::lower_bound(m_records, end, key,
+		[](const Record& record, quint64 key)
+	{
+		return record.key < key;
+	});
+
+	for (const Record* it = first; it != end && it->key == key; ++it)
+	{
+		if (it->game < quint32(m_gameCount))
+			matches.append({ int(it->game), int(it->ply) });
+	}
+
+	return matches;
+}
@@ -0,0 +1,139 @@
+/*
+    This file is part of Cute Chess.
+    Copyright (C) 2008-2018 Cute Chess authors
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef POSITIONINDEX_H
+#define POSITIONINDEX_H
+
+#include <QList>
+#include <QVector>
+#include <QFile>
+class PgnGameEntry;
+
+/*!
+ * \brief A memory-mapped index of the positions in a PGN file.
+ *
+ * PositionIndex answers the question "which games reached this
+ * position". Every position of every game is stored as a record of
+ * the position's zobrist key, the game number and the ply, and the
+ * records are sorted by key. The index file is mapped into memory, so
+ * a lookup is a binary search that only touches a few pages of the
+ * file.
+ *
+ * A position that occurs more than once in a game is only recorded at
+ * its first ply. The games are numbered in the order they appear in
+ * the PGN file, and the index also stores where each game begins.
+ *
+ * Like PgnGameIndex, the file uses the byte order of the machine that
+ * wrote it.
+ *
+ * \sa PgnGameIndex
+ */
+class LIB_EXPORT PositionIndex
+{
+	public:
+		/*! A game that reached a position. */
+		struct Match
+		{
+			/*! The number of the game, starting from 0. */
+			int game;
+			/*! The ply at which the position was reached. */
+			int ply;
+		};
+
+		/*! Creates a new index with no file. */
+		PositionIndex();
+		/*! Closes and destroys the index. */
+		~PositionIndex();
+
+		/*!
+		 * Writes an index of the positions in \a games to file
+		 * \a fileName.
+		 *
+		 * \a games are the entries of PGN file \a pgnFileName in
+		 * file order. The games are read and replayed in
+		 * \a threadCount threads; if \a threadCount is 0, the
+		 * number of threads is chosen automatically. A compressed
+		 * PGN file is always read in one thread, because it can't
+		 * be read from the middle without decompressing it from the
+		 * start. Games that can't be read are skipped.
+		 *
+		 * The records are sorted in bounded runs, and runs that
+		 * don't fit in memory are spilled to temporary files next
+		 * to \a fileName and merged into the index, so large
+		 * databases can be indexed with limited memory.
+		 *
+		 * The file is replaced atomically. Returns true if
+		 * successful; otherwise returns false.
+		 */
+		static bool build(const QString& fileName,
+				  const QString& pgnFileName,
+				  const QList<const PgnGameEntry*>& games,
+				  int threadCount = 0);
+		/*!
+		 * Writes an index of the positions in all the games of
+		 * PGN file \a pgnFileName to file \a fileName.
+		 *
+		 * This is an overloaded function that finds the games
+		 * in the file first.
+		 */
+		static bool build(const QString& fileName,
+				  const QString& pgnFileName,
+				  int threadCount = 0);
+
+		/*!
+		 * Opens and maps index file \a fileName.
+		 * Returns true if successful; otherwise returns false.
+		 */
+		bool open(const QString& fileName);
+		/*! Closes the index file. */
+		void close();
+		/*! Returns true if an index file is open. */
+		bool isOpen() const;
+		/*! Returns the name of the index file. */
+		QString fileName() const;
+
+		/*! Returns the number of games in the index. */
+		int gameCount() const;
+		/*! Returns the number of position records in the index. */
+		qint64 positionCount() const;
+		/*! Returns the stream position where \a game begins. */
+		qint64 gamePos(int game) const;
+		/*! Returns the line number where \a game begins. */
+		qint64 gameLineNumber(int game) const;
+
+		/*!
+		 * Returns the games that reached the position with zobrist
+		 * key \a key, sorted by game number.
+		 *
+		 * This function is thread-safe.
+		 */
+		QVector<Match> find(quint64 key) const;
+
+	private:
+		struct Record;
+
+		QFile m_file;
+		const uchar* m_data;
+		int m_gameCount;
+		qint64 m_recordCount;
+		const qint64* m_positions;
+		const qint64* m_lineNumbers;
+		const Record* m_records;
+};
+
+#endif // POSITIONINDEX_H
@@ -0,0 +1,155 @@
+/*
+    This file is part of Cute Chess.
+    Copyright (C) 2008-2018 Cute Chess authors
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "processusage.h"
+#include <QFile>
+#include <QList>
+#include <QByteArray>
+
+#ifdef Q_OS_LINUX
+#include <unistd.h>
+#endif
+
+
+ProcessUsage::ProcessUsage()
+	: m_isNull(true),
+	  m_userTime(0),
+	  m_systemTime(0),
+	  m_residentSize(0),
+	  m_voluntarySwitches(0),
+	  m_involuntarySwitches(0)
+{
+}
+
+ProcessUsage ProcessUsage::sample(qint64 pid)
+{
+	ProcessUsage usage;
+	if (pid <= 0)
+		return usage;
+
+#ifdef Q_OS_LINUX
+	static const qint64 ticksPerSecond = sysconf(_SC_CLK_TCK);
+	static const qint64 pageSize = sysconf(_SC_PAGESIZE) / 1024;
+
+	const QByteArray dir = "/proc/" + QByteArray::number(pid);
+
+	QFile statFile(dir + "/stat");
+	if (!statFile.open(QIODevice::ReadOnly))
+		return usage;
+	const QByteArray stat = statFile.readAll();
+
+	// The command name may contain spaces, so the numeric
+	// fields are read from the last closing parenthesis on.
+	int pos = stat.lastIndexOf(')');
+	if (pos == -1)
+		return usage;
+	const QList<QByteArray> fields = stat.mid(pos + 2).split(' ');
+	if (fields.size() < 22)
+		return usage;
+
+	// Field 3 of the stat file (process state) is at index 0
+	usage.m_userTime = fields.at(11).toLongLong() * 1000 / ticksPerSecond;
+	usage.m_systemTime = fields.at(12).toLongLong() * 1000 / ticksPerSecond;
+	usage.m_residentSize = fields.at(21).toLongLong() * pageSize;
+
+	// getrusage() can't be used for a running child process, so
+	// the context switch counters come from the status file.
+	QFile statusFile(dir + "/status");
+	if (statusFile.open(QIODevice::ReadOnly))
+	{
+		const QList<QByteArray> lines = statusFile.readAll().split('\n');
+		for (const QByteArray& line : lines)
+		{
+			if (line.startsWith("voluntary_ctxt_switches:"))
+				usage.m_voluntarySwitches = line.mid(24).trimmed().toLongLong();
+			else if (line.startsWith("nonvoluntary_ctxt_switches:"))
+				usage.m_involuntarySwitches = line.mid(27).trimmed().toLongLong();
+		}
+	}
+
+	usage.m_isNull = false;
+#endif
+
+	return usage;
+}
+
+bool ProcessUsage::isNull() const
+{
+	return m_isNull;
+}
+
+qint64 ProcessUsage::userTime() const
+{
+	return m_userTime;
+}
+
+qint64 ProcessUsage::systemTime() const
+{
+	return m_systemTime;
+}
+
+qint64 ProcessUsage::cpuTime() const
+{
+	return m_userTime + m_systemTime;
+}
+
+qint64 ProcessUsage::residentSize() const
+{
+	return m_residentSize;
+}
+
+qint64 ProcessUsage::voluntarySwitches() const
+{
+	return m_voluntarySwitches;
+}
+
+qint64 ProcessUsage::involuntarySwitches() const
+{
+	return m_involuntarySwitches;
+}
+
+ProcessUsage ProcessUsage::operator-(const ProcessUsage& other) const
+{
+	ProcessUsage usage;
+	if (m_isNull || other.m_isNull)
+		return usage;
+
+	usage.m_isNull = false;
+	usage.m_userTime = m_userTime - other.m_userTime;
+	usage.m_systemTime = m_systemTime - other.m_systemTime;
+	usage.m_residentSize = m_residentSize;
+	usage.m_voluntarySwitches = m_voluntarySwitches - other.m_voluntarySwitches;
+	usage.m_involuntarySwitches = m_involuntarySwitches - other.m_involuntarySwitches;
+
+	return usage;
+}
+
+ProcessUsage& ProcessUsage::operator+=(const ProcessUsage& other)
+{
+	if (other.m_isNull)
+		return *this;
+
+	m_isNull = false;
+	m_userTime += other.m_userTime;
+	m_systemTime += other.m_systemTime;
+	m_residentSize = qMax(m_residentSize, other.m_residentSize);
+	m_voluntarySwitches += other.m_voluntarySwitches;
+	m_involuntarySwitches += other.m_involuntarySwitches;
+
+	return *this;
+}
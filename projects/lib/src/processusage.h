@@ -0,0 +1,92 @@
+/*
+    This file is part of Cute Chess.
+    Copyright (C) 2008-2018 Cute Chess authors
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PROCESSUSAGE_H
+#define PROCESSUSAGE_H
+
+#include <QtGlobal>
+
+/*!
+ * \brief Resource usage of an engine process
+ *
+ * The ProcessUsage class stores the CPU time, resident memory and
+ * context switch counters of an operating system process. A sample
+ * taken at the start of a move can be subtracted from a sample taken
+ * at the end of the move to get the resources used by the engine while
+ * it was thinking.
+ *
+ * Sampling is only implemented on Linux, where the values are read from
+ * the proc filesystem. On other systems every sample is null.
+ */
+class LIB_EXPORT ProcessUsage
+{
+	public:
+		/*! Creates a new null ProcessUsage object. */
+		ProcessUsage();
+
+		/*!
+		 * Returns the current resource usage of process \a pid.
+		 *
+		 * Returns a null object if the process doesn't exist or
+		 * if sampling is not supported on this system.
+		 */
+		static ProcessUsage sample(qint64 pid);
+
+		/*! Returns true if the object holds no data. */
+		bool isNull() const;
+
+		/*! Returns the CPU time spent in user mode in milliseconds. */
+		qint64 userTime() const;
+		/*! Returns the CPU time spent in kernel mode in milliseconds. */
+		qint64 systemTime() const;
+		/*! Returns the total CPU time in milliseconds. */
+		qint64 cpuTime() const;
+		/*!
+		 * Returns the resident set size in kilobytes.
+		 *
+		 * For accumulated usage this is the peak value.
+		 */
+		qint64 residentSize() const;
+		/*! Returns the number of voluntary context switches. */
+		qint64 voluntarySwitches() const;
+		/*! Returns the number of involuntary context switches. */
+		qint64 involuntarySwitches() const;
+
+		/*!
+		 * Returns the resources used between \a other and this sample.
+		 *
+		 * The resident set size of the result is taken from this sample.
+		 * If either sample is null, a null object is returned.
+		 */
+		ProcessUsage operator-(const ProcessUsage& other) const;
+		/*!
+		 * Adds the CPU times and context switches of \a other to this
+		 * object and keeps the larger resident set size.
+		 */
+		ProcessUsage& operator+=(const ProcessUsage& other);
+
+	private:
+		bool m_isNull;
+		qint64 m_userTime;
+		qint64 m_systemTime;
+		qint64 m_residentSize;
+		qint64 m_voluntarySwitches;
+		qint64 m_involuntarySwitches;
+};
+
+#endif // PROCESSUSAGE_H
@@ -18,6 +18,7 @@
 
 
 #include "pyramidtournament.h"
+#include <QDataStream>
 #include <algorithm>
 
 PyramidTournament::PyramidTournament(GameManager* gameManager,
@@ -65,3 +66,23 @@ TournamentPair* PyramidTournament::nextPair(int gameNumber)
 
 	return pair(white, black);
 }
+
+void PyramidTournament::writePairingState(QDataStream& out) const
+{
+	out << qint32(m_pairNumber) << qint32(m_currentPlayer);
+}
+
+bool PyramidTournament::readPairingState(QDataStream& in)
+{
+	qint32 pairNumber;
+	qint32 currentPlayer;
+	in >> pairNumber >> currentPlayer;
+	if (in.status() != QDataStream::Ok
+	||  currentPlayer < 1 || currentPlayer >= playerCount()
+	||  pairNumber < 0 || pairNumber > currentPlayer)
+		return false;
+
+	m_pairNumber = pairNumber;
+	m_currentPlayer = currentPlayer;
+	return true;
+}
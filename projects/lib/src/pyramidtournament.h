@@ -44,6 +44,8 @@ class LIB_EXPORT PyramidTournament : public Tournament
 		virtual void initializePairing();
 		virtual int gamesPerCycle() const;
 		virtual TournamentPair* nextPair(int gameNumber);
+		virtual void writePairingState(QDataStream& out) const;
+		virtual bool readPairingState(QDataStream& in);
 
 	private:
 		int m_pairNumber;
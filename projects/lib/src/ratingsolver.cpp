@@ -0,0 +1,474 @@
+/*
+    This file is part of Cute Chess.
+    Copyright (C) 2008-2018 Cute Chess authors
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ratingsolver.h"
+#include <QThread>
+#include <QThreadPool>
+#include <QDataStream>
+#include <QScopedPointer>
+#include <QtMath>
+#include <algorithm>
+#include <functional>
+#include <random>
+#include "functiontask.h"
+
+namespace {
+
+// Convergence limit for the change of log(gamma) in one iteration
+const qreal s_tolerance = 1e-9;
+const int s_defaultMaxIterations = 10000;
+
+// Minimum number of pairwise results per thread in one iteration
+const int s_minWorkPerThread = 10000;
+
+// Seed of the first bootstrap sample, so that the results are repeatable
+const unsigned s_bootstrapSeed = 1;
+
+qreal gammaToElo(qreal gamma)
+{
+	return 400.0 * std::log10(gamma);
+}
+
+} // anonymous namespace
+
+RatingSolver::RatingSolver()
+	: m_gameCount(0),
+	  m_bootstrapCount(100),
+	  m_threadCount(1),
+	  m_confidence(0.95),
+	  m_maxIterations(s_defaultMaxIterations),
+	  m_iterations(0)
+{
+}
+
+void RatingSolver::clear()
+{
+	m_pairs.clear();
+	m_pairIndex.clear();
+	m_games.clear();
+	m_points.clear();
+	m_gameCount = 0;
+	m_firstOpponent.clear();
+	m_opponents.clear();
+	m_iterations = 0;
+	m_gamma.clear();
+	m_elo.clear();
+	m_lowerBound.clear();
+	m_upperBound.clear();
+}
+
+void RatingSolver::addResult(int player1, int player2, qreal points1)
+{
+	Q_ASSERT(player1 >= 0);
+	Q_ASSERT(player2 >= 0);
+	if (player1 == player2)
+		return;
+
+	points1 = qBound(0.0, points1, 1.0);
+	int size = qMax(player1, player2) + 1;
+	if (size > m_games.size())
+	{
+		m_games.resize(size);
+		m_points.resize(size);
+	}
+	m_games[player1]++;
+	m_games[player2]++;
+	m_points[player1] += points1;
+	m_points[player2] += 1.0 - points1;
+	m_gameCount++;
+
+	// Each pair is stored once, from the point of view of the player
+	// with the lower index
+	if (player1 > player2)
+	{
+		qSwap(player1, player2);
+		points1 = 1.0 - points1;
+	}
+	quint64 key = (quint64(player1) << 32) | quint64(player2);
+	auto it = m_pairIndex.constFind(key);
+	int index;
+	if (it == m_pairIndex.constEnd())
+	{
+		index = m_pairs.size();
+		Pair pair = { player1, player2, 0, 0.0, 0.0 };
+		m_pairs.append(pair);
+		m_pairIndex.insert(key, index);
+	}
+	else
+		index = it.value();
+
+	Pair& pair = m_pairs[index];
+	pair.games++;
+	pair.points += points1;
+	pair.squarePoints += points1 * points1;
+}
+
+int RatingSolver::playerCount() const
+{
+	return m_games.size();
+}
+
+int RatingSolver::gameCount() const
+{
+	return m_gameCount;
+}
+
+void RatingSolver::write(QDataStream& out) const
+{
+	out << qint32(m_pairs.size());
+	for (const Pair& pair : m_pairs)
+	{
+		out << qint32(pair.player1) << qint32(pair.player2)
+		    << qint32(pair.games) << pair.points << pair.squarePoints;
+	}
+}
+
+bool RatingSolver::read(QDataStream& in)
+{
+	clear();
+
+	qint32 count;
+	in >> count;
+	if (in.status() != QDataStream::Ok || count < 0)
+		return false;
+
+	for (int i = 0; i < count; i++)
+	{
+		qint32 player1;
+		qint32 player2;
+		qint32 games;
+		Pair pair;
+		in >> player1 >> player2 >> games >> pair.points >> pair.squarePoints;
+		if (in.status() != QDataStream::Ok
+		||  player1 < 0 || player2 <= player1 || games <= 0)
+		{
+			clear();
+			return false;
+		}
+		pair.player1 = player1;
+		pair.player2 = player2;
+		pair.games = games;
+
+		if (player2 >= m_games.size())
+		{
+			m_games.resize(player2 + 1);
+			m_points.resize(player2 + 1);
+		}
+		m_games[player1] += games;
+		m_games[player2] += games;
+		m_points[player1] += pair.points;
+		m_points[player2] += games - pair.points;
+		m_gameCount += games;
+
+		m_pairIndex.insert((quint64(player1) << 32) | quint64(player2), i);
+		m_pairs.append(pair);
+	}
+
+	return true;
+}
+
+void RatingSolver::setBootstrapCount(int count)
+{
+	Q_ASSERT(count >= 0);
+	m_bootstrapCount = count;
+}
+
+int RatingSolver::bootstrapCount() const
+{
+	return m_bootstrapCount;
+}
+
+void RatingSolver::setThreadCount(int count)
+{
+	Q_ASSERT(count >= 0);
+	m_threadCount = count;
+}
+
+void RatingSolver::setConfidence(qreal confidence)
+{
+	Q_ASSERT(confidence > 0.0 && confidence < 1.0);
+	m_confidence = confidence;
+}
+
+qreal RatingSolver::confidence() const
+{
+	return m_confidence;
+}
+
+void RatingSolver::setMaxIterations(int count)
+{
+	Q_ASSERT(count > 0);
+	m_maxIterations = count;
+}
+
+void RatingSolver::setInitialRatings(const QVector<qreal>& elo)
+{
+	m_gamma.resize(elo.size());
+	for (int i = 0; i < elo.size(); i++)
+		m_gamma[i] = std::pow(10.0, elo.at(i) / 400.0);
+}
+
+int RatingSolver::iterationCount() const
+{
+	return m_iterations;
+}
+
+RatingSolver::Rating RatingSolver::rating(int player) const
+{
+	Rating rating = { 0, 0.0, 0.0, 0.0, 0.0 };
+	if (player < 0 || player >= m_elo.size())
+		return rating;
+
+	rating.games = m_games.at(player);
+	rating.points = m_points.at(player);
+	rating.elo = m_elo.at(player);
+	rating.lowerBound = m_lowerBound.at(player);
+	rating.upperBound = m_upperBound.at(player);
+
+	return rating;
+}
+
+void RatingSolver::buildOpponents()
+{
+	// Compressed adjacency lists: the opponents of player i are
+	// m_opponents[m_firstOpponent[i] ... m_firstOpponent[i + 1] - 1]
+	const int count = playerCount();
+	m_firstOpponent.fill(0, count + 1);
+	for (const Pair& pair : qAsConst(m_pairs))
+	{
+		m_firstOpponent[pair.player1 + 1]++;
+		m_firstOpponent[pair.player2 + 1]++;
+	}
+	for (int i = 0; i < count; i++)
+		m_firstOpponent[i + 1] += m_firstOpponent[i];
+
+	QVector<int> pos(m_firstOpponent);
+	m_opponents.resize(m_pairs.size() * 2);
+	for (int i = 0; i < m_pairs.size(); i++)
+	{
+		const Pair& pair = m_pairs.at(i);
+		Opponent opp1 = { pair.player2, i, true };
+		Opponent opp2 = { pair.player1, i, false };
+		m_opponents[pos[pair.player1]++] = opp1;
+		m_opponents[pos[pair.player2]++] = opp2;
+	}
+}
+
+int RatingSolver::fit(const QVector<qreal>& points,
+		      QVector<qreal>& gamma,
+		      QThreadPool* pool,
+		      int threadCount) const
+{
+	const int count = playerCount();
+	QVector<qreal> newGamma(count);
+	QVector<qreal> logSum(threadCount);
+
+	// The threads only access the data through these pointers, so
+	// that the vectors are never detached in a worker thread
+	const qreal* oldData = nullptr;
+	qreal* newData = nullptr;
+	qreal* logSumData = logSum.data();
+
+	// One MM step for the players of one chunk. Each player has a
+	// virtual draw against an average player, whose gamma is 1.
+	auto update = [&](int chunk)
+	{
+		int first = qint64(count) * chunk / threadCount;
+		int last = qint64(count) * (chunk + 1) / threadCount;
+		qreal sumOfLogs = 0.0;
+
+		for (int i = first; i < last; i++)
+		{
+			const qreal g = oldData[i];
+			qreal wins = 0.5;
+			qreal sum = 1.0 / (g + 1.0);
+
+			for (int j = m_firstOpponent.at(i); j < m_firstOpponent.at(i + 1); j++)
+			{
+				const Opponent& opp = m_opponents.at(j);
+				const Pair& pair = m_pairs.at(opp.pair);
+				const qreal p = points.at(opp.pair);
+
+				wins += opp.isFirst ? p : pair.games - p;
+				sum += pair.games / (g + oldData[opp.player]);
+			}
+
+			qreal ng = wins / sum;
+			newData[i] = ng;
+			sumOfLogs += std::log(ng);
+		}
+		logSumData[chunk] = sumOfLogs;
+	};
+
+	for (int iter = 1; iter <= m_maxIterations; iter++)
+	{
+		oldData = gamma.constData();
+		newData = newGamma.data();
+		FunctionTask::parallelFor(pool, threadCount, update);
+
+		// Keep the geometric mean at 1. Otherwise the iteration
+		// would converge very slowly in the direction where all
+		// ratings move together, because only the virtual games
+		// hold it in place.
+		qreal mean = 0.0;
+		for (qreal sum : qAsConst(logSum))
+			mean += sum;
+		const qreal scale = std::exp(-mean / count);
+
+		qreal change = 0.0;
+		for (int i = 0; i < count; i++)
+		{
+			newData[i] *= scale;
+			change = qMax(change, qAbs(std::log(newData[i] / oldData[i])));
+		}
+		gamma.swap(newGamma);
+
+		if (change < s_tolerance)
+			return iter;
+	}
+
+	return -1;
+}
+
+void RatingSolver::bootstrap(QThreadPool* pool, int threadCount)
+{
+	const int count = playerCount();
+	const int samples = m_bootstrapCount;
+	QVector<qreal> elos(samples * count);
+	qreal* eloData = elos.data();
+
+	// Each thread fits a share of the samples on its own, starting
+	// from the maximum likelihood solution
+	auto run = [&](int chunk)
+	{
+		QVector<qreal> points(m_pairs.size());
+		std::normal_distribution<qreal> normal;
+
+		for (int s = chunk; s < samples; s += threadCount)
+		{
+			std::mt19937 random(s_bootstrapSeed + s);
+			for (int i = 0; i < m_pairs.size(); i++)
+			{
+				const Pair& pair = m_pairs.at(i);
+				qreal mean = pair.points / pair.games;
+				qreal var = qMax(0.0, pair.squarePoints / pair.games - mean * mean);
+				qreal p = pair.points
+					+ std::sqrt(pair.games * var) * normal(random);
+				points[i] = qBound(0.0, p, qreal(pair.games));
+			}
+
+			QVector<qreal> gamma(m_gamma);
+			fit(points, gamma, nullptr, 1);
+
+			qreal* elo = eloData + s * count;
+			qreal sum = 0.0;
+			int rated = 0;
+			for (int i = 0; i < count; i++)
+			{
+				elo[i] = gammaToElo(gamma.at(i));
+				if (m_games.at(i) > 0)
+				{
+					sum += elo[i];
+					rated++;
+				}
+			}
+			for (int i = 0; i < count; i++)
+				elo[i] -= sum / qMax(rated, 1);
+		}
+	};
+	FunctionTask::parallelFor(pool, threadCount, run);
+
+	const qreal tail = (1.0 - m_confidence) / 2.0;
+	const int lower = qBound(0, qRound(tail * (samples - 1)), samples - 1);
+	const int upper = qBound(0, qRound((1.0 - tail) * (samples - 1)), samples - 1);
+	QVector<qreal> values(samples);
+	for (int i = 0; i < count; i++)
+	{
+		for (int s = 0; s < samples; s++)
+			values[s] = elos.at(s * count + i);
+		std::sort(values.begin(), values.end());
+		m_lowerBound[i] = values.at(lower);
+		m_upperBound[i] = values.at(upper);
+	}
+}
+
+bool RatingSolver::solve()
+{
+	const int count = playerCount();
+	m_gamma.resize(count);
+	for (qreal& gamma : m_gamma)
+	{
+		if (gamma <= 0.0)
+			gamma = 1.0;
+	}
+	m_elo.fill(0.0, count);
+	m_lowerBound.fill(0.0, count);
+	m_upperBound.fill(0.0, count);
+	m_iterations = 0;
+	if (count == 0)
+		return true;
+
+	buildOpponents();
+
+	const int maxThreads = qMax(1, QThread::idealThreadCount());
+	int threadCount = m_threadCount;
+	if (threadCount <= 0)
+		threadCount = maxThreads;
+	threadCount = qBound(1, threadCount, maxThreads);
+	int fitThreads = qBound(1, m_opponents.size() / s_minWorkPerThread, threadCount);
+
+	// A single thread needs no pool
+	QScopedPointer<QThreadPool> pool;
+	if (threadCount > 1)
+	{
+		pool.reset(new QThreadPool);
+		pool->setMaxThreadCount(threadCount);
+	}
+
+	QVector<qreal> points(m_pairs.size());
+	for (int i = 0; i < m_pairs.size(); i++)
+		points[i] = m_pairs.at(i).points;
+
+	m_iterations = fit(points, m_gamma, pool.data(), fitThreads);
+	bool ok = m_iterations > 0;
+	if (!ok)
+		m_iterations = m_maxIterations;
+
+	qreal sum = 0.0;
+	int rated = 0;
+	for (int i = 0; i < count; i++)
+	{
+		m_elo[i] = gammaToElo(m_gamma.at(i));
+		if (m_games.at(i) > 0)
+		{
+			sum += m_elo.at(i);
+			rated++;
+		}
+	}
+	for (int i = 0; i < count; i++)
+	{
+		m_elo[i] -= sum / qMax(rated, 1);
+		m_lowerBound[i] = m_elo.at(i);
+		m_upperBound[i] = m_elo.at(i);
+	}
+
+	if (m_bootstrapCount > 0 && m_gameCount > 0)
+		bootstrap(pool.data(), qMin(threadCount, m_bootstrapCount));
+
+	return ok;
+}
@@ -0,0 +1,195 @@
+/*
+    This file is part of Cute Chess.
+    Copyright (C) 2008-2018 Cute Chess authors
+
+    Cute Chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cute Chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Cute Chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef RATINGSOLVER_H
+#define RATINGSOLVER_H
+
+#include <QVector>
+#include <QHash>
+class QThreadPool;
+class QDataStream;
+
+/*!
+ * \brief A maximum likelihood rating solver for multi-player events
+ *
+ * Unlike the Elo class, which rates each player against an imaginary
+ * average opponent, RatingSolver fits the ratings of all players at once
+ * from the full table of pairwise results. It uses the Bradley-Terry
+ * model, where the expected score of player A against player B is
+ * 1 / (1 + 10^((Rb - Ra) / 400)). Game results can be any number of
+ * points between 0 and 1, so fractional r-Mobility scores are handled
+ * directly.
+ *
+ * The ratings are found with the minorization-maximization (MM)
+ * algorithm, which updates every player in parallel on each iteration.
+ * Every player also gets one virtual drawn game against a player of
+ * average rating, which keeps the ratings finite when a player has won
+ * or lost every game. The ratings are normalized so that their average
+ * is 0.
+ *
+ * Confidence intervals are estimated with a parametric bootstrap: the
+ * score of every pair of players is resampled from its observed mean
+ * and variance, and the ratings are fitted again. The bootstrap
+ * samples are distributed over several threads.
+ */
+class LIB_EXPORT RatingSolver
+{
+	public:
+		/*! The rating of a single player. */
+		struct Rating
+		{
+			int games;	//!< Number of games
+			qreal points;	//!< Total points
+			qreal elo;	//!< Maximum likelihood rating
+			qreal lowerBound; //!< Lower bound of the confidence interval
+			qreal upperBound; //!< Upper bound of the confidence interval
+		};
+
+		/*! Creates a new empty rating solver. */
+		RatingSolver();
+
+		/*! Removes all results and ratings. */
+		void clear();
+		/*!
+		 * Adds the result of a game between \a player1 and \a player2
+		 * where \a player1 scored \a points1 points (0 to 1).
+		 */
+		void addResult(int player1, int player2, qreal points1);
+		/*! Returns the number of players. */
+		int playerCount() const;
+		/*! Returns the number of games. */
+		int gameCount() const;
+
+		/*! Writes the results added so far to \a out. */
+		void write(QDataStream& out) const;
+		/*!
+		 * Reads results from \a in, replacing the current results.
+		 *
+		 * Returns false if the data is invalid.
+		 */
+		bool read(QDataStream& in);
+
+		/*!
+		 * Sets the number of bootstrap samples to \a count.
+		 *
+		 * If \a count is 0, confidence intervals are not calculated.
+		 * The default is 100.
+		 */
+		void setBootstrapCount(int count);
+		/*! Returns the number of bootstrap samples. */
+		int bootstrapCount() const;
+		/*!
+		 * Sets the maximum number of threads to \a count.
+		 *
+		 * The default is 1, so that a fit during a tournament
+		 * doesn't take CPU time from the engines. If \a count is 0,
+		 * the number of CPU cores is used. The count is limited to
+		 * the number of CPU cores.
+		 */
+		void setThreadCount(int count);
+		/*!
+		 * Sets the confidence level of the intervals to
+		 * \a confidence. The default is 0.95.
+		 */
+		void setConfidence(qreal confidence);
+		/*! Returns the confidence level of the intervals. */
+		qreal confidence() const;
+		/*!
+		 * Sets the maximum number of iterations of one fit to
+		 * \a count. The default is 10000.
+		 *
+		 * A low limit gives approximate ratings quickly when the
+		 * starting point is close to the solution.
+		 */
+		void setMaxIterations(int count);
+
+		/*!
+		 * Sets the starting point of the next solve() to the
+		 * ratings \a elo, indexed by player.
+		 *
+		 * A solver that is copied to fit the ratings elsewhere can
+		 * get the solution of the copy back with this function.
+		 * Players missing from \a elo start from a rating of 0.
+		 */
+		void setInitialRatings(const QVector<qreal>& elo);
+		/*!
+		 * Fits the ratings to the results added so far.
+		 *
+		 * The previous solution of this solver, or the ratings
+		 * given to setInitialRatings(), are used as the starting
+		 * point, so solving again after a few new games takes
+		 * fewer iterations.
+		 *
+		 * Returns false if the iteration didn't converge within
+		 * the maximum number of iterations.
+		 */
+		bool solve();
+		/*! Returns the number of iterations used by the last solve(). */
+		int iterationCount() const;
+		/*!
+		 * Returns the rating of \a player.
+		 *
+		 * The rating is up to date only after calling solve().
+		 */
+		Rating rating(int player) const;
+
+	private:
+		struct Pair
+		{
+			int player1;
+			int player2;
+			int games;
+			qreal points;
+			qreal squarePoints;
+		};
+
+		struct Opponent
+		{
+			int player;
+			int pair;
+			bool isFirst;
+		};
+
+		void buildOpponents();
+		int fit(const QVector<qreal>& points,
+			QVector<qreal>& gamma,
+			QThreadPool* pool,
+			int threadCount) const;
+		void bootstrap(QThreadPool* pool, int threadCount);
+
+		QVector<Pair> m_pairs;
+		QHash<quint64, int> m_pairIndex;
+		QVector<int> m_games;
+		QVector<qreal> m_points;
+		int m_gameCount;
+
+		QVector<int> m_firstOpponent;
+		QVector<Opponent> m_opponents;
+
+		int m_bootstrapCount;
+		int m_threadCount;
+		qreal m_confidence;
+		int m_maxIterations;
+		int m_iterations;
+		QVector<qreal> m_gamma;
+		QVector<qreal> m_elo;
+		QVector<qreal> m_lowerBound;
+		QVector<qreal> m_upperBound;
+};
+
+#endif // RATINGSOLVER_H
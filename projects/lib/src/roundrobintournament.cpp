@@ -19,11 +19,43 @@
 
 #include "roundrobintournament.h"
 #include <algorithm>
+#include <QtMath>
+#include <QDataStream>
+#include "tournamentplayer.h"
+#include "ratingsolver.h"
+
+namespace {
+
+// Score variance of a player with less than two finished games. It's the
+// largest possible variance for scores between 0 and 1.
+const qreal s_priorVariance = 0.25;
+
+// Lower limit for the score variance, so that a few identical results
+// don't make a player look perfectly known
+const qreal s_minVariance = 0.01;
+
+// Iteration limit of the rating fit after each game. The fit starts from
+// the previous ratings, and one game moves them very little, so a
+// few iterations are close enough for choosing the next pair.
+const int s_estimateIterations = 20;
+
+// Probability that two players are ranked in the wrong order when the
+// difference of their ratings is diff and its variance is variance
+qreal misorderProbability(qreal diff, qreal variance)
+{
+	return 0.5 * std::erfc(qAbs(diff) / std::sqrt(2.0 * variance));
+}
+
+} // anonymous namespace
 
 RoundRobinTournament::RoundRobinTournament(GameManager* gameManager,
 					   QObject *parent)
 	: Tournament(gameManager, parent),
-	  m_pairNumber(0)
+	  m_adaptive(false),
+	  m_confidence(0.0),
+	  m_encounterCount(0),
+	  m_pairNumber(0),
+	  m_ratingGameCount(-1)
 {
 }
 
@@ -32,11 +64,28 @@ QString RoundRobinTournament::type() const
 	return "round-robin";
 }
 
+void RoundRobinTournament::setAdaptive(qreal confidence)
+{
+	Q_ASSERT(confidence >= 0.0 && confidence < 1.0);
+
+	m_adaptive = true;
+	m_confidence = confidence;
+}
+
+bool RoundRobinTournament::isAdaptive() const
+{
+	return m_adaptive;
+}
+
 void RoundRobinTournament::initializePairing()
 {
+	m_encounterCount = 0;
+	m_pairGames.fill(0, playerCount() * playerCount());
 	m_pairNumber = 0;
 	m_topHalf.clear();
 	m_bottomHalf.clear();
+	m_ratings.clear();
+	m_ratingGameCount = -1;
 	int count = playerCount() + (playerCount() % 2);
 
 	for (int i = 0; i < count / 2; i++)
@@ -55,7 +104,12 @@ TournamentPair* RoundRobinTournament::nextPair(int gameNumber)
 	if (gameNumber >= finalGameCount())
 		return nullptr;
 	if (gameNumber % gamesPerEncounter() != 0)
+	{
+		addGame(currentPair());
 		return currentPair();
+	}
+	if (m_adaptive && m_encounterCount >= gamesPerCycle())
+		return nextAdaptivePair();
 
 	if (m_pairNumber >= m_topHalf.size())
 	{
@@ -75,7 +129,205 @@ TournamentPair* RoundRobinTournament::nextPair(int gameNumber)
 	// makes the pairings easier to organize. In that case
 	// no game is played and we skip to the next pair.
 	if (white < playerCount() && black < playerCount())
-		return pair(white, black);
+	{
+		TournamentPair* ret = pair(white, black);
+		m_encounterCount++;
+		addGame(ret);
+		return ret;
+	}
 	else
 		return nextPair(gameNumber);
 }
+
+void RoundRobinTournament::writePairingState(QDataStream& out) const
+{
+	out << qint32(m_pairNumber) << m_topHalf << m_bottomHalf
+	    << qint32(m_encounterCount) << m_pairGames;
+}
+
+bool RoundRobinTournament::readPairingState(QDataStream& in)
+{
+	qint32 pairNumber;
+	QList<int> topHalf;
+	QList<int> bottomHalf;
+	qint32 encounterCount;
+	QVector<int> pairGames;
+	in >> pairNumber >> topHalf >> bottomHalf >> encounterCount >> pairGames;
+	if (in.status() != QDataStream::Ok
+	||  topHalf.size() != m_topHalf.size()
+	||  bottomHalf.size() != m_bottomHalf.size()
+	||  pairGames.size() != m_pairGames.size())
+		return false;
+
+	m_pairNumber = pairNumber;
+	m_topHalf = topHalf;
+	m_bottomHalf = bottomHalf;
+	m_encounterCount = encounterCount;
+	m_pairGames = pairGames;
+	m_ratingGameCount = -1;
+	return true;
+}
+
+bool RoundRobinTournament::areAllGamesFinished() const
+{
+	if (Tournament::areAllGamesFinished())
+		return true;
+
+	return gamesInProgress() == 0 && isRankingDecided();
+}
+
+QVector<RoundRobinTournament::Estimate> RoundRobinTournament::estimates() const
+{
+	const int count = playerCount();
+	QVector<Estimate> ret(count);
+
+	// The ratings are updated only when another game has finished,
+	// with a short fit that starts from the previous ratings
+	if (m_ratingGameCount != finishedGameCount())
+	{
+		RatingSolver solver(*ratingSolver());
+		solver.setBootstrapCount(0);
+		solver.setThreadCount(1);
+		solver.setMaxIterations(s_estimateIterations);
+		if (!m_ratings.isEmpty())
+		{
+			QVector<qreal> elo(count);
+			for (int i = 0; i < count; i++)
+				elo[i] = m_ratings.at(i) * 400.0 / M_LN10;
+			solver.setInitialRatings(elo);
+		}
+		solver.solve();
+
+		m_ratings.resize(count);
+		for (int i = 0; i < count; i++)
+			m_ratings[i] = solver.rating(i).elo * M_LN10 / 400.0;
+		m_ratingGameCount = finishedGameCount();
+	}
+
+	for (int i = 0; i < count; i++)
+	{
+		const int games = playerAt(i).gamesFinished();
+		qreal variance = s_priorVariance;
+		if (games > 1)
+		{
+			qreal mean = playerPoints(i) / games;
+			variance = qMax(s_minVariance,
+					playerSquarePoints(i) / games - mean * mean);
+		}
+
+		ret[i].rating = m_ratings.at(i);
+		ret[i].scoreVariance = variance;
+	}
+
+	// The Fisher information of a game between players whose expected
+	// score is p is (p * (1 - p))^2 divided by the score variance
+	for (int i = 0; i < count; i++)
+	{
+		qreal information = 0.0;
+		for (int j = 0; j < count; j++)
+		{
+			const int n = m_pairGames.at(i * count + j);
+			if (n == 0)
+				continue;
+			qreal p = 1.0 / (1.0 + std::exp(ret.at(j).rating - ret.at(i).rating));
+			information += n * (p * (1.0 - p)) * (p * (1.0 - p));
+		}
+		information /= ret.at(i).scoreVariance;
+		ret[i].variance = 1.0 / qMax(information, 1e-9);
+	}
+
+	return ret;
+}
+
+TournamentPair* RoundRobinTournament::nextAdaptivePair()
+{
+	if (isRankingDecided())
+		return nullptr;
+
+	// The gain of an encounter is the probability that the players
+	// are in the wrong order, weighted by the relative decrease of the
+	// variance of their rating difference. Games that are still
+	// running are counted as played, so that concurrent games are
+	// spread over different pairs.
+	const QVector<Estimate> est(estimates());
+	const qreal n = gamesPerEncounter();
+	int white = -1;
+	int black = -1;
+	qreal bestGain = -1.0;
+
+	for (int i = 0; i < est.size(); i++)
+	{
+		const Estimate& a = est.at(i);
+		for (int j = i + 1; j < est.size(); j++)
+		{
+			const Estimate& b = est.at(j);
+			const qreal p = 1.0 / (1.0 + std::exp(b.rating - a.rating));
+			const qreal info = n * (p * (1.0 - p)) * (p * (1.0 - p));
+			const qreal variance = a.variance + b.variance;
+			const qreal newVariance =
+				1.0 / (1.0 / a.variance + info / a.scoreVariance)
+			      + 1.0 / (1.0 / b.variance + info / b.scoreVariance);
+			const qreal gain = misorderProbability(a.rating - b.rating, variance)
+					 * (variance - newVariance) / variance;
+
+			if (gain > bestGain)
+			{
+				bestGain = gain;
+				white = i;
+				black = j;
+			}
+		}
+	}
+
+	if (white == -1)
+		return nullptr;
+
+	// Alternate the colours between the encounters of the pair,
+	// starting with the lower-index player as white
+	TournamentPair* ret = pair(white, black);
+	const int encounters = m_pairGames.at(white * est.size() + black)
+			       / gamesPerEncounter();
+	if ((encounters % 2 == 0) != (ret->firstPlayer() == white))
+		ret->swapPlayers();
+
+	setCurrentRound(1 + m_encounterCount / gamesPerCycle());
+	m_encounterCount++;
+	addGame(ret);
+
+	return ret;
+}
+
+bool RoundRobinTournament::isRankingDecided() const
+{
+	if (!m_adaptive
+	||  m_confidence <= 0.0
+	||  m_encounterCount < gamesPerCycle())
+		return false;
+
+	QVector<Estimate> est(estimates());
+	std::sort(est.begin(), est.end(), [](const Estimate& a, const Estimate& b)
+	{
+		return a.rating > b.rating;
+	});
+
+	for (int i = 1; i < est.size(); i++)
+	{
+		const Estimate& a = est.at(i - 1);
+		const Estimate& b = est.at(i);
+		if (misorderProbability(a.rating - b.rating, a.variance + b.variance)
+		    > 1.0 - m_confidence)
+			return false;
+	}
+
+	return true;
+}
+
+void RoundRobinTournament::addGame(TournamentPair* pair)
+{
+	const int count = playerCount();
+	const int white = pair->firstPlayer();
+	const int black = pair->secondPlayer();
+
+	m_pairGames[white * count + black]++;
+	m_pairGames[black * count + white]++;
+}
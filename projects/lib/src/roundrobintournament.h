@@ -21,12 +21,18 @@
 #define ROUNDROBINTOURNAMENT_H
 
 #include "tournament.h"
+#include <QVector>
 
 /*!
  * \brief Round-robin type chess tournament.
  *
  * In a Round-robin tournament each player meets all
  * other contestants in turn.
+ *
+ * In adaptive mode only the first cycle follows the fixed schedule.
+ * After that each new encounter is played by the pair of players
+ * whose order in the standings is the most uncertain, so games
+ * between players far apart in strength are mostly skipped.
  */
 class LIB_EXPORT RoundRobinTournament : public Tournament
 {
@@ -39,16 +45,58 @@ class LIB_EXPORT RoundRobinTournament : public Tournament
 		// Inherited from Tournament
 		virtual QString type() const;
 
+		/*!
+		 * Enables adaptive pairing.
+		 *
+		 * After the first cycle the next encounter is always given
+		 * to the pair with the highest expected information gain
+		 * about the ranking. The players' ratings come from the
+		 * tournament's rating solver, and their uncertainty from the
+		 * number of games against each opponent and the variance of
+		 * the player's game scores. The ratings are solved again
+		 * only after a new game has finished, and the colours of
+		 * a pair alternate between its encounters.
+		 *
+		 * If \a confidence is greater than 0, the tournament ends
+		 * as soon as every two neighbours in the standings are
+		 * ordered with probability \a confidence. The number of
+		 * games set by the round multiplier is an upper limit.
+		 */
+		void setAdaptive(qreal confidence);
+		/*! Returns true if adaptive pairing is enabled. */
+		bool isAdaptive() const;
+
 	protected:
 		// Inherited from Tournament
 		virtual void initializePairing();
 		virtual int gamesPerCycle() const;
 		virtual TournamentPair* nextPair(int gameNumber);
+		virtual void writePairingState(QDataStream& out) const;
+		virtual bool readPairingState(QDataStream& in);
+		virtual bool areAllGamesFinished() const;
 
 	private:
+		struct Estimate
+		{
+			qreal rating;	// Rating in natural log units
+			qreal variance;	// Variance of the rating
+			qreal scoreVariance; // Variance of one game's score
+		};
+
+		QVector<Estimate> estimates() const;
+		TournamentPair* nextAdaptivePair();
+		bool isRankingDecided() const;
+		void addGame(TournamentPair* pair);
+
+		bool m_adaptive;
+		qreal m_confidence;
+		int m_encounterCount;
+		QVector<int> m_pairGames;
 		int m_pairNumber;
 		QList<int> m_topHalf;
 		QList<int> m_bottomHalf;
+		mutable QVector<qreal> m_ratings;
+		mutable int m_ratingGameCount;
 };
 
 #endif // ROUNDROBINTOURNAMENT_H
@@ -22,6 +22,8 @@
 #include <QFile>
 #include <QMultiMap>
 #include <QSet>
+#include <QVector>
+#include <QDataStream>
 
 class BayesElo;
 class SprtProbability;
@@ -132,6 +134,55 @@ double SprtProbability::pDraw() const
 	return m_pDraw;
 }
 
+namespace {
+
+/*
+ * Finds the maximum likelihood distribution \a q on the values \a x
+ * that has the expected value \a score, given the observed frequencies
+ * \a p. The solution has the form q[i] = p[i] / (1 + lambda * (x[i] - score)),
+ * where lambda is found by bisection.
+ *
+ * \a x must be sorted. Returns false if \a score is not strictly
+ * between the smallest and largest value.
+ */
+bool mleDistribution(const QVector<double>& x,
+		     const QVector<double>& p,
+		     double score,
+		     QVector<double>& q)
+{
+	const double xMin = x.first();
+	const double xMax = x.last();
+	if (score <= xMin || score >= xMax)
+		return false;
+
+	// The denominators are positive inside this interval
+	double lo = -1.0 / (xMax - score);
+	double hi = 1.0 / (score - xMin);
+	double lambda = 0.0;
+
+	for (int iter = 0; iter < 100; iter++)
+	{
+		lambda = (lo + hi) / 2.0;
+		double f = 0.0;
+		for (int i = 0; i < x.size(); i++)
+			f += p[i] * (x[i] - score) / (1.0 + lambda * (x[i] - score));
+
+		// f is decreasing in lambda
+		if (f > 0.0)
+			lo = lambda;
+		else
+			hi = lambda;
+	}
+
+	q.resize(x.size());
+	for (int i = 0; i < x.size(); i++)
+		q[i] = p[i] / (1.0 + lambda * (x[i] - score));
+
+	return true;
+}
+
+} // anonymous namespace
+
 
 Sprt::Sprt()
 	: m_elo0(0),
@@ -140,7 +191,10 @@ Sprt::Sprt()
 	  m_beta(0),
 	  m_wins(0),
 	  m_losses(0),
-	  m_draws(0)
+	  m_draws(0),
+	  m_model(Trinomial),
+	  m_eloModel(LogisticElo),
+	  m_pairCount(0)
 {
 }
 
@@ -150,12 +204,20 @@ bool Sprt::isNull() const
 }
 
 void Sprt::initialize(double elo0, double elo1,
-		      double alpha, double beta)
+		      double alpha, double beta,
+		      Model model, EloModel eloModel)
 {
 	m_elo0 = elo0;
 	m_elo1 = elo1;
 	m_alpha = alpha;
 	m_beta = beta;
+	m_model = model;
+	m_eloModel = eloModel;
+}
+
+Sprt::Model Sprt::model() const
+{
+	return m_model;
 }
 
 Sprt::Status Sprt::status() const
@@ -167,6 +229,9 @@ Sprt::Status Sprt::status() const
 		0.0
 	};
 
+	if (m_model == Pentanomial)
+		return pentanomialStatus();
+
 	if (m_wins < 1 || m_losses < 1 || m_draws < 0)
 		return status;
 
@@ -210,3 +275,110 @@ void Sprt::addGameResult(qreal points)
 		m_draws+=points/0.5;
 	}
 }
+
+void Sprt::addGamePair(qreal points1, qreal points2)
+{
+	m_pairScores[(points1 + points2) / 2.0]++;
+	m_pairCount++;
+}
+
+int Sprt::pairCount() const
+{
+	return m_pairCount;
+}
+
+Sprt::Status Sprt::pentanomialStatus() const
+{
+	Status status = {
+		Continue,
+		0.0,
+		0.0,
+		0.0
+	};
+
+	if (m_pairScores.size() < 2)
+		return status;
+
+	// Empirical distribution of the pair scores
+	QVector<double> x;
+	QVector<double> p;
+	const double count = m_pairCount;
+	double mean = 0.0;
+	for (auto it = m_pairScores.constBegin(); it != m_pairScores.constEnd(); ++it)
+	{
+		x.append(it.key());
+		p.append(it.value() / count);
+		mean += it.key() * it.value() / count;
+	}
+
+	double variance = 0.0;
+	for (int i = 0; i < x.size(); i++)
+		variance += p[i] * (x[i] - mean) * (x[i] - mean);
+
+	// Expected scores under H0 and H1
+	double score0;
+	double score1;
+	if (m_eloModel == NormalizedElo)
+	{
+		// Normalized Elo is defined per game, and the variance of
+		// a single game is about twice that of the pair average.
+		const double k = std::log(10.0) / 800.0 * std::sqrt(2.0 * variance);
+		score0 = 0.5 + m_elo0 * k;
+		score1 = 0.5 + m_elo1 * k;
+	}
+	else
+	{
+		score0 = 1.0 / (1.0 + std::pow(10.0, -m_elo0 / 400.0));
+		score1 = 1.0 / (1.0 + std::pow(10.0, -m_elo1 / 400.0));
+	}
+
+	// Log-likelihood ratio of the maximum likelihood distributions
+	QVector<double> p0;
+	QVector<double> p1;
+	if (mleDistribution(x, p, score0, p0) && mleDistribution(x, p, score1, p1))
+	{
+		for (int i = 0; i < x.size(); i++)
+			status.llr += p[i] * count * std::log(p1[i] / p0[i]);
+	}
+	// Normal approximation when a score is outside the observed range
+	else
+		status.llr = count * (score1 - score0) * (2.0 * mean - score0 - score1)
+			   / (2.0 * variance);
+
+	status.lBound = std::log(m_beta / (1.0 - m_alpha));
+	status.uBound = std::log((1.0 - m_beta) / m_alpha);
+
+	if (status.llr > status.uBound)
+		status.result = AcceptH1;
+	else if (status.llr < status.lBound)
+		status.result = AcceptH0;
+
+	return status;
+}
+
+void Sprt::write(QDataStream& out) const
+{
+	out << m_wins << m_losses << m_draws
+	    << m_pairScores << qint32(m_pairCount);
+}
+
+bool Sprt::read(QDataStream& in)
+{
+	qreal wins;
+	qreal losses;
+	qreal draws;
+	QMap<qreal, int> pairScores;
+	qint32 pairCount;
+
+	in >> wins >> losses >> draws >> pairScores >> pairCount;
+	if (in.status() != QDataStream::Ok)
+		return false;
+
+	m_wins = wins;
+	m_losses = losses;
+	m_draws = draws;
+	m_pairScores = pairScores;
+	m_pairCount = pairCount;
+
+	return true;
+}
@@ -20,6 +20,9 @@
 #define SPRT_H
 
 #include <QtMath>
+#include <QMap>
+class QDataStream;
+
 /*!
  * \brief A Sequential Probability Ratio Test
  *
@@ -28,6 +31,14 @@
  * players when the Elo difference is known to be outside of the specified
  * interval.
  *
+ * Two statistical models are available. The trinomial model splits the
+ * points of each game into wins, losses and draws and uses the BayesElo
+ * model. The pentanomial model is a generalized SPRT (GSPRT) on the
+ * points of game pairs, ie. two games played with the same opening and
+ * reversed colors. It uses the exact distribution of the (fractional)
+ * r-Mobility points, and it accounts for the correlation between the
+ * games of a pair, so it usually needs fewer games to reach a decision.
+ *
  * \sa http://en.wikipedia.org/wiki/Sequential_probability_ratio_test
  */
 class LIB_EXPORT Sprt
@@ -50,6 +61,20 @@ class LIB_EXPORT Sprt
 			Draw		//!< Game was drawn
 		};
 
+		/*! The statistical model of the test. */
+		enum Model
+		{
+			Trinomial,	//!< Win/loss/draw BayesElo model
+			Pentanomial	//!< GSPRT on game pair points
+		};
+
+		/*! The unit of the Elo bounds of the pentanomial model. */
+		enum EloModel
+		{
+			LogisticElo,	//!< Logistic Elo
+			NormalizedElo	//!< Normalized Elo
+		};
+
 		/*! The status of the test. */
 		struct Status
 		{
@@ -76,9 +101,19 @@ class LIB_EXPORT Sprt
 		 *
 		 * \a alpha is the maximum probability for a type I error and
 		 * \a beta for a type II error outside interval [elo0, elo1].
+		 *
+		 * \a model is the statistical model of the test. With the
+		 * Pentanomial model \a eloModel selects whether \a elo0
+		 * and \a elo1 are logistic or normalized Elo. Normalized Elo
+		 * is the score difference divided by its standard deviation,
+		 * which makes the bounds independent of the draw rate.
 		 */
 		void initialize(double elo0, double elo1,
-				double alpha, double beta);
+				double alpha, double beta,
+				Model model = Trinomial,
+				EloModel eloModel = LogisticElo);
+		/*! Returns the statistical model of the test. */
+		Model model() const;
 		/*! Returns the current status of the test. */
 		Status status() const;
 		/*!
@@ -88,8 +123,33 @@ class LIB_EXPORT Sprt
 		 * check if H0 or H1 can be accepted.
 		 */
 		void addGameResult(qreal points);
+		/*!
+		 * Updates the pentanomial test with a game pair.
+		 *
+		 * \a points1 and \a points2 are the points (from 0 to 1)
+		 * of the first player in the two games of the pair.
+		 */
+		void addGamePair(qreal points1, qreal points2);
+		/*! Returns the number of game pairs added to the test. */
+		int pairCount() const;
+
+		/*!
+		 * Writes the results added to the test to \a out.
+		 *
+		 * The parameters of the test are not written.
+		 */
+		void write(QDataStream& out) const;
+		/*!
+		 * Reads the results of the test from \a in, replacing
+		 * the current results.
+		 *
+		 * Returns false if the data is invalid.
+		 */
+		bool read(QDataStream& in);
 
 	private:
+		Status pentanomialStatus() const;
+
 		double m_elo0;
 		double m_elo1;
 		double m_alpha;
@@ -97,6 +157,10 @@ class LIB_EXPORT Sprt
 		qreal m_wins;
 		qreal m_losses;
 		qreal m_draws;
+		Model m_model;
+		EloModel m_eloModel;
+		QMap<qreal, int> m_pairScores;
+		int m_pairCount;
 };
 
 #endif // SPRT_H
@@ -22,6 +22,8 @@ HEADERS += $$PWD/chessengine.h \
     $$PWD/enginetextoption.h \
     $$PWD/enginebuttonoption.h \
     $$PWD/pgngameentry.h \
+    $$PWD/pgngameindex.h \
+    $$PWD/positionindex.h \
     $$PWD/gamemanager.h \
     $$PWD/playerbuilder.h \
     $$PWD/enginebuilder.h \
@@ -45,6 +47,13 @@ HEADERS += $$PWD/chessengine.h \
     $$PWD/pyramidtournament.h \
     $$PWD/tournamentplayer.h \
     $$PWD/tournamentpair.h \
+    $$PWD/processusage.h \
+    $$PWD/npsmonitor.h \
+    $$PWD/enginelog.h \
+    $$PWD/gamewriter.h \
+    $$PWD/gzipfile.h \
+    $$PWD/ratingsolver.h \
+    $$PWD/functiontask.h \
     $$PWD/worker.h
 SOURCES += $$PWD/chessengine.cpp \
     $$PWD/chessgame.cpp \
@@ -67,6 +76,8 @@ SOURCES += $$PWD/chessengine.cpp \
     $$PWD/enginetextoption.cpp \
     $$PWD/enginebuttonoption.cpp \
     $$PWD/pgngameentry.cpp \
+    $$PWD/pgngameindex.cpp \
+    $$PWD/positionindex.cpp \
     $$PWD/gamemanager.cpp \
     $$PWD/playerbuilder.cpp \
     $$PWD/enginebuilder.cpp \
@@ -89,6 +100,13 @@ SOURCES += $$PWD/chessengine.cpp \
     $$PWD/pyramidtournament.cpp \
     $$PWD/tournamentplayer.cpp \
     $$PWD/tournamentpair.cpp \
+    $$PWD/processusage.cpp \
+    $$PWD/npsmonitor.cpp \
+    $$PWD/enginelog.cpp \
+    $$PWD/gamewriter.cpp \
+    $$PWD/gzipfile.cpp \
+    $$PWD/ratingsolver.cpp \
+    $$PWD/functiontask.cpp \
     $$PWD/worker.cpp
 win32 { 
     HEADERS += $$PWD/engineprocess_win.h \
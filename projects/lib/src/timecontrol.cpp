@@ -51,6 +51,7 @@ TimeControl::TimeControl()
 	  m_movesLeft(0),
 	  m_plyLimit(0),
 	  m_nodeLimit(0),
+	  m_scaleFactor(1.0),
 	  m_lastMoveTime(0),
 	  m_expiryMargin(0),
 	  m_expired(false),
@@ -68,6 +69,7 @@ TimeControl::TimeControl(const QString& str)
 	  m_movesLeft(0),
 	  m_plyLimit(0),
 	  m_nodeLimit(0),
+	  m_scaleFactor(1.0),
 	  m_lastMoveTime(0),
 	  m_expiryMargin(0),
 	  m_expired(false),
@@ -80,7 +82,13 @@ TimeControl::TimeControl(const QString& str)
 		return;
 	}
 
-	QStringList list = str.split('+');
+	// scale factor
+	double factor = 1.0;
+	QStringList list = str.split('*');
+	if (list.size() == 2 && list.at(1).toDouble() > 0.0)
+		factor = list.at(1).toDouble();
+
+	list = list.at(0).split('+');
 
 	// increment
 	if (list.size() == 2)
@@ -121,6 +129,9 @@ TimeControl::TimeControl(const QString& str)
 
 	if (ms > 0)
 		setTimePerTc(ms);
+
+	if (factor != 1.0)
+		scale(factor);
 }
 
 bool TimeControl::operator==(const TimeControl& other) const
@@ -131,6 +142,7 @@ bool TimeControl::operator==(const TimeControl& other) const
 	&&  m_increment == other.m_increment
 	&&  m_plyLimit == other.m_plyLimit
 	&&  m_nodeLimit == other.m_nodeLimit
+	&&  qFuzzyCompare(m_scaleFactor, other.m_scaleFactor)
 	&&  m_infinite == other.m_infinite
 	&&  m_hourglass == other.m_hourglass)
 		return true;
@@ -160,19 +172,26 @@ QString TimeControl::toString() const
 	if (m_infinite)
 		return QString("inf");
 
+	// Scaled times are written in their nominal form
+	QString factor;
+	if (m_scaleFactor != 1.0)
+		factor = QString("*") + QString::number(m_scaleFactor, 'g', 4);
+
 	if (m_timePerMove != 0)
-		return QString("%1/move").arg((double)m_timePerMove / 1000);
+		return QString("%1/move").arg(qRound(m_timePerMove / m_scaleFactor) / 1000.0)
+			+ factor;
 
 	QString str;
 	if (m_hourglass)
 		str += "hg";
 	if (m_movesPerTc > 0)
 		str += QString::number(m_movesPerTc) + "/";
-	str += QString::number((double)m_timePerTc / 1000);
+	str += QString::number(qRound(m_timePerTc / m_scaleFactor) / 1000.0);
 
 	if (m_increment > 0)
-		str += QString("+") + QString::number((double)m_increment / 1000);
-	return str;
+		str += QString("+")
+		    +  QString::number(qRound(m_increment / m_scaleFactor) / 1000.0);
+	return str + factor;
 }
 
 QString TimeControl::toVerboseString() const
@@ -207,6 +226,8 @@ QString TimeControl::toVerboseString() const
 		str += tr(", %1 plies").arg(m_plyLimit);
 	if (m_expiryMargin != 0)
 		str += tr(", %1 msec margin").arg(m_expiryMargin);
+	if (m_scaleFactor != 1.0)
+		str += tr(", scaled by %1").arg(m_scaleFactor, 0, 'f', 3);
 
 	return str;
 }
@@ -275,6 +296,11 @@ qint64 TimeControl::nodeLimit() const
 	return m_nodeLimit;
 }
 
+double TimeControl::scaleFactor() const
+{
+	return m_scaleFactor;
+}
+
 int TimeControl::expiryMargin() const
 {
 	return m_expiryMargin;
@@ -343,6 +369,16 @@ void TimeControl::setExpiryMargin(int expiryMargin)
 	m_expiryMargin = expiryMargin;
 }
 
+void TimeControl::scale(double factor)
+{
+	Q_ASSERT(factor > 0.0);
+
+	m_timePerTc = qRound(m_timePerTc * factor);
+	m_timePerMove = qRound(m_timePerMove * factor);
+	m_increment = qRound(m_increment * factor);
+	m_scaleFactor *= factor;
+}
+
 void TimeControl::startTimer()
 {
 	m_time.start();
@@ -63,6 +63,12 @@ class LIB_EXPORT TimeControl
 		 *
 		 * Example 4 (infinite thinking time):
 		 *   TimeControl("inf");
+		 *
+		 * An optional "*factor" suffix scales the times by factor,
+		 * see scale().
+		 *
+		 * Example 5 (40 moves in 120 seconds, scaled by 1.5):
+		 *   TimeControl("40/120*1.5");
 		 */
 		TimeControl(const QString& str);
 
@@ -130,6 +136,14 @@ class LIB_EXPORT TimeControl
 		/*! Returns the node limit for each move. */
 		qint64 nodeLimit() const;
 
+		/*!
+		 * Returns the factor the time control was scaled by.
+		 *
+		 * The default is 1.0.
+		 * \sa scale()
+		 */
+		double scaleFactor() const;
+
 		/*!
 		 * Returns the expiry margin.
 		 *
@@ -179,6 +193,17 @@ class LIB_EXPORT TimeControl
 		/*! Sets the expiry margin. */
 		void setExpiryMargin(int expiryMargin);
 
+		/*!
+		 * Multiplies the time per time control, time per move and
+		 * time increment by \a factor.
+		 *
+		 * This is used to give slower machines proportionally more
+		 * time. The node and ply limits are hardware independent, so
+		 * they are not scaled. The factor is included in toString()
+		 * with the nominal (unscaled) times.
+		 */
+		void scale(double factor);
+
 		
 		/*! Start the timer. */
 		void startTimer();
@@ -222,6 +247,7 @@ class LIB_EXPORT TimeControl
 		int m_movesLeft;
 		int m_plyLimit;
 		qint64 m_nodeLimit;
+		double m_scaleFactor;
 		int m_lastMoveTime;
 		int m_expiryMargin;
 		bool m_expired;
@@ -18,8 +18,12 @@
 
 #include "tournament.h"
 #include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QDataStream>
 #include <QMultiMap>
 #include <QSet>
+#include <jsonserializer.h>
 #include "gamemanager.h"
 #include "playerbuilder.h"
 #include "board/boardfactory.h"
@@ -29,11 +33,29 @@
 #include "openingsuite.h"
 #include "openingbook.h"
 #include "sprt.h"
+#include "npsmonitor.h"
+#include "ratingsolver.h"
+#include "gamewriter.h"
 #include "elo.h"
+#include "mersenne.h"
+#include "functiontask.h"
+#include <QThreadPool>
 #include <cmath>
 #include <string>
+#include <limits>
+#include <algorithm>
 
+namespace {
 
+// Minimum time in milliseconds between the starts of two background
+// rating fits while the games are running
+const qint64 s_minRatingInterval = 10000;
+
+// The time between two fits is at least this many times the time
+// that the last fit took
+const int s_ratingIntervalFactor = 4;
+
+} // anonymous namespace
 
 
 Tournament::Tournament(GameManager* gameManager, QObject *parent)
@@ -58,13 +80,29 @@ Tournament::Tournament(GameManager* gameManager, QObject *parent)
 	  m_recover(false),
 	  m_pgnCleanup(true),
 	  m_pgnWriteUnfinishedGames(true),
+	  m_pgnCpuUsage(false),
 	  m_finished(false),
 	  m_bookOwnership(false),
 	  m_openingSuite(nullptr),
 	  m_sprt(new Sprt),
+	  m_npsMonitor(new NpsMonitor),
+	  m_ratingSolver(new RatingSolver),
+	  m_ratingsEnabled(false),
+	  m_ratingsBusy(false),
+	  m_ratingGameCount(0),
+	  m_ratingFitTime(0),
+	  m_ratingPool(new QThreadPool),
+	  m_ratingsFitted(false),
+	  m_fittedGameCount(0),
+	  m_checkpointInterval(0),
+	  m_statsInterval(0),
+	  m_plyCount(0),
+	  m_startGameCount(0),
+	  m_gameWriter(new GameWriter),
 	  m_repetitionCounter(0),
 	  m_swapSides(true),
 	  m_reverseSides(false),
+	  m_pairScheduling(false),
 	  m_defaultKomi(defaultKomi),
 	  m_isLegacy(false),
 	  m_maxGScore(-1),
@@ -78,6 +116,10 @@ Tournament::Tournament(GameManager* gameManager, QObject *parent)
 	m_exponentialScoring=new Chess::rScoring(Chess::Exponential);
 	m_harmonicScoring=new Chess::rScoring(Chess::Harmonic);
 	for(int i=0;i<876;i++) m_Objectives[i]=0;
+
+	// One fit at a time, so the ratings never take more than the
+	// solver's own threads from the engines
+	m_ratingPool->setMaxThreadCount(1);
 }
 
 Tournament::~Tournament()
@@ -98,16 +140,16 @@ Tournament::~Tournament()
 	if (m_bookOwnership)
 		qDeleteAll(books);
 
+	m_ratingPool->waitForDone();
+	delete m_ratingPool;
+
 	delete m_openingSuite;
 	delete m_sprt;
+	delete m_npsMonitor;
+	delete m_ratingSolver;
 	delete m_exponentialScoring;
 	delete m_harmonicScoring;
-
-	if (m_pgnFile.isOpen())
-		m_pgnFile.close();
-
-	if (m_epdFile.isOpen())
-		m_epdFile.close();
+	delete m_gameWriter;
 }
 
 GameManager* Tournament::gameManager() const
@@ -150,6 +192,11 @@ int Tournament::gamesPerEncounter() const
 	return m_gamesPerEncounter;
 }
 
+int Tournament::openingRepetitions() const
+{
+	return m_openingRepetitions;
+}
+
 int Tournament::roundMultiplier() const
 {
 	return m_roundMultiplier;
@@ -185,6 +232,21 @@ Sprt* Tournament::sprt() const
 	return m_sprt;
 }
 
+NpsMonitor* Tournament::npsMonitor() const
+{
+	return m_npsMonitor;
+}
+
+RatingSolver* Tournament::ratingSolver() const
+{
+	return m_ratingSolver;
+}
+
+GameWriter* Tournament::gameWriter() const
+{
+	return m_gameWriter;
+}
+
 bool Tournament::canSetRoundMultiplier() const
 {
 	return true;
@@ -267,6 +329,32 @@ void Tournament::setSwapSides(bool enabled)
 	m_swapSides = enabled;
 }
 
+void Tournament::setPairScheduling(bool enabled)
+{
+	m_pairScheduling = enabled;
+}
+
+void Tournament::setCheckpoint(const QString& fileName, int interval)
+{
+	Q_ASSERT(interval > 0);
+
+	m_checkpointFile = fileName;
+	m_checkpointInterval = interval;
+}
+
+void Tournament::setResumeFile(const QString& fileName)
+{
+	m_resumeFile = fileName;
+}
+
+void Tournament::setStatsOutput(const QString& fileName, int interval)
+{
+	Q_ASSERT(interval > 0);
+
+	m_statsFile = fileName;
+	m_statsInterval = interval;
+}
+
 void Tournament::setResultFormat(const QString& format)
 {
 	m_resultFormat = format;
@@ -289,11 +377,7 @@ const QList< QString > Tournament::resultFieldTokens() const
 
 void Tournament::setPgnOutput(const QString& fileName, PgnGame::PgnMode mode)
 {
-	if (fileName != m_pgnFile.fileName())
-	{
-		m_pgnFile.close();
-		m_pgnFile.setFileName(fileName);
-	}
+	m_pgnFileName = fileName;
 	m_pgnOutMode = mode;
 }
 
@@ -307,13 +391,14 @@ void Tournament::setPgnCleanupEnabled(bool enabled)
 	m_pgnCleanup = enabled;
 }
 
+void Tournament::setPgnCpuUsage(bool enabled)
+{
+	m_pgnCpuUsage = enabled;
+}
+
 void Tournament::setEpdOutput(const QString& fileName)
 {
-	if (fileName != m_epdFile.fileName())
-	{
-		m_epdFile.close();
-		m_epdFile.setFileName(fileName);
-	}
+	m_epdFileName = fileName;
 }
 
 void Tournament::setOpeningRepetitions(int count)
@@ -384,15 +469,9 @@ bool Tournament::hasGauntletRatingsOrder() const
 	return false;
 }
 
-void Tournament::startGame(TournamentPair* pair)
+ChessGame* Tournament::createGame(const TournamentPlayer& white,
+				  const TournamentPlayer& black)
 {
-	Q_ASSERT(pair->isValid());
-	m_pair = pair;
-	m_pair->addStartedGame();
-
-	const TournamentPlayer& white = m_players[m_pair->firstPlayer()];
-	const TournamentPlayer& black = m_players[m_pair->secondPlayer()];
-
 	Chess::Board* board = Chess::BoardFactory::create(m_variant);
 	board->setCutoff(m_gCutoff);
 	board->setLegacy(m_isLegacy);
@@ -400,6 +479,7 @@ void Tournament::startGame(TournamentPair* pair)
 	Q_ASSERT(board != nullptr);
 	ChessGame* game = new ChessGame(board, new PgnGame((m_rMobType==Chess::Komi),m_isLegacy));
 	game->setKomi(m_defaultKomi);
+	game->setCpuUsageComments(m_pgnCpuUsage);
 
 	connect(game, SIGNAL(started(ChessGame*)),
 		this, SLOT(onGameStarted(ChessGame*)));
@@ -412,6 +492,49 @@ void Tournament::startGame(TournamentPair* pair)
 	game->setOpeningBook(white.book(), Chess::Side::White, white.bookDepth());
 	game->setOpeningBook(black.book(), Chess::Side::Black, black.bookDepth());
 
+	return game;
+}
+
+void Tournament::enqueueGame(ChessGame* game, GameData* data)
+{
+	game->pgn()->setEvent(m_name);
+	game->pgn()->setSite(m_site);
+	game->pgn()->setRound(data->round);
+	game->pgn()->setTag("RMobilityScoring",Chess::rMobScoringName(m_rMobType));
+
+	if (m_finishedGameCount > 0)
+		game->setStartDelay(m_startDelay);
+	game->setAdjudicator(m_adjudicator);
+
+	data->slot = acquireSlot();
+	data->startFen = game->startingFen();
+	data->openingMoves = game->moves();
+	data->komi = game->komi();
+	m_gameData[game] = data;
+
+	auto whiteBuilder = m_players.at(data->whiteIndex).builder();
+	auto blackBuilder = m_players.at(data->blackIndex).builder();
+	onGameAboutToStart(game, whiteBuilder, blackBuilder);
+	connect(game, SIGNAL(startFailed(ChessGame*)),
+		this, SLOT(onGameStartFailed(ChessGame*)));
+	m_gameManager->newGame(game,
+			       whiteBuilder,
+			       blackBuilder,
+			       GameManager::Enqueue,
+			       GameManager::ReusePlayers);
+}
+
+void Tournament::startGame(TournamentPair* pair)
+{
+	Q_ASSERT(pair->isValid());
+	m_pair = pair;
+	m_pair->addStartedGame();
+
+	const TournamentPlayer& white = m_players[m_pair->firstPlayer()];
+	const TournamentPlayer& black = m_players[m_pair->secondPlayer()];
+	ChessGame* game = createGame(white, black);
+	Chess::Board* board = game->board();
+
 	if (!m_startFen.isEmpty() || !m_openingMoves.isEmpty())
 	{
 		game->setStartingFen(m_startFen);
@@ -425,7 +548,26 @@ void Tournament::startGame(TournamentPair* pair)
 	else
 	{
 		m_repetitionCounter = 1;
-		if (m_openingSuite != nullptr)
+		if (m_openingSuite != nullptr && m_openingSuite->isCompiled())
+		{
+			// A compiled opening was validated when the suite
+			// was compiled, so it's not replayed here
+			const OpeningSuite::Opening opening =
+				m_openingSuite->nextOpening(m_openingDepth);
+
+			QVector<Chess::Move> moves;
+			moves.reserve(opening.moves.size());
+			for (const Chess::GenericMove& move : opening.moves)
+				moves.append(board->moveFromGenericMove(move));
+
+			game->setStartingFen(opening.startingFen);
+			game->setKomi(Chess::parseKomi(opening.komi));
+			game->setMoves(moves);
+			if (!opening.isValid)
+				qWarning("The opening suite is incompatible with the "
+				"current chess variant");
+		}
+		else if (m_openingSuite != nullptr)
 		{
 			if (!game->setMoves(m_openingSuite->nextGame(m_openingDepth)))
 				qWarning("The opening suite is incompatible with the "
@@ -446,20 +588,11 @@ void Tournament::startGame(TournamentPair* pair)
 		m_openingMoves = game->moves();
 	}
 
-	game->pgn()->setEvent(m_name);
-	game->pgn()->setSite(m_site);
-	game->pgn()->setRound(m_round);
-	game->pgn()->setTag("RMobilityScoring",Chess::rMobScoringName(m_rMobType));
-
-	if (m_finishedGameCount > 0)
-		game->setStartDelay(m_startDelay);
-	game->setAdjudicator(m_adjudicator);
-
 	GameData* data = new GameData;
 	data->number = ++m_nextGameNumber;
 	data->whiteIndex = m_pair->firstPlayer();
 	data->blackIndex = m_pair->secondPlayer();
-	m_gameData[game] = data;
+	data->round = m_round;
 
 	// Some tournament types may require more games than expected
 	if (m_nextGameNumber > m_finalGameCount)
@@ -470,16 +603,23 @@ void Tournament::startGame(TournamentPair* pair)
 	if (m_swapSides)
 		m_pair->swapPlayers();
 
-	auto whiteBuilder = white.builder();
-	auto blackBuilder = black.builder();
-	onGameAboutToStart(game, whiteBuilder, blackBuilder);
-	connect(game, SIGNAL(startFailed(ChessGame*)),
-		this, SLOT(onGameStartFailed(ChessGame*)));
-	m_gameManager->newGame(game,
-			       whiteBuilder,
-			       blackBuilder,
-			       GameManager::Enqueue,
-			       GameManager::ReusePlayers);
+	enqueueGame(game, data);
+}
+
+void Tournament::startResumedGame(const GameData& resumed)
+{
+	// The pair and the opening state were saved after the game was
+	// started, so the game is replayed as is without updating them
+	const TournamentPlayer& white = m_players[resumed.whiteIndex];
+	const TournamentPlayer& black = m_players[resumed.blackIndex];
+	ChessGame* game = createGame(white, black);
+
+	game->setStartingFen(resumed.startFen);
+	game->setMoves(resumed.openingMoves);
+	game->setKomi(resumed.komi);
+	game->generateOpening();
+
+	enqueueGame(game, new GameData(resumed));
 }
 
 void Tournament::onGameAboutToStart(ChessGame *game,
@@ -502,9 +642,73 @@ void Tournament::startNextGame()
 	if (m_stopping)
 		return;
 
+	if (!m_pairScheduling)
+	{
+		startPendingGame();
+		return;
+	}
+
+	// Start the remaining games of an opening at once. If there
+	// aren't enough free slots yet, wait until more games have
+	// finished.
+	const int groupSize = qBound(1, openingGroupSize(),
+				     m_gameManager->concurrency());
+	if (m_gameManager->freeSlotCount() < groupSize)
+		return;
+
+	for (int i = 0; i < groupSize; i++)
+	{
+		if (m_stopping || !startPendingGame())
+			break;
+	}
+}
+
+int Tournament::openingGroupSize() const
+{
+	// Resumed games are restarted first, and a group only has the
+	// games that were played with the same opening
+	if (!m_resumedGames.isEmpty())
+	{
+		const GameData& first = m_resumedGames.first();
+		int count = 1;
+		while (count < m_resumedGames.size()
+		&&     m_resumedGames.at(count).startFen == first.startFen
+		&&     m_resumedGames.at(count).openingMoves == first.openingMoves)
+			count++;
+		return count;
+	}
+
+	// The games left with the opening of the last started game, or
+	// all repetitions of the next opening
+	int count = m_openingRepetitions;
+	if (m_repetitionCounter < m_openingRepetitions
+	&&  (!m_startFen.isEmpty() || !m_openingMoves.isEmpty()))
+		count -= m_repetitionCounter;
+
+	// A new encounter starts with a new opening
+	const int encounterGames = gamesPerEncounter()
+		- m_nextGameNumber % gamesPerEncounter();
+	if (m_players.size() > 2 && m_openingPolicy != RoundPolicy)
+		count = qMin(count, encounterGames);
+
+	// Don't wait for slots that the last games won't need
+	if (m_finalGameCount > m_nextGameNumber)
+		count = qMin(count, m_finalGameCount - m_nextGameNumber);
+
+	return count;
+}
+
+bool Tournament::startPendingGame()
+{
+	if (!m_resumedGames.isEmpty())
+	{
+		startResumedGame(m_resumedGames.takeFirst());
+		return true;
+	}
+
 	TournamentPair* pair(nextPair(m_nextGameNumber));
 	if (!pair || !pair->isValid())
-		return;
+		return false;
 
 	bool samePlayers = pair->hasSamePlayers(m_pair);
 	if (!samePlayers && m_reverseSides)
@@ -522,6 +726,7 @@ void Tournament::startNextGame()
 	}
 
 	startGame(pair);
+	return true;
 }
 
 inline bool faulty(const Chess::Result::Type& type)
@@ -537,29 +742,9 @@ bool Tournament::writePgn(PgnGame* pgn, int gameNumber)
 	Q_ASSERT(pgn != nullptr);
 	Q_ASSERT(gameNumber > 0);
 
-	if (m_pgnFile.fileName().isEmpty())
+	if (m_pgnFileName.isEmpty())
 		return true;
 
-	bool isOpen = m_pgnFile.isOpen();
-	if (!isOpen || !m_pgnFile.exists())
-	{
-		if (isOpen)
-		{
-			qWarning("PGN file %s does not exist. Reopening...",
-				 qUtf8Printable(m_pgnFile.fileName()));
-			m_pgnFile.close();
-		}
-
-		if (!m_pgnFile.open(QIODevice::WriteOnly | QIODevice::Append))
-		{
-			qWarning("Could not open PGN file %s",
-				 qUtf8Printable(m_pgnFile.fileName()));
-			return false;
-		}
-		m_pgnOut.setDevice(&m_pgnFile);
-	}
-
-	bool ok = true;
 	m_pgnGames[gameNumber] = *pgn;
 	while (m_pgnGames.contains(m_savedGameCount + 1))
 	{
@@ -571,60 +756,39 @@ bool Tournament::writePgn(PgnGame* pgn, int gameNumber)
 			qWarning("Omitted incomplete game %d", m_savedGameCount);
 			continue;
 		}
-		if (!tmp.write(m_pgnOut, m_pgnOutMode)
-		||  m_pgnFile.error() != QFile::NoError)
-		{
-			ok = false;
-			qWarning("Could not write PGN game %d", m_savedGameCount);
-		}
+		m_gameWriter->writePgn(m_pgnFileName, tmp, m_pgnOutMode);
 	}
 
-	return ok;
+	return !m_gameWriter->hasError();
 }
 
 bool Tournament::writeEpd(ChessGame *game)
 {
 	Q_ASSERT(game != nullptr);
 
-	if (m_epdFile.fileName().isEmpty())
+	if (m_epdFileName.isEmpty())
 		return true;
 
-	bool isOpen = m_epdFile.isOpen();
-	if (!isOpen || !m_epdFile.exists())
-	{
-		if (isOpen)
-		{
-			qWarning("EPD file %s does not exist. Reopening...",
-				 qUtf8Printable(m_epdFile.fileName()));
-			m_epdFile.close();
-		}
-
-		if (!m_epdFile.open(QIODevice::WriteOnly | QIODevice::Append))
-		{
-			qWarning("Could not open EPD file %s",
-				 qUtf8Printable(m_epdFile.fileName()));
-			return false;
-		}
-		m_epdOut.setDevice(&m_epdFile);
-	}
-
-	const QString& epdPos = game->board()->fenString();
-	m_epdOut << epdPos << "\n";
-	m_epdOut.flush();
-	bool ok = true;
-	if (m_epdFile.error() != QFile::NoError)
-	{
-		ok = false;
-		qWarning("Could not write EPD position");
-	}
-
-	return ok;
+	m_gameWriter->writeLine(m_epdFileName, game->board()->fenString());
+	return !m_gameWriter->hasError();
 }
 
 
 void Tournament::addScore(int player, Chess::Side side,Chess::rMobResult gResult, Chess::rMobKomi komi)
 {
 	m_players[player].addScore(side, gResult,komi,m_gCutoff,m_exponentialScoring,m_harmonicScoring);
+	invalidateStandings(player);
+}
+
+void Tournament::invalidateStandings(int player)
+{
+	for (Standings& standings : m_standings)
+	{
+		if (player < standings.rows.size())
+			standings.rows[player].dirty = true;
+	}
+	if (player < m_objectiveRows.size())
+		m_objectiveRows[player].dirty = true;
 }
 
 void Tournament::onGameStarted(ChessGame* game)
@@ -662,16 +826,41 @@ void Tournament::onGameFinished(ChessGame* game)
 	if (!blackName.isEmpty())
 		m_players[iBlack].setName(blackName);
 
+	for (const auto& side : { Chess::Side::White, Chess::Side::Black })
+	{
+		const ChessPlayer* player = game->player(side);
+		if (player != nullptr)
+			m_players[side == Chess::Side::White ? iWhite : iBlack]
+				.addProcessUsage(player->gameUsage(),
+						 player->gameUsageTime());
+	}
+	releaseSlot(data->slot);
+	addNpsSamples(game, data);
+
 	if(game->result().type() != Chess::Result::NoResult && game->result().type() != Chess::Result::NoResult)
 	{
 		qreal oldPoints=playerPoints(0);
+		qreal oldWhitePoints=playerPoints(iWhite);
 		addScore(iWhite,Chess::Side::White,game->result().gResult(),game->komi());
 		addScore(iBlack,Chess::Side::Black,game->result().gResult(),game->komi());
 		qreal newPoints=playerPoints(0);
-		if(!m_sprt->isNull()) m_sprt->addGameResult(newPoints-oldPoints);
+		m_ratingSolver->addResult(iWhite, iBlack, playerPoints(iWhite)-oldWhitePoints);
+		if(!m_sprt->isNull()) addSprtResult(gameNumber, newPoints-oldPoints);
+		updateRatings();
 	}
+	else if (!m_sprt->isNull())
+		discardSprtResult(gameNumber);
 
 	m_maxGScore=std::max(game->result().gResult().gScore,m_maxGScore);
+	m_plyCount += pgn->moves().size();
+
+	if (game->result().type() == Chess::Result::Timeout
+	&&  !game->result().loser().isNull())
+	{
+		int loser = game->result().loser() == Chess::Side::White
+			? iWhite : iBlack;
+		m_players[loser].addTimeLoss();
+	}
 
 	if(game->result().gResult().gSide == Chess::Side::White)
 	{
@@ -684,8 +873,22 @@ void Tournament::onGameFinished(ChessGame* game)
 
 	game->pgn()->setTag("Points",rMobPoints(game->result().gResult(),game->komi()));
 
-	writeEpd(game);
-	writePgn(pgn, gameNumber);
+	bool written = writeEpd(game);
+	written = writePgn(pgn, gameNumber) && written;
+
+	if (m_checkpointInterval > 0 && !m_stopping
+	&&  m_finishedGameCount % m_checkpointInterval == 0)
+		written = writeCheckpoint() && written;
+	if (!written && m_gameWriter->hasError())
+	{
+		// Don't play games whose results can't be saved
+		if (m_error.isEmpty())
+			m_error = m_gameWriter->errorString();
+		QMetaObject::invokeMethod(this, "stop", Qt::QueuedConnection);
+	}
+	if (m_statsInterval > 0
+	&&  m_finishedGameCount % m_statsInterval == 0)
+		writeStats();
 
 	Chess::Result::Type resultType(game->result().type());
 	bool crashed = (resultType == Chess::Result::Disconnection ||
@@ -731,7 +934,10 @@ void Tournament::onGameStartFailed(ChessGame* game)
 
 	delete game->pgn();
 	game->deleteLater();
-	m_gameData.remove(game);
+	GameData* data = m_gameData.take(game);
+	if (data != nullptr)
+		releaseSlot(data->slot);
+	delete data;
 
 	stop();
 }
@@ -739,6 +945,12 @@ void Tournament::onGameStartFailed(ChessGame* game)
 void Tournament::onFinished()
 {
 	m_gameManager->cleanupIdleThreads();
+	m_gameWriter->finish();
+	if (m_gameWriter->hasError() && m_error.isEmpty())
+		m_error = m_gameWriter->errorString();
+	updateRatings(true);
+	if (m_statsInterval > 0)
+		writeStats();
 	m_finished = true;
 	emit finished();
 }
@@ -759,6 +971,15 @@ void Tournament::start()
 		setOpeningRepetitions(INT_MAX);
 
 	m_gameData.clear();
+	m_resumedGames.clear();
+	m_sprtPairPoints.clear();
+	m_ratingSolver->clear();
+	m_ratingGameCount = 0;
+	m_ratingFitTime = 0;
+	m_ratingTimer.invalidate();
+	m_ratingTable.clear();
+	m_busySlots.clear();
+	m_pausedSlots.clear();
 	m_pgnGames.clear();
 	m_startFen.clear();
 	m_openingMoves.clear();
@@ -768,6 +989,19 @@ void Tournament::start()
 
 	initializePairing();
 	m_finalGameCount = gamesPerCycle() * gamesPerEncounter() * roundMultiplier();
+	m_plyCount = 0;
+
+	if (!m_resumeFile.isEmpty() && !readCheckpoint(m_resumeFile))
+	{
+		m_error = tr("Cannot resume from checkpoint %1")
+			  .arg(m_resumeFile);
+		stop();
+		return;
+	}
+
+	// The game rate is measured from this point on
+	m_startGameCount = m_finishedGameCount;
+	m_elapsedTimer.start();
 
 	startNextGame();
 }
@@ -792,85 +1026,461 @@ void Tournament::stop()
 		QMetaObject::invokeMethod(game, "stop", Qt::QueuedConnection);
 }
 
-template<Chess::rMobScoring rMobType>
-QString Tournament::resultsForSides() const
+void Tournament::writePairingState(QDataStream& out) const
 {
+	Q_UNUSED(out);
+}
 
-	QString ret;
+bool Tournament::readPairingState(QDataStream& in)
+{
+	Q_UNUSED(in);
+	return true;
+}
 
-	if(rMobType==Chess::Classical|| rMobType == Chess::AllOrNone || rMobType == Chess::Komi)
-	{
-		TournamentPlayer player = playerAt(0);
-		TournamentPlayer player2 = playerAt(1);
-		int gamesWithWhite  = player.nWhiteGames();
-		int whiteScore  = 2 * player.whiteWins<rMobType>()+player.whiteDraws<rMobType>();
-		int games = player.gamesFinished();
-		int score = 2 * player.wins<rMobType>()+player.draws<rMobType>();
+namespace {
 
-		if(games>0)
-		{
-			ret +=tr("Score of %1 vs %2: %3 - %4 - %5  [%6 %] %7\n)")
-			.arg(qUtf8Printable(player.name()))
-			.arg(qUtf8Printable(player2.name()))
-			.arg(player.wins<rMobType>())
-			.arg(player.losses<rMobType>())
-			.arg(player.draws<rMobType>())
-			.arg(double(score) / (games* 2)*100, 0, 'f', 2)
-			.arg(games);
-		}
+const quint32 s_checkpointMagic = 0x43434b50;
+const quint32 s_checkpointVersion = 3;
 
-		if (gamesWithWhite > 0)
-		{
-			ret += tr("...      %1 playing White: %2 - %3 - %4  [%5 %] %6\n")
-			.arg(qUtf8Printable(player.name()))
-			.arg(player.whiteWins<rMobType>())
-			.arg(player.whiteLosses<rMobType>())
-			.arg(player.whiteDraws<rMobType>())
-			.arg(double(whiteScore) / (gamesWithWhite * 2)*100, 0, 'f', 2)
-			.arg(gamesWithWhite);
-		}
+// Returns the size of output file fileName, or -1 if there's no output
+qint64 outputSize(const QString& fileName)
+{
+	if (fileName.isEmpty())
+		return -1;
 
-		int gamesWithBlack  = games-gamesWithWhite;
-		int blackScore  = 2 * player.blackWins<rMobType>() + player.blackDraws<rMobType>();
+	QFileInfo info(fileName);
+	return info.exists() ? info.size() : 0;
+}
 
-		if (gamesWithBlack > 0)
-		{
-			ret += tr("...      %1 playing Black: %2 - %3 - %4  [%5 %] %6\n")
-			.arg(qUtf8Printable(player.name()))
-			.arg(player.blackWins<rMobType>())
-			.arg(player.blackLosses<rMobType>())
-			.arg(player.blackDraws<rMobType>())
-			.arg(double(blackScore) / (gamesWithBlack * 2)*100, 0, 'f', 2)
-			.arg(gamesWithBlack);
-		}
+// Truncates output file fileName to the size it had when the checkpoint
+// was written, so the games finished after the checkpoint aren't written
+// twice when they are played again
+bool truncateOutput(const QString& fileName, qint64 size)
+{
+	if (fileName.isEmpty() || size < 0)
+		return true;
 
-		if (games > 0)
-		{
-			ret += tr("...      White vs Black: %1 - %2 - %3  [%4 %] %5\n")
-			.arg(player.whiteWins<rMobType>() + player.blackLosses<rMobType>())
-			.arg(player.whiteLosses<rMobType>() + player.blackWins<rMobType>())
-			.arg(player.draws<rMobType>())
-			.arg(double(whiteScore + 2 * gamesWithBlack - blackScore)
-					/ (games * 2)*100, 0, 'f', 2)
-			.arg(games);
-		}
+	const qint64 oldSize = outputSize(fileName);
+	if (oldSize < size)
+	{
+		qWarning("File %s is shorter than when the checkpoint was written",
+			 qUtf8Printable(fileName));
+		return true;
 	}
-	else
+	if (oldSize == size)
+		return true;
+
+	if (!QFile::resize(fileName, size))
 	{
-		TournamentPlayer player = playerAt(0);
-		TournamentPlayer player2 = playerAt(1);
-		int gamesWithWhite  = player.nWhiteGames();
-		qreal whiteScore  = 2 * player.whitePoints<rMobType>();
-		int games = player.gamesFinished();
-		qreal score= 2 * player.points<rMobType>();
+		qWarning("Cannot truncate file %s", qUtf8Printable(fileName));
+		return false;
+	}
+	qInfo("Removed %lld bytes written after the checkpoint from %s",
+	      oldSize - size, qUtf8Printable(fileName));
+	return true;
+}
 
-		if(games>0)
-		{
-			ret +=tr("Score of %1 vs %2: %3 [%4 %] %5\n)")
-			.arg(qUtf8Printable(player.name()))
-			.arg(qUtf8Printable(player2.name()))
-			.arg(player.points<rMobType>())
-			.arg(double(score) / (games* 2)*100, 0, 'f', 2)
+void writeMoves(QDataStream& out, const QVector<Chess::Move>& moves)
+{
+	out << qint32(moves.size());
+	for (const Chess::Move& move : moves)
+		out << qint32(move.sourceSquare())
+		    << qint32(move.targetSquare())
+		    << qint32(move.promotion());
+}
+
+bool readMoves(QDataStream& in, QVector<Chess::Move>& moves)
+{
+	qint32 count;
+	in >> count;
+	if (in.status() != QDataStream::Ok || count < 0)
+		return false;
+
+	moves.clear();
+	for (int i = 0; i < count; i++)
+	{
+		qint32 source;
+		qint32 target;
+		qint32 promotion;
+		in >> source >> target >> promotion;
+		if (in.status() != QDataStream::Ok
+		||  source < 0 || source > 0x3FF
+		||  target < 0 || target > 0x3FF
+		||  promotion < 0 || promotion > 0x3FF)
+			return false;
+		moves.append(Chess::Move(source, target, promotion));
+	}
+
+	return true;
+}
+
+} // anonymous namespace
+
+bool Tournament::writeCheckpoint()
+{
+	// The games counted as saved must be in the PGN file
+	m_gameWriter->flush();
+	if (m_gameWriter->hasError())
+	{
+		qWarning("Cannot write checkpoint file %s: the games couldn't be saved",
+			 qUtf8Printable(m_checkpointFile));
+		return false;
+	}
+
+	QSaveFile file(m_checkpointFile);
+	if (!file.open(QIODevice::WriteOnly))
+	{
+		qWarning("Cannot open checkpoint file %s",
+			 qUtf8Printable(m_checkpointFile));
+		return false;
+	}
+
+	QDataStream out(&file);
+	out.setVersion(QDataStream::Qt_5_0);
+
+	// Settings that must match when the tournament is resumed
+	out << s_checkpointMagic << s_checkpointVersion;
+	out << type() << qint32(m_players.size())
+	    << qint32(m_gamesPerEncounter) << qint32(m_roundMultiplier)
+	    << qint32(m_rMobType);
+
+	out << qint32(m_round) << qint32(m_oldRound)
+	    << qint32(m_nextGameNumber) << qint32(m_finishedGameCount)
+	    << qint32(m_savedGameCount) << qint32(m_finalGameCount)
+	    << qint32(m_maxGScore);
+	for (int i = 0; i < 876; i++)
+		out << qint32(m_Objectives[i]);
+	out << m_plyCount;
+
+	for (const TournamentPlayer& player : qAsConst(m_players))
+		player.write(out);
+
+	out << qint32(m_pairs.size());
+	for (auto it = m_pairs.constBegin(); it != m_pairs.constEnd(); ++it)
+	{
+		out << qint32(it.key().first) << qint32(it.key().second);
+		it.value()->write(out);
+	}
+	if (m_pair != nullptr)
+		out << qint32(m_pair->firstPlayer()) << qint32(m_pair->secondPlayer());
+	else
+		out << qint32(-1) << qint32(-1);
+
+	out << m_startFen;
+	writeMoves(out, m_openingMoves);
+	out << qint32(m_komi.komi) << qint32(m_komi.gSide)
+	    << qint32(m_repetitionCounter);
+
+	m_sprt->write(out);
+	out << m_sprtPairPoints;
+	m_ratingSolver->write(out);
+
+	out << (m_openingSuite != nullptr);
+	if (m_openingSuite != nullptr)
+		m_openingSuite->write(out);
+	out << Mersenne::state();
+
+	writePairingState(out);
+
+	// Games in progress, in the order of their game numbers
+	QMap<int, GameData> games;
+	for (const GameData* data : qAsConst(m_gameData))
+		games.insert(data->number, *data);
+	for (const GameData& data : qAsConst(m_resumedGames))
+		games.insert(data.number, data);
+
+	out << qint32(games.size());
+	for (const GameData& data : qAsConst(games))
+	{
+		out << qint32(data.number)
+		    << qint32(data.whiteIndex) << qint32(data.blackIndex)
+		    << qint32(data.round) << data.startFen;
+		writeMoves(out, data.openingMoves);
+		out << qint32(data.komi.komi) << qint32(data.komi.gSide);
+	}
+
+	// Finished games waiting for earlier games before they can be
+	// written to the PGN file
+	out << qint32(m_pgnGames.size());
+	for (auto it = m_pgnGames.constBegin(); it != m_pgnGames.constEnd(); ++it)
+	{
+		QString text;
+		QTextStream stream(&text);
+		it.value().write(stream, PgnGame::Verbose);
+		stream.flush();
+		out << qint32(it.key()) << text.toUtf8();
+	}
+
+	// The writer was flushed above, so the output files end with
+	// the last saved game
+	out << outputSize(m_pgnFileName) << outputSize(m_epdFileName);
+
+	if (out.status() != QDataStream::Ok || !file.commit())
+	{
+		qWarning("Cannot write checkpoint file %s",
+			 qUtf8Printable(m_checkpointFile));
+		return false;
+	}
+
+	return true;
+}
+
+bool Tournament::readCheckpoint(const QString& fileName)
+{
+	QFile file(fileName);
+	if (!file.open(QIODevice::ReadOnly))
+	{
+		qWarning("Cannot open checkpoint file %s",
+			 qUtf8Printable(fileName));
+		return false;
+	}
+
+	QDataStream in(&file);
+	in.setVersion(QDataStream::Qt_5_0);
+
+	quint32 magic;
+	quint32 version;
+	in >> magic >> version;
+	if (magic != s_checkpointMagic || version != s_checkpointVersion)
+	{
+		qWarning("Invalid checkpoint file %s", qUtf8Printable(fileName));
+		return false;
+	}
+
+	QString tournamentType;
+	qint32 settings[4];
+	in >> tournamentType;
+	for (qint32& value : settings)
+		in >> value;
+	if (tournamentType != type()
+	||  settings[0] != m_players.size()
+	||  settings[1] != m_gamesPerEncounter
+	||  settings[2] != m_roundMultiplier
+	||  settings[3] != m_rMobType)
+	{
+		qWarning("The checkpoint was written by a tournament with "
+			 "different settings");
+		return false;
+	}
+
+	qint32 counters[7];
+	for (qint32& value : counters)
+		in >> value;
+	m_round = counters[0];
+	m_oldRound = counters[1];
+	m_nextGameNumber = counters[2];
+	m_finishedGameCount = counters[3];
+	m_savedGameCount = counters[4];
+	m_finalGameCount = counters[5];
+	m_maxGScore = counters[6];
+	for (int i = 0; i < 876; i++)
+	{
+		qint32 value;
+		in >> value;
+		m_Objectives[i] = value;
+	}
+	in >> m_plyCount;
+
+	for (int i = 0; i < m_players.size(); i++)
+	{
+		if (!m_players[i].read(in))
+			return false;
+		invalidateStandings(i);
+	}
+
+	qint32 pairCount;
+	in >> pairCount;
+	for (int i = 0; i < pairCount && in.status() == QDataStream::Ok; i++)
+	{
+		qint32 first;
+		qint32 second;
+		in >> first >> second;
+		if (first < -1 || first >= m_players.size()
+		||  second < -1 || second >= m_players.size()
+		||  (first == -1 && second == -1))
+			return false;
+		if (!pair(first, second)->read(in))
+			return false;
+	}
+
+	qint32 first;
+	qint32 second;
+	in >> first >> second;
+	m_pair = nullptr;
+	if (first != -1 || second != -1)
+		m_pair = pair(first, second);
+
+	qint32 komi;
+	qint32 komiSide;
+	qint32 repetitionCounter;
+	in >> m_startFen;
+	if (!readMoves(in, m_openingMoves))
+		return false;
+	in >> komi >> komiSide >> repetitionCounter;
+	m_komi.komi = komi;
+	m_komi.gSide = Chess::Side::Type(komiSide);
+	m_repetitionCounter = repetitionCounter;
+
+	if (!m_sprt->read(in))
+		return false;
+	in >> m_sprtPairPoints;
+	if (!m_ratingSolver->read(in))
+		return false;
+
+	bool hasOpeningSuite;
+	in >> hasOpeningSuite;
+	if (hasOpeningSuite != (m_openingSuite != nullptr)
+	||  (hasOpeningSuite && !m_openingSuite->read(in)))
+	{
+		qWarning("The checkpoint doesn't match the opening suite");
+		return false;
+	}
+	QVector<quint32> randomState;
+	in >> randomState;
+	if (!Mersenne::setState(randomState))
+		return false;
+
+	if (!readPairingState(in))
+		return false;
+
+	qint32 gameCount;
+	in >> gameCount;
+	for (int i = 0; i < gameCount && in.status() == QDataStream::Ok; i++)
+	{
+		GameData data;
+		qint32 number;
+		qint32 white;
+		qint32 black;
+		qint32 round;
+		in >> number >> white >> black >> round >> data.startFen;
+		if (!readMoves(in, data.openingMoves))
+			return false;
+		in >> komi >> komiSide;
+		if (white < 0 || white >= m_players.size()
+		||  black < 0 || black >= m_players.size())
+			return false;
+
+		data.number = number;
+		data.whiteIndex = white;
+		data.blackIndex = black;
+		data.slot = -1;
+		data.round = round;
+		data.komi.komi = komi;
+		data.komi.gSide = Chess::Side::Type(komiSide);
+		m_resumedGames.append(data);
+	}
+
+	qint32 pgnCount;
+	in >> pgnCount;
+	for (int i = 0; i < pgnCount && in.status() == QDataStream::Ok; i++)
+	{
+		qint32 number;
+		QByteArray text;
+		in >> number >> text;
+
+		PgnStream stream(&text, m_variant);
+		PgnGame pgn((m_rMobType==Chess::Komi),m_isLegacy);
+		if (!pgn.read(stream))
+			return false;
+		m_pgnGames[number] = pgn;
+	}
+
+	qint64 pgnSize;
+	qint64 epdSize;
+	in >> pgnSize >> epdSize;
+
+	if (in.status() != QDataStream::Ok)
+	{
+		qWarning("Invalid checkpoint file %s", qUtf8Printable(fileName));
+		return false;
+	}
+	if (!truncateOutput(m_pgnFileName, pgnSize)
+	||  !truncateOutput(m_epdFileName, epdSize))
+		return false;
+
+	qInfo("Resuming after %d finished games", m_finishedGameCount);
+	return true;
+}
+
+template<Chess::rMobScoring rMobType>
+QString Tournament::resultsForSides() const
+{
+
+	QString ret;
+
+	if(rMobType==Chess::Classical|| rMobType == Chess::AllOrNone || rMobType == Chess::Komi)
+	{
+		const TournamentPlayer& player(playerAt(0));
+		const TournamentPlayer& player2(playerAt(1));
+		int gamesWithWhite  = player.nWhiteGames();
+		int whiteScore  = 2 * player.whiteWins<rMobType>()+player.whiteDraws<rMobType>();
+		int games = player.gamesFinished();
+		int score = 2 * player.wins<rMobType>()+player.draws<rMobType>();
+
+		if(games>0)
+		{
+			ret +=tr("Score of %1 vs %2: %3 - %4 - %5  [%6 %] %7\n)")
+			.arg(qUtf8Printable(player.name()))
+			.arg(qUtf8Printable(player2.name()))
+			.arg(player.wins<rMobType>())
+			.arg(player.losses<rMobType>())
+			.arg(player.draws<rMobType>())
+			.arg(double(score) / (games* 2)*100, 0, 'f', 2)
+			.arg(games);
+		}
+
+		if (gamesWithWhite > 0)
+		{
+			ret += tr("...      %1 playing White: %2 - %3 - %4  [%5 %] %6\n")
+			.arg(qUtf8Printable(player.name()))
+			.arg(player.whiteWins<rMobType>())
+			.arg(player.whiteLosses<rMobType>())
+			.arg(player.whiteDraws<rMobType>())
+			.arg(double(whiteScore) / (gamesWithWhite * 2)*100, 0, 'f', 2)
+			.arg(gamesWithWhite);
+		}
+
+		int gamesWithBlack  = games-gamesWithWhite;
+		int blackScore  = 2 * player.blackWins<rMobType>() + player.blackDraws<rMobType>();
+
+		if (gamesWithBlack > 0)
+		{
+			ret += tr("...      %1 playing Black: %2 - %3 - %4  [%5 %] %6\n")
+			.arg(qUtf8Printable(player.name()))
+			.arg(player.blackWins<rMobType>())
+			.arg(player.blackLosses<rMobType>())
+			.arg(player.blackDraws<rMobType>())
+			.arg(double(blackScore) / (gamesWithBlack * 2)*100, 0, 'f', 2)
+			.arg(gamesWithBlack);
+		}
+
+		if (games > 0)
+		{
+			ret += tr("...      White vs Black: %1 - %2 - %3  [%4 %] %5\n")
+			.arg(player.whiteWins<rMobType>() + player.blackLosses<rMobType>())
+			.arg(player.whiteLosses<rMobType>() + player.blackWins<rMobType>())
+			.arg(player.draws<rMobType>())
+			.arg(double(whiteScore + 2 * gamesWithBlack - blackScore)
+					/ (games * 2)*100, 0, 'f', 2)
+			.arg(games);
+		}
+	}
+	else
+	{
+		const TournamentPlayer& player(playerAt(0));
+		const TournamentPlayer& player2(playerAt(1));
+		int gamesWithWhite  = player.nWhiteGames();
+		qreal whiteScore  = 2 * player.whitePoints<rMobType>();
+		int games = player.gamesFinished();
+		qreal score= 2 * player.points<rMobType>();
+
+		if(games>0)
+		{
+			ret +=tr("Score of %1 vs %2: %3 [%4 %] %5\n)")
+			.arg(qUtf8Printable(player.name()))
+			.arg(qUtf8Printable(player2.name()))
+			.arg(player.points<rMobType>())
+			.arg(double(score) / (games* 2)*100, 0, 'f', 2)
 			.arg(games);
 		}
 
@@ -916,290 +1526,272 @@ template QString Tournament::resultsForSides<Chess::Komi>() const;
 
 
 template<Chess::rMobScoring rMobType>
-QString Tournament::subResults() const
+void Tournament::updateStandingsRow(int index, StandingsRow& row) const
 {
-	QString ret;
+	const TournamentPlayer& player(playerAt(index));
+	rMobPointsElo elo(player.points<rMobType>(), player.squarePoints<rMobType>(), player.gamesFinished());
+	rMobPointsElo whiteElo(player.whitePoints<rMobType>(), player.whiteSquarePoints<rMobType>(), player.gamesFinished());
+	rMobPointsElo blackElo(player.blackPoints<rMobType>(), player.blackSquarePoints<rMobType>(), player.gamesFinished()-player.nWhiteGames());
+
+	row.name = player.name();
+	row.fields.clear();
 
+	qreal score;
 	if(rMobType==Chess::Classical || rMobType ==Chess::AllOrNone || rMobType==Chess::Komi)
 	{
-		QMultiMap<qreal, RankingData> ranking;
-
-
-
-		for (int i = 0; i < playerCount(); i++)
-		{
-
-			const TournamentPlayer& player(playerAt(i));
-			rMobPointsElo elo(player.points<rMobType>(), player.squarePoints<rMobType>(), player.gamesFinished());
-			rMobPointsElo whiteElo(player.whitePoints<rMobType>(), player.whiteSquarePoints<rMobType>(), player.gamesFinished());
-			rMobPointsElo blackElo(player.blackPoints<rMobType>(), player.blackSquarePoints<rMobType>(), player.gamesFinished()-player.nWhiteGames());
-
-			if (playerCount() == 2)
-					{
-						ret += resultsForSides<rMobType>();
-						if (rMobType == Chess::Classical || rMobType == Chess::AllOrNone || rMobType == Chess::Komi)
-						{
-							ret += QString("Elo difference: %1 +/- %2, LOS: %3 %, DrawRatio: %4 %")
-								.arg(elo.diff(), 0, 'f', 1)
-								.arg(elo.errorMargin(), 0, 'f', 1)
-								.arg(elo.LOS(), 0, 'f', 1)
-								.arg(qreal(player.draws<rMobType>())/player.gamesFinished()* 100, 0, 'f', 1);
-							break;
-						}
-						else
-						{
-							ret += QString("Elo difference: %1 +/- %2, LOS: %3 %")
-								.arg(elo.diff(), 0, 'f', 1)
-								.arg(elo.errorMargin(), 0, 'f', 1)
-								.arg(elo.LOS(), 0, 'f', 1);
-							break;
-						}
-
-					}
-
-
-			RankingData data =
-													{ player.name(),
-													 player.gamesFinished(),
-													 player.wins<rMobType>(),
-													 player.losses<rMobType>(),
-													 player.draws<rMobType>(),
-													 player.whiteWins<rMobType>(),
-													 player.whiteLosses<rMobType>(),
-													 player.whiteDraws<rMobType>(),
-													 player.blackWins<rMobType>(),
-													 player.blackLosses<rMobType>(),
-													 player.blackDraws<rMobType>(),
-													 player.points<rMobType>(),
-													 elo.pointRatio(),
-													 qreal(player.draws<rMobType>())/player.gamesFinished(),
-													 elo.diff(),
-													 elo.errorMargin(),
-													 elo.LOS(),
-													 whiteElo.pointRatio(),
-													 qreal(player.whiteDraws<rMobType>())/player.nWhiteGames(),
-													 whiteElo.diff(),
-													 whiteElo.errorMargin(),
-													 whiteElo.LOS(),
-													 blackElo.pointRatio(),
-													 qreal(player.blackDraws<rMobType>())/(player.gamesFinished()-player.nWhiteGames()),
-													 blackElo.diff(),
-													 blackElo.errorMargin(),
-													 blackElo.LOS() };
-
-
-
-
-
-				// Order players like this:
-				// 1. Gauntlet player (if any)
-				// 2. Players with finished games, sorted by point ratio
-				// 3. Players without finished games
-				qreal key = -1.0;
-				if ((i > 0 && i >= seedCount()) || !hasGauntletRatingsOrder())
-				{
-					if (data.games)
-						key = 1.0 - data.score;
-					else
-						key = 2.0;
-				}
-				ranking.insert(key, data);
-
-
-		}
-
+		RankingData data =
+			{ player.name(),
+			  player.gamesFinished(),
+			  player.wins<rMobType>(),
+			  player.losses<rMobType>(),
+			  player.draws<rMobType>(),
+			  player.whiteWins<rMobType>(),
+			  player.whiteLosses<rMobType>(),
+			  player.whiteDraws<rMobType>(),
+			  player.blackWins<rMobType>(),
+			  player.blackLosses<rMobType>(),
+			  player.blackDraws<rMobType>(),
+			  player.points<rMobType>(),
+			  elo.pointRatio(),
+			  qreal(player.draws<rMobType>())/player.gamesFinished(),
+			  elo.diff(),
+			  elo.errorMargin(),
+			  elo.LOS(),
+			  whiteElo.pointRatio(),
+			  qreal(player.whiteDraws<rMobType>())/player.nWhiteGames(),
+			  whiteElo.diff(),
+			  whiteElo.errorMargin(),
+			  whiteElo.LOS(),
+			  blackElo.pointRatio(),
+			  qreal(player.blackDraws<rMobType>())/(player.gamesFinished()-player.nWhiteGames()),
+			  blackElo.diff(),
+			  blackElo.errorMargin(),
+			  blackElo.LOS() };
+
+		row.fields.insert(Name,       QString("%1 ").arg(data.name, -25));
+		row.fields.insert(EloDiff,    QString("%1 ").arg(data.eloDiff, 7, 'f', 0));
+		row.fields.insert(ErrorMargin,QString("%1 ").arg(data.errorMargin, 7, 'f', 0));
+		row.fields.insert(Games,      QString("%1 ").arg(data.games, 7));
+		row.fields.insert(Wins,       QString("%1 ").arg(data.wins, 7));
+		row.fields.insert(Losses,     QString("%1 ").arg(data.losses, 7));
+		row.fields.insert(Draws,      QString("%1 ").arg(data.draws, 7));
+		row.fields.insert(Points,     QString("%1 ").arg(data.points, 8,'f',1));
+		row.fields.insert(Score,      QString("%1% ").arg(data.score * 100.0, 6, 'f', 1));
+		row.fields.insert(DrawScore,  QString("%1% ").arg(data.drawScore * 100.0, 6, 'f', 1));
+		row.fields.insert(WhiteScore, QString("%1% ").arg(data.whiteScore * 100.0, 6, 'f', 1));
+		row.fields.insert(BlackScore, QString("%1% ").arg(data.blackScore * 100.0, 6, 'f', 1));
+		row.fields.insert(WhiteDrawScore,
+				  QString("%1% ").arg(data.whiteDrawScore * 100.0, 6, 'f', 1));
+		row.fields.insert(BlackDrawScore,
+				  QString("%1% ").arg(data.blackDrawScore * 100.0, 6, 'f', 1));
+		row.fields.insert(WhiteWins,  QString("%1 ").arg(data.whiteWins, 7));
+		row.fields.insert(WhiteLosses,QString("%1 ").arg(data.whiteLosses, 7));
+		row.fields.insert(WhiteDraws, QString("%1 ").arg(data.whiteDraws, 7));
+		row.fields.insert(BlackWins,  QString("%1 ").arg(data.blackWins, 7));
+		row.fields.insert(BlackLosses,QString("%1 ").arg(data.blackLosses, 7));
+		row.fields.insert(BlackDraws, QString("%1 ").arg(data.blackDraws, 7));
+		score = data.score;
+	}
+	else
+	{
+		RankingDataPoints data =
+			{ player.name(),
+			  player.gamesFinished(),
+			  player.points<rMobType>(),
+			  player.whitePoints<rMobType>(),
+			  player.blackPoints<rMobType>(),
+			  elo.pointRatio(),
+			  elo.diff(),
+			  elo.errorMargin(),
+			  elo.LOS(),
+			  whiteElo.pointRatio(),
+			  whiteElo.diff(),
+			  whiteElo.errorMargin(),
+			  whiteElo.LOS(),
+			  blackElo.pointRatio(),
+			  blackElo.diff(),
+			  blackElo.errorMargin(),
+			  blackElo.LOS() };
+
+		row.fields.insert(Name,       QString("%1 ").arg(data.name, -25));
+		row.fields.insert(EloDiff,    QString("%1 ").arg(data.eloDiff, 7, 'f', 0));
+		row.fields.insert(ErrorMargin,QString("%1 ").arg(data.errorMargin, 7, 'f', 0));
+		row.fields.insert(Games,      QString("%1 ").arg(data.games, 7));
+		row.fields.insert(Points,     QString("%1 ").arg(data.points, 8,'f',4));
+		row.fields.insert(Score,      QString("%1% ").arg(data.score * 100.0, 6, 'f', 2));
+		row.fields.insert(WhitePoints,     QString("%1 ").arg(data.points, 8,'f',4));
+		row.fields.insert(WhiteScore,      QString("%1% ").arg(data.score * 100.0, 6, 'f', 2));
+		row.fields.insert(BlackPoints,     QString("%1 ").arg(data.points, 8,'f',4));
+		row.fields.insert(BlackScore,      QString("%1% ").arg(data.score * 100.0, 6, 'f', 2));
+		score = data.score;
+	}
 
+	// Order players like this:
+	// 1. Gauntlet player (if any)
+	// 2. Players with finished games, sorted by point ratio
+	// 3. Players without finished games
+	row.key = -1.0;
+	if ((index > 0 && index >= seedCount()) || !hasGauntletRatingsOrder())
+	{
+		if (player.gamesFinished())
+			row.key = 1.0 - score;
+		else
+			row.key = 2.0;
+	}
+}
 
+template<Chess::rMobScoring rMobType>
+QString Tournament::standingsTable() const
+{
+	Standings& standings = m_standings[rMobType];
+	const int count = playerCount();
 
-		//First assign raw format string, then try to find named format
-		QString format = m_resultFormat;
+	//First assign raw format string, then try to find named format
+	QString format = m_rMobFormat;
+	if(rMobType==Chess::Classical || rMobType ==Chess::AllOrNone || rMobType==Chess::Komi)
+	{
+		format = m_resultFormat;
 		if (m_namedFormats.contains(m_resultFormat))
 			format = m_namedFormats[m_resultFormat];
+	}
+	if (format != standings.format)
+	{
+		standings.format = format;
+		for (StandingsRow& row : standings.rows)
+			row.text.clear();
+	}
 
-		ResultFormatter formatter(m_tokenMap, format);
-		QMap<int,QString> headerMap;
+	if (standings.rows.size() != count)
+	{
+		StandingsRow empty = { true, QString(), 0.0, 0, QMap<int, QString>(), QString() };
+		standings.rows.fill(empty, count);
+		standings.order.clear();
+	}
 
-		if (!ranking.isEmpty())
-		{
-			headerMap.insert(Rank,        QString("%1 ").arg("Rank", 4));
-			headerMap.insert(Name,        QString("%1 ").arg("Name", -25));
-			headerMap.insert(EloDiff,     QString("%1 ").arg("Elo", 7));
-			headerMap.insert(ErrorMargin, QString("%1 ").arg("+/-", 7));
-			headerMap.insert(Games,	      QString("%1 ").arg("Games", 7));
-			headerMap.insert(Wins,	      QString("%1 ").arg("Wins", 7));
-			headerMap.insert(Losses,      QString("%1 ").arg("Losses", 7));
-			headerMap.insert(Draws,       QString("%1 ").arg("Draws", 7));
-			headerMap.insert(Points,      QString("%1 ").arg("Points", 8));
-			headerMap.insert(Score,	      QString("%1 ").arg("Score", 7));
-			headerMap.insert(DrawScore,   QString("%1 ").arg("Draw", 7));
-			headerMap.insert(WhiteScore,  QString("%1 ").arg("White", 7));
-			headerMap.insert(BlackScore,  QString("%1 ").arg("Black", 7));
-			headerMap.insert(WhiteDrawScore,  QString("%1 ").arg("WDraw", 7));
-			headerMap.insert(BlackDrawScore,  QString("%1 ").arg("BDraw", 7));
-			headerMap.insert(WhiteWins,   QString("%1 ").arg("WWins", 7));
-			headerMap.insert(WhiteLosses, QString("%1 ").arg("WLoss.", 7));
-			headerMap.insert(WhiteDraws,  QString("%1 ").arg("WDraws", 7));
-			headerMap.insert(BlackWins,   QString("%1 ").arg("BWins", 7));
-			headerMap.insert(BlackLosses, QString("%1 ").arg("BLoss.", 7));
-			headerMap.insert(BlackDraws,  QString("%1 ").arg("BDraws", 7));
-
-			ret += formatter.entry(headerMap);
-		}
+	// Players with equal keys are ranked in reverse order of their
+	// indexes, which is how the old QMultiMap based ranking did it.
+	const QVector<StandingsRow>& rows = standings.rows;
+	auto before = [&rows](int a, int b)
+	{
+		return rows[a].key < rows[b].key
+		    || (rows[a].key == rows[b].key && a > b);
+	};
+
+	// Only the players whose scores have changed are updated, and each
+	// of them is moved to its new place in the ranking.
+	for (int i = 0; i < count; i++)
+	{
+		StandingsRow& row = standings.rows[i];
+		if (!row.dirty && row.name == playerAt(i).name())
+			continue;
 
-		int rank = hasGauntletRatingsOrder() ? -1 : 0;
-		for (auto it = ranking.constBegin(); it != ranking.constEnd(); ++it)
+		const qreal oldKey = row.key;
+		updateStandingsRow<rMobType>(i, row);
+		row.dirty = false;
+		row.text.clear();
+
+		if (standings.order.size() == count && row.key != oldKey)
 		{
-			const RankingData data = it.value();
-			QMap<int, QString> dataMap;
-			dataMap.insert(Rank,       QString("%1 ").arg(++rank, 4));
-			dataMap.insert(Name,       QString("%1 ").arg(data.name, -25));
-			dataMap.insert(EloDiff,    QString("%1 ").arg(data.eloDiff, 7, 'f', 0));
-			dataMap.insert(ErrorMargin,QString("%1 ").arg(data.errorMargin, 7, 'f', 0));
-			dataMap.insert(Games,      QString("%1 ").arg(data.games, 7));
-			dataMap.insert(Wins,       QString("%1 ").arg(data.wins, 7));
-			dataMap.insert(Losses,     QString("%1 ").arg(data.losses, 7));
-			dataMap.insert(Draws,      QString("%1 ").arg(data.draws, 7));
-			dataMap.insert(Points,     QString("%1 ").arg(data.points, 8,'f',1));
-			dataMap.insert(Score,      QString("%1% ").arg(data.score * 100.0, 6, 'f', 1));
-			dataMap.insert(DrawScore,  QString("%1% ").arg(data.drawScore * 100.0, 6, 'f', 1));
-			dataMap.insert(WhiteScore, QString("%1% ").arg(data.whiteScore * 100.0, 6, 'f', 1));
-			dataMap.insert(BlackScore, QString("%1% ").arg(data.blackScore * 100.0, 6, 'f', 1));
-			dataMap.insert(WhiteDrawScore,
-					   QString("%1% ").arg(data.whiteDrawScore * 100.0, 6, 'f', 1));
-			dataMap.insert(BlackDrawScore,
-					   QString("%1% ").arg(data.blackDrawScore * 100.0, 6, 'f', 1));
-			dataMap.insert(WhiteWins,  QString("%1 ").arg(data.whiteWins, 7));
-			dataMap.insert(WhiteLosses,QString("%1 ").arg(data.whiteLosses, 7));
-			dataMap.insert(WhiteDraws, QString("%1 ").arg(data.whiteDraws, 7));
-			dataMap.insert(BlackWins,  QString("%1 ").arg(data.blackWins, 7));
-			dataMap.insert(BlackLosses,QString("%1 ").arg(data.blackLosses, 7));
-			dataMap.insert(BlackDraws, QString("%1 ").arg(data.blackDraws, 7));
-			ret += formatter.entry(dataMap);
+			standings.order.removeOne(i);
+			auto it = std::lower_bound(standings.order.begin(),
+						   standings.order.end(), i, before);
+			standings.order.insert(it, i);
 		}
+	}
+	if (standings.order.size() != count)
+	{
+		standings.order.resize(count);
+		for (int i = 0; i < count; i++)
+			standings.order[i] = i;
+		std::sort(standings.order.begin(), standings.order.end(), before);
+	}
 
+	QString ret;
+	if (count == 0)
+		return ret;
+
+	ResultFormatter formatter(m_tokenMap, standings.format);
+	QMap<int,QString> headerMap;
+	headerMap.insert(Rank,        QString("%1 ").arg("Rank", 4));
+	headerMap.insert(Name,        QString("%1 ").arg("Name", -25));
+	headerMap.insert(EloDiff,     QString("%1 ").arg("Elo", 7));
+	headerMap.insert(ErrorMargin, QString("%1 ").arg("+/-", 7));
+	headerMap.insert(Games,	      QString("%1 ").arg("Games", 7));
+	headerMap.insert(Points,      QString("%1 ").arg("Points", 8));
+	headerMap.insert(Score,	      QString("%1 ").arg("Score", 7));
+	if(rMobType==Chess::Classical || rMobType ==Chess::AllOrNone || rMobType==Chess::Komi)
+	{
+		headerMap.insert(Wins,	      QString("%1 ").arg("Wins", 7));
+		headerMap.insert(Losses,      QString("%1 ").arg("Losses", 7));
+		headerMap.insert(Draws,       QString("%1 ").arg("Draws", 7));
+		headerMap.insert(DrawScore,   QString("%1 ").arg("Draw", 7));
+		headerMap.insert(WhiteScore,  QString("%1 ").arg("White", 7));
+		headerMap.insert(BlackScore,  QString("%1 ").arg("Black", 7));
+		headerMap.insert(WhiteDrawScore,  QString("%1 ").arg("WDraw", 7));
+		headerMap.insert(BlackDrawScore,  QString("%1 ").arg("BDraw", 7));
+		headerMap.insert(WhiteWins,   QString("%1 ").arg("WWins", 7));
+		headerMap.insert(WhiteLosses, QString("%1 ").arg("WLoss.", 7));
+		headerMap.insert(WhiteDraws,  QString("%1 ").arg("WDraws", 7));
+		headerMap.insert(BlackWins,   QString("%1 ").arg("BWins", 7));
+		headerMap.insert(BlackLosses, QString("%1 ").arg("BLoss.", 7));
+		headerMap.insert(BlackDraws,  QString("%1 ").arg("BDraws", 7));
 	}
 	else
 	{
-		QMultiMap<qreal, RankingDataPoints> ranking;
+		headerMap.insert(WhitePoints,  QString("%1 ").arg("White", 7));
+		headerMap.insert(WhiteScore,  QString("%1 ").arg("wScore", 7));
+		headerMap.insert(BlackPoints,  QString("%1 ").arg("Black", 7));
+		headerMap.insert(BlackScore,  QString("%1 ").arg("bScore", 7));
+	}
+	ret += formatter.entry(headerMap);
 
-		for (int i = 0; i < playerCount(); i++)
+	// A row is formatted again only if the player's data or rank changed
+	int rank = hasGauntletRatingsOrder() ? -1 : 0;
+	for (int i : qAsConst(standings.order))
+	{
+		StandingsRow& row = standings.rows[i];
+		++rank;
+		if (row.text.isEmpty() || row.rank != rank)
 		{
+			row.rank = rank;
+			row.fields.insert(Rank, QString("%1 ").arg(rank, 4));
+			row.text = formatter.entry(row.fields);
+		}
+		ret += row.text;
+	}
 
-			const TournamentPlayer& player(playerAt(i));
-			rMobPointsElo elo(player.points<rMobType>(), player.squarePoints<rMobType>(), player.gamesFinished());
-			rMobPointsElo whiteElo(player.whitePoints<rMobType>(), player.whiteSquarePoints<rMobType>(), player.gamesFinished());
-			rMobPointsElo blackElo(player.blackPoints<rMobType>(), player.blackSquarePoints<rMobType>(), player.gamesFinished()-player.nWhiteGames());
-
-			if (playerCount() == 2)
-					{
-						ret += resultsForSides<rMobType>();
-						if (rMobType == Chess::Classical || rMobType == Chess::AllOrNone || rMobType == Chess::Komi)
-						{
-							ret += QString("Elo difference: %1 +/- %2, LOS: %3 %, DrawRatio: %4 %")
-								.arg(elo.diff(), 0, 'f', 1)
-								.arg(elo.errorMargin(), 0, 'f', 1)
-								.arg(elo.LOS(), 0, 'f', 1)
-								.arg(qreal(player.draws<rMobType>())/player.gamesFinished()* 100, 0, 'f', 1);
-							break;
-						}
-						else
-						{
-							ret += QString("Elo difference: %1 +/- %2, LOS: %3 %")
-								.arg(elo.diff(), 0, 'f', 1)
-								.arg(elo.errorMargin(), 0, 'f', 1)
-								.arg(elo.LOS(), 0, 'f', 1);
-							break;
-						}
-
-					}
-
-
-			RankingDataPoints data =
-													{player.name(),
-													 player.gamesFinished(),
-													 player.points<rMobType>(),
-													 player.whitePoints<rMobType>(),
-													 player.blackPoints<rMobType>(),
-													 elo.pointRatio(),
-													 elo.diff(),
-													 elo.errorMargin(),
-													 elo.LOS(),
-													 whiteElo.pointRatio(),
-													 whiteElo.diff(),
-													 whiteElo.errorMargin(),
-													 whiteElo.LOS(),
-													 blackElo.pointRatio(),
-													 blackElo.diff(),
-													 blackElo.errorMargin(),
-													 blackElo.LOS() };
-
-
-
-
-
-				// Order players like this:
-				// 1. Gauntlet player (if any)
-				// 2. Players with finished games, sorted by point ratio
-				// 3. Players without finished games
-				qreal key = -1.0;
-				if ((i > 0 && i >= seedCount()) || !hasGauntletRatingsOrder())
-				{
-					if (data.games)
-						key = 1.0 - data.score;
-					else
-						key = 2.0;
-				}
-				ranking.insert(key, data);
-			}
-
-
-
-
+	return ret;
+}
 
-		//First assign raw format string, then try to find named format
-		QString format = m_rMobFormat;
+template<Chess::rMobScoring rMobType>
+QString Tournament::subResults() const
+{
+	QString ret;
 
-		ResultFormatter formatter(m_tokenMap, format);
-		QMap<int,QString> headerMap;
+	if (playerCount() == 2)
+	{
+		const TournamentPlayer& player(playerAt(0));
+		rMobPointsElo elo(player.points<rMobType>(), player.squarePoints<rMobType>(), player.gamesFinished());
 
-		if (!ranking.isEmpty())
+		ret += resultsForSides<rMobType>();
+		if (rMobType == Chess::Classical || rMobType == Chess::AllOrNone || rMobType == Chess::Komi)
 		{
-			headerMap.insert(Rank,        QString("%1 ").arg("Rank", 4));
-			headerMap.insert(Name,        QString("%1 ").arg("Name", -25));
-			headerMap.insert(EloDiff,     QString("%1 ").arg("Elo", 7));
-			headerMap.insert(ErrorMargin, QString("%1 ").arg("+/-", 7));
-			headerMap.insert(Games,	      QString("%1 ").arg("Games", 7));
-			headerMap.insert(Points,      QString("%1 ").arg("Points", 8));
-			headerMap.insert(Score,	      QString("%1 ").arg("Score", 7));
-			headerMap.insert(WhitePoints,  QString("%1 ").arg("White", 7));
-			headerMap.insert(WhiteScore,  QString("%1 ").arg("wScore", 7));
-			headerMap.insert(BlackPoints,  QString("%1 ").arg("Black", 7));
-			headerMap.insert(BlackScore,  QString("%1 ").arg("bScore", 7));
-
-			ret += formatter.entry(headerMap);
+			ret += QString("Elo difference: %1 +/- %2, LOS: %3 %, DrawRatio: %4 %")
+				.arg(elo.diff(), 0, 'f', 1)
+				.arg(elo.errorMargin(), 0, 'f', 1)
+				.arg(elo.LOS(), 0, 'f', 1)
+				.arg(qreal(player.draws<rMobType>())/player.gamesFinished()* 100, 0, 'f', 1);
 		}
-
-		int rank = hasGauntletRatingsOrder() ? -1 : 0;
-		for (auto it = ranking.constBegin(); it != ranking.constEnd(); ++it)
+		else
 		{
-			const RankingDataPoints data = it.value();
-			QMap<int, QString> dataMap;
-			dataMap.insert(Rank,       QString("%1 ").arg(++rank, 4));
-			dataMap.insert(Name,       QString("%1 ").arg(data.name, -25));
-			dataMap.insert(EloDiff,    QString("%1 ").arg(data.eloDiff, 7, 'f', 0));
-			dataMap.insert(ErrorMargin,QString("%1 ").arg(data.errorMargin, 7, 'f', 0));
-			dataMap.insert(Games,      QString("%1 ").arg(data.games, 7));
-			dataMap.insert(Points,     QString("%1 ").arg(data.points, 8,'f',4));
-			dataMap.insert(Score,      QString("%1% ").arg(data.score * 100.0, 6, 'f', 2));
-			dataMap.insert(WhitePoints,     QString("%1 ").arg(data.points, 8,'f',4));
-			dataMap.insert(WhiteScore,      QString("%1% ").arg(data.score * 100.0, 6, 'f', 2));
-			dataMap.insert(BlackPoints,     QString("%1 ").arg(data.points, 8,'f',4));
-			dataMap.insert(BlackScore,      QString("%1% ").arg(data.score * 100.0, 6, 'f', 2));
-
-			ret += formatter.entry(dataMap);
+			ret += QString("Elo difference: %1 +/- %2, LOS: %3 %")
+				.arg(elo.diff(), 0, 'f', 1)
+				.arg(elo.errorMargin(), 0, 'f', 1)
+				.arg(elo.LOS(), 0, 'f', 1);
 		}
 	}
-
+	else
+		ret += standingsTable<rMobType>();
 
 	if(rMobType==m_rMobType)
 	{
@@ -1233,153 +1825,147 @@ template QString Tournament::subResults<Chess::Harmonic>() const;
 template QString Tournament::subResults<Chess::AllOrNone>() const;
 template QString Tournament::subResults<Chess::Komi>() const;
 
-QString Tournament::results() const
+QString Tournament::objectiveTables() const
 {
-
-	QString ret;
-
-	QString rawData=QString("Raw r-Mobility Data: \n");
-	QString asWhite=QString("As White: \n");
-	QString asBlack=QString("As Black: \n");
+	QVector<int> columns;
 	for(int i=0;i<m_maxGScore+1;i++)
 	{
 		if(m_Objectives[i]+m_Objectives[875-i]>0)
-		{
-			rawData+=QString("%1 ").arg(tr("G%1.%2").arg(i/2).arg(5*(i%2)),7);
-			rawData+=QString("%1 ").arg(tr("-G%1.%2").arg(i/2).arg(5*(i%2)),7);
-		}
+			columns << i;
 	}
-	rawData+="\n";
-	for(int i=0; i<m_maxGScore+1;i++)
+
+	// The rows of all players depend on the columns, and a player's
+	// rows are rebuilt only when the player has new results.
+	if (columns != m_objectiveColumns)
 	{
-		if(m_Objectives[i]+m_Objectives[875-i]>0)
+		m_objectiveColumns = columns;
+		m_objectiveRows.clear();
+		m_objectiveHeader.clear();
+		for (int i : qAsConst(columns))
 		{
-			rawData+=QString("%1 ").arg(m_Objectives[i], 7);
-			rawData+=QString("%1 ").arg(m_Objectives[875-i], 7);
+			m_objectiveHeader+=QString("%1 ").arg(tr("G%1.%2").arg(i/2).arg(5*(i%2)),7);
+			m_objectiveHeader+=QString("%1 ").arg(tr("-G%1.%2").arg(i/2).arg(5*(i%2)),7);
 		}
+		m_objectiveHeader+="\n";
+	}
+	if (m_objectiveRows.size() != playerCount())
+	{
+		ObjectiveRows empty = { true, QString(), QString(), QString(), QString() };
+		m_objectiveRows.fill(empty, playerCount());
+	}
+
+	QString rawData=QString("Raw r-Mobility Data: \n");
+	rawData+=m_objectiveHeader;
+	for (int i : qAsConst(columns))
+	{
+		rawData+=QString("%1 ").arg(m_Objectives[i], 7);
+		rawData+=QString("%1 ").arg(m_Objectives[875-i], 7);
 	}
 	rawData+="\n";
-	for(int i=0; i<m_maxGScore+1;i++)
+	for (int i : qAsConst(columns))
 	{
-		if(m_Objectives[i]+m_Objectives[875-i]>0)
-		{
-			rawData+=QString("%1 %").arg(double(m_Objectives[i])/m_finishedGameCount*100, 6,'f',1);
-			rawData+=QString("%1 %").arg(double(m_Objectives[875-i])/m_finishedGameCount*100, 6,'f',1);
-		}
+		rawData+=QString("%1 %").arg(double(m_Objectives[i])/m_finishedGameCount*100, 6,'f',1);
+		rawData+=QString("%1 %").arg(double(m_Objectives[875-i])/m_finishedGameCount*100, 6,'f',1);
 	}
 	rawData+="\n\n";
 
 	rawData+="By players: \n";
-	rawData+=QString("%1 ").arg("Name", -25);
-	asWhite+=QString("%1 ").arg("Name", -25);
-	asBlack+=QString("%1 ").arg("Name", -25);
+	rawData+=QString("%1 ").arg("Name", -25) + m_objectiveHeader;
+	QString asWhite=QString("As White: \n");
+	asWhite+=QString("%1 ").arg("Name", -25) + m_objectiveHeader;
+	QString asBlack=QString("As Black: \n");
+	asBlack+=QString("%1 ").arg("Name", -25) + m_objectiveHeader;
 
-	for(int i=0; i<m_maxGScore+1;i++)
+	for (int p = 0; p < playerCount(); p++)
 	{
-		if(m_Objectives[i]+m_Objectives[875-i]>0)
+		const TournamentPlayer& player(playerAt(p));
+		ObjectiveRows& rows = m_objectiveRows[p];
+		if (rows.dirty || rows.name != player.name())
 		{
-			rawData+=QString("%1 ").arg(tr("G%1.%2").arg(i/2).arg(5*(i%2)),7);
-			rawData+=QString("%1 ").arg(tr("-G%1.%2").arg(i/2).arg(5*(i%2)),7);
-			asWhite+=QString("%1 ").arg(tr("G%1.%2").arg(i/2).arg(5*(i%2)),7);
-			asWhite+=QString("%1 ").arg(tr("-G%1.%2").arg(i/2).arg(5*(i%2)),7);
-			asBlack+=QString("%1 ").arg(tr("G%1.%2").arg(i/2).arg(5*(i%2)),7);
-			asBlack+=QString("%1 ").arg(tr("-G%1.%2").arg(i/2).arg(5*(i%2)),7);
+			updateObjectiveRows(player, rows);
+			rows.dirty = false;
 		}
+
+		rawData+=rows.all;
+		asWhite+=rows.white;
+		asBlack+=rows.black;
 	}
-	rawData+="\n";
-	asWhite+="\n";
-	asBlack+="\n";
 
-	for (int i = 0; i < playerCount(); i++)
-	{
+	return rawData +"\n"+asWhite+"\n"+asBlack+"\n";
+}
 
-		TournamentPlayer player=playerAt(i);
+void Tournament::updateObjectiveRows(const TournamentPlayer& player,
+				     ObjectiveRows& rows) const
+{
+	rows.name = player.name();
 
-		rawData+=QString("%1 ").arg(player.name(), -25);
+	QString& rawData = rows.all;
+	rawData=QString("%1 ").arg(player.name(), -25);
+	for (int i : qAsConst(m_objectiveColumns))
+	{
+		rawData+=QString("%1 ").arg(player.objectives(i), 7);
+		rawData+=QString("%1 ").arg(player.objectives(875-i), 7);
+	}
+	rawData+="\n";
 
-		for(int i=0; i<m_maxGScore+1;i++)
+	if(player.gamesFinished()>0)
+	{
+		rawData+=QString("%1 ").arg(tr("..."), -25);
+		for (int i : qAsConst(m_objectiveColumns))
 		{
-			if(m_Objectives[i]+m_Objectives[875-i]>0)
-			{
-				rawData+=QString("%1 ").arg(player.objectives(i), 7);
-				rawData+=QString("%1 ").arg(player.objectives(875-i), 7);
-			}
+			rawData+=QString("%1 %").arg(double(player.objectives(i))/player.gamesFinished()*100, 6,'f',1);
+			rawData+=QString("%1 %").arg(double(player.objectives(875-i))/player.gamesFinished()*100, 6,'f',1);
 		}
 		rawData+="\n";
+	}
 
-		if(player.gamesFinished()>0)
-		{
-			rawData+=QString("%1 ").arg(tr("..."), -25);
-			for(int i=0; i<m_maxGScore+1;i++)
-			{
-				if(m_Objectives[i]+m_Objectives[875-i]>0)
-				{
-					rawData+=QString("%1 %").arg(double(player.objectives(i))/player.gamesFinished()*100, 6,'f',1);
-					rawData+=QString("%1 %").arg(double(player.objectives(875-i))/player.gamesFinished()*100, 6,'f',1);
-				}
-			}
-			rawData+="\n";
-		}
-
-		asWhite+=QString("%1 ").arg(player.name(), -25);
+	QString& asWhite = rows.white;
+	asWhite=QString("%1 ").arg(player.name(), -25);
+	for (int i : qAsConst(m_objectiveColumns))
+	{
+		asWhite+=QString("%1 ").arg(player.whiteObjectives(i), 7);
+		asWhite+=QString("%1 ").arg(player.whiteObjectives(875-i), 7);
+	}
+	asWhite+="\n";
 
-		for(int i=0; i<m_maxGScore+1;i++)
+	if(player.nWhiteGames()>0)
+	{
+		asWhite+=QString("%1 ").arg(tr("..."), -25);
+		for (int i : qAsConst(m_objectiveColumns))
 		{
-			if(m_Objectives[i]+m_Objectives[875-i]>0)
-			{
-				asWhite+=QString("%1 ").arg(player.whiteObjectives(i), 7);
-				asWhite+=QString("%1 ").arg(player.whiteObjectives(875-i), 7);
-			}
+			asWhite+=QString("%1 %").arg(double(player.whiteObjectives(i))/player.nWhiteGames()*100, 6,'f',1);
+			asWhite+=QString("%1 %").arg(double(player.whiteObjectives(875-i))/player.nWhiteGames()*100, 6,'f',1);
 		}
 		asWhite+="\n";
+	}
 
-		if(player.nWhiteGames()>0)
-		{
-			asWhite+=QString("%1 ").arg(tr("..."), -25);
-			for(int i=0; i<m_maxGScore+1;i++)
-			{
-				if(m_Objectives[i]+m_Objectives[875-i]>0)
-				{
-					asWhite+=QString("%1 %").arg(double(player.whiteObjectives(i))/player.nWhiteGames()*100, 6,'f',1);
-					asWhite+=QString("%1 %").arg(double(player.whiteObjectives(875-i))/player.nWhiteGames()*100, 6,'f',1);
-				}
-			}
-			asWhite+="\n";
-		}
-
-		asBlack+=QString("%1 ").arg(player.name(), -25);
+	QString& asBlack = rows.black;
+	asBlack=QString("%1 ").arg(player.name(), -25);
+	for (int i : qAsConst(m_objectiveColumns))
+	{
+		asBlack+=QString("%1 ").arg(player.blackObjectives(i), 7);
+		asBlack+=QString("%1 ").arg(player.blackObjectives(875-i), 7);
+	}
+	asBlack+="\n";
 
-		for(int i=0; i<m_maxGScore+1;i++)
+	if(player.gamesFinished()-player.nWhiteGames()>0)
+	{
+		asBlack+=QString("%1 ").arg(tr("..."), -25);
+		for (int i : qAsConst(m_objectiveColumns))
 		{
-			if(m_Objectives[i]+m_Objectives[875-i]>0)
-			{
-				asBlack+=QString("%1 ").arg(player.blackObjectives(i), 7);
-				asBlack+=QString("%1 ").arg(player.blackObjectives(875-i), 7);
-			}
+			asBlack+=QString("%1 %").arg(double(player.blackObjectives(i))/(player.gamesFinished()-player.nWhiteGames())*100, 6,'f',1);
+			asBlack+=QString("%1 %").arg(double(player.whiteObjectives(875-i))/(player.gamesFinished()-player.nWhiteGames())*100, 6,'f',1);
 		}
 		asBlack+="\n";
+	}
+}
 
-		if(player.gamesFinished()-player.nWhiteGames()>0)
-		{
-
-			asBlack+=QString("%1 ").arg(tr("..."), -25);
-			for(int i=0; i<m_maxGScore+1;i++)
-			{
-				if(m_Objectives[i]+m_Objectives[875-i]>0)
-				{
-					asBlack+=QString("%1 %").arg(double(player.blackObjectives(i))/(player.gamesFinished()-player.nWhiteGames())*100, 6,'f',1);
-					asBlack+=QString("%1 %").arg(double(player.whiteObjectives(875-i))/(player.gamesFinished()-player.nWhiteGames())*100, 6,'f',1);
-				}
-			}
-			asBlack+="\n";
-		}
-
-
-
+QString Tournament::results() const
+{
 
+	QString ret;
 
-	}
-	ret+=rawData +"\n"+asWhite+"\n"+asBlack+"\n";
+	ret+=objectiveTables();
 
 	ret+=*((playerCount()==2) ? "Match":"Tournament") +" result: " + Chess::rMobScoringName(m_rMobType) + " Scoring:\n";
 	switch(m_rMobType)
@@ -1439,6 +2025,470 @@ QString Tournament::results() const
 
 }
 
+void Tournament::addSprtResult(int gameNumber, qreal points)
+{
+	if (m_sprt->model() != Sprt::Pentanomial)
+	{
+		m_sprt->addGameResult(points);
+		return;
+	}
+
+	// The two games of an opening pair get consecutive game numbers
+	int pair = (gameNumber - 1) / 2;
+	auto it = m_sprtPairPoints.find(pair);
+	if (it == m_sprtPairPoints.end())
+	{
+		m_sprtPairPoints.insert(pair, points);
+		return;
+	}
+
+	// The other game ended without a result, so this game has no pair
+	if (!std::isnan(it.value()))
+		m_sprt->addGamePair(it.value(), points);
+	m_sprtPairPoints.erase(it);
+}
+
+void Tournament::discardSprtResult(int gameNumber)
+{
+	if (m_sprt->model() != Sprt::Pentanomial)
+		return;
+
+	// A game without a result leaves the other game of its pair alone.
+	// Its result is dropped now, or marked to be dropped when it
+	// arrives, so it doesn't stay in the checkpoint forever.
+	int pair = (gameNumber - 1) / 2;
+	auto it = m_sprtPairPoints.find(pair);
+	if (it == m_sprtPairPoints.end())
+		m_sprtPairPoints.insert(pair, std::numeric_limits<qreal>::quiet_NaN());
+	else
+		m_sprtPairPoints.erase(it);
+}
+
+int Tournament::acquireSlot()
+{
+	for (int i = 0; i < m_busySlots.size(); i++)
+	{
+		if (!m_busySlots.at(i) && !m_pausedSlots.at(i))
+		{
+			m_busySlots[i] = true;
+			return i;
+		}
+	}
+
+	m_busySlots.append(true);
+	m_pausedSlots.append(false);
+	return m_busySlots.size() - 1;
+}
+
+void Tournament::releaseSlot(int slot)
+{
+	if (slot >= 0 && slot < m_busySlots.size())
+		m_busySlots[slot] = false;
+}
+
+void Tournament::addNpsSamples(ChessGame* game, const GameData* data)
+{
+	if (m_npsMonitor->isNull())
+		return;
+
+	for (const auto& side : { Chess::Side::White, Chess::Side::Black })
+	{
+		const ChessPlayer* player = game->player(side);
+		if (player == nullptr)
+			continue;
+
+		int slot = data->slot;
+		int index = (side == Chess::Side::White) ? data->whiteIndex
+							 : data->blackIndex;
+		if (!m_npsMonitor->addSample(index, slot, player->gameNps()))
+			continue;
+
+		qWarning("Slot %d: NPS of %s dropped to %.0f%% of its baseline",
+			 slot + 1,
+			 qUtf8Printable(m_players.at(index).name()),
+			 m_npsMonitor->slotStats(slot).ratio * 100.0);
+
+		// Slots aren't bound to cores, so the best that pausing can
+		// do is to retire the slot and lower the concurrency.
+		int concurrency = m_gameManager->concurrency();
+		if (m_npsMonitor->action() == NpsMonitor::Pause
+		&&  concurrency > 1 && !m_pausedSlots.at(slot))
+		{
+			m_pausedSlots[slot] = true;
+			m_gameManager->setConcurrency(concurrency - 1);
+			qWarning("Slot %d paused, concurrency reduced to %d",
+				 slot + 1, concurrency - 1);
+		}
+	}
+}
+
+QString Tournament::npsStatistics() const
+{
+	if (m_npsMonitor->isNull())
+		return QString();
+
+	QString ret;
+	for (int i = 0; i < m_npsMonitor->playerCount() && i < m_players.size(); i++)
+	{
+		const NpsMonitor::PlayerStats stats(m_npsMonitor->playerStats(i));
+		if (stats.count == 0)
+			continue;
+
+		if (ret.isEmpty())
+		{
+			ret = tr("Search speed:\n");
+			ret += QString("%1 %2 %3 %4 %5 %6 %7\n")
+				.arg("Name", -25)
+				.arg("Games", 6)
+				.arg("Baseline", 10)
+				.arg("Mean", 10)
+				.arg("StDev", 10)
+				.arg("Min", 10)
+				.arg("Max", 10);
+		}
+
+		ret += QString("%1 %2 %3 %4 %5 %6 %7\n")
+			.arg(m_players.at(i).name(), -25)
+			.arg(stats.count, 6)
+			.arg(stats.baseline, 10, 'f', 0)
+			.arg(stats.mean, 10, 'f', 0)
+			.arg(stats.stdev, 10, 'f', 0)
+			.arg(stats.min, 10, 'f', 0)
+			.arg(stats.max, 10, 'f', 0);
+	}
+	if (ret.isEmpty())
+		return ret;
+
+	for (int i = 0; i < m_npsMonitor->slotCount(); i++)
+	{
+		const NpsMonitor::SlotStats stats(m_npsMonitor->slotStats(i));
+		if (stats.count == 0)
+			continue;
+
+		ret += tr("Slot %1: %2 samples, mean %3%, current %4%%5\n")
+			.arg(i + 1)
+			.arg(stats.count)
+			.arg(stats.meanRatio * 100.0, 0, 'f', 1)
+			.arg(stats.ratio * 100.0, 0, 'f', 1)
+			.arg(i < m_pausedSlots.size() && m_pausedSlots.at(i)
+			     ? tr(" (paused)") : QString());
+	}
+
+	return ret;
+}
+
+void Tournament::setRatingsEnabled(bool enabled)
+{
+	m_ratingsEnabled = enabled;
+}
+
+bool Tournament::ratingsEnabled() const
+{
+	return m_ratingsEnabled;
+}
+
+QString Tournament::ratingTable() const
+{
+	return m_ratingTable;
+}
+
+void Tournament::waitForRatings()
+{
+	updateRatings(true);
+	while (m_ratingsBusy)
+	{
+		m_ratingPool->waitForDone();
+		onRatingsFitted();
+		updateRatings(true);
+	}
+}
+
+void Tournament::updateRatings(bool force)
+{
+	if (!m_ratingsEnabled || m_ratingsBusy
+	||  m_ratingSolver->gameCount() == m_ratingGameCount)
+		return;
+
+	// While the games are running the fits are spaced out, so that
+	// the solver is idle most of the time. The games that finish in
+	// between are included in the next fit.
+	if (!force && m_ratingTimer.isValid()
+	&&  m_ratingTimer.elapsed() < qMax(s_minRatingInterval,
+					   s_ratingIntervalFactor * m_ratingFitTime))
+		return;
+
+	// The fit works on a copy of the results, so the tournament can
+	// keep adding games while it runs
+	RatingSolver* solver = new RatingSolver(*m_ratingSolver);
+	QStringList names;
+	for (const TournamentPlayer& player : qAsConst(m_players))
+		names << player.name();
+
+	m_ratingsBusy = true;
+	m_ratingTimer.start();
+	m_ratingPool->start(new FunctionTask([=]()
+	{
+		const QString table = formatRatingTable(*solver, names);
+		const int gameCount = solver->gameCount();
+		QVector<qreal> elo(solver->playerCount());
+		for (int i = 0; i < elo.size(); i++)
+			elo[i] = solver->rating(i).elo;
+		delete solver;
+
+		QMutexLocker locker(&m_ratingMutex);
+		m_fittedTable = table;
+		m_fittedGameCount = gameCount;
+		m_fittedRatings = elo;
+		m_ratingsFitted = true;
+		QMetaObject::invokeMethod(this, "onRatingsFitted",
+					  Qt::QueuedConnection);
+	}));
+}
+
+void Tournament::onRatingsFitted()
+{
+	{
+		QMutexLocker locker(&m_ratingMutex);
+		if (!m_ratingsFitted)
+			return;
+		m_ratingTable = m_fittedTable;
+		m_ratingGameCount = m_fittedGameCount;
+		// The next fit starts from this solution
+		m_ratingSolver->setInitialRatings(m_fittedRatings);
+		m_ratingsFitted = false;
+	}
+	m_ratingsBusy = false;
+	m_ratingFitTime = m_ratingTimer.elapsed();
+
+	emit ratingTableChanged();
+
+	// Games that finished during the fit
+	updateRatings();
+}
+
+QString Tournament::formatRatingTable(RatingSolver& solver,
+				      const QStringList& names)
+{
+	if (solver.gameCount() == 0)
+		return QString();
+
+	if (!solver.solve())
+		qWarning("The maximum likelihood ratings did not converge");
+
+	QVector<int> order;
+	for (int i = 0; i < names.size(); i++)
+	{
+		if (solver.rating(i).games > 0)
+			order << i;
+	}
+	std::stable_sort(order.begin(), order.end(), [&](int a, int b)
+	{
+		return solver.rating(a).elo > solver.rating(b).elo;
+	});
+
+	QString ret;
+	if (solver.bootstrapCount() > 0)
+		ret = tr("Maximum likelihood ratings after %1 games "
+			 "(%2% confidence):\n")
+			.arg(solver.gameCount())
+			.arg(solver.confidence() * 100.0, 0, 'f', 0);
+	else
+		ret = tr("Maximum likelihood ratings after %1 games:\n")
+			.arg(solver.gameCount());
+	ret += QString("%1 %2 %3 %4 %5 %6 %7\n")
+		.arg("Rank", 4)
+		.arg("Name", -25)
+		.arg("Elo", 7)
+		.arg("Lower", 7)
+		.arg("Upper", 7)
+		.arg("Games", 7)
+		.arg("Score", 7);
+
+	int rank = 0;
+	for (int i : qAsConst(order))
+	{
+		const RatingSolver::Rating rating(solver.rating(i));
+		ret += QString("%1 %2 %3 %4 %5 %6 %7%\n")
+			.arg(++rank, 4)
+			.arg(names.at(i), -25)
+			.arg(rating.elo, 7, 'f', 0)
+			.arg(rating.lowerBound, 7, 'f', 0)
+			.arg(rating.upperBound, 7, 'f', 0)
+			.arg(rating.games, 7)
+			.arg(rating.points / rating.games * 100.0, 6, 'f', 1);
+	}
+
+	return ret;
+}
+
+namespace {
+
+// The G-score histogram columns that have games, with the counts of
+// the two sides given by \a count
+template<typename Count>
+QVariantList objectiveList(const QVector<int>& columns,
+			   const QString& first,
+			   const QString& second,
+			   Count count)
+{
+	QVariantList list;
+	for (int i : columns)
+	{
+		QVariantMap column;
+		column["g"] = i / 2.0;
+		column[first] = count(i);
+		column[second] = count(875 - i);
+		list.append(column);
+	}
+
+	return list;
+}
+
+} // anonymous namespace
+
+QVariantMap Tournament::statistics() const
+{
+	QVariantMap stats;
+	stats["type"] = type();
+	stats["name"] = m_name;
+	stats["variant"] = m_variant;
+	stats["scoring"] = Chess::rMobScoringName(m_rMobType);
+	stats["finishedGames"] = m_finishedGameCount;
+	stats["finalGames"] = m_finalGameCount;
+	stats["gamesInProgress"] = m_gameData.size();
+
+	const qint64 elapsed = m_elapsedTimer.isValid() ? m_elapsedTimer.elapsed() : 0;
+	stats["gamesPerSecond"] = elapsed > 0
+		? (m_finishedGameCount - m_startGameCount) * 1000.0 / elapsed
+		: 0.0;
+	stats["averagePlies"] = m_finishedGameCount > 0
+		? double(m_plyCount) / m_finishedGameCount
+		: 0.0;
+
+	QVector<int> columns;
+	for (int i = 0; i < m_maxGScore + 1; i++)
+	{
+		if (m_Objectives[i] + m_Objectives[875 - i] > 0)
+			columns << i;
+	}
+	stats["objectives"] = objectiveList(columns, "white", "black",
+		[this](int i) { return m_Objectives[i]; });
+
+	int timeLosses = 0;
+	QVariantList players;
+	for (const TournamentPlayer& player : m_players)
+	{
+		QVariantMap points;
+		points["classical"] = player.points<Chess::Classical>();
+		points["exponential"] = player.points<Chess::Exponential>();
+		points["harmonic"] = player.points<Chess::Harmonic>();
+		points["allOrNone"] = player.points<Chess::AllOrNone>();
+		points["komi"] = player.points<Chess::Komi>();
+
+		QVariantMap map;
+		map["name"] = player.name();
+		map["games"] = player.gamesFinished();
+		map["wins"] = player.wins<Chess::Classical>();
+		map["losses"] = player.losses<Chess::Classical>();
+		map["draws"] = player.draws<Chess::Classical>();
+		map["timeLosses"] = player.timeLosses();
+		map["points"] = points;
+		map["objectives"] = objectiveList(columns, "for", "against",
+			[&player](int i) { return player.objectives(i); });
+		players.append(map);
+
+		timeLosses += player.timeLosses();
+	}
+	stats["players"] = players;
+	stats["timeLosses"] = timeLosses;
+
+	if (!m_sprt->isNull())
+	{
+		const Sprt::Status status = m_sprt->status();
+		QVariantMap sprt;
+		sprt["llr"] = status.llr;
+		sprt["lowerBound"] = status.lBound;
+		sprt["upperBound"] = status.uBound;
+		if (status.result == Sprt::AcceptH0)
+			sprt["result"] = "H0";
+		else if (status.result == Sprt::AcceptH1)
+			sprt["result"] = "H1";
+		else
+			sprt["result"] = "continue";
+		stats["sprt"] = sprt;
+	}
+
+	return stats;
+}
+
+bool Tournament::writeStats() const
+{
+	QSaveFile file(m_statsFile);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+	{
+		qWarning("Cannot open statistics file %s",
+			 qUtf8Printable(m_statsFile));
+		return false;
+	}
+
+	QTextStream out(&file);
+	JsonSerializer serializer(statistics());
+	if (!serializer.serialize(out))
+	{
+		qWarning("Cannot serialize statistics: %s",
+			 qUtf8Printable(serializer.errorString()));
+		file.cancelWriting();
+		return false;
+	}
+	out.flush();
+
+	if (!file.commit())
+	{
+		qWarning("Cannot write statistics file %s",
+			 qUtf8Printable(m_statsFile));
+		return false;
+	}
+
+	return true;
+}
+
+QString Tournament::resourceUsage() const
+{
+	QString ret;
+
+	for (const TournamentPlayer& player : m_players)
+	{
+		const ProcessUsage& usage = player.processUsage();
+		if (usage.isNull())
+			continue;
+
+		if (ret.isEmpty())
+		{
+			ret = tr("Resource usage:\n");
+			ret += QString("%1 %2 %3 %4 %5 %6 %7\n")
+				.arg("Name", -25)
+				.arg("CPU(s)", 10)
+				.arg("Think(s)", 10)
+				.arg("CPU/wall", 8)
+				.arg("MaxRSS(MB)", 10)
+				.arg("VolCS", 10)
+				.arg("InvolCS", 10);
+		}
+
+		qint64 thinkTime = player.processUsageTime();
+		ret += QString("%1 %2 %3 %4 %5 %6 %7\n")
+			.arg(player.name(), -25)
+			.arg(usage.cpuTime() / 1000.0, 10, 'f', 1)
+			.arg(thinkTime / 1000.0, 10, 'f', 1)
+			.arg(thinkTime > 0 ? double(usage.cpuTime()) / thinkTime : 0.0, 8, 'f', 2)
+			.arg(usage.residentSize() / 1024.0, 10, 'f', 1)
+			.arg(usage.voluntarySwitches(), 10)
+			.arg(usage.involuntarySwitches(), 10);
+	}
+
+	return ret;
+}
+
 
 ResultFormatter::ResultFormatter::ResultFormatter(const QMap<QString, int>& tokenMap,
 						  const QString& format,
@@ -1567,3 +2617,24 @@ qreal Tournament::playerPoints(int player) const
 	}
 }
 
+qreal Tournament::playerSquarePoints(int player) const
+{
+	switch(rMobType())
+	{
+	case Chess::Classical:
+		return playerAt(player).squarePoints<Chess::Classical>();
+
+	case Chess::Harmonic:
+		return playerAt(player).squarePoints<Chess::Harmonic>();
+
+	case Chess::AllOrNone:
+		return playerAt(player).squarePoints<Chess::AllOrNone>();
+
+	case Chess::Komi:
+		return playerAt(player).squarePoints<Chess::Komi>();
+
+	default:
+		return playerAt(player).squarePoints<Chess::Exponential>();
+	}
+}
+
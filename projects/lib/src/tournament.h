@@ -23,8 +23,11 @@
 #include <QList>
 #include <QVector>
 #include <QMap>
+#include <QVariant>
+#include <QElapsedTimer>
 #include <QFile>
 #include <QTextStream>
+#include <QMutex>
 #include "board/move.h"
 #include "timecontrol.h"
 #include "pgngame.h"
@@ -37,6 +40,11 @@ class ChessGame;
 class OpeningBook;
 class OpeningSuite;
 class Sprt;
+class NpsMonitor;
+class RatingSolver;
+class GameWriter;
+class QDataStream;
+class QThreadPool;
 
 /*!
  * \brief Base class for chess tournaments
@@ -108,6 +116,12 @@ class LIB_EXPORT Tournament : public QObject
 		 * The default value is 1.
 		 */
 		int roundMultiplier() const;
+		/*!
+		 * Returns the number of times each opening is played.
+		 *
+		 * \sa setOpeningRepetitions()
+		 */
+		int openingRepetitions() const;
 		/*! Returns the number of games finished so far. */
 		int finishedGameCount() const;
 		/*! Returns the total number of games that will be played. */
@@ -128,6 +142,42 @@ class LIB_EXPORT Tournament : public QObject
 		 * stopping criterion.
 		 */
 		Sprt* sprt() const;
+		/*!
+		 * Returns the NPS monitor of this tournament.
+		 *
+		 * Initializing \a npsMonitor makes this tournament track the
+		 * search speed of the players in each concurrency slot.
+		 * The slots are logical game indexes, not CPU cores.
+		 */
+		NpsMonitor* npsMonitor() const;
+		/*!
+		 * Returns the rating solver of this tournament.
+		 *
+		 * The solver receives the points of every finished game
+		 * under the tournament's r-Mobility scoring.
+		 *
+		 * \sa ratingTable()
+		 */
+		RatingSolver* ratingSolver() const;
+		/*!
+		 * Enables or disables the maximum likelihood rating table.
+		 *
+		 * When enabled, the ratings are fitted again in a background
+		 * thread after games finish, and ratingTableChanged() is
+		 * emitted when a new table is ready. The fit uses the thread
+		 * count of ratingSolver(). While the games are running, the
+		 * fits are at least 10 seconds apart. Disabled by default.
+		 */
+		void setRatingsEnabled(bool enabled);
+		/*! Returns true if the rating table is enabled. */
+		bool ratingsEnabled() const;
+		/*!
+		 * Returns the writer of the PGN and EPD output files.
+		 *
+		 * The games are written on a separate thread, in the order
+		 * of their game numbers.
+		 */
+		GameWriter* gameWriter() const;
 
 		/*! Sets the tournament's name to \a name. */
 		void setName(const QString& name);
@@ -206,6 +256,15 @@ class LIB_EXPORT Tournament : public QObject
 		 */
 		void setPgnCleanupEnabled(bool enabled);
 
+		/*!
+		 * Sets CPU usage comments in the PGN output to \a enabled.
+		 *
+		 * If \a enabled is true then each engine move's comment
+		 * includes the ratio of the engine's CPU time to its
+		 * wall-clock thinking time. The default is false.
+		 */
+		void setPgnCpuUsage(bool enabled);
+
 		/*!
 		 * Sets the EPD output file for the end positions to \a fileName.
 		 *
@@ -260,6 +319,55 @@ class LIB_EXPORT Tournament : public QObject
 		 * swap sides for the following game.
 		 */
 		void setSwapSides(bool enabled);
+		/*!
+		 * Sets the pair scheduling flag to \a enabled.
+		 *
+		 * If \a enabled is true then all games of a repeated opening
+		 * (see \a setOpeningRepetitions()) are started together, and
+		 * only when there are enough free game slots for all of them.
+		 * A group of games never has games of two openings, and it
+		 * is limited by the concurrency and by the remaining games.
+		 * This keeps the games of an opening pair close to each other
+		 * in the results and in the PGN output. The default is false.
+		 */
+		void setPairScheduling(bool enabled);
+		/*!
+		 * Writes a checkpoint of the tournament to \a fileName after
+		 * every \a interval finished games.
+		 *
+		 * The checkpoint holds the scores, the pairing schedule, the
+		 * position in the opening suite, the state of the random
+		 * number generator and the games in progress. The file is
+		 * replaced atomically, so it always holds a complete
+		 * checkpoint.
+		 *
+		 * \sa setResumeFile()
+		 */
+		void setCheckpoint(const QString& fileName, int interval);
+		/*!
+		 * Makes the tournament continue from checkpoint \a fileName
+		 * when it's started.
+		 *
+		 * The tournament must have the same type, players and
+		 * settings as the tournament that wrote the checkpoint. The
+		 * games that were in progress at the time of the checkpoint
+		 * are played again before any new games. The PGN and EPD
+		 * output files are truncated to their size at the time of
+		 * the checkpoint, so the games that finished after it
+		 * aren't written twice.
+		 */
+		void setResumeFile(const QString& fileName);
+		/*!
+		 * Writes a snapshot of the tournament statistics to
+		 * \a fileName in JSON format after every \a interval
+		 * finished games, and when the tournament finishes.
+		 *
+		 * The file is replaced atomically, so a reader always
+		 * sees a complete snapshot.
+		 *
+		 * \sa statistics()
+		 */
+		void setStatsOutput(const QString& fileName, int interval);
 		/*!
 		 * The \a format specifies which information are listed in the
 		 * table of tournament results. Available tokens are given by
@@ -297,6 +405,48 @@ class LIB_EXPORT Tournament : public QObject
 		 * The default implementation works for most tournament types.
 		 */
 		virtual QString results() const;
+		/*!
+		 * Returns a summary of the resources (CPU time, memory and
+		 * context switches) used by each player's engine process.
+		 *
+		 * Returns an empty string if no resource usage was recorded.
+		 */
+		QString resourceUsage() const;
+		/*!
+		 * Returns the NPS distribution of each player and the
+		 * relative speed of each concurrency slot.
+		 *
+		 * Returns an empty string if the NPS monitor is not in use
+		 * or if no player reported its search speed.
+		 */
+		QString npsStatistics() const;
+		/*!
+		 * Returns the maximum likelihood ratings of the last finished
+		 * background fit as a table sorted by rating.
+		 *
+		 * The table may lag behind the latest games while a fit is
+		 * running. Returns an empty string if the table is disabled
+		 * or no fit has finished yet.
+		 *
+		 * \sa setRatingsEnabled(), waitForRatings()
+		 */
+		QString ratingTable() const;
+		/*!
+		 * Blocks until the rating table includes every finished
+		 * game.
+		 */
+		void waitForRatings();
+		/*!
+		 * Returns the statistics of the tournament as a map that
+		 * can be serialized to JSON.
+		 *
+		 * The map holds the points of every player under all
+		 * r-Mobility scoring schemes, the G-score histograms of the
+		 * tournament and of each player, the SPRT state, the game
+		 * rate, the average game length and the number of games
+		 * lost on time.
+		 */
+		QVariantMap statistics() const;
 
 		void setDefaultKomi(Chess::rMobKomi komi);
 
@@ -358,6 +508,13 @@ class LIB_EXPORT Tournament : public QObject
 		 * is sent.
 		 */
 		void finished();
+		/*!
+		 * This signal is emitted when a background fit has updated
+		 * the rating table.
+		 *
+		 * \sa ratingTable()
+		 */
+		void ratingTableChanged();
 
 
 
@@ -406,6 +563,23 @@ class LIB_EXPORT Tournament : public QObject
 		 * immediately afterwards.
 		 */
 		virtual void initializePairing() = 0;
+		/*!
+		 * Writes the state of the pairings to \a out.
+		 *
+		 * Subclasses that keep their own pairing state must
+		 * reimplement this function and readPairingState().
+		 * The default implementation writes nothing.
+		 */
+		virtual void writePairingState(QDataStream& out) const;
+		/*!
+		 * Reads the state of the pairings from \a in when the
+		 * tournament is resumed from a checkpoint. This function
+		 * is called after initializePairing().
+		 *
+		 * Returns false if the data is invalid. The default
+		 * implementation reads nothing and returns true.
+		 */
+		virtual bool readPairingState(QDataStream& in);
 		/*!
 		 * Returns the number of games in one tournament cycle.
 		 *
@@ -459,6 +633,11 @@ class LIB_EXPORT Tournament : public QObject
 		virtual bool hasGauntletRatingsOrder() const;
 
 		qreal playerPoints(int player) const;
+		/*!
+		 * Returns the sum of the squared points of player \a player
+		 * with the tournament's scoring.
+		 */
+		qreal playerSquarePoints(int player) const;
 
 
 
@@ -474,6 +653,7 @@ class LIB_EXPORT Tournament : public QObject
 		void onGameFinished(ChessGame* game);
 		void onGameDestroyed(ChessGame* game);
 		void onGameStartFailed(ChessGame* game);
+		void onRatingsFitted();
 
 	private:
 		/*! Output field identifier */
@@ -565,6 +745,13 @@ class LIB_EXPORT Tournament : public QObject
 			int number;
 			int whiteIndex;
 			int blackIndex;
+			int slot;
+			// The opening, so that the game can be replayed
+			// when the tournament is resumed
+			int round;
+			QString startFen;
+			QVector<Chess::Move> openingMoves;
+			Chess::rMobKomi komi;
 		};
 
 
@@ -623,12 +810,72 @@ class LIB_EXPORT Tournament : public QObject
 		};
 
 
+		/*!
+		 * A cached row in the standings table of one scoring scheme.
+		 *
+		 * Rows are updated only when the player has new results, and
+		 * formatted again only when the data or the rank changes.
+		 */
+		struct StandingsRow
+		{
+			bool dirty;
+			QString name;
+			qreal key;
+			int rank;
+			QMap<int, QString> fields;
+			QString text;
+		};
+
+		/*! Live standings of one scoring scheme. */
+		struct Standings
+		{
+			QVector<StandingsRow> rows;
+			QVector<int> order;
+			QString format;
+		};
+
+		/*! Cached rows of a player in the r-Mobility objective tables. */
+		struct ObjectiveRows
+		{
+			bool dirty;
+			QString name;
+			QString all;
+			QString white;
+			QString black;
+		};
+
 		template<Chess::rMobScoring>
 		QString resultsForSides() const;
+		template<Chess::rMobScoring>
+		void updateStandingsRow(int index, StandingsRow& row) const;
+		template<Chess::rMobScoring>
+		QString standingsTable() const;
+		void invalidateStandings(int player);
+		QString objectiveTables() const;
+		void updateObjectiveRows(const TournamentPlayer& player,
+					 ObjectiveRows& rows) const;
 
 		template<Chess::rMobScoring>
 		QString subResults() const;
 
+		int openingGroupSize() const;
+		bool startPendingGame();
+		ChessGame* createGame(const TournamentPlayer& white,
+				      const TournamentPlayer& black);
+		void enqueueGame(ChessGame* game, GameData* data);
+		void startResumedGame(const GameData& resumed);
+		bool writeCheckpoint();
+		bool writeStats() const;
+		bool readCheckpoint(const QString& fileName);
+		void addSprtResult(int gameNumber, qreal points);
+		void discardSprtResult(int gameNumber);
+		int acquireSlot();
+		void releaseSlot(int slot);
+		void addNpsSamples(ChessGame* game, const GameData* data);
+		void updateRatings(bool force = false);
+		static QString formatRatingTable(RatingSolver& solver,
+						 const QStringList& names);
+
 		GameManager* m_gameManager;
 		ChessGame* m_lastGame;
 		QString m_error;
@@ -652,25 +899,57 @@ class LIB_EXPORT Tournament : public QObject
 		bool m_recover;
 		bool m_pgnCleanup;
 		bool m_pgnWriteUnfinishedGames;
+		bool m_pgnCpuUsage;
 		bool m_finished;
 		bool m_bookOwnership;
 		GameAdjudicator m_adjudicator;
 		OpeningSuite* m_openingSuite;
 		Sprt* m_sprt;
-		QFile m_pgnFile;
-		QTextStream m_pgnOut;
-		QFile m_epdFile;
-		QTextStream m_epdOut;
+		NpsMonitor* m_npsMonitor;
+		RatingSolver* m_ratingSolver;
+		bool m_ratingsEnabled;
+		bool m_ratingsBusy;
+		int m_ratingGameCount;
+		QElapsedTimer m_ratingTimer;
+		qint64 m_ratingFitTime;
+		QString m_ratingTable;
+		QThreadPool* m_ratingPool;
+		QMutex m_ratingMutex;
+		bool m_ratingsFitted;
+		int m_fittedGameCount;
+		QVector<qreal> m_fittedRatings;
+		QString m_fittedTable;
+		QVector<bool> m_busySlots;
+		QVector<bool> m_pausedSlots;
+		QMap<int, qreal> m_sprtPairPoints;
+		QString m_checkpointFile;
+		int m_checkpointInterval;
+		QString m_resumeFile;
+		QList<GameData> m_resumedGames;
+		QString m_statsFile;
+		int m_statsInterval;
+		qint64 m_plyCount;
+		int m_startGameCount;
+		QElapsedTimer m_elapsedTimer;
+		GameWriter* m_gameWriter;
+		QString m_pgnFileName;
+		QString m_epdFileName;
 		QString m_startFen;
 		int m_repetitionCounter;
 		int m_swapSides;
 		bool m_reverseSides;
+		bool m_pairScheduling;
 		Chess::rMobKomi m_defaultKomi;
 		bool m_isLegacy;
 		Chess::rMobKomi m_komi;
 
 		int m_maxGScore;
 		int m_Objectives[876];
+		// One entry for each Chess::rMobScoring scheme
+		mutable Standings m_standings[5];
+		mutable QVector<ObjectiveRows> m_objectiveRows;
+		mutable QVector<int> m_objectiveColumns;
+		mutable QString m_objectiveHeader;
 
 
 		QString m_resultFormat;
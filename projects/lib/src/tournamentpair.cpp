@@ -18,6 +18,7 @@
 
 #include "tournamentpair.h"
 #include <algorithm>
+#include <QDataStream>
 
 
 TournamentPair::TournamentPair(int firstPlayer,
@@ -133,3 +134,39 @@ void TournamentPair::swapPlayers()
 	std::swap(m_first, m_second);
 	m_hasOriginalOrder = !m_hasOriginalOrder;
 }
+
+void TournamentPair::write(QDataStream& out) const
+{
+	out << qint32(m_first.index) << m_first.score
+	    << qint32(m_second.index) << m_second.score
+	    << qint32(m_gamesStarted) << m_hasOriginalOrder;
+}
+
+bool TournamentPair::read(QDataStream& in)
+{
+	qint32 first;
+	qint32 second;
+	qint32 gamesStarted;
+	Player firstPlayer;
+	Player secondPlayer;
+	bool hasOriginalOrder;
+
+	in >> first >> firstPlayer.score
+	   >> second >> secondPlayer.score
+	   >> gamesStarted >> hasOriginalOrder;
+	firstPlayer.index = first;
+	secondPlayer.index = second;
+
+	if (in.status() != QDataStream::Ok)
+		return false;
+	if (!((first == m_first.index && second == m_second.index)
+	||    (first == m_second.index && second == m_first.index)))
+		return false;
+
+	m_first = firstPlayer;
+	m_second = secondPlayer;
+	m_gamesStarted = gamesStarted;
+	m_hasOriginalOrder = hasOriginalOrder;
+
+	return true;
+}
@@ -20,6 +20,7 @@
 #define TOURNAMENTPAIR_H
 
 #include <QObject>
+class QDataStream;
 /*!
  * \brief A single encounter in a tournament
  *
@@ -113,6 +114,16 @@ class LIB_EXPORT TournamentPair
 		 */
 		void swapPlayers();
 
+		/*! Writes the state of the pair to \a out. */
+		void write(QDataStream& out) const;
+		/*!
+		 * Reads the state of the pair from \a in.
+		 *
+		 * Returns false if the state doesn't belong to a pair with
+		 * the same players.
+		 */
+		bool read(QDataStream& in);
+
 	private:
 		struct Player
 		{
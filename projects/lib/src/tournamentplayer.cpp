@@ -18,6 +18,7 @@
 
 #include "tournamentplayer.h"
 #include <cmath>
+#include <QDataStream>
 
 
 TournamentPlayer::TournamentPlayer(PlayerBuilder* builder,
@@ -30,6 +31,7 @@ TournamentPlayer::TournamentPlayer(PlayerBuilder* builder,
 	  m_bookDepth(bookDepth),
 	  m_games(0),
 	  m_whiteGames(0),
+	  m_timeLosses(0),
 	  m_classicalWins(0),
 	  m_classicalLosses(0),
 	  m_whiteClassicalWins(0),
@@ -49,7 +51,8 @@ TournamentPlayer::TournamentPlayer(PlayerBuilder* builder,
 	  m_harmonicPoints(0),
 	  m_whiteHarmonicPoints(0),
 	  m_squareHarmonicPoints(0),
-	  m_whiteSquareHarmonicPoints(0)
+	  m_whiteSquareHarmonicPoints(0),
+	  m_processUsageTime(0)
 {
 	Q_ASSERT(builder != nullptr);
 	for(int i=0;i<876;i++)
@@ -357,6 +360,35 @@ int TournamentPlayer::gamesFinished() const
 	return m_games;
 }
 
+void TournamentPlayer::addTimeLoss()
+{
+	m_timeLosses++;
+}
+
+int TournamentPlayer::timeLosses() const
+{
+	return m_timeLosses;
+}
+
+void TournamentPlayer::addProcessUsage(const ProcessUsage& usage, qint64 thinkTime)
+{
+	if (usage.isNull())
+		return;
+
+	m_processUsage += usage;
+	m_processUsageTime += thinkTime;
+}
+
+const ProcessUsage& TournamentPlayer::processUsage() const
+{
+	return m_processUsage;
+}
+
+qint64 TournamentPlayer::processUsageTime() const
+{
+	return m_processUsageTime;
+}
+
 template<Chess::rMobScoring rMobType>
 int TournamentPlayer::wins() const
 {
@@ -527,3 +559,78 @@ int TournamentPlayer::blackObjectives(int i) const
 	return m_Objectives[i]-m_whiteObjectives[i];
 }
 
+
+void TournamentPlayer::write(QDataStream& out) const
+{
+	out << name();
+
+	for (int i = 0; i < 876; i++)
+		out << qint32(m_Objectives[i]) << qint32(m_whiteObjectives[i]);
+
+	out << qint32(m_games) << qint32(m_whiteGames) << qint32(m_timeLosses)
+	    << qint32(m_classicalWins) << qint32(m_classicalLosses)
+	    << qint32(m_whiteClassicalWins) << qint32(m_whiteClassicalLosses)
+	    << qint32(m_rMobWins) << qint32(m_rMobLosses)
+	    << qint32(m_whiteRMobWins) << qint32(m_whiteRMobLosses)
+	    << qint32(m_komiWins) << qint32(m_komiLosses)
+	    << qint32(m_whiteKomiWins) << qint32(m_whiteKomiLosses);
+
+	out << m_exponentialPoints << m_whiteExponentialPoints
+	    << m_squareExponentialPoints << m_whiteSquareExponentialPoints
+	    << m_harmonicPoints << m_whiteHarmonicPoints
+	    << m_squareHarmonicPoints << m_whiteSquareHarmonicPoints;
+}
+
+bool TournamentPlayer::read(QDataStream& in)
+{
+	QString playerName;
+	in >> playerName;
+
+	qint32 values[2 * 876 + 15];
+	for (qint32& value : values)
+		in >> value;
+
+	qreal points[8];
+	for (qreal& value : points)
+		in >> value;
+
+	if (in.status() != QDataStream::Ok)
+		return false;
+
+	const qint32* value = values;
+	for (int i = 0; i < 876; i++)
+	{
+		m_Objectives[i] = *value++;
+		m_whiteObjectives[i] = *value++;
+	}
+
+	m_games = *value++;
+	m_whiteGames = *value++;
+	m_timeLosses = *value++;
+	m_classicalWins = *value++;
+	m_classicalLosses = *value++;
+	m_whiteClassicalWins = *value++;
+	m_whiteClassicalLosses = *value++;
+	m_rMobWins = *value++;
+	m_rMobLosses = *value++;
+	m_whiteRMobWins = *value++;
+	m_whiteRMobLosses = *value++;
+	m_komiWins = *value++;
+	m_komiLosses = *value++;
+	m_whiteKomiWins = *value++;
+	m_whiteKomiLosses = *value++;
+
+	m_exponentialPoints = points[0];
+	m_whiteExponentialPoints = points[1];
+	m_squareExponentialPoints = points[2];
+	m_whiteSquareExponentialPoints = points[3];
+	m_harmonicPoints = points[4];
+	m_whiteHarmonicPoints = points[5];
+	m_squareHarmonicPoints = points[6];
+	m_whiteSquareHarmonicPoints = points[7];
+
+	if (!playerName.isEmpty())
+		setName(playerName);
+
+	return true;
+}
@@ -23,8 +23,10 @@
 #include "timecontrol.h"
 #include "board/side.h"
 #include "board/result.h"
+#include "processusage.h"
 
 class OpeningBook;
+class QDataStream;
 
 
 /*! \brief A class for storing a player's tournament-specific details. */
@@ -91,6 +93,38 @@ class LIB_EXPORT TournamentPlayer
 
 
 		int gamesFinished() const;
+		/*! Adds a game lost on time to the player's record. */
+		void addTimeLoss();
+		/*! Returns the number of games the player has lost on time. */
+		int timeLosses() const;
+
+		/*!
+		 * Adds \a usage to the player's resource usage. \a thinkTime
+		 * is the wall-clock thinking time in milliseconds during which
+		 * the resources were used.
+		 */
+		void addProcessUsage(const ProcessUsage& usage, qint64 thinkTime);
+		/*! Returns the resources used by the player's engine process. */
+		const ProcessUsage& processUsage() const;
+		/*!
+		 * Returns the wall-clock thinking time in milliseconds that
+		 * corresponds to processUsage().
+		 */
+		qint64 processUsageTime() const;
+
+		/*!
+		 * Writes the player's name and score accumulators to \a out.
+		 *
+		 * The builder, time control, opening book and resource
+		 * usage are not written.
+		 */
+		void write(QDataStream& out) const;
+		/*!
+		 * Reads the player's name and score accumulators from \a in.
+		 *
+		 * Returns false if the data is invalid.
+		 */
+		bool read(QDataStream& in);
 
 
 	private:
@@ -103,6 +137,7 @@ class LIB_EXPORT TournamentPlayer
 		int m_whiteObjectives[876];
 		int m_games;
 		int m_whiteGames;
+		int m_timeLosses;
 
 		int m_classicalWins;
 		int m_classicalLosses;
@@ -134,6 +169,8 @@ class LIB_EXPORT TournamentPlayer
 		qreal m_squareHarmonicPoints;
 		qreal m_whiteSquareHarmonicPoints;
 
+		ProcessUsage m_processUsage;
+		qint64 m_processUsageTime;
 };
 
 #endif // TOURNAMENTPLAYER_H
@@ -17,6 +17,8 @@ class tst_Board: public QObject
 		
 		void moveStrings_data() const;
 		void moveStrings();
+		void invalidMoveStrings_data() const;
+		void invalidMoveStrings();
 		
 		void results_data() const;
 		void results();
@@ -193,6 +195,11 @@ void tst_Board::moveStrings_data() const
 		<< "Qf6"
 		<< "3r1rk1/6q1/1p1pb2p/p1p2np1/P1P2p2/1PNP4/1Q2PPBP/1R2R2K b - - 2 1"
 		<< "3r1rk1/8/1p1pbq1p/p1p2np1/P1P2p2/1PNP4/1Q2PPBP/1R2R2K w - - 3 2";
+	QTest::newRow("san4")
+		<< "standard"
+		<< "Ne4 Kd7 Kf2"
+		<< "4k3/8/8/8/1b6/2N3N1/8/4K3 w - - 0 1 G218.0"
+		<< "8/3k4/8/8/1b2N3/2N5/5K2/8 b - - 3 2 G218.0";
 	QTest::newRow("coord3")
 		<< "standard"
 		<< "g7f6"
@@ -610,6 +617,41 @@ void tst_Board::moveStrings()
 		QCOMPARE(m_board->fenString(), endfen);
 }
 
+void tst_Board::invalidMoveStrings_data() const
+{
+	QTest::addColumn<QString>("variant");
+	QTest::addColumn<QString>("fen");
+	QTest::addColumn<QString>("move");
+
+	QTest::newRow("ambiguous knight")
+		<< "standard"
+		<< "4k3/8/8/8/1b6/2N3N1/3P4/4K3 w - - 0 1"
+		<< "Ne4";
+	QTest::newRow("ambiguous rook")
+		<< "standard"
+		<< "3k4/8/8/8/8/4K3/8/R6R w - - 0 1"
+		<< "Rd1";
+	QTest::newRow("pinned knight")
+		<< "standard"
+		<< "4k3/8/8/8/1b6/2N3N1/8/4K3 w - - 0 1"
+		<< "Nce4";
+	QTest::newRow("no such piece")
+		<< "standard"
+		<< "4k3/8/8/8/1b6/2N3N1/8/4K3 w - - 0 1"
+		<< "Be4";
+}
+
+void tst_Board::invalidMoveStrings()
+{
+	QFETCH(QString, variant);
+	QFETCH(QString, fen);
+	QFETCH(QString, move);
+
+	setVariant(variant);
+	QVERIFY(m_board->setFenString(fen));
+	QVERIFY(m_board->moveFromString(move).isNull());
+}
+
 void tst_Board::results_data() const
 {
 	QTest::addColumn<QString>("variant");
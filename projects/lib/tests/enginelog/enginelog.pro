@@ -0,0 +1,4 @@
+include(../tests.pri)
+
+TARGET = tst_enginelog
+SOURCES += tst_enginelog.cpp
@@ -0,0 +1,107 @@
+#include <QtTest/QtTest>
+#include <QTemporaryDir>
+#include <enginelog.h>
+
+
+class tst_EngineLog: public QObject
+{
+	Q_OBJECT
+
+	private slots:
+		void perEngine() const;
+		void perGame() const;
+		void dropped() const;
+
+	private:
+		static QStringList readLines(const QString& fileName);
+};
+
+
+QStringList tst_EngineLog::readLines(const QString& fileName)
+{
+	QFile file(fileName);
+	if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+		return QStringList();
+	return QString(file.readAll()).split('\n', QString::SkipEmptyParts);
+}
+
+void tst_EngineLog::perEngine() const
+{
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+
+	EngineLog log(dir.path(), EngineLog::PerEngine);
+	QVERIFY(log.activate());
+	QCOMPARE(EngineLog::active(), &log);
+
+	log.addName(3, "engine");
+	log.addLine(3, EngineLog::ToEngine, "uci");
+	log.addLine(4, EngineLog::ToEngine, "xboard");
+	log.addLine(3, EngineLog::FromEngine, "uciok");
+	log.finish();
+	QVERIFY(EngineLog::active() == nullptr);
+
+	QStringList lines = readLines(dir.filePath("engine-3.log"));
+	QCOMPARE(lines.size(), 2);
+	QVERIFY(lines.at(0).endsWith(" >engine(3): uci"));
+	QVERIFY(lines.at(1).endsWith(" <engine(3): uciok"));
+
+	lines = readLines(dir.filePath("engine-4.log"));
+	QCOMPARE(lines.size(), 1);
+	QVERIFY(lines.at(0).endsWith(" >(4): xboard"));
+}
+
+void tst_EngineLog::perGame() const
+{
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+
+	EngineLog log(dir.path(), EngineLog::PerGame);
+	QVERIFY(log.activate());
+
+	int key = 0;
+	log.addLine(1, EngineLog::ToEngine, "uci");
+	log.addGame(1, &key);
+	log.addLine(1, EngineLog::ToEngine, "ucinewgame");
+	log.addGame(2, &key);
+	log.addLine(2, EngineLog::ToEngine, "new");
+
+	// A new game that reuses the key of a finished game
+	log.addGame(2, &key);
+	log.addLine(2, EngineLog::ToEngine, "new");
+	log.finish();
+
+	QCOMPARE(readLines(dir.filePath("engines.log")).size(), 1);
+	QCOMPARE(readLines(dir.filePath("game-1.log")).size(), 2);
+	QCOMPARE(readLines(dir.filePath("game-2.log")).size(), 1);
+}
+
+void tst_EngineLog::dropped() const
+{
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+
+	// The writer isn't running yet, so the buffer fills up
+	EngineLog log(dir.path(), EngineLog::PerEngine, 4);
+	for (int i = 0; i < 6; i++)
+		QCOMPARE(log.addLine(1, EngineLog::FromEngine,
+				     QByteArray::number(i)), i < 4);
+	QCOMPARE(log.droppedCount(), 2u);
+
+	// The engines resend the control records that don't fit
+	int key = 0;
+	QVERIFY(!log.addName(1, "engine"));
+	QVERIFY(!log.addGame(1, &key));
+	QCOMPARE(log.droppedCount(), 4u);
+
+	QVERIFY(log.activate());
+	log.finish();
+
+	const QStringList lines = readLines(dir.filePath("engine-1.log"));
+	QCOMPARE(lines.size(), 5);
+	QVERIFY(lines.at(3).endsWith(": 3"));
+	QVERIFY(lines.at(4).contains("4 lines dropped"));
+}
+
+QTEST_MAIN(tst_EngineLog)
+#include "tst_enginelog.moc"
@@ -0,0 +1,4 @@
+include(../tests.pri)
+
+TARGET = tst_gzipfile
+SOURCES += tst_gzipfile.cpp
@@ -0,0 +1,193 @@
+#include <QtTest/QtTest>
+#include <QTemporaryDir>
+#include <gzipfile.h>
+#include <gamewriter.h>
+
+
+class tst_GzipFile: public QObject
+{
+	Q_OBJECT
+
+	private slots:
+		void readWrite() const;
+		void seek() const;
+		void plainFile() const;
+		void truncatedMember() const;
+		void truncatedHeader() const;
+		void corruptedData() const;
+		void writeOnly() const;
+
+	private:
+		static QString writeLines(const QString& fileName, int count);
+};
+
+
+QString tst_GzipFile::writeLines(const QString& fileName, int count)
+{
+	QString text;
+
+	GameWriter writer;
+	writer.setFrameSize(3);
+	for (int i = 0; i < count; i++)
+	{
+		const QString line = QString("line %1").arg(i);
+		writer.writeLine(fileName, line);
+		text += line + '\n';
+	}
+	writer.finish();
+
+	return text;
+}
+
+void tst_GzipFile::readWrite() const
+{
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+
+	const QString fileName = dir.filePath("lines.epd.gz");
+	const QString text = writeLines(fileName, 10);
+	QVERIFY(GzipFile::isCompressed(fileName));
+
+	GzipFile file(fileName);
+	QVERIFY(file.open(QIODevice::ReadOnly));
+	QVERIFY(!file.atEnd());
+
+	// The uncompressed size doesn't move the read position
+	QCOMPARE(file.size(), qint64(text.size()));
+	QCOMPARE(file.pos(), qint64(0));
+	QCOMPARE(QString(file.readAll()), text);
+	QVERIFY(file.atEnd());
+	QCOMPARE(file.pos(), qint64(text.size()));
+	QCOMPARE(file.compressedPos(), QFileInfo(fileName).size());
+}
+
+void tst_GzipFile::seek() const
+{
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+
+	const QString fileName = dir.filePath("lines.epd.gz");
+	const QString text = writeLines(fileName, 100);
+
+	GzipFile file(fileName);
+	QVERIFY(file.open(QIODevice::ReadOnly));
+
+	// Forward, backward and across the compressed members
+	const qint64 positions[] = { 500, 7, 0, 770, 400 };
+	for (qint64 pos : positions)
+	{
+		QVERIFY(file.seek(pos));
+		QCOMPARE(file.pos(), pos);
+		QCOMPARE(QString(file.read(20)), text.mid(int(pos), 20));
+	}
+
+	QVERIFY(file.seek(text.size()));
+	QVERIFY(file.atEnd());
+	QVERIFY(!file.seek(text.size() + 1));
+}
+
+void tst_GzipFile::plainFile() const
+{
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+
+	const QString fileName = dir.filePath("lines.epd");
+	const QString text = writeLines(fileName, 5);
+	QVERIFY(!GzipFile::isCompressed(fileName));
+
+	QIODevice* file = GzipFile::openFile(fileName);
+	QVERIFY(file != nullptr);
+	QVERIFY(qobject_cast<GzipFile*>(file) == nullptr);
+	QCOMPARE(QString(file->readAll()), text);
+	delete file;
+}
+
+void tst_GzipFile::truncatedMember() const
+{
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+
+	// Cut the file in the middle of a member, like a crash while
+	// the writer appends to it
+	const QString fileName = dir.filePath("lines.epd.gz");
+	const QString text = writeLines(fileName, 100);
+	QVERIFY(QFile::resize(fileName, QFileInfo(fileName).size() / 2));
+
+	GzipFile file(fileName);
+	QVERIFY(file.open(QIODevice::ReadOnly));
+	const qint64 size = file.size();
+	const QString read(file.readAll());
+	QVERIFY(!read.isEmpty());
+	QVERIFY(read.size() < text.size());
+	QVERIFY(text.startsWith(read));
+	QCOMPARE(size, qint64(read.size()));
+	QVERIFY(file.atEnd());
+}
+
+void tst_GzipFile::truncatedHeader() const
+{
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+
+	// Only the signature of the first member
+	const QString fileName = dir.filePath("empty.epd.gz");
+	QFile out(fileName);
+	QVERIFY(out.open(QIODevice::WriteOnly));
+	out.write(GzipFile::compress("line\n").left(4));
+	out.close();
+	QVERIFY(GzipFile::isCompressed(fileName));
+
+	GzipFile file(fileName);
+	QVERIFY(file.open(QIODevice::ReadOnly));
+	QVERIFY(file.atEnd());
+	QVERIFY(file.readAll().isEmpty());
+	QCOMPARE(file.size(), qint64(0));
+	QVERIFY(!file.seek(1));
+}
+
+void tst_GzipFile::corruptedData() const
+{
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+
+	QByteArray text;
+	for (int i = 0; i < 1000; i++)
+		text += "line " + QByteArray::number(i) + '\n';
+
+	// The CRC in the member's trailer catches the damage even if
+	// the deflate data is still decodable
+	QByteArray data = GzipFile::compress(text);
+	QVERIFY(!data.isEmpty());
+	data[data.size() / 2] = char(data.at(data.size() / 2) ^ 0xff);
+
+	const QString fileName = dir.filePath("bad.epd.gz");
+	QFile out(fileName);
+	QVERIFY(out.open(QIODevice::WriteOnly));
+	out.write(data);
+	out.close();
+
+	GzipFile file(fileName);
+	QVERIFY(file.open(QIODevice::ReadOnly));
+	QVERIFY(file.readAll() != text);
+	QCOMPARE(file.errorString(), QString("Corrupted compressed data"));
+	QVERIFY(file.atEnd());
+}
+
+void tst_GzipFile::writeOnly() const
+{
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+
+	const QString fileName = dir.filePath("lines.epd.gz");
+	writeLines(fileName, 5);
+
+	GzipFile file(fileName);
+	QVERIFY(!file.open(QIODevice::WriteOnly));
+	QVERIFY(!file.open(QIODevice::ReadWrite));
+	QVERIFY(!file.isOpen());
+	QVERIFY(GzipFile::openFile(fileName, QIODevice::Append) == nullptr);
+	QVERIFY(GzipFile::openFile(dir.filePath("missing.gz")) == nullptr);
+}
+
+QTEST_MAIN(tst_GzipFile)
+#include "tst_gzipfile.moc"
@@ -0,0 +1,4 @@
+include(../tests.pri)
+
+TARGET = tst_npsmonitor
+SOURCES += tst_npsmonitor.cpp
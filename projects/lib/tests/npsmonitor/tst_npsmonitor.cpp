@@ -0,0 +1,87 @@
+#include <QtTest/QtTest>
+#include <npsmonitor.h>
+
+
+class tst_NpsMonitor: public QObject
+{
+	Q_OBJECT
+
+	private slots:
+		void baseline() const;
+		void slowSlot() const;
+		void playerStats() const;
+};
+
+
+void tst_NpsMonitor::baseline() const
+{
+	NpsMonitor monitor;
+	QVERIFY(monitor.isNull());
+	QVERIFY(!monitor.addSample(0, 0, 1000.0));
+	QCOMPARE(monitor.playerCount(), 0);
+
+	monitor.initialize(2, 0.9, NpsMonitor::Warn);
+	QVERIFY(!monitor.isNull());
+
+	// Baseline games are not compared to anything
+	QVERIFY(!monitor.addSample(0, 0, 1000.0));
+	QVERIFY(!monitor.addSample(0, 1, 100.0));
+	QCOMPARE(monitor.slotCount(), 0);
+	QCOMPARE(monitor.playerStats(0).baseline, 550.0);
+
+	// Engines that don't report their speed are ignored
+	QVERIFY(!monitor.addSample(1, 0, 0.0));
+	QCOMPARE(monitor.playerStats(1).count, 0);
+}
+
+void tst_NpsMonitor::slowSlot() const
+{
+	NpsMonitor monitor;
+	monitor.initialize(1, 0.8, NpsMonitor::Pause);
+	QCOMPARE(monitor.action(), NpsMonitor::Pause);
+
+	QVERIFY(!monitor.addSample(0, 0, 1000.0));
+	QVERIFY(!monitor.addSample(1, 1, 2000.0));
+
+	QVERIFY(!monitor.addSample(0, 0, 1000.0));
+	QVERIFY(!monitor.addSample(1, 0, 1900.0));
+	QVERIFY(!monitor.slotStats(0).isSlow);
+
+	// The alert is only raised once per slowdown
+	QVERIFY(monitor.addSample(0, 1, 500.0));
+	QVERIFY(monitor.slotStats(1).isSlow);
+	QVERIFY(!monitor.addSample(1, 1, 1000.0));
+
+	// The moving average recovers gradually
+	for (int i = 0; i < 3; i++)
+		QVERIFY(!monitor.addSample(0, 1, 1000.0));
+	QVERIFY(monitor.slotStats(1).isSlow);
+	QVERIFY(!monitor.addSample(0, 1, 1000.0));
+	QVERIFY(!monitor.slotStats(1).isSlow);
+	QVERIFY(monitor.addSample(1, 1, 200.0));
+
+	QCOMPARE(monitor.slotCount(), 2);
+	QCOMPARE(monitor.slotStats(0).count, 2);
+	QCOMPARE(monitor.slotStats(1).count, 7);
+}
+
+void tst_NpsMonitor::playerStats() const
+{
+	NpsMonitor monitor;
+	monitor.initialize(10, 0.85, NpsMonitor::Warn);
+
+	const double samples[] = { 900.0, 1100.0, 1000.0, 1200.0, 800.0 };
+	for (double nps : samples)
+		monitor.addSample(0, 0, nps);
+
+	NpsMonitor::PlayerStats stats = monitor.playerStats(0);
+	QCOMPARE(stats.count, 5);
+	QCOMPARE(stats.mean, 1000.0);
+	QVERIFY(qAbs(stats.stdev - 158.11) < 0.01);
+	QCOMPARE(stats.min, 800.0);
+	QCOMPARE(stats.max, 1200.0);
+	QCOMPARE(stats.baseline, 0.0);
+}
+
+QTEST_MAIN(tst_NpsMonitor)
+#include "tst_npsmonitor.moc"
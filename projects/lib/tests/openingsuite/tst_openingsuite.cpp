@@ -0,0 +1,339 @@
+#include <QtTest/QtTest>
+#include <QTemporaryDir>
+#include <openingsuite.h>
+#include <board/board.h>
+#include <board/boardfactory.h>
+#include <testfile.h>
+
+
+class tst_OpeningSuite: public QObject
+{
+	Q_OBJECT
+
+	private slots:
+		void cache() const;
+		void staleCache() const;
+		void corruptCache_data() const;
+		void corruptCache() const;
+		void index() const;
+
+	private:
+		quint64 key(const QString& fen, const QString& moves) const;
+};
+
+
+quint64 tst_OpeningSuite::key(const QString& fen, const QString& moves) const
+{
+	Chess::Board* board = Chess::BoardFactory::create("standard");
+	if (fen.isEmpty())
+		board->reset();
+	else
+		board->setFenString(fen);
+
+	const QStringList list = moves.split(' ');
+	for (const QString& move : list)
+		board->makeMove(board->moveFromString(move));
+
+	const quint64 key = board->key();
+	delete board;
+	return key;
+}
+
+void tst_OpeningSuite::cache() const
+{
+	const QString fen("4k3/8/8/8/8/8/8/4K2R w K - 0 1");
+	const QString badFen("4k3/8/8/8/8/8/4K3 w - - 0 1");
+	const QString gFen("4k3/8/8/8/8/8/8/R3K3 w Q - 0 1 G12.5");
+	const QByteArray pgn =
+		"[Event \"A\"]\n"
+		"\n"
+		"1. e4 e5 2. Nf3 Nc6 *\n"
+		"\n"
+		"[Event \"B\"]\n"
+		"[FEN \"" + fen.toLatin1() + "\"]\n"
+		"[SetUp \"1\"]\n"
+		"\n"
+		"1. O-O Kd7 *\n"
+		"\n"
+		"[Event \"C\"]\n"
+		"[Variant \"crazyhouse\"]\n"
+		"\n"
+		"1. e4 d5 2. exd5 Qxd5 3. P@c4 *\n"
+		"\n"
+		"[Event \"D\"]\n"
+		"[FEN \"" + badFen.toLatin1() + "\"]\n"
+		"[SetUp \"1\"]\n"
+		"\n"
+		"1. Kd2 *\n"
+		"\n"
+		"[Event \"E\"]\n"
+		"[FEN \"" + gFen.toLatin1() + "\"]\n"
+		"[SetUp \"1\"]\n"
+		"\n"
+		"1. O-O-O *\n";
+
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+	const QString fileName = dir.filePath("openings.pgn");
+	const QString cacheFileName = dir.filePath("openings.cache");
+
+	QVERIFY(writeFile(fileName, pgn));
+
+	OpeningSuite suite(fileName, OpeningSuite::PgnFormat);
+	suite.setCacheFile(cacheFileName, "standard");
+	QVERIFY(suite.initialize());
+	QVERIFY(suite.isCompiled());
+	QVERIFY(QFile::exists(cacheFileName));
+
+	OpeningSuite::Opening opening = suite.nextOpening(100);
+	QVERIFY(opening.isValid);
+	QVERIFY(opening.startingFen.isEmpty());
+	QCOMPARE(opening.moves.size(), 4);
+	QCOMPARE(opening.key, key(QString(), "e4 e5 Nf3 Nc6"));
+	QCOMPARE(opening.startingGResult, QString("G218.0"));
+
+	// The FEN is kept as written, and the G-result is the
+	// initial one if the FEN doesn't have it
+	opening = suite.nextOpening(100);
+	QVERIFY(opening.isValid);
+	QCOMPARE(opening.startingFen, fen);
+	QCOMPARE(opening.startingGResult, QString("G218.0"));
+	QCOMPARE(opening.moves.size(), 2);
+	QCOMPARE(opening.key, key(fen, "O-O Kd7"));
+
+	// The piece drop is illegal in standard chess
+	opening = suite.nextOpening(100);
+	QVERIFY(!opening.isValid);
+	QCOMPARE(opening.moves.size(), 4);
+
+	// An invalid FEN isn't replaced with the default position
+	opening = suite.nextOpening(100);
+	QVERIFY(!opening.isValid);
+	QCOMPARE(opening.startingFen, badFen);
+	QVERIFY(opening.startingGResult.isEmpty());
+	QVERIFY(opening.moves.isEmpty());
+
+	opening = suite.nextOpening(100);
+	QVERIFY(opening.isValid);
+	QCOMPARE(opening.startingFen, gFen);
+	QCOMPARE(opening.startingGResult, QString("G12.5"));
+	QCOMPARE(opening.moves.size(), 1);
+
+	// Wrap around and cut the opening short
+	opening = suite.nextOpening(2);
+	QVERIFY(opening.isValid);
+	QCOMPARE(opening.moves.size(), 2);
+	QCOMPARE(opening.key, quint64(0));
+
+	// The illegal drop is after the first four plies
+	opening = suite.nextOpening(100);
+	QVERIFY(opening.isValid);
+	opening = suite.nextOpening(4);
+	QVERIFY(opening.isValid);
+	QCOMPARE(opening.moves.size(), 4);
+	opening = suite.nextOpening(5);
+	QVERIFY(!opening.isValid);
+
+	// Load the cache, starting from the second opening
+	OpeningSuite suite2(fileName, OpeningSuite::PgnFormat,
+			    OpeningSuite::SequentialOrder, 1);
+	suite2.setCacheFile(cacheFileName, "standard");
+	QVERIFY(suite2.initialize());
+	QVERIFY(suite2.isCompiled());
+
+	PgnGame game = suite2.nextGame(100);
+	QCOMPARE(game.startingFenString(), fen);
+	QCOMPARE(game.moves().size(), 2);
+
+	// A different variant compiles the suite again
+	OpeningSuite suite3(fileName, OpeningSuite::PgnFormat,
+			    OpeningSuite::SequentialOrder, 2);
+	suite3.setCacheFile(cacheFileName, "crazyhouse");
+	QVERIFY(suite3.initialize());
+	QVERIFY(suite3.isCompiled());
+
+	opening = suite3.nextOpening(100);
+	QVERIFY(opening.isValid);
+	QCOMPARE(opening.moves.size(), 5);
+}
+
+void tst_OpeningSuite::staleCache() const
+{
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+	const QString fileName = dir.filePath("openings.pgn");
+	const QString cacheFileName = dir.filePath("openings.cache");
+
+	QVERIFY(writeFile(fileName, "[Event \"A\"]\n\n1. e4 *\n"));
+	{
+		OpeningSuite suite(fileName, OpeningSuite::PgnFormat);
+		suite.setCacheFile(cacheFileName, "standard");
+		QVERIFY(suite.initialize());
+		QCOMPARE(suite.nextOpening(100).key, key(QString(), "e4"));
+	}
+
+	// A suite of a different size
+	QVERIFY(writeFile(fileName, "[Event \"A\"]\n\n1. e4 e5 *\n"));
+	{
+		OpeningSuite suite(fileName, OpeningSuite::PgnFormat);
+		suite.setCacheFile(cacheFileName, "standard");
+		QVERIFY(suite.initialize());
+		QVERIFY(suite.isCompiled());
+		QCOMPARE(suite.nextOpening(100).key, key(QString(), "e4 e5"));
+	}
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
+	// A suite of the same size with a different modification time
+	QVERIFY(writeFile(fileName, "[Event \"A\"]\n\n1. d4 d5 *\n"));
+	{
+		QFile file(fileName);
+		QVERIFY(file.open(QIODevice::ReadWrite));
+		QVERIFY(file.setFileTime(QDateTime::currentDateTime().addDays(1),
+					 QFileDevice::FileModificationTime));
+	}
+	{
+		OpeningSuite suite(fileName, OpeningSuite::PgnFormat);
+		suite.setCacheFile(cacheFileName, "standard");
+		QVERIFY(suite.initialize());
+		QCOMPARE(suite.nextOpening(100).key, key(QString(), "d4 d5"));
+	}
+#endif
+
+	// Without the suite file the cache can't be validated
+	QVERIFY(QFile::remove(fileName));
+	OpeningSuite suite(fileName, OpeningSuite::PgnFormat);
+	suite.setCacheFile(cacheFileName, "standard");
+	QVERIFY(!suite.initialize());
+	QVERIFY(!suite.isCompiled());
+}
+
+void tst_OpeningSuite::corruptCache_data() const
+{
+	QTest::addColumn<int>("size");
+	QTest::addColumn<int>("offset");
+
+	// The cache header is 48 bytes. The first record follows it,
+	// with the move count at offset 28 of the record. A size of -1
+	// keeps the size, and an offset of -1 patches nothing.
+	QTest::newRow("partial header") << 40 << -1;
+	QTest::newRow("truncated") << 60 << -1;
+	QTest::newRow("version") << -1 << 4;
+	QTest::newRow("format") << -1 << 8;
+	QTest::newRow("opening count") << -1 << 12;
+	QTest::newRow("variant") << -1 << 40;
+	QTest::newRow("move count") << -1 << 48 + 28;
+}
+
+void tst_OpeningSuite::corruptCache() const
+{
+	QFETCH(int, size);
+	QFETCH(int, offset);
+
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+	const QString fileName = dir.filePath("openings.pgn");
+	const QString cacheFileName = dir.filePath("openings.cache");
+	QVERIFY(writeFile(fileName, "[Event \"A\"]\n\n1. e4 e5 2. Nf3 *\n"));
+
+	{
+		OpeningSuite suite(fileName, OpeningSuite::PgnFormat);
+		suite.setCacheFile(cacheFileName, "standard");
+		QVERIFY(suite.initialize());
+	}
+	const qint64 compiledSize = QFileInfo(cacheFileName).size();
+
+	if (size >= 0)
+		QVERIFY(QFile::resize(cacheFileName, size));
+	if (offset >= 0)
+		QVERIFY(patchFile(cacheFileName, offset, quint32(0x7fffffff)));
+
+	// The damaged cache is rejected and compiled again
+	OpeningSuite suite(fileName, OpeningSuite::PgnFormat);
+	suite.setCacheFile(cacheFileName, "standard");
+	QVERIFY(suite.initialize());
+	QVERIFY(suite.isCompiled());
+	QCOMPARE(QFileInfo(cacheFileName).size(), compiledSize);
+
+	const OpeningSuite::Opening opening = suite.nextOpening(100);
+	QVERIFY(opening.isValid);
+	QCOMPARE(opening.moves.size(), 3);
+	QCOMPARE(opening.key, key(QString(), "e4 e5 Nf3"));
+}
+
+void tst_OpeningSuite::index() const
+{
+	QStringList fens;
+	fens << "4k3/8/8/8/8/8/8/4K2R w K - 0 1"
+	     << "4k3/8/8/8/8/8/8/R3K3 w Q - 0 1"
+	     << "r3k3/8/8/8/8/8/8/4K3 b q - 0 1";
+
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+	const QString fileName = dir.filePath("openings.epd");
+	const QString indexFileName = dir.filePath("openings.idx");
+
+	QFile file(fileName);
+	QVERIFY(file.open(QIODevice::WriteOnly));
+	for (const QString& fen : qAsConst(fens))
+		file.write(fen.left(fen.lastIndexOf(" 0 1")).toLatin1() + "\n");
+	file.close();
+
+	// Start from the last opening and write the index
+	OpeningSuite suite(fileName, OpeningSuite::EpdFormat,
+			   OpeningSuite::SequentialOrder, 2);
+	suite.setIndexFile(indexFileName);
+	QVERIFY(suite.initialize());
+	QVERIFY(QFile::exists(indexFileName));
+	QCOMPARE(suite.nextGame(100).startingFenString(), fens.at(2));
+	QCOMPARE(suite.nextGame(100).startingFenString(), fens.at(0));
+
+	// Reuse the index without writing it again
+	const QDateTime modified = QFileInfo(indexFileName).lastModified();
+	OpeningSuite suite2(fileName, OpeningSuite::EpdFormat,
+			    OpeningSuite::SequentialOrder, 1);
+	suite2.setIndexFile(indexFileName);
+	QVERIFY(suite2.initialize());
+	QCOMPARE(QFileInfo(indexFileName).lastModified(), modified);
+	QCOMPARE(suite2.nextGame(100).startingFenString(), fens.at(1));
+
+	// Random order reads every opening from the index
+	OpeningSuite suite3(fileName, OpeningSuite::EpdFormat,
+			    OpeningSuite::RandomOrder);
+	suite3.setIndexFile(indexFileName);
+	QVERIFY(suite3.initialize());
+	QStringList found;
+	for (int i = 0; i < fens.size(); i++)
+		found << suite3.nextGame(100).startingFenString();
+	found.sort();
+	QStringList expected(fens);
+	expected.sort();
+	QCOMPARE(found, expected);
+
+	// An index cut inside its last position is replaced
+	const qint64 indexSize = QFileInfo(indexFileName).size();
+	QVERIFY(QFile::resize(indexFileName, indexSize - 8));
+
+	OpeningSuite suite4(fileName, OpeningSuite::EpdFormat,
+			    OpeningSuite::SequentialOrder, 2);
+	suite4.setIndexFile(indexFileName);
+	QVERIFY(suite4.initialize());
+	QCOMPARE(QFileInfo(indexFileName).size(), indexSize);
+	QCOMPARE(suite4.nextGame(100).startingFenString(), fens.at(2));
+
+	// An index of a suite that has grown since is stale, and the
+	// start index finds the new opening after it's rebuilt
+	fens << "4k3/8/8/8/8/8/8/4K2Q w - - 0 1";
+	QVERIFY(file.open(QIODevice::Append));
+	file.write(fens.last().left(fens.last().lastIndexOf(" 0 1")).toLatin1() + "\n");
+	file.close();
+
+	OpeningSuite suite5(fileName, OpeningSuite::EpdFormat,
+			    OpeningSuite::SequentialOrder, 3);
+	suite5.setIndexFile(indexFileName);
+	QVERIFY(suite5.initialize());
+	QVERIFY(QFileInfo(indexFileName).size() > indexSize);
+	QCOMPARE(suite5.nextGame(100).startingFenString(), fens.at(3));
+}
+
+QTEST_MAIN(tst_OpeningSuite)
+#include "tst_openingsuite.moc"
@@ -0,0 +1,4 @@
+include(../tests.pri)
+
+TARGET = tst_pgngameindex
+SOURCES += tst_pgngameindex.cpp
@@ -0,0 +1,350 @@
+#include <QtTest/QtTest>
+#include <QTemporaryDir>
+#include <pgnstream.h>
+#include <pgngameentry.h>
+#include <pgngameindex.h>
+#include <pgngamefilter.h>
+#include <testfile.h>
+
+namespace {
+
+QList<const PgnGameEntry*> readEntries(const QByteArray& pgn)
+{
+	QList<const PgnGameEntry*> entries;
+	PgnStream stream(&pgn);
+	for (;;)
+	{
+		PgnGameEntry* entry = new PgnGameEntry;
+		if (!entry->read(stream))
+		{
+			delete entry;
+			break;
+		}
+		entries << entry;
+	}
+
+	return entries;
+}
+
+} // anonymous namespace
+
+
+class tst_PgnGameIndex: public QObject
+{
+	Q_OBJECT
+
+	private slots:
+		void readWrite() const;
+		void truncated_data() const;
+		void truncated() const;
+		void badHeader_data() const;
+		void badHeader() const;
+		void badStringOffset() const;
+		void overlongString() const;
+		void emptyIndex() const;
+		void query() const;
+
+	private:
+		static bool writeTwoGameIndex(const QString& fileName);
+		static QVector<qint64> columnEnds(const QString& fileName);
+};
+
+
+bool tst_PgnGameIndex::writeTwoGameIndex(const QString& fileName)
+{
+	QList<const PgnGameEntry*> entries = readEntries(
+		"[Event \"Test\"]\n"
+		"[White \"Alpha\"]\n"
+		"\n"
+		"1. e4 *\n"
+		"\n"
+		"[Event \"Test\"]\n"
+		"[White \"Beta\"]\n"
+		"\n"
+		"1. d4 *\n");
+	const bool ok = entries.size() == 2
+		     && PgnGameIndex::write(fileName, entries);
+	qDeleteAll(entries);
+
+	return ok;
+}
+
+QVector<qint64> tst_PgnGameIndex::columnEnds(const QString& fileName)
+{
+	// The 32-byte header has the game count at offset 8, the tag
+	// count at 12 and the size of the string table at 16. The ends
+	// are those of the positions, the line numbers, the tags and the
+	// string table.
+	const QByteArray data = readFile(fileName);
+	const qint64 count = readValue<quint32>(data, 8);
+	const qint64 tagCount = readValue<quint32>(data, 12);
+	const qint64 stringsSize = readValue<quint32>(data, 16);
+
+	QVector<qint64> ends;
+	ends << 32 + count * 8;
+	ends << ends.last() + count * 8;
+	ends << ends.last() + count * tagCount * 4;
+	ends << ends.last() + stringsSize;
+	return ends;
+}
+
+
+void tst_PgnGameIndex::readWrite() const
+{
+	const QByteArray pgn =
+		"[Event \"Test\"]\n"
+		"[White \"Alpha\"]\n"
+		"[Black \"Beta\"]\n"
+		"[Result \"1-0\"]\n"
+		"\n"
+		"1. e4 e5 1-0\n"
+		"\n"
+		"[Event \"Test\"]\n"
+		"[White \"Beta\"]\n"
+		"[Black \"Alpha\"]\n"
+		"[Result \"1/2-1/2\"]\n"
+		"[Variant \"chess960\"]\n"
+		"\n"
+		"1. d4 d5 1/2-1/2\n";
+
+	QList<const PgnGameEntry*> entries = readEntries(pgn);
+	QCOMPARE(entries.size(), 2);
+
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+	const QString fileName = dir.filePath("games.idx");
+	QVERIFY(PgnGameIndex::write(fileName, entries));
+
+	PgnGameIndex index;
+	QVERIFY(index.open(fileName));
+	QCOMPARE(index.count(), entries.size());
+
+	for (int i = 0; i < entries.size(); i++)
+	{
+		const PgnGameEntry* expected = entries.at(i);
+		const PgnGameEntry entry = index.entry(i);
+
+		QCOMPARE(entry.pos(), expected->pos());
+		QCOMPARE(entry.lineNumber(), expected->lineNumber());
+		for (int tag = 0; tag <= PgnGameEntry::VariantTag; tag++)
+		{
+			const auto type = PgnGameEntry::TagType(tag);
+			QCOMPARE(entry.tagValue(type), expected->tagValue(type));
+		}
+	}
+	QCOMPARE(index.entry(1).tagValue(PgnGameEntry::WhiteTag), QString("Beta"));
+	QCOMPARE(index.entry(1).tagValue(PgnGameEntry::VariantTag), QString("chess960"));
+
+	index.close();
+	QVERIFY(!index.isOpen());
+	qDeleteAll(entries);
+}
+
+void tst_PgnGameIndex::truncated_data() const
+{
+	QTest::addColumn<int>("column");
+
+	// The file ends one byte short of the end of a column
+	QTest::newRow("positions") << 0;
+	QTest::newRow("line numbers") << 1;
+	QTest::newRow("tags") << 2;
+	QTest::newRow("strings") << 3;
+}
+
+void tst_PgnGameIndex::truncated() const
+{
+	QFETCH(int, column);
+
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+	const QString fileName = dir.filePath("games.idx");
+	QVERIFY(writeTwoGameIndex(fileName));
+
+	const QVector<qint64> ends = columnEnds(fileName);
+	QCOMPARE(ends.last(), QFileInfo(fileName).size());
+	QVERIFY(QFile::resize(fileName, ends.at(column) - 1));
+
+	PgnGameIndex index;
+	QVERIFY(!index.open(fileName));
+	QVERIFY(!index.isOpen());
+	QCOMPARE(index.count(), 0);
+}
+
+void tst_PgnGameIndex::badHeader_data() const
+{
+	QTest::addColumn<int>("offset");
+	QTest::addColumn<quint32>("value");
+
+	// The index has two games, so a game count of 1 or 3 gives
+	// columns that don't add up to the size of the file
+	QTest::newRow("magic") << 0 << quint32(0);
+	QTest::newRow("version") << 4 << quint32(2);
+	QTest::newRow("fewer games") << 8 << quint32(1);
+	QTest::newRow("more games") << 8 << quint32(3);
+	QTest::newRow("huge game count") << 8 << quint32(0xffffffff);
+	QTest::newRow("tag count") << 12 << quint32(PgnGameEntry::VariantTag);
+	QTest::newRow("strings size") << 16 << quint32(0);
+}
+
+void tst_PgnGameIndex::badHeader() const
+{
+	QFETCH(int, offset);
+	QFETCH(quint32, value);
+
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+	const QString fileName = dir.filePath("games.idx");
+	QVERIFY(writeTwoGameIndex(fileName));
+	QVERIFY(patchFile(fileName, offset, value));
+
+	PgnGameIndex index;
+	QVERIFY(!index.open(fileName));
+	QVERIFY(!index.isOpen());
+	QVERIFY(!index.open(dir.filePath("missing.idx")));
+}
+
+void tst_PgnGameIndex::badStringOffset() const
+{
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+	const QString fileName = dir.filePath("games.idx");
+	QVERIFY(writeTwoGameIndex(fileName));
+
+	// The first tag column is the Event tag
+	const QVector<qint64> ends = columnEnds(fileName);
+	QVERIFY(patchFile(fileName, ends.at(1), quint32(0xfffffff0)));
+
+	// The size still matches, so the index opens, but the tag
+	// points outside the strings and reads as empty
+	PgnGameIndex index;
+	QVERIFY(index.open(fileName));
+	QCOMPARE(index.count(), 2);
+	QVERIFY(index.entry(0).tagValue(PgnGameEntry::EventTag).isEmpty());
+	QCOMPARE(index.entry(0).tagValue(PgnGameEntry::WhiteTag), QString("Alpha"));
+	QCOMPARE(index.entry(1).tagValue(PgnGameEntry::EventTag), QString("Test"));
+
+	PgnGameFilter filter;
+	filter.setEvent("test");
+	const PgnGameIndex::Query query = index.query(filter);
+	QVERIFY(!query.mayMatch(0));
+	QVERIFY(query.mayMatch(1));
+}
+
+void tst_PgnGameIndex::overlongString() const
+{
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+	const QString fileName = dir.filePath("games.idx");
+	QVERIFY(writeTwoGameIndex(fileName));
+
+	// The first string of the table is the shared Event tag "Test".
+	// A length byte that runs past the end of the table must not be
+	// read, neither by the entries nor by the string search.
+	const QVector<qint64> ends = columnEnds(fileName);
+	QCOMPARE(readValue<quint8>(readFile(fileName), int(ends.at(2))), quint8(4));
+	QVERIFY(patchFile(fileName, ends.at(2), quint8(0xff)));
+
+	PgnGameIndex index;
+	QVERIFY(index.open(fileName));
+	QVERIFY(index.entry(0).tagValue(PgnGameEntry::EventTag).isEmpty());
+	QVERIFY(index.entry(1).tagValue(PgnGameEntry::EventTag).isEmpty());
+	QCOMPARE(index.entry(1).tagValue(PgnGameEntry::WhiteTag), QString("Beta"));
+
+	PgnGameFilter filter;
+	filter.setEvent("test");
+	const PgnGameIndex::Query query = index.query(filter);
+	QVERIFY(!query.mayMatch(0));
+	QVERIFY(!query.mayMatch(1));
+}
+
+void tst_PgnGameIndex::emptyIndex() const
+{
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+	const QString fileName = dir.filePath("empty.idx");
+	QVERIFY(PgnGameIndex::write(fileName, QList<const PgnGameEntry*>()));
+
+	PgnGameIndex index;
+	QVERIFY(index.open(fileName));
+	QCOMPARE(index.count(), 0);
+	index.query(PgnGameFilter("alpha"));
+}
+
+void tst_PgnGameIndex::query() const
+{
+	const QByteArray pgn =
+		"[Event \"Test Cup\"]\n"
+		"[White \"Alpha\"]\n"
+		"[Black \"Beta\"]\n"
+		"[Result \"1-0\"]\n"
+		"\n"
+		"1. e4 e5 1-0\n"
+		"\n"
+		"[Event \"Test Cup\"]\n"
+		"[White \"Beta\"]\n"
+		"[Black \"Alpha\"]\n"
+		"[Result \"1/2-1/2\"]\n"
+		"\n"
+		"1. d4 d5 1/2-1/2\n"
+		"\n"
+		"[Event \"Open\"]\n"
+		"[Site \"Helsinki\"]\n"
+		"[White \"Gamma\"]\n"
+		"[Black \"Alpha\"]\n"
+		"[Result \"0-1\"]\n"
+		"\n"
+		"1. c4 c5 0-1\n";
+
+	QList<const PgnGameEntry*> entries = readEntries(pgn);
+	QCOMPARE(entries.size(), 3);
+
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+	const QString fileName = dir.filePath("games.idx");
+	QVERIFY(PgnGameIndex::write(fileName, entries));
+
+	PgnGameIndex index;
+	QVERIFY(index.open(fileName));
+
+	auto games = [&](const PgnGameFilter& filter)
+	{
+		const PgnGameIndex::Query query = index.query(filter);
+		QList<int> ret;
+		for (int i = 0; i < index.count(); i++)
+		{
+			if (query.mayMatch(i) && index.entry(i).match(filter))
+				ret << i;
+		}
+		return ret;
+	};
+
+	PgnGameFilter filter;
+	QCOMPARE(games(filter), QList<int>({ 0, 1, 2 }));
+	QCOMPARE(games(PgnGameFilter("alpha")), QList<int>({ 0, 1, 2 }));
+	QCOMPARE(games(PgnGameFilter("helsinki")), QList<int>({ 2 }));
+	QCOMPARE(games(PgnGameFilter("delta")), QList<int>());
+
+	filter.setEvent("cup");
+	QCOMPARE(games(filter), QList<int>({ 0, 1 }));
+
+	filter = PgnGameFilter();
+	filter.setPlayer("alpha", Chess::Side::White);
+	QCOMPARE(games(filter), QList<int>({ 0 }));
+	filter.setPlayer("alpha", Chess::Side::Black);
+	QCOMPARE(games(filter), QList<int>({ 1, 2 }));
+	filter.setOpponent("gamma");
+	QCOMPARE(games(filter), QList<int>({ 2 }));
+
+	filter = PgnGameFilter();
+	filter.setPlayer("beta", Chess::Side::NoSide);
+	filter.setOpponent("alpha");
+	QCOMPARE(games(filter), QList<int>({ 0, 1 }));
+	filter.setEvent("open");
+	QCOMPARE(games(filter), QList<int>());
+
+	index.close();
+	qDeleteAll(entries);
+}
+
+QTEST_MAIN(tst_PgnGameIndex)
+#include "tst_pgngameindex.moc"
@@ -0,0 +1,185 @@
+#include <QtTest/QtTest>
+#include <QTemporaryDir>
+#include <pgnstream.h>
+#include <testfile.h>
+
+
+class tst_PgnStream: public QObject
+{
+	Q_OBJECT
+
+	private slots:
+		void crlfTextMode() const;
+		void seekRoundTrip_data() const;
+		void seekRoundTrip() const;
+		void posAfterSeek() const;
+
+	private:
+		static QByteArray games(int count, const QByteArray& newline,
+					QVector<qint64>* offsets);
+};
+
+QByteArray tst_PgnStream::games(int count,
+				const QByteArray& newline,
+				QVector<qint64>* offsets)
+{
+	// Every game takes four lines, so game i starts on line 4 * i + 1
+	QByteArray data;
+	for (int i = 0; i < count; i++)
+	{
+		offsets->append(data.size());
+		data += "[Event \"" + QByteArray::number(i) + "\"]" + newline
+		      + newline
+		      + "1. e4 *" + newline
+		      + newline;
+	}
+
+	return data;
+}
+
+void tst_PgnStream::crlfTextMode() const
+{
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+
+	const QByteArray data("[Event \"a\"]\r\n"
+			      "[Site \"b\"]\r\n"
+			      "\r\n"
+			      "{first\r\nsecond} 1. e4 e5 *\r\n");
+	const QString fileName = dir.filePath("crlf.pgn");
+	QVERIFY(writeFile(fileName, data));
+
+	QFile file(fileName);
+	QVERIFY(file.open(QIODevice::ReadOnly | QIODevice::Text));
+	PgnStream stream(&file);
+
+	QVERIFY(stream.nextGame());
+	QCOMPARE(stream.readNext(), PgnStream::PgnTag);
+	QCOMPARE(stream.tagValue(), QByteArray("a"));
+	QCOMPARE(stream.readNext(), PgnStream::PgnTag);
+	QCOMPARE(stream.tagValue(), QByteArray("b"));
+	QCOMPARE(stream.lineNumber(), qint64(2));
+
+	// The carriage returns are removed from the tokens
+	QCOMPARE(stream.readNext(), PgnStream::PgnComment);
+	QCOMPARE(stream.tokenString(), QByteArray("first\nsecond"));
+	QCOMPARE(stream.lineNumber(), qint64(5));
+	QCOMPARE(stream.readNext(), PgnStream::PgnMoveNumber);
+	QCOMPARE(stream.readNext(), PgnStream::PgnMove);
+	QCOMPARE(stream.tokenString(), QByteArray("e4"));
+	QCOMPARE(stream.readNext(), PgnStream::PgnMove);
+	QCOMPARE(stream.tokenString(), QByteArray("e5"));
+	QCOMPARE(stream.readNext(), PgnStream::PgnResult);
+
+	// But the positions are offsets in the file
+	QCOMPARE(stream.pos(), qint64(data.indexOf('*') + 1));
+
+	QVERIFY(stream.seek(data.indexOf("[Site"), 2));
+	QCOMPARE(stream.pos(), qint64(data.indexOf("[Site")));
+	QVERIFY(stream.nextGame());
+	QCOMPARE(stream.readNext(), PgnStream::PgnTag);
+	QCOMPARE(stream.tagValue(), QByteArray("b"));
+	QCOMPARE(stream.lineNumber(), qint64(2));
+}
+
+void tst_PgnStream::seekRoundTrip_data() const
+{
+	QTest::addColumn<QByteArray>("newline");
+	QTest::addColumn<bool>("textMode");
+
+	QTest::newRow("lf") << QByteArray("\n") << false;
+	QTest::newRow("crlf") << QByteArray("\r\n") << true;
+}
+
+void tst_PgnStream::seekRoundTrip() const
+{
+	QFETCH(QByteArray, newline);
+	QFETCH(bool, textMode);
+
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+
+	// Several 64 KiB blocks of games
+	QVector<qint64> offsets;
+	const QByteArray data = games(8000, newline, &offsets);
+	QVERIFY(data.size() > 3 * 65536);
+	const QString fileName = dir.filePath("games.pgn");
+	QVERIFY(writeFile(fileName, data));
+
+	QFile file(fileName);
+	QIODevice::OpenMode mode = QIODevice::ReadOnly;
+	if (textMode)
+		mode |= QIODevice::Text;
+	QVERIFY(file.open(mode));
+	PgnStream stream(&file);
+
+	// Reading forward reports the offset and line of every game
+	QVector<qint64> positions;
+	while (stream.nextGame())
+	{
+		positions.append(stream.pos());
+		QCOMPARE(stream.readNext(), PgnStream::PgnTag);
+		QCOMPARE(stream.lineNumber(), qint64(4 * (positions.size() - 1) + 1));
+		while (stream.readNext() != PgnStream::NoToken)
+			;
+	}
+	QCOMPARE(positions, offsets);
+
+	// Seeking back to a reported position continues from the same
+	// game, inside the current block and across the block boundaries
+	int boundary = 0;
+	while (offsets.at(boundary + 1) < 65536)
+		boundary++;
+	const int targets[] = {
+		offsets.size() - 1, offsets.size() - 2, 0, boundary,
+		boundary + 1, 5000, 17, boundary - 1
+	};
+	for (int i : targets)
+	{
+		const qint64 line = 4 * i + 1;
+		QVERIFY(stream.seek(positions.at(i), line));
+		QCOMPARE(stream.pos(), positions.at(i));
+		QCOMPARE(stream.lineNumber(), line);
+
+		QVERIFY(stream.nextGame());
+		QCOMPARE(stream.pos(), positions.at(i));
+		QCOMPARE(stream.readNext(), PgnStream::PgnTag);
+		QCOMPARE(stream.tagValue(), QByteArray::number(i));
+		QCOMPARE(stream.readNext(), PgnStream::PgnMoveNumber);
+		QCOMPARE(stream.lineNumber(), line + 2);
+	}
+}
+
+void tst_PgnStream::posAfterSeek() const
+{
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+
+	QVector<qint64> offsets;
+	const QByteArray data = games(4000, "\n", &offsets);
+	const QString fileName = dir.filePath("games.pgn");
+	QVERIFY(writeFile(fileName, data));
+
+	QFile file(fileName);
+	QVERIFY(file.open(QIODevice::ReadOnly));
+	PgnStream stream(&file);
+
+	// A position outside the buffer is read from the device, and
+	// pos() must report it before anything is read
+	QVERIFY(stream.seek(offsets.at(3000), 12001));
+	QCOMPARE(stream.pos(), offsets.at(3000));
+	QCOMPARE(stream.lineNumber(), qint64(12001));
+	QVERIFY(stream.seek(offsets.at(1), 5));
+	QCOMPARE(stream.pos(), offsets.at(1));
+
+	QCOMPARE(stream.readChar(), '[');
+	QCOMPARE(stream.pos(), offsets.at(1) + 1);
+
+	// The line number doesn't depend on the position
+	QVERIFY(stream.seek(offsets.at(2)));
+	QCOMPARE(stream.lineNumber(), qint64(1));
+	QVERIFY(!stream.seek(-1));
+}
+
+QTEST_MAIN(tst_PgnStream)
+#include "tst_pgnstream.moc"
@@ -1,6 +1,8 @@
 #include <QtTest/QtTest>
 #include <QMap>
+#include <QTemporaryDir>
 #include <polyglotbook.h>
+#include <pgnstream.h>
 #include <board/standardboard.h>
 
 class tst_PolyglotBook: public QObject
@@ -10,6 +12,7 @@ class tst_PolyglotBook: public QObject
 	private slots:
 		void initialValues();
 		void startPos();
+		void importFile();
 
 	private:
 		QMap<QString,quint16> entries(const OpeningBook* book,
@@ -72,6 +75,72 @@ void tst_PolyglotBook::startPos()
 
 	entries = this->entries(&book, &board);
 	QCOMPARE(entries, expect);
+
+	// Same test with a shared memory-mapped book
+	book = PolyglotBook(OpeningBook::Mapped);
+	QVERIFY(book.read("book_small.bin"));
+
+	entries = this->entries(&book, &board);
+	QCOMPARE(entries, expect);
+
+	auto book2 = PolyglotBook(OpeningBook::Mapped);
+	QVERIFY(book2.read("book_small.bin"));
+	QCOMPARE(this->entries(&book2, &board), expect);
+	QVERIFY(book2.entries(1234).isEmpty());
+}
+
+void tst_PolyglotBook::importFile()
+{
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+	const QString pgnFileName = dir.filePath("games.pgn");
+	const QString bookFileName = dir.filePath("book.bin");
+
+	// Enough games for more than one thread
+	QFile file(pgnFileName);
+	QVERIFY(file.open(QIODevice::WriteOnly));
+	for (int i = 0; i < 600; i++)
+	{
+		if (i % 3 == 0)
+			file.write("[Result \"1-0\"]\n\n1. e4 e5 2. Nf3 Nc6 1-0\n\n");
+		else if (i % 3 == 1)
+			file.write("[Result \"1/2-1/2\"]\n\n1. d4 d5 1/2-1/2\n\n");
+		else
+			file.write("[Result \"0-1\"]\n\n1. e4 c5 0-1\n\n");
+	}
+	file.close();
+
+	auto book = PolyglotBook(OpeningBook::Ram);
+	const int moveCount = book.import(pgnFileName, 10, 2);
+
+	// Import the same games one by one
+	auto serialBook = PolyglotBook(OpeningBook::Ram);
+	QVERIFY(file.open(QIODevice::ReadOnly | QIODevice::Text));
+	PgnStream stream(&file);
+	QCOMPARE(serialBook.import(stream, 10), moveCount);
+	file.close();
+
+	QMap<QString,quint16> expect;
+	expect["e4"] = 400;
+	expect["d4"] = 200;
+
+	Chess::StandardBoard board;
+	board.initialize();
+	board.setFenString(board.defaultFenString());
+	QCOMPARE(entries(&book, &board), expect);
+	QCOMPARE(entries(&serialBook, &board), expect);
+
+	QVERIFY(book.write(bookFileName));
+	auto mappedBook = PolyglotBook(OpeningBook::Mapped);
+	QVERIFY(mappedBook.read(bookFileName));
+	QCOMPARE(entries(&mappedBook, &board), expect);
+
+	board.makeMove(board.moveFromString("e4"));
+	expect.clear();
+	expect["c5"] = 400;
+	QCOMPARE(entries(&book, &board), expect);
+	QCOMPARE(entries(&mappedBook, &board), expect);
+	QCOMPARE(entries(&serialBook, &board), expect);
 }
 
 QTEST_MAIN(tst_PolyglotBook)
@@ -0,0 +1,247 @@
+#include <QtTest/QtTest>
+#include <QTemporaryDir>
+#include <positionindex.h>
+#include <gzipfile.h>
+#include <board/board.h>
+#include <board/boardfactory.h>
+#include <testfile.h>
+
+
+class tst_PositionIndex: public QObject
+{
+	Q_OBJECT
+
+	private slots:
+		void find() const;
+		void threadsAndCompression() const;
+		void truncated_data() const;
+		void truncated() const;
+		void badGameNumber() const;
+		void recordCountOverflow() const;
+};
+
+
+namespace {
+
+const QByteArray s_pgn =
+	"[Event \"Test\"]\n"
+	"\n"
+	"1. e4 e5 2. Nf3 Nc6 *\n"
+	"\n"
+	"[Event \"Test\"]\n"
+	"\n"
+	"1. d4 d5 2. Nf3 Nf6 *\n"
+	"\n"
+	"[Event \"Test\"]\n"
+	"\n"
+	"1. Nf3 Nf6 2. Ng1 Ng8 3. e4 *\n";
+
+// The 32-byte header has the game count at offset 8 and the record
+// count at offset 16. The game columns follow it, and the 16-byte
+// records of a key, a game and a ply come last.
+const int s_recordSize = 16;
+
+qint64 recordsStart(const QByteArray& index)
+{
+	return 32 + qint64(readValue<quint32>(index, 8)) * 2 * 8;
+}
+
+} // anonymous namespace
+
+
+void tst_PositionIndex::find() const
+{
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+	const QString pgnFileName = dir.filePath("games.pgn");
+	const QString fileName = dir.filePath("games.pos");
+	QVERIFY(writeFile(pgnFileName, s_pgn));
+
+	QVERIFY(PositionIndex::build(fileName, pgnFileName));
+
+	PositionIndex index;
+	QVERIFY(index.open(fileName));
+	QCOMPARE(index.gameCount(), 3);
+	QCOMPARE(index.gamePos(0), qint64(0));
+	QCOMPARE(index.gameLineNumber(2), qint64(9));
+
+	Chess::Board* board = Chess::BoardFactory::create("standard");
+	QVERIFY(board != nullptr);
+	board->reset();
+
+	// The third game returns to the starting position, which is
+	// only recorded at its first ply
+	QVector<PositionIndex::Match> matches = index.find(board->key());
+	QCOMPARE(matches.size(), 3);
+	for (int i = 0; i < matches.size(); i++)
+	{
+		QCOMPARE(matches.at(i).game, i);
+		QCOMPARE(matches.at(i).ply, 0);
+	}
+
+	board->makeMove(board->moveFromString("e4"));
+	matches = index.find(board->key());
+	QCOMPARE(matches.size(), 2);
+	QCOMPARE(matches.at(0).game, 0);
+	QCOMPARE(matches.at(0).ply, 1);
+	QCOMPARE(matches.at(1).game, 2);
+	QCOMPARE(matches.at(1).ply, 5);
+
+	// The final position of a game
+	board->reset();
+	const QStringList moves = QString("d4 d5 Nf3 Nf6").split(' ');
+	for (const QString& move : moves)
+		board->makeMove(board->moveFromString(move));
+	matches = index.find(board->key());
+	QCOMPARE(matches.size(), 1);
+	QCOMPARE(matches.at(0).game, 1);
+	QCOMPARE(matches.at(0).ply, 4);
+
+	board->makeMove(board->moveFromString("e3"));
+	QVERIFY(index.find(board->key()).isEmpty());
+
+	delete board;
+	index.close();
+	QVERIFY(index.find(0).isEmpty());
+}
+
+void tst_PositionIndex::threadsAndCompression() const
+{
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+	const QString pgnFileName = dir.filePath("games.pgn");
+	const QString gzFileName = dir.filePath("games.pgn.gz");
+
+	// Enough games to split the work between threads
+	QByteArray pgn;
+	for (int i = 0; i < 100; i++)
+		pgn += s_pgn + "\n";
+	QVERIFY(writeFile(pgnFileName, pgn));
+	QVERIFY(writeFile(gzFileName, GzipFile::compress(pgn)));
+
+	// The records are merged in key and game order, and the game
+	// positions of a compressed file are offsets in the uncompressed
+	// data, so every build gives the same file
+	const QString fileName = dir.filePath("games.pos");
+	QVERIFY(PositionIndex::build(fileName, pgnFileName, 1));
+	const QByteArray expected = readFile(fileName);
+	QVERIFY(!expected.isEmpty());
+
+	QVERIFY(PositionIndex::build(fileName, pgnFileName, 3));
+	QCOMPARE(readFile(fileName), expected);
+	QVERIFY(PositionIndex::build(fileName, gzFileName, 3));
+	QCOMPARE(readFile(fileName), expected);
+
+	QVERIFY(!PositionIndex::build(dir.filePath("missing.pos"),
+				      dir.filePath("missing.pgn")));
+	QVERIFY(!QFile::exists(dir.filePath("missing.pos")));
+}
+
+void tst_PositionIndex::truncated_data() const
+{
+	QTest::addColumn<int>("cut");
+
+	// Where the file is cut, or a whole record is added with -1
+	QTest::newRow("positions") << 0;
+	QTest::newRow("line numbers") << 1;
+	QTest::newRow("first record") << 2;
+	QTest::newRow("last record") << 3;
+	QTest::newRow("extra record") << -1;
+}
+
+void tst_PositionIndex::truncated() const
+{
+	QFETCH(int, cut);
+
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+	const QString pgnFileName = dir.filePath("games.pgn");
+	const QString fileName = dir.filePath("games.pos");
+	QVERIFY(writeFile(pgnFileName, s_pgn));
+	QVERIFY(PositionIndex::build(fileName, pgnFileName));
+
+	const QByteArray data = readFile(fileName);
+	const qint64 gameCount = readValue<quint32>(data, 8);
+	const qint64 recordCount = readValue<quint64>(data, 16);
+	const qint64 start = recordsStart(data);
+	QCOMPARE(gameCount, qint64(3));
+	QCOMPARE(start + recordCount * s_recordSize, qint64(data.size()));
+
+	// A file whose records don't match the counts of the header
+	const qint64 sizes[] = {
+		32 + gameCount * 8 - 1,
+		start - 1,
+		start + s_recordSize / 2,
+		data.size() - s_recordSize
+	};
+	if (cut >= 0)
+		QVERIFY(QFile::resize(fileName, sizes[cut]));
+	else
+		QVERIFY(writeFile(fileName, data + data.right(s_recordSize)));
+
+	PositionIndex index;
+	QVERIFY(!index.open(fileName));
+	QVERIFY(!index.isOpen());
+	QVERIFY(index.find(0).isEmpty());
+}
+
+void tst_PositionIndex::badGameNumber() const
+{
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+	const QString pgnFileName = dir.filePath("games.pgn");
+	const QString fileName = dir.filePath("games.pos");
+	QVERIFY(writeFile(pgnFileName, s_pgn));
+	QVERIFY(PositionIndex::build(fileName, pgnFileName));
+
+	Chess::Board* board = Chess::BoardFactory::create("standard");
+	QVERIFY(board != nullptr);
+	board->reset();
+	const quint64 key = board->key();
+	delete board;
+
+	// Point the starting position record of the second game to a
+	// game that doesn't exist
+	const QByteArray data = readFile(fileName);
+	qint64 pos = recordsStart(data);
+	for (; pos < data.size(); pos += s_recordSize)
+	{
+		if (readValue<quint64>(data, int(pos)) == key
+		&&  readValue<quint32>(data, int(pos) + 8) == 1)
+			break;
+	}
+	QVERIFY(pos < data.size());
+	QVERIFY(patchFile(fileName, pos + 8, quint32(3)));
+
+	// The size still matches, so the index opens, but the record
+	// is skipped
+	PositionIndex index;
+	QVERIFY(index.open(fileName));
+	const QVector<PositionIndex::Match> matches = index.find(key);
+	QCOMPARE(matches.size(), 2);
+	QCOMPARE(matches.at(0).game, 0);
+	QCOMPARE(matches.at(1).game, 2);
+}
+
+void tst_PositionIndex::recordCountOverflow() const
+{
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+	const QString pgnFileName = dir.filePath("games.pgn");
+	const QString fileName = dir.filePath("games.pos");
+	QVERIFY(writeFile(pgnFileName, s_pgn));
+	QVERIFY(PositionIndex::build(fileName, pgnFileName));
+
+	// A record count whose size in bytes overflows 64 bits must not
+	// wrap around to the size of the file
+	PositionIndex index;
+	QVERIFY(index.open(fileName));
+	const quint64 count = quint64(index.positionCount()) + (quint64(1) << 60);
+	index.close();
+
+	QVERIFY(patchFile(fileName, 16, count));
+	QVERIFY(!index.open(fileName));
+}
+
+QTEST_MAIN(tst_PositionIndex)
+#include "tst_positionindex.moc"
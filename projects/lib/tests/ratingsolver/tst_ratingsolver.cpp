@@ -0,0 +1,134 @@
+#include <QtTest/QtTest>
+#include <ratingsolver.h>
+#include <cmath>
+
+
+class tst_RatingSolver: public QObject
+{
+	Q_OBJECT
+
+	private slots:
+		void consistentResults() const;
+		void fractionalPoints() const;
+		void confidenceIntervals() const;
+		void perfectScore() const;
+		void warmStart() const;
+};
+
+
+static void addGames(RatingSolver& solver, int player1, int player2,
+		     int games, qreal points1)
+{
+	for (int i = 0; i < games; i++)
+		solver.addResult(player1, player2, i < points1 ? 1.0 : 0.0);
+}
+
+void tst_RatingSolver::consistentResults() const
+{
+	// Expected scores of 75%, 75% and 90% fit ratings that are
+	// 191 Elo apart
+	RatingSolver solver;
+	solver.setBootstrapCount(0);
+	addGames(solver, 0, 1, 10000, 7500);
+	addGames(solver, 2, 1, 10000, 2500);
+	addGames(solver, 0, 2, 10000, 9000);
+	QCOMPARE(solver.playerCount(), 3);
+	QCOMPARE(solver.gameCount(), 30000);
+
+	QVERIFY(solver.solve());
+	qreal diff = 400.0 * std::log10(3.0);
+	QVERIFY(qAbs(solver.rating(0).elo - diff) < 0.5);
+	QVERIFY(qAbs(solver.rating(1).elo) < 0.5);
+	QVERIFY(qAbs(solver.rating(2).elo + diff) < 0.5);
+	QCOMPARE(solver.rating(0).games, 20000);
+	QCOMPARE(solver.rating(0).points, 16500.0);
+
+	// Without bootstrapping the bounds equal the rating
+	QCOMPARE(solver.rating(0).lowerBound, solver.rating(0).elo);
+	QCOMPARE(solver.rating(0).upperBound, solver.rating(0).elo);
+}
+
+void tst_RatingSolver::fractionalPoints() const
+{
+	RatingSolver solver;
+	solver.setBootstrapCount(0);
+	for (int i = 0; i < 1000; i++)
+		solver.addResult(0, 1, 0.75);
+
+	QVERIFY(solver.solve());
+	qreal diff = solver.rating(0).elo - solver.rating(1).elo;
+	QVERIFY(qAbs(diff - 400.0 * std::log10(3.0)) < 1.0);
+	QCOMPARE(solver.rating(0).elo, -solver.rating(1).elo);
+}
+
+void tst_RatingSolver::confidenceIntervals() const
+{
+	RatingSolver solver;
+	solver.setBootstrapCount(50);
+	solver.setThreadCount(2);
+	addGames(solver, 0, 1, 200, 120);
+	addGames(solver, 1, 2, 200, 120);
+	addGames(solver, 0, 2, 200, 140);
+	QVERIFY(solver.solve());
+
+	for (int i = 0; i < 3; i++)
+	{
+		RatingSolver::Rating rating(solver.rating(i));
+		QVERIFY(rating.lowerBound < rating.elo);
+		QVERIFY(rating.upperBound > rating.elo);
+		QVERIFY(rating.upperBound - rating.lowerBound < 200.0);
+	}
+
+	// The bootstrap samples are repeatable
+	RatingSolver::Rating first(solver.rating(0));
+	QVERIFY(solver.solve());
+	QCOMPARE(solver.rating(0).lowerBound, first.lowerBound);
+	QCOMPARE(solver.rating(0).upperBound, first.upperBound);
+}
+
+void tst_RatingSolver::perfectScore() const
+{
+	// The virtual draws keep the ratings finite
+	RatingSolver solver;
+	solver.setBootstrapCount(0);
+	addGames(solver, 0, 1, 10, 10);
+	addGames(solver, 1, 2, 10, 5);
+
+	QVERIFY(solver.solve());
+	QVERIFY(solver.rating(0).elo > solver.rating(1).elo);
+	QVERIFY(solver.rating(0).elo < 1000.0);
+	QVERIFY(solver.rating(2).elo > -1000.0);
+}
+
+void tst_RatingSolver::warmStart() const
+{
+	RatingSolver solver;
+	solver.setBootstrapCount(0);
+	addGames(solver, 0, 1, 1000, 750);
+	addGames(solver, 1, 2, 1000, 600);
+	RatingSolver copy(solver);
+	RatingSolver limited(solver);
+
+	QVERIFY(solver.solve());
+	const int iterations = solver.iterationCount();
+	QVERIFY(iterations > 2);
+
+	// A copy that starts from the solution needs fewer iterations
+	copy.setInitialRatings(QVector<qreal>()
+			       << solver.rating(0).elo
+			       << solver.rating(1).elo
+			       << solver.rating(2).elo);
+	QVERIFY(copy.solve());
+	QVERIFY(copy.iterationCount() < iterations);
+	for (int i = 0; i < 3; i++)
+		QVERIFY(qAbs(copy.rating(i).elo - solver.rating(i).elo) < 0.01);
+
+	// The iteration limit stops the fit early
+	limited.setMaxIterations(2);
+	QVERIFY(!limited.solve());
+	QCOMPARE(limited.iterationCount(), 2);
+	QVERIFY(limited.rating(0).elo > limited.rating(2).elo);
+}
+
+QTEST_MAIN(tst_RatingSolver)
+#include "tst_ratingsolver.moc"
@@ -9,6 +9,8 @@ class tst_Sprt: public QObject
 	private slots:
 		void sprt_data() const;
 		void sprt();
+		void pentanomial_data() const;
+		void pentanomial();
 
 	private:
 		bool fuzzyCompare(double val1, double val2);
@@ -88,11 +90,11 @@ void tst_Sprt::sprt()
 	sprt.initialize(elo0, elo1, alpha, beta);
 
 	for (int i = 0; i < wins; i++)
-		sprt.addGameResult(Sprt::Win);
+		sprt.addGameResult(1.0);
 	for (int i = 0; i < losses; i++)
-		sprt.addGameResult(Sprt::Loss);
+		sprt.addGameResult(0.0);
 	for (int i = 0; i < draws; i++)
-		sprt.addGameResult(Sprt::Draw);
+		sprt.addGameResult(0.5);
 
 	Sprt::Status status = sprt.status();
 	QVERIFY(fuzzyCompare(status.llr, llr));
@@ -100,5 +102,64 @@ void tst_Sprt::sprt()
 	QVERIFY(fuzzyCompare(status.uBound, ubound));
 }
 
+void tst_Sprt::pentanomial_data() const
+{
+	QTest::addColumn<double>("elo0");
+	QTest::addColumn<double>("elo1");
+	QTest::addColumn<bool>("normalized");
+	QTest::addColumn< QList<int> >("pairs");
+	QTest::addColumn<double>("llr");
+
+	// Number of pairs with a pair score of 0, 0.25, 0.5, 0.75 and 1
+	QTest::newRow("logistic1")
+		<< 0.0
+		<< 10.0
+		<< false
+		<< (QList<int>() << 3 << 10 << 20 << 30 << 5)
+		<< 1.10;
+	QTest::newRow("logistic2")
+		<< 0.0
+		<< 10.0
+		<< false
+		<< (QList<int>() << 0 << 45 << 30 << 0 << 0)
+		<< -11.31;
+	QTest::newRow("normalized")
+		<< 0.0
+		<< 5.0
+		<< true
+		<< (QList<int>() << 3 << 10 << 20 << 30 << 5)
+		<< 0.39;
+}
+
+void tst_Sprt::pentanomial()
+{
+	QFETCH(double, elo0);
+	QFETCH(double, elo1);
+	QFETCH(bool, normalized);
+	QFETCH(QList<int>, pairs);
+	QFETCH(double, llr);
+
+	Sprt sprt;
+	sprt.initialize(elo0, elo1, 0.05, 0.05, Sprt::Pentanomial,
+			normalized ? Sprt::NormalizedElo : Sprt::LogisticElo);
+
+	// Each pair score is made of two games with the same total
+	for (int i = 0; i < pairs.size(); i++)
+	{
+		for (int j = 0; j < pairs.at(i); j++)
+			sprt.addGamePair(i * 0.25, i * 0.25);
+	}
+
+	int count = 0;
+	for (int n : qAsConst(pairs))
+		count += n;
+	QCOMPARE(sprt.pairCount(), count);
+
+	Sprt::Status status = sprt.status();
+	QVERIFY(fuzzyCompare(status.llr, llr));
+	QVERIFY(fuzzyCompare(status.lBound, -2.94));
+	QVERIFY(fuzzyCompare(status.uBound, 2.94));
+}
+
 QTEST_MAIN(tst_Sprt)
 #include "tst_sprt.moc"
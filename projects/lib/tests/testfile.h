@@ -0,0 +1,48 @@
+#ifndef TESTFILE_H
+#define TESTFILE_H
+
+#include <cstring>
+#include <QFile>
+#include <QByteArray>
+#include <QString>
+
+// Helpers for the tests that build files and damage them on purpose
+
+inline bool writeFile(const QString& fileName, const QByteArray& data)
+{
+	QFile file(fileName);
+	return file.open(QIODevice::WriteOnly)
+	    && file.write(data) == data.size();
+}
+
+inline QByteArray readFile(const QString& fileName)
+{
+	QFile file(fileName);
+	if (!file.open(QIODevice::ReadOnly))
+		return QByteArray();
+	return file.readAll();
+}
+
+// Overwrites the bytes of \a fileName at \a pos with \a value in the
+// byte order of the machine, like the mapped index files use
+template<typename T>
+bool patchFile(const QString& fileName, qint64 pos, T value)
+{
+	QFile file(fileName);
+	return file.open(QIODevice::ReadWrite)
+	    && file.seek(pos)
+	    && file.write(reinterpret_cast<const char*>(&value),
+			  sizeof(value)) == qint64(sizeof(value));
+}
+
+// Reads a value of type T from \a data at \a pos
+template<typename T>
+T readValue(const QByteArray& data, int pos)
+{
+	T value = T();
+	if (pos >= 0 && pos + int(sizeof(value)) <= data.size())
+		std::memcpy(&value, data.constData() + pos, sizeof(value));
+	return value;
+}
+
+#endif // TESTFILE_H
@@ -12,5 +12,9 @@ CONFIG += testcase
 include(../lib.pri)
 include(../libexport.pri)
 
+# Shared helpers for the file format tests
+INCLUDEPATH += $$PWD
+HEADERS += $$PWD/testfile.h
+
 OBJECTS_DIR = .obj
 MOC_DIR = .moc
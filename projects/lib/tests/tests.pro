@@ -1,5 +1,5 @@
 TEMPLATE = subdirs
-SUBDIRS = chessboard tb sprt mersenne tournamentplayer tournamentpair polyglotbook
+SUBDIRS = chessboard tb sprt mersenne tournamentplayer tournamentpair polyglotbook npsmonitor enginelog ratingsolver gzipfile pgngameindex positionindex openingsuite pgnstream
 win32 {
     SUBDIRS += pipereader
 }